@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <wchar.h>
+#include <stdint.h>
 
 typedef double btr_elem_t;
 
@@ -25,6 +26,7 @@ typedef enum
 	INVALID_INDEX              = 1 << 7,
 	PARENT_NODE_IS_FREE        = 1 << 8,
 	UNKNOWN_NODE_TYPE          = 1 << 9,
+	INVALID_AST_FILE           = 1 << 10,
 } error_t;
 
 
@@ -80,6 +82,10 @@ enum Std_func
 {
 	GETVAR,
 	PUTEXPR,
+	FILLRAM,
+	COPYRAM,
+	CMPRAM,
+	READRAM,
 };
 
 struct Node_value
@@ -87,6 +93,7 @@ struct Node_value
 	double       num_value;
 	Ops          op_value;
 	wchar_t 	*var_value;
+	size_t       sym_ID;
 	Std_func     func;
 };
 
@@ -110,6 +117,111 @@ struct Uni_ret
 	Second_arg arg;
 };
 
+struct Node_chunk
+{
+	Node_chunk  *next;
+	B_tree_node *nodes;
+	size_t       used;
+};
+
+/**
+ * @brief Pool the nodes are bump-allocated from while it is in use.
+ *
+ * The nodes come from chunks of chunk_size nodes, a released node goes to free_nodes
+ * (linked by its left child) and is given out again first.
+ */
+struct Node_arena
+{
+	Node_chunk  *chunks;
+	B_tree_node *free_nodes;
+	size_t       chunk_size;
+	size_t       nodes_amount;
+};
+
+union Compact_value
+{
+	uint32_t num_ID;
+	uint32_t sym_ID;
+	uint32_t op_value;
+	uint32_t func;
+};
+
+/**
+ * @brief Node of a Compact_tree, 16 bytes instead of the 48 of a B_tree_node.
+ *
+ * The children are indices into the node array, COMPACT_NULL is no child. The value is
+ * tagged by the type: NUM nodes keep the index of their number in the number pool, OP and
+ * UNR_OP the operation, STD_FUNC the function, and VAR, FUNC, CMD_FUNC and FUNC_DECL the
+ * interned ID of their name.
+ */
+struct Compact_node
+{
+	uint32_t      left;
+	uint32_t      right;
+	Compact_value value;
+	uint8_t       type;
+};
+
+/**
+ * @brief Tree kept in one array of nodes, the numbers and the names aside.
+ *
+ * pack_tree lays the nodes out in preorder, so a walk over the indices visits the parents
+ * before the children. names maps the interned IDs to the names, and the node 0 is reserved
+ * for COMPACT_NULL.
+ */
+struct Compact_tree
+{
+	Compact_node  *nodes;
+	size_t         size;
+	size_t         capacity;
+	btr_elem_t    *nums;
+	size_t         nums_size;
+	size_t         nums_capacity;
+	wchar_t      **names;
+	size_t         names_amount;
+	uint32_t       root;
+	void          *mapping;
+	size_t         mapping_size;
+};
+
+/**
+ * @brief Header of the binary tree file, the offsets count from the start of the file.
+ *
+ * The header is followed by the numbers, the nodes, an offset per name into the characters
+ * (AST_NO_NAME if the ID has no name) and the zero-terminated names. Every part is aligned
+ * to 8 bytes, so the file is used in place wherever it is mapped.
+ */
+struct Ast_header
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t wchar_size;
+	uint32_t root;
+	uint32_t nodes_amount;
+	uint32_t nums_amount;
+	uint32_t names_amount;
+	uint64_t nums_offset;
+	uint64_t nodes_offset;
+	uint64_t names_offset;
+	uint64_t chars_offset;
+	uint64_t file_size;
+};
+
+enum Visit_action
+{
+	VISIT_CONTINUE = 0,
+	VISIT_SKIP     = 1,
+	VISIT_STOP     = 2,
+};
+
+typedef Visit_action (*Node_visitor)(B_tree_node *node, void *context);
+
+struct Visit_item
+{
+	B_tree_node *node;
+	bool         children_done;
+};
+
 struct Node_charachteristics
 {
 	const char *name;
@@ -120,7 +232,14 @@ struct Node_charachteristics
 const size_t NODE_LABEL_STR_SIZE   = 1000;
 const size_t OP_TOKEN_SIZE 		   = 15;
 const size_t STD_FUNC_TOKEN_SIZE   = 100;
-const size_t GR_DUMP_GEN_CMD_SIZE  = 100;
+const size_t GR_DUMP_GEN_CMD_SIZE  = 200;
+const size_t GR_DUMP_BUF_SIZE      = 1 << 16;
+const size_t NODE_ARENA_CHUNK      = 4096;
+const uint32_t COMPACT_NULL        = 0;
+const size_t VISIT_STACK_INLINE    = 64;
+const char   AST_MAGIC[8]          = "TATAST";
+const uint32_t AST_FORMAT_VERSION  = 1;
+const uint32_t AST_NO_NAME         = UINT32_MAX;
 const bool   RIGHT_CHILD           = true;
 const bool   LEFT_CHILD            = false;
 
@@ -157,9 +276,103 @@ error_t destroy_subtree (B_tree_node *parent_node, bool is_right_child);
 
 error_t txt_dump        (B_tree_node *root, const char *name);
 
+/**
+ * @brief Writes the tree into b_tree_name.dot and starts dot rendering b_tree_name.png
+ * in the background.
+ */
 Uni_ret gr_dump_code_gen(B_tree_node *root, const char *b_tree_name);
 
 bool    cmp_nodes       (B_tree_node *node_1, B_tree_node *node_2);
 
+/**
+ * @brief Prepares an empty arena, chunk_size 0 means NODE_ARENA_CHUNK nodes per chunk.
+ */
+error_t arena_ctor      (Node_arena *arena, size_t chunk_size);
+
+/**
+ * @brief Frees every node of the arena at once, the trees built in it become invalid.
+ */
+void    arena_dtor      (Node_arena *arena);
+
+/**
+ * @brief Drops every node of the arena but keeps its newest chunk, so the next tree of the
+ * same size takes no memory from the heap.
+ */
+void    arena_reset     (Node_arena *arena);
+
+/**
+ * @brief Makes create_node take the nodes from arena, NULL brings back the heap.
+ *
+ * An arena must be in use before any node of a tree is created and until its last node
+ * is released, because a node is released the way it was allocated.
+ *
+ * @return Node_arena* The arena used before.
+ */
+Node_arena *use_arena   (Node_arena *arena);
+
+/**
+ * @brief Releases a single node without its children.
+ */
+void    release_node    (B_tree_node *node);
+
+/**
+ * @brief Releases every node under root without recursion, so any depth is fine.
+ */
+void    release_tree    (B_tree_node *root);
+
+/**
+ * @brief Walks the tree under root with an explicit stack, left child first.
+ *
+ * pre_visit gets a node before its children and post_visit after them, either may be NULL.
+ * VISIT_SKIP from pre_visit leaves the children out, VISIT_STOP from either ends the walk.
+ * post_visit may release its node. Without post_visit a node leaves the stack before its
+ * children, so a chain of right children takes a single stack item however long it is.
+ *
+ * @return error_t UNABLE_TO_ALLOCATE if the stack can't grow, the visitors keep their own errors.
+ */
+error_t visit_tree      (B_tree_node *root, Node_visitor pre_visit, Node_visitor post_visit,
+						 void *context);
+
+error_t compact_tree_ctor(Compact_tree *tree, size_t capacity);
+
+void    compact_tree_dtor(Compact_tree *tree);
+
+/**
+ * @brief Appends a node, its children must be in the tree already or be COMPACT_NULL.
+ * A mapped tree is read-only and gets no nodes.
+ *
+ * @return uint32_t Index of the node, COMPACT_NULL if it can't be allocated.
+ */
+uint32_t compact_add    (Compact_tree *tree, Node_type type, Node_value value,
+						 uint32_t left_child, uint32_t right_child);
+
+/**
+ * @brief Packs the tree under root, the names stay owned by the pointer tree.
+ */
+error_t pack_tree       (Compact_tree *tree, const B_tree_node *root);
+
+/**
+ * @brief Builds a pointer tree from the compact one with create_node.
+ */
+B_tree_node *unpack_tree(const Compact_tree *tree, error_t *error_code);
+
+/**
+ * @brief Restores the full value of a node: its number, operation, function or name and ID.
+ */
+Node_value compact_value(const Compact_tree *tree, uint32_t node_ID);
+
+/**
+ * @brief Writes the tree into a binary file of the Ast_header format.
+ */
+error_t save_compact_tree(const Compact_tree *tree, const char *file_name);
+
+/**
+ * @brief Maps a binary tree file and points tree into it, nothing but the name table is copied.
+ *
+ * The file is checked for the magic, the version, the wchar_t size and the bounds of every
+ * part. Without mmap the file is read into memory instead. compact_tree_dtor unmaps it.
+ */
+error_t map_compact_tree (Compact_tree *tree, const char *file_name);
+
 
 #endif
@@ -68,6 +68,36 @@ error_t destroy_subtree(struct B_tree_node *parent_node, bool is_right_child)
 	return B_TREE_ALL_GOOD;
 }
 
+struct Dump_walk
+{
+	Node_charachteristics *nd_description;
+	FILE                  *file_ptr;
+	error_t                error_code;
+};
+
+// every node goes out with its edges in one walk, so the file is streamed as the tree is read
+static Visit_action gr_dump_visit(B_tree_node *node, void *context)
+{
+	Dump_walk *walk = (Dump_walk *)context;
+
+	walk->error_code = print_regular_nodes(node, walk->nd_description, walk->file_ptr);
+	if(walk->error_code != B_TREE_ALL_GOOD)
+	{
+		return VISIT_STOP;
+	}
+
+	gr_dump_connect_nodes(node, walk->file_ptr);
+
+	return VISIT_CONTINUE;
+}
+
+static Visit_action txt_dump_visit(B_tree_node *node, void *context)
+{
+	txt_dump_node(node, ((Dump_walk *)context)->file_ptr);
+
+	return VISIT_CONTINUE;
+}
+
 Uni_ret gr_dump_code_gen(B_tree_node *root, const char *b_tree_name)
 {
 	char *file_name = create_file_name(b_tree_name, ".dot");
@@ -86,6 +116,8 @@ Uni_ret gr_dump_code_gen(B_tree_node *root, const char *b_tree_name)
 		return result;
 	}
 
+	setvbuf(result.arg.file_ptr, NULL, _IOFBF, GR_DUMP_BUF_SIZE);
+
 	#define WRITE_TO_DUMP_FILE(...) fprintf(result.arg.file_ptr, __VA_ARGS__);
 
 	WRITE_TO_DUMP_FILE("digraph BinaryTree {\n"
@@ -119,9 +151,15 @@ Uni_ret gr_dump_code_gen(B_tree_node *root, const char *b_tree_name)
 		"label = \"{ROOT: %p}\"];\n"
 	"}\n", LIGHT_GREEN, root);
 
+	Dump_walk walk = {&nd_description, result.arg.file_ptr, B_TREE_ALL_GOOD};
+
 	if(root != NULL)
 	{
-		result.error_code = print_regular_nodes(root, &nd_description, result.arg.file_ptr);
+		result.error_code = visit_tree(root, &gr_dump_visit, NULL, &walk);
+		if(result.error_code == B_TREE_ALL_GOOD)
+		{
+			result.error_code = walk.error_code;
+		}
 
 		if(result.error_code != B_TREE_ALL_GOOD)
 		{
@@ -132,8 +170,6 @@ Uni_ret gr_dump_code_gen(B_tree_node *root, const char *b_tree_name)
 		}
 	}
 
-	gr_dump_connect_nodes(root, result.arg.file_ptr);
-
 	WRITE_TO_DUMP_FILE("}");
 
 	#undef WRITE_TO_DUMP_FILE
@@ -171,11 +207,13 @@ error_t txt_dump(struct B_tree_node *root, const char *name)
 	DUMP("             left:");
 	DUMP("             right:\n");
 
-	txt_dump_node(root, dump_file);
+	Dump_walk walk = {NULL, dump_file, B_TREE_ALL_GOOD};
+
+	error_t error_code = visit_tree(root, &txt_dump_visit, NULL, &walk);
 
 	#undef DUMP
 
-	return B_TREE_ALL_GOOD;
+	return error_code;
 }
 
 // struct Construct_b_tree_result construct_b_tree(const char *data_base_file_name)
@@ -265,6 +303,62 @@ error_t txt_dump(struct B_tree_node *root, const char *name)
 
 //оптимизация
 
+static bool cmp_values(const B_tree_node *node_1, const B_tree_node *node_2)
+{
+	switch(node_1->type)
+	{
+		case NUM:
+		{
+			return !cmp_double(node_1->value.num_value, node_2->value.num_value);
+		}
+		case OP:
+		case UNR_OP:
+		{
+			return node_1->value.op_value == node_2->value.op_value;
+		}
+		case VAR:
+		{
+			return node_1->value.sym_ID == node_2->value.sym_ID &&
+				   !wcsncmp(node_1->value.var_value, node_2->value.var_value, NODE_LABEL_STR_SIZE);
+		}
+		case FUNC:
+		case CMD_FUNC:
+		{
+			return node_1->value.sym_ID == node_2->value.sym_ID;
+		}
+		case COMMA:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		{
+			return true;
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case DECLARE:
+		case RETURN:
+		case FUNC_DECL:
+		case MAIN:
+		default:
+		{
+			return false;
+		}
+	}
+}
+
 bool cmp_nodes(B_tree_node *node_1, B_tree_node *node_2)
 {
 	if(node_1 == NULL && node_2 == NULL)
@@ -277,21 +371,7 @@ bool cmp_nodes(B_tree_node *node_1, B_tree_node *node_2)
 		return false;
 	}
 
-	if(	cmp_nodes(node_1->left, node_2->left) &&
-		cmp_nodes(node_1->right, node_2->right) &&
-		(
-			(	(node_1->type == NUM && node_2->type == NUM) &&
-				(!cmp_double(node_1->value.num_value, node_2->value.num_value)	)	) ||
-			(	(node_1->type == OP && node_2->type == OP) &&
-				(node_1->value.op_value == node_2->value.op_value	)	) ||
-			(	(node_1->type == VAR && node_2->type == VAR) &&
-				(!wcsncmp(node_1->value.var_value, node_2->value.var_value, NODE_LABEL_STR_SIZE)	)	)
-		)	)
-	{
-		return true;
-	}
-	else
-	{
-		return false;
-	}
+	// only the expressions are compared, the statements are never equal
+	return node_1->type == node_2->type && cmp_values(node_1, node_2) &&
+		   cmp_nodes(node_1->left, node_2->left) && cmp_nodes(node_1->right, node_2->right);
 }
@@ -0,0 +1,144 @@
+#include "b_tree.h"
+#include "b_tree_secondary.h"
+
+// every thread compiles into its own arena
+static thread_local Node_arena *CURRENT_ARENA = NULL;
+
+static Node_chunk *add_chunk(Node_arena *arena)
+{
+	Node_chunk *chunk = (Node_chunk *)calloc(1, sizeof(Node_chunk) +
+												arena->chunk_size * sizeof(B_tree_node));
+	if(chunk == NULL)
+	{
+		return NULL;
+	}
+
+	chunk->nodes = (B_tree_node *)(chunk + 1);
+	chunk->next  = arena->chunks;
+
+	arena->chunks = chunk;
+
+	return chunk;
+}
+
+error_t arena_ctor(Node_arena *arena, size_t chunk_size)
+{
+	if(arena == NULL)
+	{
+		return B_TREE_NULL_PTR;
+	}
+
+	arena->chunks       = NULL;
+	arena->free_nodes   = NULL;
+	arena->chunk_size   = chunk_size == 0 ? NODE_ARENA_CHUNK : chunk_size;
+	arena->nodes_amount = 0;
+
+	return B_TREE_ALL_GOOD;
+}
+
+void arena_dtor(Node_arena *arena)
+{
+	if(arena == NULL)
+	{
+		return;
+	}
+
+	if(CURRENT_ARENA == arena)
+	{
+		CURRENT_ARENA = NULL;
+	}
+
+	Node_chunk *chunk = arena->chunks;
+	while(chunk != NULL)
+	{
+		Node_chunk *next = chunk->next;
+		free(chunk);
+
+		chunk = next;
+	}
+
+	arena->chunks       = NULL;
+	arena->free_nodes   = NULL;
+	arena->nodes_amount = 0;
+}
+
+void arena_reset(Node_arena *arena)
+{
+	if(arena == NULL || arena->chunks == NULL)
+	{
+		return;
+	}
+
+	Node_chunk *chunk = arena->chunks->next;
+	while(chunk != NULL)
+	{
+		Node_chunk *next = chunk->next;
+		free(chunk);
+
+		chunk = next;
+	}
+
+	// the nodes of a chunk are taken as zeroed, like the ones calloc gives
+	memset(arena->chunks->nodes, 0, arena->chunks->used * sizeof(B_tree_node));
+
+	arena->chunks->next = NULL;
+	arena->chunks->used = 0;
+
+	arena->free_nodes   = NULL;
+	arena->nodes_amount = 0;
+}
+
+Node_arena *use_arena(Node_arena *arena)
+{
+	Node_arena *previous = CURRENT_ARENA;
+
+	CURRENT_ARENA = arena;
+
+	return previous;
+}
+
+void release_node(B_tree_node *node)
+{
+	deallocate_node_memory(node);
+}
+
+B_tree_node *arena_alloc(Node_arena *arena)
+{
+	if(arena->free_nodes != NULL)
+	{
+		B_tree_node *node = arena->free_nodes;
+		arena->free_nodes = node->left;
+
+		memset(node, 0, sizeof(B_tree_node));
+		arena->nodes_amount++;
+
+		return node;
+	}
+
+	Node_chunk *chunk = arena->chunks;
+	if(chunk == NULL || chunk->used == arena->chunk_size)
+	{
+		chunk = add_chunk(arena);
+		if(chunk == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	arena->nodes_amount++;
+
+	return chunk->nodes + chunk->used++;
+}
+
+void arena_free(Node_arena *arena, B_tree_node *node)
+{
+	node->left        = arena->free_nodes;
+	arena->free_nodes = node;
+
+	arena->nodes_amount--;
+}
+
+Node_arena *current_arena(void)
+{
+	return CURRENT_ARENA;
+}
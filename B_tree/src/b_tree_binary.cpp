@@ -0,0 +1,248 @@
+#include "b_tree.h"
+#include "b_tree_secondary.h"
+#include "utils.h"
+
+static uint64_t align_part(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+static bool has_name(Node_type type)
+{
+	return type == VAR || type == FUNC || type == CMD_FUNC || type == FUNC_DECL;
+}
+
+error_t save_compact_tree(const Compact_tree *tree, const char *file_name)
+{
+	if(tree == NULL || tree->nodes == NULL)
+	{
+		return B_TREE_NULL_PTR;
+	}
+
+	size_t chars_amount = 0;
+	for(size_t sym_ID = 0; sym_ID < tree->names_amount; sym_ID++)
+	{
+		if(tree->names[sym_ID] != NULL)
+		{
+			chars_amount += wcslen(tree->names[sym_ID]) + 1;
+		}
+	}
+
+	Ast_header header = {};
+	memcpy(header.magic, AST_MAGIC, sizeof(header.magic));
+
+	header.version      = AST_FORMAT_VERSION;
+	header.wchar_size   = (uint32_t)sizeof(wchar_t);
+	header.root         = tree->root;
+	header.nodes_amount = (uint32_t)tree->size;
+	header.nums_amount  = (uint32_t)tree->nums_size;
+	header.names_amount = (uint32_t)tree->names_amount;
+	header.nums_offset  = align_part(sizeof(Ast_header));
+	header.nodes_offset = align_part(header.nums_offset  + tree->nums_size    * sizeof(btr_elem_t));
+	header.names_offset = align_part(header.nodes_offset + tree->size         * sizeof(Compact_node));
+	header.chars_offset = align_part(header.names_offset + tree->names_amount * sizeof(uint32_t));
+	header.file_size    = header.chars_offset + chars_amount * sizeof(wchar_t);
+
+	char *buf = (char *)calloc(header.file_size, sizeof(char));
+	if(buf == NULL)
+	{
+		return UNABLE_TO_ALLOCATE;
+	}
+
+	memcpy(buf, &header, sizeof(Ast_header));
+
+	// an empty pool may have no buffer at all
+	if(tree->nums_size != 0)
+	{
+		memcpy(buf + header.nums_offset, tree->nums, tree->nums_size * sizeof(btr_elem_t));
+	}
+
+	if(tree->size != 0)
+	{
+		memcpy(buf + header.nodes_offset, tree->nodes, tree->size * sizeof(Compact_node));
+	}
+
+	uint32_t *name_offsets = (uint32_t *)(buf + header.names_offset);
+	wchar_t  *chars        = (wchar_t  *)(buf + header.chars_offset);
+	uint32_t  chars_size   = 0;
+
+	for(size_t sym_ID = 0; sym_ID < tree->names_amount; sym_ID++)
+	{
+		if(tree->names[sym_ID] == NULL)
+		{
+			name_offsets[sym_ID] = AST_NO_NAME;
+			continue;
+		}
+
+		size_t length = wcslen(tree->names[sym_ID]) + 1;
+
+		name_offsets[sym_ID] = chars_size;
+		memcpy(chars + chars_size, tree->names[sym_ID], length * sizeof(wchar_t));
+
+		chars_size += (uint32_t)length;
+	}
+
+	error_t error_code = B_TREE_ALL_GOOD;
+
+	FILE *file = fopen(file_name, "wb");
+	if(file == NULL)
+	{
+		error_code = B_TREE_UNABLE_TO_OPEN_FILE;
+	}
+	else
+	{
+		if(fwrite(buf, sizeof(char), header.file_size, file) != header.file_size)
+		{
+			error_code = UNEXPECTED_WRITTEN_ELEMS;
+		}
+
+		fclose(file);
+	}
+
+	free(buf);
+
+	return error_code;
+}
+
+static bool part_fits(uint64_t offset, uint64_t amount, uint64_t elem_size, uint64_t file_size)
+{
+	return offset % 8 == 0 && offset <= file_size && amount <= (file_size - offset) / elem_size;
+}
+
+static bool check_header(const Ast_header *header, size_t file_size)
+{
+	if(file_size < sizeof(Ast_header) || memcmp(header->magic, AST_MAGIC, sizeof(header->magic)) ||
+	   header->version != AST_FORMAT_VERSION || header->wchar_size != sizeof(wchar_t) ||
+	   header->file_size != file_size || header->chars_offset > file_size)
+	{
+		return false;
+	}
+
+	uint64_t chars_amount = (file_size - header->chars_offset) / sizeof(wchar_t);
+
+	return header->nodes_amount > 0 && header->root < header->nodes_amount &&
+		   part_fits(header->nums_offset,  header->nums_amount,  sizeof(btr_elem_t),   file_size) &&
+		   part_fits(header->nodes_offset, header->nodes_amount, sizeof(Compact_node), file_size) &&
+		   part_fits(header->names_offset, header->names_amount, sizeof(uint32_t),     file_size) &&
+		   part_fits(header->chars_offset, chars_amount,         sizeof(wchar_t),      file_size);
+}
+
+static bool child_fits(const Compact_tree *tree, size_t node_ID, uint32_t child_ID, bool preorder)
+{
+	if(child_ID == COMPACT_NULL)
+	{
+		return true;
+	}
+
+	return child_ID < tree->size && (preorder ? child_ID > node_ID : child_ID < node_ID);
+}
+
+static bool check_nodes(const Compact_tree *tree)
+{
+	// pack_tree puts the children after their parent and compact_add before it,
+	// and either order keeps the walks from looping
+	bool preorder = tree->root <= 1;
+
+	for(size_t node_ID = 1; node_ID < tree->size; node_ID++)
+	{
+		const Compact_node *node = &tree->nodes[node_ID];
+
+		if(!child_fits(tree, node_ID, node->left, preorder) ||
+		   !child_fits(tree, node_ID, node->right, preorder) || node->type > NOT_EQUAL)
+		{
+			return false;
+		}
+
+		if(node->type == NUM && node->value.num_ID >= tree->nums_size)
+		{
+			return false;
+		}
+
+		if(has_name((Node_type)node->type) && (node->value.sym_ID >= tree->names_amount ||
+											   tree->names[node->value.sym_ID] == NULL))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+error_t map_compact_tree(Compact_tree *tree, const char *file_name)
+{
+	if(tree == NULL)
+	{
+		return B_TREE_NULL_PTR;
+	}
+
+	*tree = {};
+
+	size_t file_size = 0;
+	char  *mapping   = map_file(file_name, &file_size);
+	if(mapping == NULL)
+	{
+		return B_TREE_UNABLE_TO_OPEN_FILE;
+	}
+
+	tree->mapping      = mapping;
+	tree->mapping_size = file_size;
+
+	const Ast_header *header = (const Ast_header *)mapping;
+	if(!check_header(header, file_size))
+	{
+		compact_tree_dtor(tree);
+
+		return INVALID_AST_FILE;
+	}
+
+	tree->nodes         = (Compact_node *)(mapping + header->nodes_offset);
+	tree->size          = header->nodes_amount;
+	tree->capacity      = header->nodes_amount;
+	tree->nums          = (btr_elem_t *)(mapping + header->nums_offset);
+	tree->nums_size     = header->nums_amount;
+	tree->nums_capacity = header->nums_amount;
+	tree->root          = header->root;
+
+	tree->names = (wchar_t **)calloc(header->names_amount + 1, sizeof(wchar_t *));
+	if(tree->names == NULL)
+	{
+		compact_tree_dtor(tree);
+
+		return UNABLE_TO_ALLOCATE;
+	}
+
+	tree->names_amount = header->names_amount;
+
+	const uint32_t *name_offsets = (const uint32_t *)(mapping + header->names_offset);
+	wchar_t        *chars        = (wchar_t *)(mapping + header->chars_offset);
+	size_t          chars_amount = (file_size - header->chars_offset) / sizeof(wchar_t);
+
+	// the last name ends the characters, so every name ends within the file
+	bool terminated = chars_amount > 0 && chars[chars_amount - 1] == L'\0';
+
+	for(size_t sym_ID = 0; sym_ID < tree->names_amount; sym_ID++)
+	{
+		if(name_offsets[sym_ID] == AST_NO_NAME)
+		{
+			continue;
+		}
+
+		if(!terminated || name_offsets[sym_ID] >= chars_amount)
+		{
+			compact_tree_dtor(tree);
+
+			return INVALID_AST_FILE;
+		}
+
+		tree->names[sym_ID] = chars + name_offsets[sym_ID];
+	}
+
+	if(!check_nodes(tree))
+	{
+		compact_tree_dtor(tree);
+
+		return INVALID_AST_FILE;
+	}
+
+	return B_TREE_ALL_GOOD;
+}
@@ -0,0 +1,389 @@
+#include "b_tree.h"
+#include "b_tree_secondary.h"
+#include "utils.h"
+
+static const size_t STD_COMPACT_CAPACITY = 64;
+
+static uint32_t reserve_node(Compact_tree *tree)
+{
+	if(tree->size >= tree->capacity)
+	{
+		size_t capacity = tree->capacity * 2;
+
+		Compact_node *nodes = (Compact_node *)realloc(tree->nodes, capacity * sizeof(Compact_node));
+		if(nodes == NULL)
+		{
+			return COMPACT_NULL;
+		}
+
+		tree->nodes    = nodes;
+		tree->capacity = capacity;
+	}
+
+	tree->nodes[tree->size] = {};
+
+	return (uint32_t)tree->size++;
+}
+
+static bool add_num(Compact_tree *tree, btr_elem_t num_value, uint32_t *num_ID)
+{
+	if(tree->nums_size >= tree->nums_capacity)
+	{
+		size_t capacity = (tree->nums_capacity + 1) * 2;
+
+		btr_elem_t *nums = (btr_elem_t *)realloc(tree->nums, capacity * sizeof(btr_elem_t));
+		if(nums == NULL)
+		{
+			return false;
+		}
+
+		tree->nums          = nums;
+		tree->nums_capacity = capacity;
+	}
+
+	*num_ID = (uint32_t)tree->nums_size;
+	tree->nums[tree->nums_size++] = num_value;
+
+	return true;
+}
+
+static bool add_name(Compact_tree *tree, size_t sym_ID, wchar_t *name)
+{
+	if(sym_ID >= tree->names_amount)
+	{
+		size_t amount = (sym_ID + 1) * 2;
+
+		wchar_t **names = (wchar_t **)realloc(tree->names, amount * sizeof(wchar_t *));
+		if(names == NULL)
+		{
+			return false;
+		}
+
+		memset(names + tree->names_amount, 0, (amount - tree->names_amount) * sizeof(wchar_t *));
+
+		tree->names        = names;
+		tree->names_amount = amount;
+	}
+
+	tree->names[sym_ID] = name;
+
+	return true;
+}
+
+static bool pack_value(Compact_tree *tree, Node_type type, Node_value value, Compact_value *packed)
+{
+	switch(type)
+	{
+		case NUM:
+		{
+			return add_num(tree, value.num_value, &packed->num_ID);
+		}
+		case OP:
+		case UNR_OP:
+		{
+			packed->op_value = (uint32_t)value.op_value;
+
+			return true;
+		}
+		case STD_FUNC:
+		{
+			packed->func = (uint32_t)value.func;
+
+			return true;
+		}
+		case VAR:
+		case FUNC:
+		case CMD_FUNC:
+		case FUNC_DECL:
+		{
+			packed->sym_ID = (uint32_t)value.sym_ID;
+
+			return add_name(tree, value.sym_ID, value.var_value);
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case MAIN:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		default:
+		{
+			packed->num_ID = 0;
+
+			return true;
+		}
+	}
+}
+
+static uint32_t pack_node(Compact_tree *tree, const B_tree_node *node, error_t *error_code)
+{
+	uint32_t first_ID = COMPACT_NULL;
+	uint32_t prev_ID  = COMPACT_NULL;
+
+	// the right children are packed in the loop, so a statement chain of any length needs no stack,
+	// and each of them still follows the left subtree of its parent as in preorder
+	for(; node != NULL && *error_code == B_TREE_ALL_GOOD; node = node->right)
+	{
+		uint32_t node_ID = reserve_node(tree);
+		if(node_ID == COMPACT_NULL)
+		{
+			*error_code = UNABLE_TO_ALLOCATE;
+
+			return COMPACT_NULL;
+		}
+
+		Compact_value value = {};
+		if(!pack_value(tree, node->type, node->value, &value))
+		{
+			*error_code = UNABLE_TO_ALLOCATE;
+
+			return COMPACT_NULL;
+		}
+
+		uint32_t left_ID = pack_node(tree, node->left, error_code);
+
+		// the node array may have moved while the left child was packed
+		tree->nodes[node_ID].type  = (uint8_t)node->type;
+		tree->nodes[node_ID].value = value;
+		tree->nodes[node_ID].left  = left_ID;
+		tree->nodes[node_ID].right = COMPACT_NULL;
+
+		if(prev_ID == COMPACT_NULL)
+		{
+			first_ID = node_ID;
+		}
+		else
+		{
+			tree->nodes[prev_ID].right = node_ID;
+		}
+
+		prev_ID = node_ID;
+	}
+
+	return first_ID;
+}
+
+static B_tree_node *unpack_node(const Compact_tree *tree, uint32_t node_ID, error_t *error_code)
+{
+	B_tree_node  *first = NULL;
+	B_tree_node **slot  = &first;
+
+	for(; node_ID != COMPACT_NULL && *error_code == B_TREE_ALL_GOOD; node_ID = tree->nodes[node_ID].right)
+	{
+		if(node_ID >= tree->size)
+		{
+			*error_code = INVALID_INDEX;
+
+			break;
+		}
+
+		B_tree_node *left = unpack_node(tree, tree->nodes[node_ID].left, error_code);
+
+		Uni_ret result = create_node((Node_type)tree->nodes[node_ID].type, compact_value(tree, node_ID), left, NULL);
+		if(result.error_code != B_TREE_ALL_GOOD)
+		{
+			*error_code = result.error_code;
+
+			node_delete(left);
+
+			break;
+		}
+
+		*slot = result.arg.node;
+		slot  = &result.arg.node->right;
+	}
+
+	if(*error_code != B_TREE_ALL_GOOD)
+	{
+		node_delete(first);
+
+		return NULL;
+	}
+
+	return first;
+}
+
+error_t compact_tree_ctor(Compact_tree *tree, size_t capacity)
+{
+	if(tree == NULL)
+	{
+		return B_TREE_NULL_PTR;
+	}
+
+	*tree = {};
+
+	tree->capacity = (capacity == 0 ? STD_COMPACT_CAPACITY : capacity) + 1;
+
+	tree->nodes = (Compact_node *)calloc(tree->capacity, sizeof(Compact_node));
+	if(tree->nodes == NULL)
+	{
+		return UNABLE_TO_ALLOCATE;
+	}
+
+	// the node 0 stands for COMPACT_NULL
+	tree->size = 1;
+	tree->root = COMPACT_NULL;
+
+	return B_TREE_ALL_GOOD;
+}
+
+void compact_tree_dtor(Compact_tree *tree)
+{
+	if(tree == NULL)
+	{
+		return;
+	}
+
+	if(tree->mapping != NULL)
+	{
+		unmap_file(tree->mapping, tree->mapping_size);
+	}
+	else
+	{
+		free(tree->nodes);
+		free(tree->nums);
+	}
+
+	free(tree->names);
+
+	*tree = {};
+}
+
+uint32_t compact_add(Compact_tree *tree, Node_type type, Node_value value,
+					 uint32_t left_child, uint32_t right_child)
+{
+	if(tree->mapping != NULL)
+	{
+		return COMPACT_NULL;
+	}
+
+	Compact_value packed = {};
+	if(!pack_value(tree, type, value, &packed))
+	{
+		return COMPACT_NULL;
+	}
+
+	uint32_t node_ID = reserve_node(tree);
+	if(node_ID == COMPACT_NULL)
+	{
+		return COMPACT_NULL;
+	}
+
+	tree->nodes[node_ID].type  = (uint8_t)type;
+	tree->nodes[node_ID].value = packed;
+	tree->nodes[node_ID].left  = left_child;
+	tree->nodes[node_ID].right = right_child;
+
+	return node_ID;
+}
+
+error_t pack_tree(Compact_tree *tree, const B_tree_node *root)
+{
+	if(tree == NULL || tree->nodes == NULL)
+	{
+		return B_TREE_NULL_PTR;
+	}
+
+	if(tree->mapping != NULL)
+	{
+		return INVALID_VALUE;
+	}
+
+	error_t error_code = B_TREE_ALL_GOOD;
+
+	tree->root = pack_node(tree, root, &error_code);
+
+	return error_code;
+}
+
+B_tree_node *unpack_tree(const Compact_tree *tree, error_t *error_code)
+{
+	if(tree == NULL || tree->nodes == NULL)
+	{
+		*error_code = B_TREE_NULL_PTR;
+
+		return NULL;
+	}
+
+	*error_code = B_TREE_ALL_GOOD;
+
+	return unpack_node(tree, tree->root, error_code);
+}
+
+Node_value compact_value(const Compact_tree *tree, uint32_t node_ID)
+{
+	const Compact_node *node = &tree->nodes[node_ID];
+
+	Node_value value = {.num_value = 0};
+
+	switch((Node_type)node->type)
+	{
+		case NUM:
+		{
+			value.num_value = tree->nums[node->value.num_ID];
+			break;
+		}
+		case OP:
+		case UNR_OP:
+		{
+			value.op_value = (Ops)node->value.op_value;
+			break;
+		}
+		case STD_FUNC:
+		{
+			value.func = (Std_func)node->value.func;
+			break;
+		}
+		case VAR:
+		case FUNC:
+		case CMD_FUNC:
+		case FUNC_DECL:
+		{
+			value.sym_ID    = node->value.sym_ID;
+			value.var_value = tree->names[node->value.sym_ID];
+			break;
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case MAIN:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		default:
+		{
+			break;
+		}
+	}
+
+	return value;
+}
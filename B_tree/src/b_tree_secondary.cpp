@@ -6,19 +6,17 @@
 
 void node_delete(struct B_tree_node *node)
 {
-	if(node == NULL)
-	{
-		return;
-	}
-
-	node_delete(node->left);
-	node_delete(node->right);
-
-	deallocate_node_memory(node);
+	release_tree(node);
 }
 
 struct B_tree_node *allocate_node_memory(void)
 {
+	Node_arena *arena = current_arena();
+	if(arena != NULL)
+	{
+		return arena_alloc(arena);
+	}
+
 	return (struct B_tree_node *)calloc(1, sizeof(struct B_tree_node));
 }
 
@@ -29,6 +27,14 @@ error_t deallocate_node_memory(struct B_tree_node *node)
 		return B_TREE_NODE_NULL_PTR;
 	}
 
+	Node_arena *arena = current_arena();
+	if(arena != NULL)
+	{
+		arena_free(arena, node);
+
+		return B_TREE_ALL_GOOD;
+	}
+
 	free(node);
 	node = NULL;
 
@@ -346,13 +352,6 @@ error_t print_regular_nodes(struct B_tree_node *node,
 
 	gr_dump_node(node, nd_description, graphic_dump_code_file_ptr);
 
-	print_regular_nodes(node->left,
-						nd_description,
-						graphic_dump_code_file_ptr);
-	print_regular_nodes(node->right,
-						nd_description,
-						graphic_dump_code_file_ptr);
-
 	return B_TREE_ALL_GOOD;
 }
 
@@ -367,14 +366,12 @@ void gr_dump_connect_nodes(struct B_tree_node *node, FILE *graphic_dump_code_fil
 	{
 		fprintf(graphic_dump_code_file_ptr, "%lu -> %lu\n", (unsigned long)node,
 															(unsigned long)node->left);
-		gr_dump_connect_nodes(node->left, graphic_dump_code_file_ptr);
 	}
 
 	if(node->right != NULL)
 	{
 		fprintf(graphic_dump_code_file_ptr, "%lu -> %lu\n", (unsigned long)node,
 															(unsigned long)node->right);
-		gr_dump_connect_nodes(node->right, graphic_dump_code_file_ptr);
 	}
 }
 
@@ -645,9 +642,6 @@ void txt_dump_node(struct B_tree_node *node, FILE *console_dump_file)
 	DUMP("%18.p", node->right);
 
 	DUMP("\n");
-
-	txt_dump_node(node->left,  console_dump_file);
-	txt_dump_node(node->right, console_dump_file);
 }
 
 error_t compile_dot(const char *b_tree_name)
@@ -659,8 +653,9 @@ error_t compile_dot(const char *b_tree_name)
 		fprintf(stderr, "Unable to allocate\n");
 		return UNABLE_TO_ALLOCATE;
 	}
+	// the image is rendered in the background, the compilation doesn't wait for it
 	snprintf(gr_dump_gen_cmd, GR_DUMP_GEN_CMD_SIZE,
-		"dot -Tpng %s.dot -o %s.png -Gdpi=100\n", b_tree_name, b_tree_name);
+		"dot -Tpng %s.dot -o %s.png -Gdpi=100 > /dev/null 2>&1 &", b_tree_name, b_tree_name);
 
 	system(gr_dump_gen_cmd);
 
@@ -700,6 +695,10 @@ char *get_func_token(Std_func func_type)
 	{
 		CASE(GETVAR)
 		CASE(PUTEXPR)
+		CASE(FILLRAM)
+		CASE(COPYRAM)
+		CASE(CMPRAM)
+		CASE(READRAM)
 		default:
 		{
 			strncpy(func_token, "UNKNOWN", STD_FUNC_TOKEN_SIZE);
@@ -14,6 +14,12 @@ B_tree_node *allocate_node_memory  (void);
 
 error_t      deallocate_node_memory(B_tree_node *node);
 
+B_tree_node *arena_alloc           (Node_arena *arena);
+
+void         arena_free            (Node_arena *arena, B_tree_node *node);
+
+Node_arena  *current_arena         (void);
+
 error_t      print_regular_nodes   (B_tree_node *node,
 									Node_charachteristics *nd_description,
 							        FILE *graphic_dump_code_file_ptr);
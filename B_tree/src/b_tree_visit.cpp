@@ -0,0 +1,139 @@
+#include "b_tree.h"
+#include "b_tree_secondary.h"
+
+struct Visit_stack
+{
+	Visit_item  inline_items[VISIT_STACK_INLINE];
+	Visit_item *items;
+	size_t      size;
+	size_t      capacity;
+};
+
+static bool push_item(Visit_stack *stack, B_tree_node *node)
+{
+	if(node == NULL)
+	{
+		return true;
+	}
+
+	if(stack->size >= stack->capacity)
+	{
+		size_t capacity = stack->capacity * 2;
+
+		Visit_item *items = NULL;
+		if(stack->items == stack->inline_items)
+		{
+			items = (Visit_item *)calloc(capacity, sizeof(Visit_item));
+			if(items != NULL)
+			{
+				memcpy(items, stack->inline_items, stack->size * sizeof(Visit_item));
+			}
+		}
+		else
+		{
+			items = (Visit_item *)realloc(stack->items, capacity * sizeof(Visit_item));
+		}
+
+		if(items == NULL)
+		{
+			return false;
+		}
+
+		stack->items    = items;
+		stack->capacity = capacity;
+	}
+
+	stack->items[stack->size++] = {.node = node, .children_done = false};
+
+	return true;
+}
+
+error_t visit_tree(B_tree_node *root, Node_visitor pre_visit, Node_visitor post_visit,
+				   void *context)
+{
+	Visit_stack stack = {};
+	stack.items    = stack.inline_items;
+	stack.capacity = VISIT_STACK_INLINE;
+
+	error_t error_code = B_TREE_ALL_GOOD;
+
+	if(!push_item(&stack, root))
+	{
+		return UNABLE_TO_ALLOCATE;
+	}
+
+	while(stack.size > 0)
+	{
+		Visit_item *item = &stack.items[stack.size - 1];
+		B_tree_node *node = item->node;
+
+		if(item->children_done)
+		{
+			stack.size--;
+
+			if(post_visit(node, context) == VISIT_STOP)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		Visit_action action = pre_visit == NULL ? VISIT_CONTINUE : pre_visit(node, context);
+		if(action == VISIT_STOP)
+		{
+			break;
+		}
+
+		if(post_visit == NULL)
+		{
+			stack.size--;
+		}
+		else
+		{
+			item->children_done = true;
+		}
+
+		if(action == VISIT_SKIP)
+		{
+			continue;
+		}
+
+		// the right child is pushed first, so the left one is visited first
+		if(!push_item(&stack, node->right) || !push_item(&stack, node->left))
+		{
+			error_code = UNABLE_TO_ALLOCATE;
+			break;
+		}
+	}
+
+	if(stack.items != stack.inline_items)
+	{
+		free(stack.items);
+	}
+
+	return error_code;
+}
+
+void release_tree(B_tree_node *root)
+{
+	// every left child is rotated up to the right spine, so the tree unrolls into a list
+	while(root != NULL)
+	{
+		B_tree_node *left = root->left;
+		if(left != NULL)
+		{
+			root->left  = left->right;
+			left->right = root;
+
+			root = left;
+
+			continue;
+		}
+
+		B_tree_node *next = root->right;
+		deallocate_node_memory(root);
+
+		root = next;
+	}
+}
@@ -0,0 +1,267 @@
+#ifndef ASM_IR_H
+#define ASM_IR_H
+
+#include <stdio.h>
+
+#include "assembler.h"
+
+/**
+ * @file asm_ir.h
+ * @brief Typed in-memory form of the assembly code.
+ *
+ * The program is an array of commands with typed operands and numbered labels.
+ * It is lowered straight into the byte code, so there is no text to format and parse,
+ * and it is dumped into the human-readable assembly code only for debugging.
+ */
+
+const size_t IR_NO_LABEL       = (size_t)-1; /**< Label ID which names no label. */
+const size_t IR_START_CAPACITY = 64; /**< Starting capacity of the commands and the labels arrays. */
+const size_t IR_REALLOC_COEFF  = 2; /**< Growth factor of the arrays. */
+
+/**
+ * @enum Ir_op
+ * @brief Enumeration of the commands, which are lowered into the byte code commands.
+ */
+enum Ir_op
+{
+	IR_LABEL   = 0, /**< Definition of the label, which is no command. */
+	IR_PUSH    = 1,
+	IR_POP     = 2,
+	IR_ADD     = 3,
+	IR_SUB     = 4,
+	IR_MUL     = 5,
+	IR_DIV     = 6,
+	IR_SQRT    = 7,
+	IR_IN      = 8,
+	IR_OUT     = 9,
+	IR_JMP     = 10,
+	IR_JA      = 11,
+	IR_JB      = 12,
+	IR_JAE     = 13,
+	IR_JBE     = 14,
+	IR_JE      = 15,
+	IR_JNE     = 16,
+	IR_CALL    = 17,
+	IR_RET     = 18,
+	IR_HLT     = 19,
+	IR_DRAW    = 20,
+	IR_FILL    = 21,
+	IR_COPY    = 22,
+	IR_COMPARE = 23,
+	IR_SNAP    = 24,
+	IR_CALL_START = 25, /**< Start of the call sequence, where the register allocator saves the values
+	                         that live across the call, which is no command. */
+	IR_TAIL_CALL  = 26, /**< Jump to a function, which returns straight to the caller of the current one. */
+	IR_IADD    = 27,
+	IR_ISUB    = 28,
+	IR_IMUL    = 29,
+	IR_IJA     = 30,
+	IR_IJB     = 31,
+	IR_IJAE    = 32,
+	IR_IJBE    = 33,
+	IR_IJE     = 34,
+	IR_IJNE    = 35,
+	IR_OPS_AMOUNT, /**< Amount of the commands. */
+};
+
+/**
+ * @enum Ir_var_type
+ * @brief Enumeration of the variable types, which pick the register bank of a variable.
+ */
+enum Ir_var_type
+{
+	IR_FLOAT_VAR = 0, /**< Lives in r0, r1 and so on or in RAM. */
+	IR_INT_VAR   = 1, /**< Holds integers only, lives in i0, i1 and so on or in RAM. */
+};
+
+/**
+ * @enum Ir_arg_type
+ * @brief Enumeration of the operand types of a command.
+ */
+enum Ir_arg_type
+{
+	IR_NO_ARG      = 0, /**< The command has no operand. */
+	IR_IMM_ARG     = 1, /**< Immediate number, push only. */
+	IR_REG_ARG     = 2, /**< Register. */
+	IR_RAM_IMM_ARG = 3, /**< RAM cell at the immediate address. */
+	IR_RAM_REG_ARG = 4, /**< RAM cell at the address in the register. */
+	IR_LABEL_ARG   = 5, /**< Label, which the jumps and the calls go to. */
+	IR_RANGE_ARG   = 6, /**< Head and end of the RAM range, draw only. */
+	IR_VAR_ARG     = 7, /**< Variable, which has to be replaced by a register or a RAM cell before the lowering. */
+};
+
+/**
+ * @struct Ir_arg
+ * @brief Structure representing the operand of a command.
+ */
+struct Ir_arg
+{
+	Ir_arg_type  type; /**< Type of the operand. */
+	double       imm; /**< Immediate number of IR_IMM_ARG. */
+	size_t       value; /**< Register ID, RAM address, label ID, variable ID or range head. */
+	size_t       end; /**< Range end of IR_RANGE_ARG. */
+};
+
+/**
+ * @struct Ir_cmd
+ * @brief Structure representing a command or a label definition.
+ */
+struct Ir_cmd
+{
+	Ir_op   op; /**< Command. */
+	Ir_arg  arg; /**< Operand, the label ID of a definition. */
+};
+
+/**
+ * @struct Ir_program
+ * @brief Structure representing the program.
+ */
+struct Ir_program
+{
+	Ir_cmd       *cmds; /**< Commands in the execution order. */
+	size_t        size; /**< Amount of commands. */
+	size_t        capacity; /**< Capacity of the commands array. */
+	char        **labels; /**< Label names, indexed by the label ID. */
+	size_t        labels_amount; /**< Amount of labels. */
+	size_t        labels_capacity; /**< Capacity of the labels array. */
+	size_t        vars_amount; /**< Amount of variables, which are numbered from 0. */
+	Ir_var_type  *var_types; /**< Types of the variables, indexed by the variable ID. */
+	size_t        vars_capacity; /**< Capacity of the variable types array. */
+};
+
+/**
+ * @brief Makes an operand without a value.
+ */
+Ir_arg    ir_no_arg    ();
+
+/**
+ * @brief Makes an immediate number operand.
+ */
+Ir_arg    ir_imm_arg   (double imm);
+
+/**
+ * @brief Makes a register operand.
+ */
+Ir_arg    ir_reg_arg   (unsigned char reg_ID);
+
+/**
+ * @brief Makes a RAM operand at the immediate address.
+ */
+Ir_arg    ir_ram_arg   (size_t address);
+
+/**
+ * @brief Makes a RAM operand at the address in the register.
+ */
+Ir_arg    ir_ram_reg_arg(unsigned char reg_ID);
+
+/**
+ * @brief Makes a label operand.
+ */
+Ir_arg    ir_label_arg (size_t label_ID);
+
+/**
+ * @brief Makes a variable operand.
+ */
+Ir_arg    ir_var_arg   (size_t var_ID);
+
+/**
+ * @brief Compares two operands.
+ *
+ * @return bool Returns true if the operands name the same value.
+ */
+bool      ir_same_arg  (const Ir_arg *first, const Ir_arg *second);
+
+/**
+ * @brief Initializes an empty program.
+ *
+ * @param program Pointer to the program, freed by ir_dtor().
+ * @return asm_err_t Returns ASM_UNABLE_TO_ALLOCATE if the arrays can't be allocated.
+ */
+asm_err_t ir_ctor      (Ir_program *program);
+
+/**
+ * @brief Frees the program.
+ *
+ * @param program Pointer to the program.
+ */
+void      ir_dtor      (Ir_program *program);
+
+/**
+ * @brief Creates a new label, which is defined later by ir_define().
+ *
+ * @param program Pointer to the program.
+ * @param label_ID Pointer to the ID of the new label.
+ * @param name Name of the label, which must have no spaces. It is copied.
+ * @return asm_err_t Returns ASM_UNABLE_TO_ALLOCATE if the label can't be allocated.
+ */
+asm_err_t ir_new_label (Ir_program *program, size_t *label_ID, const char *name);
+
+/**
+ * @brief Creates a new variable.
+ *
+ * @param program Pointer to the program.
+ * @param type Type of the variable.
+ * @param var_ID Pointer to the ID of the new variable.
+ * @return asm_err_t Returns ASM_UNABLE_TO_ALLOCATE if the variable can't be allocated.
+ */
+asm_err_t ir_new_var   (Ir_program *program, Ir_var_type type, size_t *var_ID);
+
+/**
+ * @brief Finds the label by its name.
+ *
+ * @return size_t Returns the label ID, IR_NO_LABEL if there is no such label.
+ */
+size_t    ir_find_label(const Ir_program *program, const char *name);
+
+/**
+ * @brief Appends a command to the program.
+ *
+ * @param program Pointer to the program.
+ * @param op Command.
+ * @param arg Operand of the command.
+ * @return asm_err_t Returns ASM_UNABLE_TO_ALLOCATE if the program can't grow.
+ */
+asm_err_t ir_emit      (Ir_program *program, Ir_op op, Ir_arg arg);
+
+/**
+ * @brief Appends the definition of the label at the current position.
+ */
+asm_err_t ir_define    (Ir_program *program, size_t label_ID);
+
+/**
+ * @brief Checks whether the command is a jump, a call or a tail call to a label.
+ */
+bool      ir_is_jump   (Ir_op op);
+
+/**
+ * @brief Writes a command in the human-readable assembly code, without a newline.
+ */
+void      ir_print_cmd (const Ir_program *program, const Ir_cmd *cmd, FILE *file);
+
+/**
+ * @brief Writes the program in the human-readable assembly code, which compile() accepts.
+ */
+void      ir_dump      (const Ir_program *program, FILE *file);
+
+/**
+ * @brief Lowers the program into machine code in memory.
+ *
+ * @param program Pointer to the program.
+ * @param byte_code Pointer to the machine code in the legacy 8 byte slots,
+ * which is allocated by the function and freed by the caller.
+ * @param byte_code_length Pointer to the length of the machine code in bytes.
+ * @return asm_err_t Returns LABEL_DOESNT_EXIST if a jump goes to an undefined label.
+ */
+asm_err_t ir_assemble  (const Ir_program *program, char **byte_code, size_t *byte_code_length);
+
+/**
+ * @brief Lowers the program into machine code and writes file_name.bin and file_name.labels,
+ * the same files compile() writes for the assembly code.
+ *
+ * @param program Pointer to the program.
+ * @param file_name Name the binary and the label map are named after.
+ * @return asm_err_t Returns ASM_ALL_GOOD if compilation is successful, otherwise returns an error code.
+ */
+asm_err_t ir_compile   (const Ir_program *program, const char *file_name);
+
+#endif
@@ -20,6 +20,9 @@ typedef enum
     LABEL_DOESNT_EXIST      = 1 << 2, /**< Label does not exist error. */
 	ASM_INVALID_FWRITE      = 1 << 3, /**< The amount of written elements is unexpexted. */
 	ASM_INVALID_FREAD       = 1 << 4, /**< The amount of read elements is unexpexted. */
+	ASM_UNKNOWN_REGISTER    = 1 << 5, /**< The register isn't one of the SPU_REGS_AMOUNT VM registers. */
+	ASM_INVALID_BYTE_CODE   = 1 << 6, /**< The byte code can't be packed into the compact encoding. */
+	ASM_INVALID_IR          = 1 << 7, /**< The command of the in-memory program has an operand it can't take. */
 } asm_err_t;
 
 
@@ -47,9 +50,28 @@ typedef struct
 
 /**
  * @brief Compiles the human-readable code into machine code.
+ *
+ * The binary file gets the compact encoding, or the legacy 8 byte slots
+ * if the assembler is built with ASM_LEGACY_BYTE_CODE.
+ *
  * @param file_name The name of the human-readable code file.
  * @return Returns ASM_ALL_GOOD if compilation is successful, otherwise returns an error code.
  */
 asm_err_t  compile     (const char *file_name);
 
+/**
+ * @brief Compiles the human-readable code from memory into machine code in memory.
+ *
+ * Nothing is read from or written to disk, so there is no label map either.
+ * The machine code is left in the legacy 8 byte slots.
+ *
+ * @param human_code The text of the human-readable code.
+ * @param length The length of the text.
+ * @param byte_code Pointer to the machine code, which is allocated by the function and freed by the caller.
+ * @param byte_code_length Pointer to the length of the machine code in bytes.
+ * @return Returns ASM_ALL_GOOD if compilation is successful, otherwise returns an error code.
+ */
+asm_err_t  compile_buffer(const char *human_code, size_t length,
+                          char **byte_code, size_t *byte_code_length);
+
 #endif
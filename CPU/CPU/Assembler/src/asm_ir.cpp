@@ -0,0 +1,693 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm_ir.h"
+#include "assembler_additional.h"
+#include "commands.h"
+
+#define ALLOCATION_CHECK(ptr)\
+	if(ptr == NULL)\
+	{\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return ASM_UNABLE_TO_ALLOCATE;			\
+	}
+
+#define BYTE_CODE\
+	manager->byte_code
+
+#define CMD(ID)\
+	program->cmds[ID]
+
+static const size_t NUM_TEXT_SIZE = 512; /**< Enough for any double written with %lf. */
+
+/**
+ * @struct Ir_op_info
+ * @brief Structure describing how a command of the in-memory program is written.
+ */
+struct Ir_op_info
+{
+	const char *name; /**< Name in the human-readable assembly code. */
+	Command     cmd; /**< Command of the byte code. */
+};
+
+static const Ir_op_info IR_OPS[IR_OPS_AMOUNT] =
+{
+	{":",       VOID   },
+	{"push",    PUSH   },
+	{"pop",     POP    },
+	{"add",     ADD    },
+	{"sub",     SUB    },
+	{"mul",     MUL    },
+	{"div",     DIV    },
+	{"sqrt",    SQRT   },
+	{"in",      IN     },
+	{"out",     OUT    },
+	{"jmp",     JMP    },
+	{"ja",      JA     },
+	{"jb",      JB     },
+	{"jae",     JAE    },
+	{"jbe",     JBE    },
+	{"je",      JE     },
+	{"jne",     JNE    },
+	{"call",    CALL   },
+	{"ret",     RET    },
+	{"hlt",     HLT    },
+	{"draw",    DRAW   },
+	{"fill",    FILL   },
+	{"copy",    COPY   },
+	{"compare", COMPARE},
+	{"snap",    SNAP   },
+	{"call_start", VOID},
+	{"jmp",     JMP    },
+	{"iadd",    IADD   },
+	{"isub",    ISUB   },
+	{"imul",    IMUL   },
+	{"ija",     IJA    },
+	{"ijb",     IJB    },
+	{"ijae",    IJAE   },
+	{"ijbe",    IJBE   },
+	{"ije",     IJE    },
+	{"ijne",    IJNE   },
+};
+
+Ir_arg ir_no_arg()
+{
+	Ir_arg arg = {};
+
+	arg.type = IR_NO_ARG;
+
+	return arg;
+}
+
+Ir_arg ir_imm_arg(double imm)
+{
+	Ir_arg arg = {};
+
+	arg.type = IR_IMM_ARG;
+	arg.imm  = imm;
+
+	return arg;
+}
+
+Ir_arg ir_reg_arg(unsigned char reg_ID)
+{
+	Ir_arg arg = {};
+
+	arg.type  = IR_REG_ARG;
+	arg.value = reg_ID;
+
+	return arg;
+}
+
+Ir_arg ir_ram_arg(size_t address)
+{
+	Ir_arg arg = {};
+
+	arg.type  = IR_RAM_IMM_ARG;
+	arg.value = address;
+
+	return arg;
+}
+
+Ir_arg ir_ram_reg_arg(unsigned char reg_ID)
+{
+	Ir_arg arg = {};
+
+	arg.type  = IR_RAM_REG_ARG;
+	arg.value = reg_ID;
+
+	return arg;
+}
+
+Ir_arg ir_label_arg(size_t label_ID)
+{
+	Ir_arg arg = {};
+
+	arg.type  = IR_LABEL_ARG;
+	arg.value = label_ID;
+
+	return arg;
+}
+
+Ir_arg ir_var_arg(size_t var_ID)
+{
+	Ir_arg arg = {};
+
+	arg.type  = IR_VAR_ARG;
+	arg.value = var_ID;
+
+	return arg;
+}
+
+bool ir_same_arg(const Ir_arg *first, const Ir_arg *second)
+{
+	if(first->type != second->type)
+	{
+		return false;
+	}
+
+	switch(first->type)
+	{
+		case IR_NO_ARG:
+		{
+			return true;
+		}
+		case IR_IMM_ARG:
+		{
+			return !memcmp(&first->imm, &second->imm, sizeof(double));
+		}
+		case IR_RANGE_ARG:
+		{
+			return first->value == second->value && first->end == second->end;
+		}
+		case IR_REG_ARG:
+		case IR_RAM_IMM_ARG:
+		case IR_RAM_REG_ARG:
+		case IR_LABEL_ARG:
+		case IR_VAR_ARG:
+		default:
+		{
+			return first->value == second->value;
+		}
+	}
+}
+
+asm_err_t ir_ctor(Ir_program *program)
+{
+	*program = {};
+
+	CALLOC(program->cmds,      IR_START_CAPACITY, Ir_cmd);
+	CALLOC(program->labels,    IR_START_CAPACITY, char *);
+	CALLOC(program->var_types, IR_START_CAPACITY, Ir_var_type);
+
+	program->capacity        = IR_START_CAPACITY;
+	program->labels_capacity = IR_START_CAPACITY;
+	program->vars_capacity   = IR_START_CAPACITY;
+
+	return ASM_ALL_GOOD;
+}
+
+void ir_dtor(Ir_program *program)
+{
+	if(program->labels != NULL)
+	{
+		for(size_t label_ID = 0; label_ID < program->labels_amount; label_ID++)
+		{
+			free(program->labels[label_ID]);
+		}
+	}
+
+	free(program->labels);
+	free(program->cmds);
+	free(program->var_types);
+
+	*program = {};
+}
+
+asm_err_t ir_new_label(Ir_program *program, size_t *label_ID, const char *name)
+{
+	if(program->labels_amount >= program->labels_capacity)
+	{
+		program->labels_capacity *= IR_REALLOC_COEFF;
+		REALLOC(program->labels, program->labels_capacity, char *);
+	}
+
+	size_t name_size = strlen(name) + 1;
+
+	char *label = NULL;
+	CALLOC(label, name_size, char);
+	memcpy(label, name, name_size);
+
+	program->labels[program->labels_amount] = label;
+	*label_ID = program->labels_amount++;
+
+	return ASM_ALL_GOOD;
+}
+
+asm_err_t ir_new_var(Ir_program *program, Ir_var_type type, size_t *var_ID)
+{
+	if(program->vars_amount >= program->vars_capacity)
+	{
+		program->vars_capacity *= IR_REALLOC_COEFF;
+		REALLOC(program->var_types, program->vars_capacity, Ir_var_type);
+	}
+
+	program->var_types[program->vars_amount] = type;
+	*var_ID = program->vars_amount++;
+
+	return ASM_ALL_GOOD;
+}
+
+size_t ir_find_label(const Ir_program *program, const char *name)
+{
+	for(size_t label_ID = 0; label_ID < program->labels_amount; label_ID++)
+	{
+		if(!strcmp(program->labels[label_ID], name))
+		{
+			return label_ID;
+		}
+	}
+
+	return IR_NO_LABEL;
+}
+
+asm_err_t ir_emit(Ir_program *program, Ir_op op, Ir_arg arg)
+{
+	if(program->size >= program->capacity)
+	{
+		program->capacity *= IR_REALLOC_COEFF;
+		REALLOC(program->cmds, program->capacity, Ir_cmd);
+	}
+
+	CMD(program->size).op  = op;
+	CMD(program->size).arg = arg;
+
+	program->size++;
+
+	return ASM_ALL_GOOD;
+}
+
+asm_err_t ir_define(Ir_program *program, size_t label_ID)
+{
+	return ir_emit(program, IR_LABEL, ir_label_arg(label_ID));
+}
+
+bool ir_is_jump(Ir_op op)
+{
+	return (op >= IR_JMP && op <= IR_CALL) || op == IR_TAIL_CALL || (op >= IR_IJA && op <= IR_IJNE);
+}
+
+static void print_num(double num, FILE *file)
+{
+	char   text[NUM_TEXT_SIZE] = {};
+	double read_num            = 0;
+
+	// %lf is what the backend always wrote, the long form is only for the numbers it would round
+	snprintf(text, sizeof(text), "%lf", num);
+	if(sscanf(text, "%lf", &read_num) != 1 || memcmp(&read_num, &num, sizeof(double)))
+	{
+		snprintf(text, sizeof(text), "%.17g", num);
+	}
+
+	fprintf(file, "%s", text);
+}
+
+void ir_print_cmd(const Ir_program *program, const Ir_cmd *cmd, FILE *file)
+{
+	char reg_name[REG_NAME_SIZE] = {};
+
+	if(cmd->op == IR_LABEL)
+	{
+		fprintf(file, ":%s", program->labels[cmd->arg.value]);
+
+		return;
+	}
+
+	fprintf(file, "%s", IR_OPS[cmd->op].name);
+
+	switch(cmd->arg.type)
+	{
+		case IR_IMM_ARG:
+		{
+			fprintf(file, " ");
+			print_num(cmd->arg.imm, file);
+
+			break;
+		}
+		case IR_REG_ARG:
+		{
+			write_reg_name(reg_name, REG_NAME_SIZE, (unsigned char)cmd->arg.value);
+			fprintf(file, " %s", reg_name);
+
+			break;
+		}
+		case IR_RAM_IMM_ARG:
+		{
+			fprintf(file, " [%lu]", cmd->arg.value);
+
+			break;
+		}
+		case IR_RAM_REG_ARG:
+		{
+			write_reg_name(reg_name, REG_NAME_SIZE, (unsigned char)cmd->arg.value);
+			fprintf(file, " [%s]", reg_name);
+
+			break;
+		}
+		case IR_LABEL_ARG:
+		{
+			fprintf(file, " %s", program->labels[cmd->arg.value]);
+
+			break;
+		}
+		case IR_RANGE_ARG:
+		{
+			fprintf(file, " %lu %lu", cmd->arg.value, cmd->arg.end);
+
+			break;
+		}
+		case IR_VAR_ARG:
+		{
+			fprintf(file, " %%v%lu", cmd->arg.value);
+
+			break;
+		}
+		case IR_NO_ARG:
+		default:
+		{
+			break;
+		}
+	}
+}
+
+void ir_dump(const Ir_program *program, FILE *file)
+{
+	for(size_t cmd_ID = 0; cmd_ID < program->size; cmd_ID++)
+	{
+		ir_print_cmd(program, &CMD(cmd_ID), file);
+		fprintf(file, "\n");
+	}
+}
+
+static bool get_ir_reg(const Ir_cmd *cmd, Ir_op op, unsigned char *reg)
+{
+	// an unknown register is left for write_stack_cmd() to report
+	if(cmd->op != op || cmd->arg.type != IR_REG_ARG || cmd->arg.value >= FIRST_INT_REG + INT_REGS_AMOUNT)
+	{
+		return false;
+	}
+
+	*reg = (unsigned char)cmd->arg.value;
+
+	return true;
+}
+
+static bool get_ir_imm(const Ir_cmd *cmd, double *imm)
+{
+	if(cmd->op != IR_PUSH || cmd->arg.type != IR_IMM_ARG)
+	{
+		return false;
+	}
+
+	*imm = cmd->arg.imm;
+
+	return true;
+}
+
+// the same sequences fuse_cmds() finds in the human-readable code
+static bool fuse_ir_cmds(Compile_manager *manager, const Ir_program *program, size_t *cmd_ID)
+{
+	size_t first_ID = *cmd_ID;
+
+	if(first_ID + 2 >= program->size)
+	{
+		return false;
+	}
+
+	Fused_cmd fused   = {};
+	bool      swapped = false;
+
+	if(!get_ir_reg(&CMD(first_ID), IR_PUSH, &fused.reg_A))
+	{
+		if(!get_ir_imm(&CMD(first_ID), &fused.imm) ||
+		   !get_ir_reg(&CMD(first_ID + 1), IR_PUSH, &fused.reg_A))
+		{
+			return false;
+		}
+
+		fused.mode = IMM_MASK;
+		swapped    = true;
+	}
+	else if(!get_ir_reg(&CMD(first_ID + 1), IR_PUSH, &fused.reg_B))
+	{
+		if(!get_ir_imm(&CMD(first_ID + 1), &fused.imm))
+		{
+			return false;
+		}
+
+		fused.mode = IMM_MASK;
+	}
+
+	size_t  last_ID = first_ID + 2;
+	bool    is_jump = false;
+
+	const Fusion *fusion = find_fusion_by_op(CMD(last_ID).op, &is_jump);
+	if(fusion == NULL)
+	{
+		return false;
+	}
+
+	fused.num = swapped ? fusion->swapped_num : fusion->fused_num;
+	if(fused.num == VOID || !fusion_fits_reg(fusion, fused.reg_A) ||
+	   (!(fused.mode & IMM_MASK) && !fusion_fits_reg(fusion, fused.reg_B)))
+	{
+		return false;
+	}
+
+	unsigned char popped = 0;
+
+	if(is_jump)
+	{
+		fused.label = program->labels[CMD(last_ID).arg.value];
+	}
+	else if(last_ID + 1 < program->size && get_ir_reg(&CMD(last_ID + 1), IR_POP, &popped) &&
+			fusion_fits_reg(fusion, popped))
+	{
+		fused.reg_dst = popped;
+		fused.mode   |= REG_MASK;
+		last_ID++;
+	}
+
+	write_fused(manager, &fused);
+
+	*cmd_ID = last_ID;
+
+	return true;
+}
+
+static asm_err_t write_reg(Compile_manager *manager, size_t reg_ID)
+{
+	if(reg_ID >= FIRST_INT_REG + INT_REGS_AMOUNT)
+	{
+		LOG("ERROR: unknown register %lu.\n", reg_ID);
+
+		return ASM_UNKNOWN_REGISTER;
+	}
+
+	write_char_w_alignment(&BYTE_CODE, (char)reg_ID, ALIGN_TO_INT);
+
+	return ASM_ALL_GOOD;
+}
+
+static asm_err_t write_stack_cmd(Compile_manager *manager, const Ir_cmd *cmd)
+{
+	char cmd_type = (char)IR_OPS[cmd->op].cmd;
+	int  address  = (int)cmd->arg.value;
+
+	write_to_buf(&BYTE_CODE, &cmd_type, sizeof(char));
+
+	switch(cmd->arg.type)
+	{
+		case IR_IMM_ARG:
+		{
+			if(cmd->op != IR_PUSH)
+			{
+				break;
+			}
+
+			mask_buffer(&BYTE_CODE, IMM_MASK);
+			align_buffer(&BYTE_CODE, SIX_BYTE_ALIGNMENT);
+
+			write_to_buf(&BYTE_CODE, &cmd->arg.imm, sizeof(double));
+
+			return ASM_ALL_GOOD;
+		}
+		case IR_REG_ARG:
+		{
+			mask_buffer(&BYTE_CODE, REG_MASK);
+			align_buffer(&BYTE_CODE, TWO_BYTE_ALIGNMENT);
+
+			return write_reg(manager, cmd->arg.value);
+		}
+		case IR_RAM_IMM_ARG:
+		{
+			mask_buffer(&BYTE_CODE, RAM_MASK | IMM_MASK);
+			align_buffer(&BYTE_CODE, TWO_BYTE_ALIGNMENT);
+
+			write_to_buf(&BYTE_CODE, &address, sizeof(int));
+
+			return ASM_ALL_GOOD;
+		}
+		case IR_RAM_REG_ARG:
+		{
+			mask_buffer(&BYTE_CODE, RAM_MASK | REG_MASK);
+			align_buffer(&BYTE_CODE, TWO_BYTE_ALIGNMENT);
+
+			return write_reg(manager, cmd->arg.value);
+		}
+		case IR_NO_ARG:
+		case IR_LABEL_ARG:
+		case IR_RANGE_ARG:
+		case IR_VAR_ARG:
+		default:
+		{
+			break;
+		}
+	}
+
+	LOG("ERROR: %s has an invalid operand of type %d.\n", IR_OPS[cmd->op].name, cmd->arg.type);
+
+	return ASM_INVALID_IR;
+}
+
+static asm_err_t write_ir_cmd(Compile_manager *manager, const Ir_program *program, const Ir_cmd *cmd)
+{
+	if(cmd->op == IR_LABEL)
+	{
+		define_label(manager, program->labels[cmd->arg.value]);
+
+		return ASM_ALL_GOOD;
+	}
+
+	if(cmd->op == IR_PUSH || cmd->op == IR_POP)
+	{
+		return write_stack_cmd(manager, cmd);
+	}
+
+	if(cmd->op == IR_CALL_START)
+	{
+		LOG("ERROR: the call sequence was not lowered by the register allocator.\n");
+
+		return ASM_INVALID_IR;
+	}
+
+	char cmd_type = (char)IR_OPS[cmd->op].cmd;
+
+	if(ir_is_jump(cmd->op))
+	{
+		if(cmd->arg.type != IR_LABEL_ARG || cmd->arg.value >= program->labels_amount)
+		{
+			LOG("ERROR: %s has no label.\n", IR_OPS[cmd->op].name);
+
+			return ASM_INVALID_IR;
+		}
+
+		size_t jmp_IP_pos = get_ip_pos(manager);
+
+		write_char_w_alignment(&BYTE_CODE, cmd_type, ALIGN_TO_INT);
+		write_to_buf(&BYTE_CODE, &POISON_JMP_POS, sizeof(int));
+
+		reference_label(manager, program->labels[cmd->arg.value], jmp_IP_pos);
+
+		return ASM_ALL_GOOD;
+	}
+
+	write_char_w_alignment(&BYTE_CODE, cmd_type, ALIGN_TO_DOUBLE);
+
+	if(cmd->op == IR_DRAW)
+	{
+		unsigned int head = (unsigned int)cmd->arg.value;
+		unsigned int end  = (unsigned int)cmd->arg.end;
+
+		write_to_buf(&BYTE_CODE, &head, sizeof(int));
+		write_to_buf(&BYTE_CODE, &end,  sizeof(int));
+	}
+
+	return ASM_ALL_GOOD;
+}
+
+static asm_err_t ir_cmds_process(Compile_manager *manager, const Ir_program *program)
+{
+	// a command takes two slots at most, the main jump takes one more
+	size_t byte_code_size = (program->size + 1) * sizeof(double) * B_CODE_SIZE_COEFF;
+
+	CALLOC(BYTE_CODE.buf, byte_code_size, char);
+	manager->byte_code_start = BYTE_CODE.buf;
+
+	BYTE_CODE.length = byte_code_size;
+
+	asm_err_t error_code = label_table_ctor(&(manager->label_table),
+											program->size + program->labels_amount + 1);
+	if(error_code != ASM_ALL_GOOD)
+	{
+		return error_code;
+	}
+
+	write_main_jmp(manager);
+
+	for(size_t cmd_ID = 0; cmd_ID < program->size; cmd_ID++)
+	{
+		if(fuse_ir_cmds(manager, program, &cmd_ID))
+		{
+			continue;
+		}
+
+		error_code = write_ir_cmd(manager, program, &CMD(cmd_ID));
+		if(error_code != ASM_ALL_GOOD)
+		{
+			return error_code;
+		}
+	}
+
+	// unlike the text, the program knows where it ends, so no trailing zeros are guessed
+	BYTE_CODE.length = (size_t)(BYTE_CODE.buf - manager->byte_code_start);
+	BYTE_CODE.buf    = manager->byte_code_start;
+
+	log_labels(&(manager->label_table));
+
+	return check_labels(manager);
+}
+
+#undef CALL
+
+#define CALL(...)						\
+	error_code = __VA_ARGS__;			\
+	if(error_code != ASM_ALL_GOOD)		\
+	{									\
+		manager_dtor(&manager);			\
+		return error_code;				\
+	}
+
+asm_err_t ir_assemble(const Ir_program *program, char **byte_code, size_t *byte_code_length)
+{
+	Compile_manager manager = {};
+	init_manager(&manager);
+	asm_err_t error_code = ASM_ALL_GOOD;
+
+	CALL(ir_cmds_process(&manager, program));
+
+	*byte_code        = manager.byte_code_start;
+	*byte_code_length = manager.byte_code.length;
+
+	// the byte code is the caller's now
+	manager.byte_code_start = NULL;
+
+	manager_dtor(&manager);
+
+	return ASM_ALL_GOOD;
+}
+
+asm_err_t ir_compile(const Ir_program *program, const char *file_name)
+{
+	Compile_manager manager = {};
+	init_manager(&manager);
+	asm_err_t error_code = ASM_ALL_GOOD;
+
+	CALL(ir_cmds_process(&manager, program));
+
+	CALL(pack_byte_code(&manager));
+
+	CALL(create_bin(&manager, file_name));
+
+	CALL(create_label_map(&manager, file_name));
+
+	manager_dtor(&manager);
+
+	return ASM_ALL_GOOD;
+}
+
+#undef CALL
+#undef CMD
+#undef BYTE_CODE
+#undef ALLOCATION_CHECK
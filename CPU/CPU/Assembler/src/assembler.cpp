@@ -35,25 +35,66 @@
 		return ASM_UNABLE_TO_OPEN_FILE;								\
 	}
 
-#define CALL(...)				\
-	error_code = __VA_ARGS__;	\
+/**
+ * @def CALL_OR_FREE(...)
+ * @brief Macro to call a compilation step, which frees the manager if the step fails.
+ */
+#define CALL_OR_FREE(...)				\
+	error_code = __VA_ARGS__;			\
+	if(error_code != ASM_ALL_GOOD)		\
+	{									\
+		manager_dtor(&manager);			\
+		return error_code;				\
+	}
+
+asm_err_t assemble(Compile_manager *manager)
+{
+	asm_err_t error_code = cmds_process(manager);
+	CHECK_ERROR;
+
+	error_code = check_labels(manager);
 	CHECK_ERROR;
 
+	return reduce_buffer_size(manager);
+}
+
 asm_err_t compile(const char *file_name)
 {
 	Compile_manager manager = {};
 	init_manager(&manager);
 	asm_err_t error_code = ASM_ALL_GOOD;
 
-	CALL(parse_human_code(&manager, file_name));
+	CALL_OR_FREE(parse_human_code(&manager, file_name));
+
+	CALL_OR_FREE(assemble(&manager));
+
+	CALL_OR_FREE(pack_byte_code(&manager));
+
+	CALL_OR_FREE(create_bin(&manager, file_name));
+
+	CALL_OR_FREE(create_label_map(&manager, file_name));
+
+	manager_dtor(&manager);
+
+	return ASM_ALL_GOOD;
+}
+
+asm_err_t compile_buffer(const char *human_code, size_t length,
+						 char **byte_code, size_t *byte_code_length)
+{
+	Compile_manager manager = {};
+	init_manager(&manager);
+	asm_err_t error_code = ASM_ALL_GOOD;
 
-	CALL(cmds_process(&manager));
+	CALL_OR_FREE(load_human_code(&manager, human_code, length));
 
-	CALL(arrange_labels(&manager));
+	CALL_OR_FREE(assemble(&manager));
 
-	CALL(reduce_buffer_size(&manager));
+	*byte_code        = manager.byte_code_start;
+	*byte_code_length = manager.byte_code.length;
 
-	CALL(create_bin(&manager, file_name));
+	// the byte code is the caller's now
+	manager.byte_code_start = NULL;
 
 	manager_dtor(&manager);
 
@@ -61,5 +102,6 @@ asm_err_t compile(const char *file_name)
 }
 
 #undef CHECK_ERROR
+#undef CALL_OR_FREE
 #undef FILE_PTR_CHECK
 #undef REDUCED_BYTE_CODE
@@ -26,18 +26,12 @@
  * @param buf Pointer to the buffer.
  * @param size Size of the buffer.
  */
-#define LOG_BUFFER(buf, size)\
-    LOG("\nBuffer log from %s:\n", __func__);\
-    print_binary(buf, size, #buf, asm_write_log)
-
-/**
- * @def CURRENT_JMP_PTR
- * @brief Macro to get the current jump pointer.
- *
- * This macro retrieves the current jump pointer from the 'jmp_poses_w_carriage' structure.
- */
-#define CURRENT_JMP_PTR\
-    jmp_poses_w_carriage->JMP_poses[jmp_poses_w_carriage->carriage]
+#define LOG_BUFFER(buf, size)								\
+    LOG("\nBuffer log from %s:\n", __func__);				\
+    if(LOG_LEVEL_DEBUG >= LOG_MIN_LEVEL)					\
+    {														\
+        print_binary(buf, size, #buf, asm_write_log);		\
+    }
 
 /**
  * @def BYTE_CODE
@@ -62,33 +56,69 @@
 
 asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 {
-	WITH_OPEN
-	(
-		file_name, "r", human_code,
-
-		size_t human_code_file_length = get_file_length(human_code);
-		manager->human_code_buffer =
-		{
-			.length = human_code_file_length,
-		};
-		CALLOC(manager->human_code_buffer.buf, human_code_file_length, char);
+	// the file is split where it is mapped, without a copy
+	manager->strings = map_parse(file_name);
 
-		FREAD(manager->human_code_buffer.buf, sizeof(char),
-		      manager->human_code_buffer.length, human_code);
-	)
+	if(manager->strings.lines == NULL)
+	{
+		LOG("\nERROR: Unable to read %s\n", file_name);
+		return ASM_UNABLE_TO_OPEN_FILE;
+	}
 
-	manager->strings.amount = count_file_lines(manager->human_code_buffer);
 	LOG("amount of lines: %lu\n", manager->strings.amount);
 
-	CALLOC(manager->strings.tokens, manager->strings.amount, char *);
+	return ASM_ALL_GOOD;
+}
+
+asm_err_t load_human_code(Compile_manager *manager, const char *human_code, size_t length)
+{
+	manager->strings.text =
+	{
+		.length = length,
+	};
+	// the '\0' after the text ends the last line if it has no '\n'
+	CALLOC(manager->strings.text.buf, length + 1, char);
 
-	ptr_arranger(manager->strings.tokens, manager->human_code_buffer); //rename
+	memcpy(manager->strings.text.buf, human_code, length);
+
+	return arrange_human_code(manager);
+}
+
+asm_err_t arrange_human_code(Compile_manager *manager)
+{
+	if(!split_lines(&(manager->strings)))
+	{
+		LOG("Unable to allocate the lines.\n");
+		return ASM_UNABLE_TO_ALLOCATE;
+	}
+
+	LOG("amount of lines: %lu\n", manager->strings.amount);
 
 	return ASM_ALL_GOOD;
 }
 
-#define COMMANDS\
-	manager->strings.tokens
+const char *asm_line(Compile_manager *manager, size_t line_ID)
+{
+	size_t slot_ID = line_ID % ASM_LINE_WINDOW;
+	char  *slot    = manager->line_window + slot_ID * (manager->strings.max_length + 1);
+
+	if(manager->window_lines[slot_ID] != line_ID)
+	{
+		copy_line(&(manager->strings), line_ID, slot);
+
+		manager->window_lines[slot_ID] = line_ID;
+	}
+
+	return slot;
+}
+
+const char *line_text(const Compile_manager *manager, size_t line_ID)
+{
+	return manager->strings.text.buf + manager->strings.lines[line_ID].offset;
+}
+
+#define COMMAND(line_ID)\
+	asm_line(manager, line_ID)
 
 #define WRITE_BYTE(ptr)\
 	write_to_buf(&BYTE_CODE, ptr, sizeof(char));
@@ -110,7 +140,7 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
  			mask_buffer(&(manager->byte_code), RAM_MASK | REG_MASK);	\
  			ALIGN_BUF(TWO_BYTE_ALIGNMENT);								\
  																		\
-			reg_type = GET_REG_TYPE_RAM(cmd_name);						\
+			GET_REG_TYPE(cmd_arg + 1);									\
  			write_char_w_alignment(&BYTE_CODE, reg_type, ALIGN_TO_INT);	\
  		}																\
  		else															\
@@ -138,7 +168,8 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 	{																		\
 		cmd_type = (Command)num;											\
 		WRITE_BYTE(&cmd_type);												\
-		char *cmd_arg = COMMANDS[line_ID] + LEN(cmd_name) + SPACE_SKIP;		\
+		const char *cmd_arg =												\
+			COMMAND(line_ID) + LEN(cmd_name) + SPACE_SKIP;					\
 																			\
 		PROCESS_RAM_ARG(cmd_name)											\
 		else if(sscanf(cmd_arg, "%lf", &argument_value) == 0)				\
@@ -146,7 +177,7 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 			mask_buffer(&(manager->byte_code), REG_MASK);					\
 			ALIGN_BUF(TWO_BYTE_ALIGNMENT);									\
 																			\
-			reg_type = GET_REG_TYPE(cmd_name);								\
+			GET_REG_TYPE(cmd_arg);											\
 			write_char_w_alignment(&BYTE_CODE, reg_type, ALIGN_TO_INT);		\
 																			\
 		}																	\
@@ -175,7 +206,8 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 	{																		\
 		cmd_type = (Command)num;											\
 		WRITE_BYTE(&cmd_type);												\
-		char *cmd_arg = COMMANDS[line_ID] + LEN(cmd_name) + SPACE_SKIP;		\
+		const char *cmd_arg =												\
+			COMMAND(line_ID) + LEN(cmd_name) + SPACE_SKIP;					\
 																			\
 		PROCESS_RAM_ARG(cmd_name)											\
 		else																\
@@ -183,7 +215,7 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 			mask_buffer(&(manager->byte_code), REG_MASK);					\
 			ALIGN_BUF(TWO_BYTE_ALIGNMENT);									\
 																			\
-			reg_type = GET_REG_TYPE(cmd_name);								\
+			GET_REG_TYPE(cmd_arg);											\
 			write_char_w_alignment(&BYTE_CODE, reg_type, ALIGN_TO_INT);		\
 		}																	\
 	}
@@ -218,21 +250,21 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 #define WRITE_CMD_W_LABEL_ARG(cmd_name, num)								\
 	else if(IS_COMMAND(cmd_name))											\
 	{																		\
+		size_t jmp_IP_pos = get_ip_pos(manager);							\
+																			\
 		write_char_w_alignment(&BYTE_CODE, (char)num, ALIGN_TO_INT);		\
 		WRITE_INT(&POISON_JMP_POS);											\
 																			\
-		CURRENT_JMP.name = COMMANDS[line_ID] + LEN(cmd_name) + 1;			\
-		CURRENT_JMP.IP_pos = (int)get_ip_pos(manager) - 1;					\
-																			\
-		manager->jmp_poses_w_carriage.carriage++;							\
+		reference_label(manager,											\
+						line_text(manager, line_ID) + LEN(cmd_name) + 1,	\
+						jmp_IP_pos);										\
 	}
 
 /**
  * @def WRITE_LABEL
- * @brief Macro to write a label to the byte code buffer.
+ * @brief Macro to define a label at the current position of the byte code buffer.
  *
- * This macro writes a label to the byte code buffer. It then writes
- * the label name and its position to the byte code buffer.
+ * The jumps assembled before the label are patched right away.
  *
  * @param cmd_name The name of the command.
  * @param num The numerical representation of the command.
@@ -240,10 +272,7 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 #define WRITE_LABEL(cmd_name, num)													\
 	else if(IS_COMMAND(cmd_name))													\
 	{																				\
-		CURRENT_LABEL.name   = COMMANDS[line_ID] + LEN(":");						\
-		CURRENT_LABEL.IP_pos = get_ip_pos(manager);									\
-																					\
-		manager->labels_w_carriage.carriage++;										\
+		define_label(manager, line_text(manager, line_ID) + LEN(":"));				\
 	}
 
 #define WRITE_CMD_W_2_ARGS(cmd_name, num)									\
@@ -252,7 +281,7 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 		cmd_type = (Command)num;											\
 		write_char_w_alignment(&BYTE_CODE, (char)num, ALIGN_TO_DOUBLE);		\
 																			\
-		char *cmd_arg = COMMANDS[line_ID] + LEN(cmd_name);					\
+		const char *cmd_arg = COMMAND(line_ID) + LEN(cmd_name);				\
 																			\
 		unsigned int head  = 0;												\
 		unsigned int end   = 0;												\
@@ -264,6 +293,15 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name)
 																			\
 	}
 
+/**
+ * @def WRITE_FUSED
+ * @brief Macro for fused commands, which are written by fuse_cmds only.
+ *
+ * @param cmd_name The name of the command.
+ * @param num The numerical representation of the command.
+ */
+#define WRITE_FUSED(cmd_name, num)
+
 /**
  * @def DEF_CMD
  * @brief Macro to define a command with different argument types.
@@ -288,54 +326,52 @@ asm_err_t cmds_process(Compile_manager *manager)
 
 	manager->byte_code.length = byte_code_size;
 
-	manager->labels_w_carriage =
+	CALLOC(manager->line_window, ASM_LINE_WINDOW * (manager->strings.max_length + 1), char);
+
+	for(size_t slot_ID = 0; slot_ID < ASM_LINE_WINDOW; slot_ID++)
 	{
-		.carriage = 0,
-	};
-	CALLOC(manager->labels_w_carriage.labels, amount_of_lines, Label)
+		manager->window_lines[slot_ID] = NO_LINE;
+	}
 
-	manager->jmp_poses_w_carriage =
+	// every line mentions one label at most, and the main jump adds one more
+	asm_err_t table_error = label_table_ctor(&(manager->label_table), amount_of_lines + 1);
+	if(table_error != ASM_ALL_GOOD)
 	{
-		.carriage = 0,
-	};
-	CALLOC(manager->jmp_poses_w_carriage.JMP_poses, amount_of_lines, JMP_pos);
+		return table_error;
+	}
 
-	write_main_jmp(&BYTE_CODE, &(manager->jmp_poses_w_carriage));
+	write_main_jmp(manager);
 
 	char cmd_type = (char)VOID;
 	elem_t argument_value = NAN;
 	char reg_type = 0;
+	unsigned char reg_ID = 0;
 	unsigned int RAM_address = 0;
 
-	#define CURRENT_LABEL\
-		manager->labels_w_carriage.labels[manager->labels_w_carriage.carriage]
-
-	#define CURRENT_JMP\
-		manager->jmp_poses_w_carriage.JMP_poses[manager->jmp_poses_w_carriage.carriage]
-
-	#define GET_REG_TYPE(cmd)\
-		*(COMMANDS[line_ID] + LEN(cmd) + SPACE_SKIP + LETTER_SKIP) - 'a'
-
-	#define GET_REG_TYPE_RAM(cmd)\
-		*(COMMANDS[line_ID] + LEN(cmd) + SPACE_SKIP + 2 * LETTER_SKIP) - 'a'
+	#define GET_REG_TYPE(reg_name)\
+		if(read_reg_name(reg_name, &reg_ID) == 0)								\
+		{																		\
+			LOG("ERROR: unknown register in \"%s\".\n", COMMAND(line_ID));	\
+																				\
+			return ASM_UNKNOWN_REGISTER;										\
+		}																		\
+		reg_type = (char)reg_ID;
 
 	#define IS_COMMAND(cmd)\
-		!strncmp(COMMANDS[line_ID], cmd, LEN(cmd))
+		!strncmp(COMMAND(line_ID), cmd, LEN(cmd))
 
-	FOR(size_t line_ID = 0; line_ID < amount_of_lines; line_ID++)
+	// generated programs easily exceed CYCLE_LIMIT lines, so the loop isn't a FOR one
+	for(size_t line_ID = 0; line_ID < amount_of_lines; line_ID++)
 	{
-		if(false)
+		if(fuse_cmds(manager, &line_ID))
 		{
 			;
 		}
 		#include "cmd_definitions.h"
-
-		FOR_END;
 	}
 
 	LOG_BUFFER(manager->byte_code_start, BYTE_CODE.length);
-	log_labels(&(manager->labels_w_carriage));
-	log_jmps(&(manager->jmp_poses_w_carriage));
+	log_labels(&(manager->label_table));
 
 	manager->byte_code.buf = manager->byte_code_start;
 
@@ -347,26 +383,364 @@ asm_err_t cmds_process(Compile_manager *manager)
 #undef WRITE_CMD_W_LABEL_ARG
 #undef WRITE_CMD_W_NO_ARG
 #undef WRITE_LABEL
+#undef WRITE_FUSED
 #undef DEF_CMD
-#undef CURRENT_LABEL
 #undef GET_REG_TYPE
 #undef IS_COMMAND
-#undef CURRENT_JMP
 
-asm_err_t write_main_jmp(struct Buffer_w_info *byte_code,
-					   JMP_poses_w_carriage *jmp_poses_w_carriage)
+static const Fusion ARITHM_FUSIONS[] =
+{
+	{"add",  IR_ADD,  ADD_FUSED,  ADD_FUSED,  false},
+	{"sub",  IR_SUB,  SUB_FUSED,  VOID,       false},
+	{"mul",  IR_MUL,  MUL_FUSED,  MUL_FUSED,  false},
+	{"div",  IR_DIV,  DIV_FUSED,  VOID,       false},
+	{"iadd", IR_IADD, IADD_FUSED, IADD_FUSED, true },
+	{"isub", IR_ISUB, ISUB_FUSED, VOID,       true },
+	{"imul", IR_IMUL, IMUL_FUSED, IMUL_FUSED, true },
+};
+
+static const Fusion JUMP_FUSIONS[] =
+{
+	{"jae",  IR_JAE,  JAE_FUSED,  JBE_FUSED,  false},
+	{"ja",   IR_JA,   JA_FUSED,   JB_FUSED,   false},
+	{"jbe",  IR_JBE,  JBE_FUSED,  JAE_FUSED,  false},
+	{"jb",   IR_JB,   JB_FUSED,   JA_FUSED,   false},
+	{"je",   IR_JE,   JE_FUSED,   JE_FUSED,   false},
+	{"jne",  IR_JNE,  JNE_FUSED,  JNE_FUSED,  false},
+	{"ijae", IR_IJAE, IJAE_FUSED, IJBE_FUSED, true },
+	{"ija",  IR_IJA,  IJA_FUSED,  IJB_FUSED,  true },
+	{"ijbe", IR_IJBE, IJBE_FUSED, IJAE_FUSED, true },
+	{"ijb",  IR_IJB,  IJB_FUSED,  IJA_FUSED,  true },
+	{"ije",  IR_IJE,  IJE_FUSED,  IJE_FUSED,  true },
+	{"ijne", IR_IJNE, IJNE_FUSED, IJNE_FUSED, true },
+};
+
+bool fuse_cmds(Compile_manager *manager, size_t *line_ID)
+{
+	size_t first_line = *line_ID;
+
+	if(first_line + 2 >= manager->strings.amount)
+	{
+		return false;
+	}
+
+	unsigned char reg_A   = 0;
+	unsigned char reg_B   = 0;
+	unsigned char reg_dst = 0;
+	double        imm     = 0;
+	bool          has_imm = false;
+	bool          swapped = false;
+
+	if(!get_reg_operand(COMMAND(first_line), "push", &reg_A))
+	{
+		if(!get_imm_operand(COMMAND(first_line), &imm) ||
+		   !get_reg_operand(COMMAND(first_line + 1), "push", &reg_A))
+		{
+			return false;
+		}
+
+		has_imm = true;
+		swapped = true;
+	}
+	else if(!get_reg_operand(COMMAND(first_line + 1), "push", &reg_B))
+	{
+		if(!get_imm_operand(COMMAND(first_line + 1), &imm))
+		{
+			return false;
+		}
+
+		has_imm = true;
+	}
+
+	const char *cmd_line   = COMMAND(first_line + 2);
+	size_t      last_line  = first_line + 2;
+	char        mode       = (char)(has_imm ? IMM_MASK : 0);
+	bool        is_jump    = false;
+
+	const Fusion *fusion = find_fusion(ARITHM_FUSIONS, sizeof(ARITHM_FUSIONS) / sizeof(Fusion),
+									   cmd_line, false);
+
+	if(fusion == NULL)
+	{
+		fusion = find_fusion(JUMP_FUSIONS, sizeof(JUMP_FUSIONS) / sizeof(Fusion),
+							 cmd_line, true);
+		is_jump = true;
+	}
+
+	if(fusion == NULL)
+	{
+		return false;
+	}
+
+	char fused_num = swapped ? fusion->swapped_num : fusion->fused_num;
+
+	if(fused_num == VOID || !fusion_fits_reg(fusion, reg_A) || (!has_imm && !fusion_fits_reg(fusion, reg_B)))
+	{
+		return false;
+	}
+
+	// a result of the other bank is popped by the pop itself
+	unsigned char popped = 0;
+
+	if(!is_jump && last_line + 1 < manager->strings.amount &&
+	   get_reg_operand(COMMAND(last_line + 1), "pop", &popped) && fusion_fits_reg(fusion, popped))
+	{
+		reg_dst = popped;
+		mode   |= REG_MASK;
+		last_line++;
+	}
+
+	Fused_cmd fused =
+	{
+		.num     = fused_num,
+		.mode    = mode,
+		.reg_A   = reg_A,
+		.reg_B   = reg_B,
+		.reg_dst = reg_dst,
+		.imm     = imm,
+		.label   = is_jump ? line_text(manager, first_line + 2) + strlen(fusion->name) + SPACE_SKIP : NULL,
+	};
+
+	write_fused(manager, &fused);
+
+	LOG("Fused lines %lu-%lu into command %d.\n", first_line, last_line, fused_num);
+
+	*line_ID = last_line;
+
+	return true;
+}
+
+bool get_reg_operand(const char *line, const char *cmd_name, unsigned char *reg)
+{
+	size_t name_len = strlen(cmd_name);
+
+	if(strncmp(line, cmd_name, name_len) != 0 || line[name_len] != ' ')
+	{
+		return false;
+	}
+
+	size_t reg_len = read_reg_name(line + name_len + SPACE_SKIP, reg);
+
+	return reg_len != 0 && line[name_len + SPACE_SKIP + reg_len] == '\0';
+}
+
+bool get_imm_operand(const char *line, double *imm)
+{
+	if(strncmp(line, "push ", LEN("push ")) != 0)
+	{
+		return false;
+	}
+
+	const char *cmd_arg = line + LEN("push ");
+
+	return *cmd_arg != '[' && *cmd_arg != 'r' && sscanf(cmd_arg, "%lf", imm) == 1;
+}
+
+const Fusion *find_ir_fusion(const Fusion *fusions, size_t amount, Ir_op op)
+{
+	for(size_t fusion_ID = 0; fusion_ID < amount; fusion_ID++)
+	{
+		if(fusions[fusion_ID].op == op)
+		{
+			return &fusions[fusion_ID];
+		}
+	}
+
+	return NULL;
+}
+
+const Fusion *find_fusion_by_op(Ir_op op, bool *is_jump)
+{
+	const Fusion *fusion = find_ir_fusion(ARITHM_FUSIONS, sizeof(ARITHM_FUSIONS) / sizeof(Fusion), op);
+
+	*is_jump = fusion == NULL;
+
+	if(fusion == NULL)
+	{
+		fusion = find_ir_fusion(JUMP_FUSIONS, sizeof(JUMP_FUSIONS) / sizeof(Fusion), op);
+	}
+
+	return fusion;
+}
+
+bool fusion_fits_reg(const Fusion *fusion, unsigned char reg)
+{
+	return is_int_reg(reg) == fusion->is_int;
+}
+
+void write_fused(Compile_manager *manager, const Fused_cmd *fused)
+{
+	size_t fused_IP_pos = get_ip_pos(manager);
+	int    int_arg      = (fused->label != NULL) ? POISON_JMP_POS : (int)fused->reg_dst;
+
+	write_to_buf(&BYTE_CODE, &fused->num,   sizeof(char));
+	write_to_buf(&BYTE_CODE, &fused->mode,  sizeof(char));
+	write_to_buf(&BYTE_CODE, &fused->reg_A, sizeof(char));
+	write_to_buf(&BYTE_CODE, &fused->reg_B, sizeof(char));
+	write_to_buf(&BYTE_CODE, &int_arg,      sizeof(int));
+
+	if(fused->mode & IMM_MASK)
+	{
+		write_to_buf(&BYTE_CODE, &fused->imm, sizeof(double));
+	}
+
+	if(fused->label != NULL)
+	{
+		reference_label(manager, fused->label, fused_IP_pos);
+	}
+}
+
+const Fusion *find_fusion(const Fusion *fusions, size_t amount,
+						  const char *line, bool has_label_arg)
+{
+	for(size_t fusion_ID = 0; fusion_ID < amount; fusion_ID++)
+	{
+		size_t name_len = strlen(fusions[fusion_ID].name);
+
+		if(strncmp(line, fusions[fusion_ID].name, name_len) == 0 &&
+		   line[name_len] == (has_label_arg ? ' ' : '\0'))
+		{
+			return &fusions[fusion_ID];
+		}
+	}
+
+	return NULL;
+}
+
+asm_err_t write_main_jmp(Compile_manager *manager)
 {
-	write_char_w_alignment(byte_code, JMP, ALIGN_TO_INT);
+	write_char_w_alignment(&BYTE_CODE, JMP, ALIGN_TO_INT);
 
-	write_to_buf(byte_code, &POISON_JMP_POS, sizeof(int));
+	write_to_buf(&BYTE_CODE, &POISON_JMP_POS, sizeof(int));
 
-	CURRENT_JMP_PTR.name   = MAIN_JMP_NAME;
-	CURRENT_JMP_PTR.IP_pos = 0;
-	jmp_poses_w_carriage->carriage++;
+	reference_label(manager, MAIN_JMP_NAME, 0);
 
 	return ASM_ALL_GOOD;
 }
 
+asm_err_t label_table_ctor(Label_table *table, size_t capacity)
+{
+	table->amount         = 0;
+	table->capacity       = capacity;
+	table->fixups_amount  = 0;
+	table->buckets_amount = 1;
+
+	while(table->buckets_amount < capacity * LABEL_BUCKETS_COEFF)
+	{
+		table->buckets_amount *= 2;
+	}
+
+	CALLOC(table->labels,  capacity,              Label);
+	CALLOC(table->fixups,  capacity,              Fixup);
+	CALLOC(table->buckets, table->buckets_amount, size_t);
+
+	return ASM_ALL_GOOD;
+}
+
+void label_table_dtor(Label_table *table)
+{
+	free(table->labels);
+	free(table->fixups);
+	free(table->buckets);
+
+	table->labels         = NULL;
+	table->fixups         = NULL;
+	table->buckets        = NULL;
+	table->amount         = 0;
+	table->capacity       = 0;
+	table->fixups_amount  = 0;
+	table->buckets_amount = 0;
+}
+
+Label *get_label(Label_table *table, const char *name)
+{
+	// a name of the text ends with its line
+	size_t name_len = strcspn(name, " \t\r\n");
+	size_t hash     = hash_bytes(HASH_OFFSET_BASIS, name, name_len);
+	size_t mask     = table->buckets_amount - 1;
+
+	size_t bucket_ID = hash & mask;
+
+	// the table has twice as many buckets as labels, so the probing always meets an empty one
+	while(table->buckets[bucket_ID] != 0)
+	{
+		Label *label = &table->labels[table->buckets[bucket_ID] - 1];
+
+		if(label->hash == hash && label->name_len == name_len &&
+		   !strncmp(label->name, name, name_len))
+		{
+			return label;
+		}
+
+		bucket_ID = (bucket_ID + 1) & mask;
+	}
+
+	Label *label = &table->labels[table->amount];
+
+	label->name     = name;
+	label->name_len = name_len;
+	label->hash     = hash;
+	label->IP_pos   = 0;
+	label->defined  = false;
+	label->fixups   = NO_FIXUP;
+
+	table->buckets[bucket_ID] = ++table->amount;
+
+	return label;
+}
+
+void define_label(Compile_manager *manager, const char *name)
+{
+	Label *label = get_label(&(manager->label_table), name);
+
+	if(label->defined)
+	{
+		LOG("WARNING: label %.*s is defined again, the first one is kept.\n",
+			(int)label->name_len, label->name);
+
+		return;
+	}
+
+	label->defined = true;
+	label->IP_pos  = get_ip_pos(manager);
+
+	for(size_t fixup_ID = label->fixups; fixup_ID != NO_FIXUP;
+		fixup_ID = manager->label_table.fixups[fixup_ID].next)
+	{
+		patch_jump(manager, manager->label_table.fixups[fixup_ID].IP_pos, label->IP_pos);
+	}
+
+	label->fixups = NO_FIXUP;
+}
+
+void reference_label(Compile_manager *manager, const char *name, size_t IP_pos)
+{
+	Label_table *table = &(manager->label_table);
+	Label       *label = get_label(table, name);
+
+	if(label->defined)
+	{
+		patch_jump(manager, IP_pos, label->IP_pos);
+
+		return;
+	}
+
+	Fixup *fixup = &table->fixups[table->fixups_amount];
+
+	fixup->IP_pos = IP_pos;
+	fixup->next   = label->fixups;
+
+	label->fixups = table->fixups_amount++;
+}
+
+void patch_jump(Compile_manager *manager, size_t IP_pos, size_t label_pos)
+{
+	int jmp_arg = (int)label_pos;
+
+	memcpy(manager->byte_code_start + IP_pos * sizeof(double) + JMP_ARG_OFFSET,
+		   &jmp_arg, sizeof(int));
+}
+
 asm_err_t write_to_buf(struct Buffer_w_info *byte_code,
 					 const void *value, size_t size)
 {
@@ -407,107 +781,39 @@ asm_err_t write_char_w_alignment(struct Buffer_w_info *byte_code,
 	return ASM_ALL_GOOD;
 }
 
-asm_err_t log_labels(struct Labels_w_carriage *labels_w_carriage)
+asm_err_t log_labels(Label_table *table)
 {
 	LOG("\nLABELS\n");
 	LOG("label_ID        IP_pos        name\n");
-	FOR(size_t label_ID = 0; label_ID < labels_w_carriage->carriage; label_ID++)
-	{
-		LOG("%8.lu%14.lu        %s\n",
-			label_ID, labels_w_carriage->labels[label_ID].IP_pos,
-			labels_w_carriage->labels[label_ID].name);
-
-		FOR_END
-	}
-
-	return ASM_ALL_GOOD;
-}
-
-asm_err_t log_jmps(struct JMP_poses_w_carriage *jmp_poses_w_carriage)
-{
-	LOG("\nJMPS\n");
-	LOG("JMP_ID        IP_pos        name\n");
-	FOR(size_t JMP_ID = 0; JMP_ID < jmp_poses_w_carriage->carriage; JMP_ID++)
+	for(size_t label_ID = 0; label_ID < table->amount; label_ID++)
 	{
-		LOG("%6.lu%14.lu        %s\n",
-			JMP_ID, jmp_poses_w_carriage->JMP_poses[JMP_ID].IP_pos,
-			jmp_poses_w_carriage->JMP_poses[JMP_ID].name);
-
-		FOR_END
+		LOG("%8.lu%14.lu        %.*s%s\n",
+			label_ID, table->labels[label_ID].IP_pos,
+			(int)table->labels[label_ID].name_len, table->labels[label_ID].name,
+			table->labels[label_ID].defined ? "" : " (undefined)");
 	}
 
 	return ASM_ALL_GOOD;
 }
 
-#define CURRENT_JMP\
-	manager->jmp_poses_w_carriage.JMP_poses[jmp_ID]
-#define CURRENT_LABEL\
-	manager->labels_w_carriage.labels[label_ID]
-
-asm_err_t arrange_labels(Compile_manager *manager)
+asm_err_t check_labels(Compile_manager *manager)
 {
 	asm_err_t error_code = ASM_ALL_GOOD;
 
-	const size_t amount_of_jmps   = manager->jmp_poses_w_carriage.carriage;
-	const size_t amount_of_labels = manager->labels_w_carriage.carriage;
-
-	bool label_found = false;
-
-	FOR(size_t jmp_ID = 0; jmp_ID < amount_of_jmps; jmp_ID++)
+	for(size_t label_ID = 0; label_ID < manager->label_table.amount; label_ID++)
 	{
-		LOG("Working on %s...\n", CURRENT_JMP);
+		Label *label = &manager->label_table.labels[label_ID];
 
-		FOR(size_t label_ID = 0; label_ID < amount_of_labels; label_ID++)
+		if(!label->defined)
 		{
-			LOG("\tIs it %s?\n", CURRENT_LABEL.name);
-			if(!strncmp(CURRENT_LABEL.name, CURRENT_JMP.name, strlen(CURRENT_JMP.name)))
-			{
-				LOG("\t\tYes. Fixing...\n");
-
-				label_found = true;
-
-				BYTE_CODE.buf += sizeof(double) *
-					(size_t)CURRENT_JMP.IP_pos + sizeof(int);
-
-
-				/* why sizeof(int) - 1 ???????????????????????????????????????????
-					почему то при записи без -1 затирается лишний байт
-					если записать sizeof(short) тоже записывается на один айт больше,
-					то есть от типа не зависит.
-					при использовании этой функции ранее проблем не возникало
-				*/
-				write_to_buf(&BYTE_CODE, &CURRENT_LABEL.IP_pos, sizeof(int) - 1);
-
-				BYTE_CODE.buf = manager->byte_code_start;
-
-				// LOG_BUFFER(FIXED_BYTE_CODE.buf, FIXED_BYTE_CODE.length);
-
-				break;
-			}
-			else
-			{
-				LOG("\t\tNo\n");
-			}
-
-			FOR_END
-		}
-
-		if(!label_found)
-		{
-			LOG("label for %s jmp doesn't exists\n", CURRENT_JMP.name);
+			LOG("label for %.*s jmp doesn't exists\n", (int)label->name_len, label->name);
 			error_code = LABEL_DOESNT_EXIST;
 		}
-
-		FOR_END
 	}
 
-	LOG_BUFFER(manager->byte_code_start, BYTE_CODE.length);
-
 	LOG("Byte_code size: %lu * sizeof(double) bytes\n",
 			 manager->byte_code.length / sizeof(double));
 
-	manager->byte_code.buf = manager->byte_code_start;
-
 	return error_code;
 }
 
@@ -526,7 +832,7 @@ asm_err_t reduce_buffer_size(Compile_manager *manager)
 	}
 	else
 	{
-		FOR(size_t carriage = 0; carriage < BYTE_CODE.length; carriage += sizeof(long))
+		for(size_t carriage = 0; carriage < BYTE_CODE.length; carriage += sizeof(long))
 		{
 			if(CURRENT_CHUNK == 0)
 			{
@@ -544,8 +850,6 @@ asm_err_t reduce_buffer_size(Compile_manager *manager)
 				non_zero_flag = false;
 				zero_flag = false;
 			}
-
-			FOR_END
 		}
 	}
 
@@ -562,6 +866,35 @@ asm_err_t reduce_buffer_size(Compile_manager *manager)
 	return ASM_ALL_GOOD;
 }
 
+asm_err_t pack_byte_code(Compile_manager *manager)
+{
+#ifdef ASM_LEGACY_BYTE_CODE
+	(void)manager;
+#else
+	char *compact = NULL;
+	CALLOC(compact, compact_code_bound(BYTE_CODE.length), char);
+
+	size_t compact_length = pack_compact_code(BYTE_CODE.buf, BYTE_CODE.length, compact);
+	if(compact_length == 0)
+	{
+		LOG("ERROR: Unable to pack the byte code.\n");
+		free(compact);
+
+		return ASM_INVALID_BYTE_CODE;
+	}
+
+	LOG("Packed %lu bytes of byte code into %lu.\n", BYTE_CODE.length, compact_length);
+
+	free(manager->byte_code_start);
+
+	BYTE_CODE.buf            = compact;
+	BYTE_CODE.length         = compact_length;
+	manager->byte_code_start = compact;
+#endif
+
+	return ASM_ALL_GOOD;
+}
+
 asm_err_t create_bin(Compile_manager *manager, const char *file_name)
 {
 	char *byte_code_file_name = create_file_name(file_name, ".bin");
@@ -580,25 +913,44 @@ asm_err_t create_bin(Compile_manager *manager, const char *file_name)
 	return ASM_ALL_GOOD;
 }
 
+asm_err_t create_label_map(Compile_manager *manager, const char *file_name)
+{
+	char *label_map_file_name = create_file_name(file_name, ".labels");
+	ALLOCATION_CHECK(label_map_file_name);
+
+	WITH_OPEN
+	(
+		label_map_file_name, "w", label_map,
+
+		free(label_map_file_name);
+
+		for(size_t label_ID = 0; label_ID < manager->label_table.amount; label_ID++)
+		{
+			const Label *label = &manager->label_table.labels[label_ID];
+
+			if(label->defined)
+			{
+				fprintf(label_map, "%lu %.*s\n", label->IP_pos, (int)label->name_len, label->name);
+			}
+		}
+	)
+
+	return ASM_ALL_GOOD;
+}
+
 asm_err_t manager_dtor(Compile_manager *manager)
 {
-	free(manager->byte_code.buf);
-	free(manager->human_code_buffer.buf);
-	free(manager->jmp_poses_w_carriage.JMP_poses);
-	free(manager->labels_w_carriage.labels);
-	free(manager->strings.tokens);
+	free(manager->byte_code_start);
+	free(manager->line_window);
+	strings_dtor(&(manager->strings));
+
+	label_table_dtor(&(manager->label_table));
 
 	manager->byte_code.buf                  = NULL;
- 	manager->human_code_buffer.buf          = NULL;
- 	manager->jmp_poses_w_carriage.JMP_poses = NULL;
- 	manager->labels_w_carriage.labels       = NULL;
- 	manager->strings.tokens                 = NULL;
+	manager->byte_code_start                = NULL;
+	manager->line_window                    = NULL;
 
 	manager->byte_code.length 				= 0;
-	manager->human_code_buffer.length 		= 0;
-	manager->jmp_poses_w_carriage.carriage 	= 0;
-	manager->labels_w_carriage.carriage 	= 0;
-	manager->strings.amount 				= 0;
 
 	return ASM_ALL_GOOD;
 }
@@ -617,17 +969,10 @@ asm_err_t init_manager(Compile_manager *manager)
 	manager->byte_code.buf                  = NULL;
 	manager->byte_code.length               = 0;
 
-	manager->human_code_buffer.buf          = NULL;
-	manager->human_code_buffer.length       = 0;
-
-	manager->jmp_poses_w_carriage.JMP_poses = NULL;
-	manager->jmp_poses_w_carriage.carriage  = 0;
+	manager->label_table                    = {};
 
-	manager->labels_w_carriage.labels       = NULL;
-	manager->labels_w_carriage.carriage     = 0;
-
-	manager->strings.tokens                 = NULL;
-	manager->strings.amount                 = 0;
+	manager->strings                        = {};
+	manager->line_window                    = NULL;
 
 	manager->byte_code_start                = NULL;
 
@@ -641,29 +986,17 @@ size_t get_ip_pos(Compile_manager *manager)
 
 void asm_write_log(const char *fmt, ...)
 {
-
-    static FILE *log_file = fopen("asm_log.txt", "w");
-
-    if (log_file == NULL)
-	{
-        perror("Error opening log_file");
-        return;
-    }
-
-    va_list args = NULL;
+    va_list args;
 
     va_start(args, fmt);
 
-    vfprintf(log_file, fmt, args);
+    log_vwrite(LOG_SINK_ASM, fmt, args);
 
     va_end(args);
 }
 
-#undef CURRENT_JMP
-#undef CURRENT_LABEL
 #undef FIXED_BYTE_CODE
 #undef LOG_BUFFER
-#undef CURRENT_JMP_PTR
 #undef BYTE_CODE
 #undef FILE_PTR_CHECK
 #undef ALLOCATION_CHECK
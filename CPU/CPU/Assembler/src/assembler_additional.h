@@ -10,6 +10,8 @@
 #include "../../../../File_parser/include/file_parser.h"
 #include "utils.h"
 #include "secondary.h"
+#include "compact_code.h"
+#include "asm_ir.h"
 
 /**
  * @brief Macro to log messages to a file.
@@ -18,12 +20,12 @@
  * Usage: LOG("Message to log");
  */
 #define LOG(...)\
-	asm_write_log(__VA_ARGS__);
+	LOG_AT(LOG_LEVEL_DEBUG, LOG_SINK_ASM, __VA_ARGS__);
 
 /**
- * @brief Logs a message to a file.
+ * @brief Logs a message into the assembler sink, for the callers which need a function.
  *
- * Logs a message to a file named "log.txt" with the specified format and additional information.
+ * It logs even if LOG_MIN_LEVEL is above LOG_LEVEL_DEBUG, so its callers check the level.
  *
  * @param fmt The format string for the log message.
  * @param ... Additional arguments to be formatted according to the format string.
@@ -53,62 +55,94 @@ void asm_write_log(const char *fmt, ...);
 
 /**
  * @struct Label
- * @brief Structure representing a label with its name and position.
+ * @brief Structure representing a label, which is either defined or only jumped to so far.
  */
 struct Label
 {
-    char  *name; /**< Name of the label. */
-    size_t IP_pos; /**< Position of the label in the bytecode. */
+    const char *name; /**< Name of the label in the human code, not NUL-terminated. */
+    size_t      name_len; /**< Length of the name. */
+    size_t      hash; /**< Hash of the name. */
+    size_t      IP_pos; /**< Position of the label in the bytecode. */
+    bool        defined; /**< The label line was already assembled. */
+    size_t      fixups; /**< First jump waiting for the label position, NO_FIXUP if there are none. */
 };
 
 /**
- * @struct Labels_w_carriage
- * @brief Structure representing labels along with their carriage position.
+ * @struct Fixup
+ * @brief Structure representing a jump assembled before its label.
  */
-struct Labels_w_carriage
+struct Fixup
 {
-    Label *labels; /**< Array of labels. */
-    size_t carriage; /**< Carriage position of the labels. */
+    size_t IP_pos; /**< Position of the jump in the bytecode. */
+    size_t next; /**< Next jump waiting for the same label, NO_FIXUP for the last one. */
 };
 
 /**
- * @struct JMP_pos
- * @brief Structure representing a jump with its name and position.
+ * @struct Label_table
+ * @brief Structure representing the labels indexed by an open addressing hash table.
  */
-struct JMP_pos
+struct Label_table
 {
-    char const *name; /**< Name of the jump. */
-    int         IP_pos; /**< Position of the jump in the bytecode. */
+    Label  *labels; /**< Labels in the order they were first mentioned. */
+    size_t  amount; /**< Amount of labels. */
+    size_t  capacity; /**< Size of the labels and the fixups arrays. */
+    size_t *buckets; /**< Label ID + 1 for every used bucket, 0 for the empty ones. */
+    size_t  buckets_amount; /**< Amount of buckets, a power of two. */
+    Fixup  *fixups; /**< Jumps waiting for their labels. */
+    size_t  fixups_amount; /**< Amount of fixups. */
 };
 
 /**
- * @struct JMP_poses_w_carriage
- * @brief Structure representing jumps along with their carriage position.
+ * @struct Fusion
+ * @brief Structure describing a command which can be fused with the pushes of its operands.
  */
-struct JMP_poses_w_carriage
+struct Fusion
 {
-    JMP_pos *JMP_poses; /**< Array of jumps. */
-    size_t   carriage; /**< Carriage position of the jumps. */
+    const char *name; /**< Name of the plain command. */
+    Ir_op       op; /**< The plain command in the in-memory program. */
+    char        fused_num; /**< Fused command for the operands in push order. */
+    char        swapped_num; /**< Fused command for the swapped operands, VOID if they can't be swapped. */
+    bool        is_int; /**< The fused command works on the integer registers. */
 };
 
+/**
+ * @struct Fused_cmd
+ * @brief Structure representing the operands of a fused command.
+ */
+struct Fused_cmd
+{
+    char           num; /**< Fused command. */
+    char           mode; /**< IMM_MASK if the second operand is the immediate, REG_MASK if the result is popped. */
+    unsigned char  reg_A; /**< Register of the first operand. */
+    unsigned char  reg_B; /**< Register of the second operand. */
+    unsigned char  reg_dst; /**< Register the result is popped to. */
+    double         imm; /**< Immediate second operand. */
+    const char    *label; /**< Label of the fused jump, NULL for the arithmetic commands. */
+};
+
+const size_t ASM_LINE_WINDOW = 4; /**< Lines fuse_cmds() looks at together. */
+const size_t NO_LINE         = (size_t)-1;
+
 struct Compile_manager
 {
-    Strings       strings;
-	Buffer_w_info        human_code_buffer; /**< Buffer with length information for human-readable code. */
-	Labels_w_carriage    labels_w_carriage; /**< Structure containing labels with carriage information. */
-    JMP_poses_w_carriage jmp_poses_w_carriage; /**< Structure containing jumps with carriage information. */
+    Strings       strings; /**< Lines of the human-readable code, which own its text. */
+	char                *line_window; /**< C strings of the last lines looked at, max_length + 1 bytes each. */
+	size_t               window_lines[ASM_LINE_WINDOW]; /**< Line in every slot of the window, NO_LINE if none. */
+	Label_table          label_table; /**< Labels and the jumps waiting for them. */
 	Buffer_w_info        byte_code; /**< Buffer with length information for bytecode. */
 	char                *byte_code_start; /**< Start of the byte code buffer. */
 };
 
 const int           POISON_JMP_POS                 = -1;
+const size_t        NO_FIXUP                       = (size_t)-1;
+const size_t        LABEL_BUCKETS_COEFF            =  2;
+const size_t        JMP_ARG_OFFSET                 =  sizeof(int);
 const char          IDENTIFIER_BYTE                =  1;
 const int           CMD_TYPE_ALIGNMENT_VALUE       =  3;
 const size_t        ALIGN_TO_INT                   =  sizeof(int)    - sizeof(char);
 const size_t        ALIGN_TO_DOUBLE                =  sizeof(double) - sizeof(char);
 const char * const  MAIN_JMP_NAME                  = "main";
 const unsigned char SPACE_SKIP                     = 1;
-const unsigned char LETTER_SKIP                    = 1;
 const unsigned char SIX_BYTE_ALIGNMENT             = 6;
 const unsigned char ONE_BYTE_ALIGNMENT             = 1;
 const unsigned char TWO_BYTE_ALIGNMENT             = 2;
@@ -117,8 +151,8 @@ const unsigned char B_CODE_SIZE_COEFF              = 2;
 /**
  * @brief Parses the human-readable assembly code and prepares it for compilation.
  *
- * This function reads the human-readable assembly code from a file,
- * allocates memory for the buffer, and arranges the tokens.
+ * This function maps the file of the human-readable assembly code with map_parse()
+ * and splits it into lines without writing it.
  *
  * @param manager Pointer to the Compile_manager structure.
  * @param file_name Name of the file containing human-readable assembly code.
@@ -126,6 +160,53 @@ const unsigned char B_CODE_SIZE_COEFF              = 2;
  */
 asm_err_t parse_human_code(Compile_manager *manager, const char *file_name);
 
+/**
+ * @brief Copies the human-readable assembly code from memory and prepares it for compilation.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param human_code Text of the assembly code, which is left untouched.
+ * @param length Length of the text.
+ * @return Error code indicating the status of the function.
+ */
+asm_err_t load_human_code(Compile_manager *manager, const char *human_code, size_t length);
+
+/**
+ * @brief Splits the loaded human-readable code into lines.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @return Error code indicating the status of the function.
+ */
+asm_err_t arrange_human_code(Compile_manager *manager);
+
+/**
+ * @brief Assembles the loaded human-readable code into the byte code of the manager.
+ *
+ * Runs cmds_process(), check_labels() and reduce_buffer_size().
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @return Error code indicating the status of the function.
+ */
+asm_err_t assemble(Compile_manager *manager);
+
+/**
+ * @brief Gets a line of the human-readable code as a C string.
+ *
+ * The lines of the text are ended by their '\n' only, and sscanf would scan the rest of the text
+ * for a '\0', so the line is copied into the slot of the window it falls in. The window is as deep
+ * as the lines fuse_cmds() looks at together, and a copy is overwritten when a line ASM_LINE_WINDOW
+ * lines away is got, so the labels, which the label table keeps, are taken from line_text().
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param line_ID Number of the line.
+ * @return The line ended with '\0'.
+ */
+const char *asm_line(Compile_manager *manager, size_t line_ID);
+
+/**
+ * @brief Gets the start of a line in the text of the human-readable code, which lives as long as the manager.
+ */
+const char *line_text(const Compile_manager *manager, size_t line_ID);
+
 /**
  * @brief Processes the assembly commands and generates the byte code.
  *
@@ -137,17 +218,144 @@ asm_err_t parse_human_code(Compile_manager *manager, const char *file_name);
  */
 asm_err_t cmds_process(Compile_manager *manager);
 
+/**
+ * @brief Replaces a sequence of stack commands starting at the line with one fused command.
+ *
+ * Recognizes "push reg; push reg|imm; op [; pop reg]" for arithmetic commands and
+ * "push reg; push reg|imm; jcc label" for conditional jumps. An immediate first
+ * operand is accepted if the operands can be swapped.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param line_ID Pointer to the current line, moved to the last fused line on success.
+ * @return True if the fused command was written, false otherwise.
+ */
+bool fuse_cmds(Compile_manager *manager, size_t *line_ID);
+
+/**
+ * @brief Parses the register operand of a command line such as "push rax".
+ *
+ * @param line Command line.
+ * @param cmd_name Expected name of the command.
+ * @param reg Pointer to the parsed register ID.
+ * @return True if the line is the command with a register operand.
+ */
+bool get_reg_operand(const char *line, const char *cmd_name, unsigned char *reg);
+
+/**
+ * @brief Parses the immediate operand of a push command line.
+ *
+ * @param line Command line.
+ * @param imm Pointer to the parsed immediate value.
+ * @return True if the line is a push of an immediate value.
+ */
+bool get_imm_operand(const char *line, double *imm);
+
+/**
+ * @brief Finds the fusion of an in-memory program command in a table.
+ *
+ * @param fusions Table of fusions.
+ * @param amount Amount of fusions in the table.
+ * @param op Command.
+ * @return Pointer to the found fusion or NULL.
+ */
+const Fusion *find_ir_fusion(const Fusion *fusions, size_t amount, Ir_op op);
+
+/**
+ * @brief Finds the fusion of a command, which the fused command is chosen from.
+ *
+ * @param op Command following the pushes of the operands.
+ * @param is_jump Pointer to the flag which is set if the command is a conditional jump.
+ * @return Pointer to the found fusion or NULL.
+ */
+const Fusion *find_fusion_by_op(Ir_op op, bool *is_jump);
+
+/**
+ * @brief Checks whether the register is of the bank the fused command works on.
+ */
+bool fusion_fits_reg(const Fusion *fusion, unsigned char reg);
+
+/**
+ * @brief Writes a fused command and references its label if it is a jump.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param fused Operands of the fused command.
+ */
+void write_fused(Compile_manager *manager, const Fused_cmd *fused);
+
+/**
+ * @brief Finds the fusion of a command line in a table.
+ *
+ * @param fusions Table of fusions.
+ * @param amount Amount of fusions in the table.
+ * @param line Command line.
+ * @param has_label_arg True if the command is followed by a label argument.
+ * @return Pointer to the found fusion or NULL.
+ */
+const Fusion *find_fusion(const Fusion *fusions, size_t amount,
+						  const char *line, bool has_label_arg);
+
 /**
  * @brief Writes main jump instruction.
  *
  * Writes the main jump instruction to the bytecode.
  *
- * @param byte_code Pointer to the bytecode buffer and length.
- * @param jmp_poses_w_carriage Pointer to the structure containing jump positions.
+ * @param manager Pointer to the Compile_manager structure.
  * @return Error code indicating the success or failure of the operation.
  */
-asm_err_t write_main_jmp(struct Buffer_w_info *byte_code,
-					   JMP_poses_w_carriage *jmp_poses_w_carriage);
+asm_err_t write_main_jmp(Compile_manager *manager);
+
+/**
+ * @brief Allocates the label table.
+ *
+ * @param table Pointer to the label table.
+ * @param capacity Largest amount of labels and jumps, every line mentions one label at most.
+ * @return Error code indicating the success or failure of the operation.
+ */
+asm_err_t label_table_ctor(Label_table *table, size_t capacity);
+
+/**
+ * @brief Frees the label table.
+ *
+ * @param table Pointer to the label table.
+ */
+void label_table_dtor(Label_table *table);
+
+/**
+ * @brief Finds the label by its name, adding an undefined one if there is no such label yet.
+ *
+ * The name ends at the first whitespace or at the end of the line.
+ *
+ * @param table Pointer to the label table.
+ * @param name Name of the label.
+ * @return Pointer to the label.
+ */
+Label *get_label(Label_table *table, const char *name);
+
+/**
+ * @brief Defines the label at the current position and patches the jumps waiting for it.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param name Name of the label.
+ */
+void define_label(Compile_manager *manager, const char *name);
+
+/**
+ * @brief Writes the label position to the jump, or leaves a fixup if the label isn't defined yet.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param name Name of the label.
+ * @param IP_pos Position of the jump in the bytecode.
+ */
+void reference_label(Compile_manager *manager, const char *name, size_t IP_pos);
+
+/**
+ * @brief Writes the label position to the int argument of the jump.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param IP_pos Position of the jump in the bytecode.
+ * @param label_pos Position of the label in the bytecode.
+ */
+void patch_jump(Compile_manager *manager, size_t IP_pos, size_t label_pos);
 
 /**
  * @brief Writes data of a certain size to the buffer.
@@ -185,40 +393,41 @@ asm_err_t write_char_w_alignment(struct Buffer_w_info *byte_code,
  *
  * Logs the labels along with their IDs and positions.
  *
- * @param labels_w_carriage Pointer to the structure containing labels.
+ * @param table Pointer to the label table.
  * @return Error code indicating the success or failure of the operation.
  */
-asm_err_t log_labels(struct Labels_w_carriage *labels_w_carriage);
+asm_err_t log_labels(Label_table *table);
 
 /**
- * @brief Logs jumps.
+ * @brief Checks that every jump got its label.
  *
- * Logs the jumps along with their IDs and positions.
+ * Jumps are patched while the commands are processed, so only the labels
+ * that were jumped to but never defined are left to report.
  *
- * @param jmp_poses_w_carriage Pointer to the structure containing jumps.
- * @return Error code indicating the success or failure of the operation.
+ * @param manager Pointer to the Compile_manager structure.
+ * @return LABEL_DOESNT_EXIST if a jump has no label, ASM_ALL_GOOD otherwise.
  */
-asm_err_t log_jmps(struct JMP_poses_w_carriage *jmp_poses_w_carriage);
+asm_err_t check_labels(Compile_manager *manager);
 
 /**
- * @brief Arranges the labels in the byte code.
+ * @brief Reduces the size of the byte code buffer.
  *
- * This function arranges the labels in the byte code based on the jump positions.
+ * This function reduces the size of the byte code buffer by removing trailing zeros.
  *
  * @param manager Pointer to the Compile_manager structure.
  * @return Error code indicating the status of the function.
  */
-asm_err_t arrange_labels(Compile_manager *manager);
+asm_err_t reduce_buffer_size(Compile_manager *manager);
 
 /**
- * @brief Reduces the size of the byte code buffer.
+ * @brief Replaces the byte code with its compact encoding, see compact_code.h.
  *
- * This function reduces the size of the byte code buffer by removing trailing zeros.
+ * Does nothing if the assembler is built with ASM_LEGACY_BYTE_CODE.
  *
  * @param manager Pointer to the Compile_manager structure.
- * @return Error code indicating the status of the function.
+ * @return ASM_INVALID_BYTE_CODE if the byte code has an unknown command, otherwise the status of the allocation.
  */
-asm_err_t reduce_buffer_size(Compile_manager *manager);
+asm_err_t pack_byte_code(Compile_manager *manager);
 
 /**
  * @brief Creates a binary file containing the byte code.
@@ -231,6 +440,18 @@ asm_err_t reduce_buffer_size(Compile_manager *manager);
  */
 asm_err_t create_bin(Compile_manager *manager, const char *file_name);                                              //  хуй 
 
+/**
+ * @brief Creates a text file mapping the labels to their positions in the byte code.
+ *
+ * Every line holds the slot index of a label and its name. The SPU profiler and
+ * trace decoder read it to name the parts of the program.
+ *
+ * @param manager Pointer to the Compile_manager structure.
+ * @param file_name Name of the human-readable code file, ".labels" is appended to it.
+ * @return Error code indicating the status of the function.
+ */
+asm_err_t create_label_map(Compile_manager *manager, const char *file_name);
+
 /**
  * @brief Destructor for the Compile_manager structure.
  *
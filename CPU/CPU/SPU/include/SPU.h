@@ -8,6 +8,8 @@
  * @brief Header file containing function declarations for the SPU program.
  */
 
+#include <stdint.h>
+
 #include "stack.h"
 
 const size_t AMOUNT_OF_REGISTERS = 4; /**< Number of registers in the SPU VM. */
@@ -21,6 +23,56 @@ struct RAM
 {
     size_t RAM_size;
     elem_t *user_RAM; /**< Array representing user-accessible RAM. */
+    bool    mapped; /**< user_RAM is a private mapping of a snapshot rather than a heap buffer. */
+};
+
+/**
+ * @struct VM_stack
+ * @brief Structure representing a fixed-capacity stack owned by the SPU VM.
+ */
+struct VM_stack
+{
+    elem_t *data; /**< Preallocated stack buffer. */
+    size_t  size; /**< Amount of elements on the stack. */
+    size_t  capacity; /**< Capacity of the stack, set in the config file. */
+};
+
+/**
+ * @struct Output_sink
+ * @brief Structure representing the buffered output channel of the SPU VM.
+ */
+struct Output_sink
+{
+    FILE  *file; /**< File the buffer is flushed to. */
+    char  *buf; /**< Output buffer. */
+    size_t size; /**< Amount of buffered bytes. */
+    size_t capacity; /**< Size of the buffer, set in the config file. */
+    bool   binary; /**< Values are written as raw elem_t instead of text. */
+};
+
+/**
+ * @enum Input_type
+ * @brief Enumeration of the sources the in command reads from.
+ */
+typedef enum
+{
+    INPUT_INTERACTIVE = 0, /**< Prompt the user and read a value from stdin. */
+    INPUT_VALUES      = 1, /**< Array of already parsed values. */
+    INPUT_BINARY      = 2, /**< Stream of raw elem_t values. */
+} Input_type;
+
+/**
+ * @struct Input_source
+ * @brief Structure representing the source of the in command.
+ */
+struct Input_source
+{
+    Input_type    type; /**< Kind of the source. */
+    const elem_t *values; /**< Values of INPUT_VALUES. */
+    elem_t       *owned_values; /**< Values parsed from text, freed by input_dtor(). */
+    size_t        amount; /**< Amount of values. */
+    size_t        carriage; /**< Index of the next value. */
+    FILE         *stream; /**< Stream of INPUT_BINARY. */
 };
 
 /**
@@ -30,11 +82,15 @@ struct RAM
 struct VM
 {
     elem_t *registers; /**< Array representing registers in the SPU VM. */
-    struct Stack user_stack; /**< Stack for user-defined operations. */
-    struct Stack ret_stack; /**< Stack for return addresses. */
+    int64_t *int_registers; /**< Integer registers i0, i1 and so on, which wrap around on overflow. */
+    struct VM_stack user_stack; /**< Stack for user-defined operations. */
+    struct VM_stack ret_stack; /**< Stack for return addresses. */
     RAM    rand_access_mem; /**< Random access memory in the SPU VM. */
 	char  *byte_code; /**< Pointer to the byte code. */
 	size_t regs_amount;
+	bool   jit_enabled; /**< Run the program natively, set by "jit:" in the config file. */
+	struct Output_sink output; /**< Buffered output of out and the drivers. */
+	struct Input_source *input; /**< Source of the in command. */
 };
 
 /**
@@ -49,8 +105,43 @@ typedef enum
     SPU_INVALID_FREAD       = 1 << 2, /**< Invalid read operation error. */
     INVALID_RAM_MODE        = 1 << 3, /**< Invalid RAM access mode error. */
     SPU_INVALID_PARSE       = 1 << 4, /**< Parse_file executed with an error. */
+    SPU_UNKNOWN_COMMAND     = 1 << 5, /**< Byte code contains an unknown command. */
+    SPU_STACK_OVERFLOW      = 1 << 6, /**< Program pushed past the capacity of a VM stack. */
+    SPU_STACK_UNDERFLOW     = 1 << 7, /**< Program popped from an empty VM stack. */
+    SPU_JIT_UNSUPPORTED     = 1 << 8, /**< JIT can't translate the program, the interpreter runs it. */
+    SPU_INPUT_EXHAUSTED     = 1 << 9, /**< in was executed after the input source ran out of values. */
+    SPU_RAM_OUT_OF_RANGE    = 1 << 10, /**< A block RAM command got a range outside of the RAM. */
+    SPU_INVALID_SNAPSHOT    = 1 << 11, /**< The snapshot is damaged or was taken of another program or config. */
+    SPU_INVALID_FWRITE      = 1 << 12, /**< Invalid write operation error. */
+    SPU_INVALID_BYTE_CODE   = 1 << 13, /**< The compact byte code is damaged or of another version. */
 } spu_err_t;
 
+/**
+ * @struct Spu_snapshot
+ * @brief Structure representing the snapshot files of a run.
+ *
+ * The snap command writes the full VM state to save_file: registers, RAM, both stacks
+ * and the position after the command. A run with restore_file starts from that state
+ * instead of the beginning of the program.
+ */
+struct Spu_snapshot
+{
+    const char *save_file; /**< File the snap command writes to, NULL to ignore snap. */
+    const char *restore_file; /**< Snapshot to start from, NULL to start from the beginning. */
+};
+
+/**
+ * @struct Spu_job
+ * @brief Structure representing a run of the program by execute_parallel().
+ */
+struct Spu_job
+{
+    Input_source *input; /**< Source of the in command, owned by the caller. */
+    const char   *output_file; /**< Output file of the run, NULL for "execution_result_<job index>.txt". */
+    const char   *restore_file; /**< Snapshot the run starts from, NULL to start from the beginning. */
+    spu_err_t     error_code; /**< Error code the run ended with, set by execute_parallel(). */
+};
+
 /**
  * @struct Buf_w_carriage_n_len
  * @brief Structure representing a buffer with carriage and length information.
@@ -95,4 +186,77 @@ typedef struct
 spu_err_t execute(const char *bin_file, const char *config_file,
 				void (*driver)(VM *, char *, FILE *));
 
+/**
+ * @brief Executes the binary file like execute(), with the in command reading from the input source.
+ *
+ * @param bin_file Path to the binary file to execute.
+ * @param config_file Path to the configuration file.
+ * @param driver Pointer to the driver function for the Virtual Machine.
+ * @param input Pointer to the input source, see SPU_input.h.
+ * @return An error code indicating the success or failure of the execution.
+ */
+spu_err_t execute_with_input(const char *bin_file, const char *config_file,
+							 void (*driver)(VM *, char *, FILE *), Input_source *input);
+
+/**
+ * @brief Executes the binary file like execute_with_input(), saving or restoring the VM state.
+ *
+ * Restoring maps the RAM image of the snapshot copy-on-write where the platform allows it,
+ * so many runs started from one snapshot share its pages until they write to them.
+ *
+ * @param bin_file Path to the binary file to execute.
+ * @param config_file Path to the configuration file.
+ * @param driver Pointer to the driver function for the Virtual Machine.
+ * @param input Pointer to the input source, see SPU_input.h.
+ * @param snapshot Pointer to the snapshot files.
+ * @return An error code indicating the success or failure of the execution.
+ */
+spu_err_t execute_with_snapshot(const char *bin_file, const char *config_file,
+								void (*driver)(VM *, char *, FILE *), Input_source *input,
+								const Spu_snapshot *snapshot);
+
+/**
+ * @brief Executes byte code which is already in memory like execute_with_input(), for example the one of compile_buffer().
+ *
+ * Legacy byte code is neither copied nor freed, compact byte code is unpacked into a copy.
+ * There is no binary file, so the profiler report has no label names.
+ *
+ * @param byte_code Pointer to the byte code.
+ * @param length Length of the byte code in bytes.
+ * @param config_file Path to the configuration file.
+ * @param driver Pointer to the driver function for the Virtual Machine.
+ * @param input Pointer to the input source, see SPU_input.h.
+ * @return An error code indicating the success or failure of the execution.
+ */
+spu_err_t execute_byte_code(char *byte_code, size_t length, const char *config_file,
+							void (*driver)(VM *, char *, FILE *), Input_source *input);
+
+/**
+ * @brief Loads the binary file once and runs it for every job on a pool of threads.
+ *
+ * Every run gets its own VM: registers, RAM, stacks and output buffer, all sharing
+ * the read-only byte code. Jobs with the interactive input source share stdin, and the
+ * driver must be safe to call from several threads.
+ *
+ * @param bin_file Path to the binary file to execute.
+ * @param config_file Path to the configuration file.
+ * @param driver Pointer to the driver function for the Virtual Machine.
+ * @param jobs Pointer to the jobs.
+ * @param jobs_amount Amount of jobs.
+ * @param threads_amount Amount of threads, 0 for the amount of hardware threads.
+ * @return An error code of loading the byte code, the results of the runs are in the jobs.
+ */
+spu_err_t execute_parallel(const char *bin_file, const char *config_file,
+						   void (*driver)(VM *, char *, FILE *),
+						   Spu_job *jobs, size_t jobs_amount, size_t threads_amount);
+
+/**
+ * @brief Returns the amount of the instructions the last run of the calling thread dispatched.
+ *
+ * The instructions are counted only in a build with SPU_COUNT_CMDS, without it the result is 0.
+ *
+ * @return Amount of the dispatched instructions.
+ */
+size_t spu_cmds_executed(void);
+
 #endif
@@ -0,0 +1,75 @@
+#ifndef SPU_INPUT
+#define SPU_INPUT
+
+/**
+ * @file SPU_input.h
+ * @brief Sources the in command reads its values from.
+ *
+ * The interactive source keeps the old prompt on stdin. The other ones let
+ * execute_with_input() feed a program with a whole data set: values parsed
+ * from a text file or buffer, a caller-owned array, or a stream of raw elem_t.
+ * Once a source runs out of values, in halts the VM with SPU_INPUT_EXHAUSTED.
+ */
+
+#include "SPU.h"
+
+/**
+ * @brief Makes the source prompt the user on stdin, which is what execute() uses.
+ *
+ * @param input Pointer to the source.
+ */
+void input_interactive(Input_source *input);
+
+/**
+ * @brief Makes the source read the values of an array, which the caller keeps alive during the execution.
+ *
+ * @param input Pointer to the source.
+ * @param values Pointer to the values.
+ * @param amount Amount of values.
+ */
+void input_from_values(Input_source *input, const elem_t *values, size_t amount);
+
+/**
+ * @brief Parses whitespace separated numbers of a text buffer into the source.
+ *
+ * @param input Pointer to the source.
+ * @param text Pointer to the text.
+ * @param length Length of the text.
+ * @return spu_err_t Returns SPU_INVALID_PARSE if the text contains something besides numbers.
+ */
+spu_err_t input_from_text(Input_source *input, const char *text, size_t length);
+
+/**
+ * @brief Parses whitespace separated numbers of a text file into the source.
+ *
+ * @param input Pointer to the source.
+ * @param file_name Path to the file.
+ * @return spu_err_t Returns an error code indicating the status of the parsing.
+ */
+spu_err_t input_from_file(Input_source *input, const char *file_name);
+
+/**
+ * @brief Makes the source read raw elem_t values from a binary stream.
+ *
+ * @param input Pointer to the source.
+ * @param stream Pointer to the stream, which stays owned by the caller.
+ */
+void input_from_stream(Input_source *input, FILE *stream);
+
+/**
+ * @brief Reads the next value of the source.
+ *
+ * @param input Pointer to the source.
+ * @param value Pointer to the read value.
+ * @return bool Returns false if the source has no values left.
+ */
+bool input_read(Input_source *input, elem_t *value);
+
+/**
+ * @brief Frees the values parsed by the source.
+ *
+ * @param input Pointer to the source.
+ */
+void input_dtor(Input_source *input);
+
+#endif
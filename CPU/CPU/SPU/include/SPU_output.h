@@ -0,0 +1,61 @@
+#ifndef SPU_OUTPUT
+#define SPU_OUTPUT
+
+/**
+ * @file SPU_output.h
+ * @brief Buffered output channel shared by the out command and the drivers.
+ *
+ * Everything is collected in the VM output buffer and written to the file when
+ * the buffer fills up or the VM halts. In binary mode out writes raw elem_t values
+ * and file_draw writes one byte per RAM cell, which is set by "binary_output: 1" in the config file.
+ */
+
+#include "SPU.h"
+
+const size_t STD_OUTPUT_BUFFER_SIZE = 1 << 16; /**< Output buffer size if the config has no output_buffer_size. */
+const size_t DOUBLE_TEXT_MAX        = 320; /**< Longest "%.3lf" text of a double with the terminating zero. */
+
+/**
+ * @brief Writes bytes to the sink, flushing it first if they don't fit.
+ *
+ * @param sink Pointer to the sink.
+ * @param data Pointer to the bytes.
+ * @param size Amount of bytes.
+ */
+void sink_write(Output_sink *sink, const void *data, size_t size);
+
+/**
+ * @brief Writes a symbol to the sink.
+ *
+ * @param sink Pointer to the sink.
+ * @param symbol Symbol to write.
+ */
+void sink_write_char(Output_sink *sink, char symbol);
+
+/**
+ * @brief Writes the result of the out command: "RESULT: %.3lf\n", or the raw value in binary mode.
+ *
+ * @param sink Pointer to the sink.
+ * @param value Value to write.
+ */
+void sink_write_value(Output_sink *sink, elem_t value);
+
+/**
+ * @brief Writes the buffered bytes to the file.
+ *
+ * @param sink Pointer to the sink.
+ */
+void sink_flush(Output_sink *sink);
+
+/**
+ * @brief Formats a double the way "%.3lf" does.
+ *
+ * Small finite values are formatted by hand, the rest and the ones next to a rounding tie go to snprintf.
+ *
+ * @param buf Buffer of at least DOUBLE_TEXT_MAX bytes.
+ * @param value Value to format.
+ * @return size_t Returns the length of the text.
+ */
+size_t format_double(char *buf, elem_t value);
+
+#endif
@@ -2,23 +2,77 @@
 
 #include "SPU_additional.h"
 #include "SPU.h"
+#include "SPU_input.h"
 
 spu_err_t execute(const char *bin_file, const char *config_file,
 				void (*driver)(VM *, char *, FILE *))
+{
+	Input_source input = {};
+	input_interactive(&input);
+
+	return execute_with_input(bin_file, config_file, driver, &input);
+}
+
+spu_err_t execute_with_input(const char *bin_file, const char *config_file,
+							 void (*driver)(VM *, char *, FILE *), Input_source *input)
+{
+	Spu_snapshot snapshot = {};
+
+	return execute_with_snapshot(bin_file, config_file, driver, input, &snapshot);
+}
+
+spu_err_t execute_with_snapshot(const char *bin_file, const char *config_file,
+								void (*driver)(VM *, char *, FILE *), Input_source *input,
+								const Spu_snapshot *snapshot)
 {
 	spu_err_t error_code = SPU_ALL_GOOD;
 
+	Byte_code byte_code = {};
+	CALL(load_byte_code(&byte_code, bin_file));
+
 	WITH_OPEN
 	(
 		"execution_result.txt", "w", exe_result,
 
-		WITH_OPEN
-		(
-			bin_file, "rb", bin_file_ptr,
+		error_code = process(&byte_code, config_file, exe_result, driver, input, snapshot);
+	)
+
+	unload_byte_code(&byte_code);
+
+	return error_code;
+}
+
+spu_err_t execute_byte_code(char *byte_code, size_t length, const char *config_file,
+							void (*driver)(VM *, char *, FILE *), Input_source *input)
+{
+	spu_err_t error_code = SPU_ALL_GOOD;
+
+	Byte_code loaded   = {};
+	Byte_code unpacked = {};
+	loaded.buf    = byte_code;
+	loaded.length = length;
+
+	if(is_compact_code(byte_code, length))
+	{
+		error_code = unpack_byte_code(&unpacked, byte_code, length);
+		if(error_code != SPU_ALL_GOOD)
+		{
+			unload_byte_code(&unpacked);
+
+			return error_code;
+		}
 
-			CALL(process(bin_file_ptr, config_file, exe_result, driver));
-		)
+		loaded = unpacked;
+	}
+
+	WITH_OPEN
+	(
+		"execution_result.txt", "w", exe_result,
+
+		error_code = process(&loaded, config_file, exe_result, driver, input, NULL);
 	)
 
+	unload_byte_code(&unpacked);
+
 	return error_code;
 }
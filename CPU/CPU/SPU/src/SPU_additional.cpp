@@ -4,9 +4,26 @@
 #include <string.h>
 #include <math.h>
 
+#include <mutex>
+
 #include "SPU_additional.h"
+#include "SPU_decoder.h"
+#include "SPU_jit.h"
+#include "SPU_output.h"
+#include "SPU_input.h"
+#include "SPU_profile.h"
+#include "SPU_trace.h"
+#include "SPU_ram.h"
+#include "SPU_snapshot.h"
 #include "file_parser.h"
 
+#ifdef SPU_MMAP_AVAILABLE
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
 /**
  * @def BYTE_CODE
  * @brief Macro representing the byte code of the Virtual Machine.
@@ -19,37 +36,292 @@
  * @param buf Pointer to the buffer.
  * @param size Size of the buffer.
  */
-#define LOG_BUFFER(buf, size)\
-	print_binary(buf, size, #buf, spu_write_log)
+#define LOG_BUFFER(buf, size)							\
+	if(LOG_LEVEL_DEBUG >= LOG_MIN_LEVEL)				\
+	{													\
+		print_binary(buf, size, #buf, spu_write_log);	\
+	}
+
+/**
+ * @def CUR_CMD
+ * @brief Macro representing the decoded instruction under the carriage.
+ */
+#define CUR_CMD program.cmds[cmd_ID]
+
+/**
+ * @def NEXT_CMD
+ * @brief Macro for moving the carriage to the next decoded instruction.
+ */
+#define NEXT_CMD cmd_ID++
+
+/**
+ * @def USER_PUSH(value)
+ * @brief Macro for pushing a value on the operand stack. Bounds are checked per block.
+ */
+#define USER_PUSH(value)\
+	vm.user_stack.data[vm.user_stack.size++] = (value)
+
+/**
+ * @def USER_POP
+ * @brief Macro for popping a value from the operand stack. Bounds are checked per block.
+ */
+#define USER_POP\
+	vm.user_stack.data[--vm.user_stack.size]
+
+/**
+ * @def RET_PUSH(value)
+ * @brief Macro for pushing a return address on the return stack.
+ */
+#define RET_PUSH(value)\
+	vm.ret_stack.data[vm.ret_stack.size++] = (value)
+
+/**
+ * @def RET_POP
+ * @brief Macro for popping a return address from the return stack.
+ */
+#define RET_POP\
+	vm.ret_stack.data[--vm.ret_stack.size]
+
+/**
+ * @def ERROR_HALT(error)
+ * @brief Macro for stopping the execution with an error.
+ */
+#define ERROR_HALT(error)	\
+	error_code = error;		\
+	HALT;
+
+/**
+ * @def CALL_OR_HALT(...)
+ * @brief Macro for calling a block RAM or snapshot operation and stopping the execution if it fails.
+ */
+#define CALL_OR_HALT(...)				\
+	call_error = __VA_ARGS__;			\
+	if(call_error != SPU_ALL_GOOD)		\
+	{									\
+		ERROR_HALT(call_error);			\
+	}
+
+/**
+ * @def CHECK_STACK_BOUNDS
+ * @brief Macro for checking the operand stack once for the whole block that starts under the carriage.
+ */
+#define CHECK_STACK_BOUNDS													\
+	if(vm.user_stack.size < CUR_CMD.stack_need)								\
+	{																		\
+		ERROR_HALT(SPU_STACK_UNDERFLOW);									\
+	}																		\
+	if(vm.user_stack.size + CUR_CMD.stack_growth > vm.user_stack.capacity)	\
+	{																		\
+		ERROR_HALT(SPU_STACK_OVERFLOW);										\
+	}
+
+/**
+ * @def JUMP
+ * @brief Macro for moving the carriage to the target of the current instruction.
+ */
+#define JUMP				\
+	cmd_ID = CUR_CMD.arg;	\
+	CHECK_STACK_BOUNDS;
+
+/**
+ * @def BRANCH(condition, cmd_size)
+ * @brief Macro for jumping to the target if the condition holds, otherwise moving past the instruction.
+ * @param condition Condition on cmp_result.
+ * @param cmd_size Amount of slots the instruction takes.
+ */
+#define BRANCH(condition, cmd_size)		\
+	if(condition)						\
+	{									\
+		JUMP;							\
+	}									\
+	else								\
+	{									\
+		cmd_ID += cmd_size;				\
+		CHECK_STACK_BOUNDS;				\
+	}
+
+/**
+ * @def REG_A
+ * @brief Macro representing the first register operand of the current fused instruction.
+ */
+#define REG_A vm.registers[CUR_CMD.reg_A]
 
 /**
- * @def UPDATE_BYTE_CODE_CARRIAGE
- * @brief Macro for updating the byte code carriage position.
+ * @def REG_B
+ * @brief Macro representing the second register operand of the current fused instruction.
  */
-#define UPDATE_BYTE_CODE_CARRIAGE \
-    byte_code_carriage = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int)) * sizeof(double);
+#define REG_B vm.registers[CUR_CMD.reg_B]
 
 /**
- * @def MOVE_CARRIAGE
- * @brief Macro for moving the byte code carriage.
+ * @def INT_REG_A
+ * @brief Macro representing the first integer register operand of the current fused instruction.
  */
-#define MOVE_CARRIAGE byte_code_carriage += sizeof(double)
+#define INT_REG_A vm.int_registers[CUR_CMD.reg_A]
 
 /**
- * @def DEF_CMD(name, num, type, ...)
- * @brief Macro for defining a command in the byte code processing switch-case statement.
- * @param name Name of the command.
- * @param num Numeric representation of the command.
- * @param type Type of the command for assembler.
+ * @def INT_REG_B
+ * @brief Macro representing the second integer register operand of the current fused instruction.
+ */
+#define INT_REG_B vm.int_registers[CUR_CMD.reg_B]
+
+/**
+ * @def INT_OP(first, sign, second)
+ * @brief Macro for the integer arithmetic, which wraps around on overflow as the native code does.
+ */
+#define INT_OP(first, sign, second)\
+	(int64_t)((uint64_t)(first) sign (uint64_t)(second))
+
+/**
+ * @def CMP_INT(first, second)
+ * @brief Macro for comparing two integers exactly, with the result of cmp_double.
+ */
+#define CMP_INT(first, second)\
+	(((first) > (second)) - ((first) < (second)))
+
+/**
+ * @def COND_JUMP(condition)
+ * @brief Macro for comparing the two top stack values and jumping if the condition holds.
+ * @param condition Condition on cmp_result.
+ */
+#define COND_JUMP(condition)									\
+	value_B = USER_POP;											\
+	value_A = USER_POP;											\
+																\
+	cmp_result = cmp_double(value_A, value_B);					\
+																\
+	BRANCH(condition, 1);
+
+/**
+ * @def HALT
+ * @brief Macro for stopping the execution.
+ */
+#define HALT goto halt
+
+#if defined(SPU_PROFILE) || defined(SPU_TRACE) || defined(SPU_COUNT_CMDS)
+
+/**
+ * @def TRY_JIT
+ * @brief Profiled, traced and counted runs stay in the interpreter.
+ */
+#define TRY_JIT
+
+#else
+
+/**
+ * @def TRY_JIT
+ * @brief Macro for running the program natively if the JIT is enabled and can translate it.
+ *
+ * Native code always starts at the beginning, so a run restored from a snapshot is interpreted.
+ */
+#define TRY_JIT																			\
+	if(cmd_ID == 0 && jit_execute(&vm, &program, output_file, driver, &error_code))	\
+	{																					\
+		HALT;																			\
+	}
+
+#endif
+
+#ifdef SPU_PROFILE
+
+/**
+ * @def PROFILE_CMD
+ * @brief Macro for counting the dispatch of the instruction under the carriage.
+ */
+#define PROFILE_CMD\
+	profile_cmd(&profile, cmd_ID, &CUR_CMD)
+
+#else
+
+#define PROFILE_CMD
+
+#endif
+
+#ifdef SPU_COUNT_CMDS
+
+/**
+ * @def COUNT_CMD
+ * @brief Macro for counting every dispatched instruction of the run.
+ */
+#define COUNT_CMD\
+	executed_cmds++
+
+#else
+
+#define COUNT_CMD
+
+#endif
+
+// the amount of the instructions of the last run of the thread, see spu_cmds_executed()
+static thread_local size_t LAST_RUN_CMDS = 0;
+
+#ifdef SPU_TRACE
+
+/**
+ * @def TRACE_CMD
+ * @brief Macro for recording the dispatch of the instruction under the carriage.
+ */
+#define TRACE_CMD\
+	trace_cmd(&trace, cmd_ID, &CUR_CMD, &vm)
+
+#else
+
+#define TRACE_CMD
+
+#endif
+
+#ifdef SPU_THREADED_DISPATCH
+
+/**
+ * @def DISPATCH
+ * @brief Macro for jumping straight to the handler of the instruction under the carriage.
+ */
+#define DISPATCH\
+	goto *CUR_CMD.handler;
+
+/**
+ * @def DEF_HANDLER(type, pops, pushes, ...)
+ * @brief Macro for defining a labeled command handler in the threaded interpreter.
+ * @param type Decoded type of the command.
+ * @param pops Amount of values the command pops from the operand stack.
+ * @param pushes Amount of values the command pushes on the operand stack.
+ * @param ... Code block representing the action of the command.
+ */
+#define DEF_HANDLER(type, pops, pushes, ...)	\
+    handler_##type:								\
+    {											\
+        PROFILE_CMD;							\
+        COUNT_CMD;								\
+        TRACE_CMD;								\
+        __VA_ARGS__								\
+        DISPATCH;								\
+    }
+
+/**
+ * @def DEF_HANDLER_ADDRESS(type, ...)
+ * @brief Macro for filling the dispatch table with the address of the command handler.
+ */
+#define DEF_HANDLER_ADDRESS(type, ...)\
+	dispatch_table[type] = &&handler_##type;
+
+#else
+
+/**
+ * @def DEF_DECODED_CMD(type, pops, pushes, ...)
+ * @brief Macro for defining a command in the decoded instruction switch-case statement.
+ * @param type Decoded type of the command.
+ * @param pops Amount of values the command pops from the operand stack.
+ * @param pushes Amount of values the command pushes on the operand stack.
  * @param ... Code block representing the action of the command.
  */
-#define DEF_CMD(name, num, type, ...) \
-    case num:                          \
-    {                                  \
-        __VA_ARGS__                    \
-        break;                         \
+#define DEF_DECODED_CMD(type, pops, pushes, ...)	\
+    case type:										\
+    {												\
+        __VA_ARGS__									\
+        break;										\
     }
 
+#endif
+
 #define ALLOCATION_CHECK(ptr)					\
 	if(ptr == NULL)								\
 	{											\
@@ -57,44 +329,104 @@
 		return SPU_UNABLE_TO_ALLOCATE;			\
 	}
 
-spu_err_t process(FILE *bin_file, const char *config_file,
-				FILE *output_file, void (*driver)(VM *, char *, FILE *))
+spu_err_t process(Byte_code *byte_code, const char *config_file, FILE *output_file,
+				void (*driver)(VM *, char *, FILE *), Input_source *input,
+				const Spu_snapshot *snapshot)
 {
-	size_t byte_code_length = get_file_length(bin_file);
 	spu_err_t error_code = SPU_ALL_GOOD;
 
 	VM_CTOR(vm, config_file);
 
-	CALLOC(BYTE_CODE, byte_code_length, char);
+	BYTE_CODE      = byte_code->buf;
+	vm.output.file = output_file;
+	vm.input       = input;
 
-	FREAD(BYTE_CODE, sizeof(char), byte_code_length, bin_file);
+	Decoded_program program = {};
+	CALL(decode_byte_code(&program, BYTE_CODE, byte_code->length));
 
-	size_t byte_code_carriage = 0;
-	char command              = (char)VOID;
-	size_t reg_type           = 0;
+	size_t cmd_ID             = 0;
 	elem_t user_entered_value = NAN;
 	elem_t value              = NAN;
 	elem_t value_A            = NAN;
 	elem_t value_B            = NAN;
 	int cmp_result            = 666;
 	unsigned int RAM_address  = 0;
+	spu_err_t call_error      = SPU_ALL_GOOD;
+
+	if(snapshot != NULL && snapshot->restore_file != NULL)
+	{
+		error_code = snapshot_restore(&vm, byte_code, &cmd_ID, snapshot->restore_file);
+
+		if(error_code != SPU_ALL_GOOD || cmd_ID >= program.size)
+		{
+			decoded_program_dtor(&program);
+			VM_dtor(&vm);
+
+			return error_code != SPU_ALL_GOOD ? error_code : SPU_INVALID_SNAPSHOT;
+		}
+	}
 
 	#ifdef CPU_DEBUG
 		bool run_flag = false;
 	#endif
 
-	#define CURRENT_BYTE_CODE\
-		(BYTE_CODE + byte_code_carriage)
+	#ifdef SPU_COUNT_CMDS
+		size_t executed_cmds = 0;
+	#endif
+
+	#ifdef SPU_PROFILE
+		Profile profile = {};
+		CALL(profile_ctor(&profile, program.size));
+	#endif
+
+	#ifdef SPU_TRACE
+		Trace trace = {};
+		CALL(trace_ctor(&trace, vm.regs_amount));
+	#endif
+
+#ifdef SPU_THREADED_DISPATCH
+	void *dispatch_table[DECODED_TYPES_AMOUNT] = {};
+
+	#define DEF_DECODED_CMD DEF_HANDLER_ADDRESS
+	#include "decoded_cmd_definitions.h"
+	#undef DEF_DECODED_CMD
+
+	for(size_t slot_ID = 0; slot_ID < program.size; slot_ID++)
+	{
+		program.cmds[slot_ID].handler = dispatch_table[program.cmds[slot_ID].type];
+	}
+
+	TRY_JIT;
+
+	CHECK_STACK_BOUNDS;
+	DISPATCH;
+
+	#define DEF_DECODED_CMD DEF_HANDLER
+	#include "decoded_cmd_definitions.h"
+	#undef DEF_DECODED_CMD
+#else
+	TRY_JIT;
 
-	while(byte_code_carriage < byte_code_length)
+	CHECK_STACK_BOUNDS;
+
+	while(true)
 	{
-		command = *(CURRENT_BYTE_CODE);
-		switch(command)
+		#ifdef CPU_DEBUG
+			char command = CUR_CMD.command;
+		#endif
+
+		PROFILE_CMD;
+		COUNT_CMD;
+		TRACE_CMD;
+
+		switch(CUR_CMD.type)
 		{
-			#include "cmd_definitions.h"
+			#include "decoded_cmd_definitions.h"
+			case DECODED_TYPES_AMOUNT:
 			default:
 			{
 				printf("Unknown_command\n");
+				HALT;
 			}
 		}
 		#ifdef CPU_DEBUG
@@ -102,93 +434,404 @@ spu_err_t process(FILE *bin_file, const char *config_file,
 		#endif
 
 	}
+#endif
+
+	halt:
+
+	#ifdef SPU_COUNT_CMDS
+		LAST_RUN_CMDS = executed_cmds;
+	#endif
 
-	free(BYTE_CODE);
+	#ifdef SPU_PROFILE
+		profile_report(&profile, &program, byte_code->file_name, PROFILE_FILE_NAME);
+		profile_dtor(&profile);
+	#endif
+
+	#ifdef SPU_TRACE
+		if(error_code != SPU_ALL_GOOD)
+		{
+			trace_dump(&trace, TRACE_FILE_NAME);
+		}
+		trace_dtor(&trace);
+	#endif
+
+	decoded_program_dtor(&program);
 	VM_dtor(&vm);
 
-	return SPU_ALL_GOOD;
+	return error_code;
+}
+
+size_t spu_cmds_executed(void)
+{
+	return LAST_RUN_CMDS;
+}
+
+int64_t elem_to_int(elem_t value)
+{
+	// the same value cvttsd2si gives the native code for NaN and out of range values
+	if(value >= (elem_t)INT64_MIN && value < -(elem_t)INT64_MIN)
+	{
+		return (int64_t)value;
+	}
+
+	return INT64_MIN;
 }
 
-#undef CMD_DEF
+#ifdef SPU_THREADED_DISPATCH
+	#undef DISPATCH
+	#undef DEF_HANDLER
+	#undef DEF_HANDLER_ADDRESS
+#else
+	#undef DEF_DECODED_CMD
+#endif
+
+#undef TRACE_CMD
+#undef COUNT_CMD
+#undef PROFILE_CMD
+#undef TRY_JIT
+#undef HALT
+#undef COND_JUMP
+#undef CMP_INT
+#undef INT_OP
+#undef INT_REG_B
+#undef INT_REG_A
+#undef REG_B
+#undef REG_A
+#undef BRANCH
+#undef JUMP
+#undef CHECK_STACK_BOUNDS
+#undef CALL_OR_HALT
+#undef ERROR_HALT
+#undef RET_POP
+#undef RET_PUSH
+#undef USER_POP
+#undef USER_PUSH
+#undef NEXT_CMD
+#undef CUR_CMD
 
 spu_err_t VM_ctor(struct VM *vm, const char *config_file)
 {
-	WITH_OPEN
-	(
-		config_file, "r", config_file_ptr,
+	spu_err_t error_code = SPU_ALL_GOOD;
+	VM_config settings   = {};
 
-		Strings settings = file_parse(config_file_ptr);
-	)
-	if(settings.tokens == NULL)
+	CALL(get_config(config_file, &settings));
+
+	const VM_config *config = &settings;
+
+	if(config->regs_amount < REGS_AMOUNT)
+	{
+		LOG("regs amount %lu is less than the %lu registers of the ISA, using %lu.\n",
+			config->regs_amount, REGS_AMOUNT, REGS_AMOUNT);
+	}
+
+	vm->regs_amount              = config->regs_amount < REGS_AMOUNT ? REGS_AMOUNT : config->regs_amount;
+	vm->rand_access_mem.RAM_size = config->RAM_size;
+	vm->jit_enabled              = config->jit_enabled;
+	vm->output.capacity          = config->output_buffer_size;
+	vm->output.binary            = config->binary_output;
+
+	if(config->output_buffer_size != 0)
+	{
+		CALLOC(vm->output.buf, config->output_buffer_size, char);
+	}
+
+	CALLOC(vm->registers, vm->regs_amount, elem_t);
+	CALLOC(vm->int_registers, INT_REGS_AMOUNT, int64_t);
+	CALLOC(vm->rand_access_mem.user_RAM, config->RAM_size, elem_t);
+
+	CALLOC(vm->user_stack.data, config->user_stack_size, elem_t);
+	vm->user_stack.capacity = config->user_stack_size;
+
+	CALLOC(vm->ret_stack.data, config->ret_stack_size, elem_t);
+	vm->ret_stack.capacity = config->ret_stack_size;
+
+	return SPU_ALL_GOOD;
+}
+
+static Config_cache config_cache       = {};
+static std::mutex   config_cache_mutex;
+
+static void clear_config_cache(void);
+
+spu_err_t get_config(const char *config_file, VM_config *config)
+{
+	std::lock_guard<std::mutex> cache_lock(config_cache_mutex);
+
+	if(config_cache.file_name == NULL || strcmp(config_cache.file_name, config_file) != 0)
+	{
+		spu_err_t error_code = SPU_ALL_GOOD;
+		VM_config parsed     = {};
+
+		CALL(parse_config(config_file, &parsed));
+
+		clear_config_cache();
+
+		config_cache.file_name = strdup(config_file);
+		ALLOCATION_CHECK(config_cache.file_name);
+
+		config_cache.config = parsed;
+	}
+
+	*config = config_cache.config;
+
+	return SPU_ALL_GOOD;
+}
+
+static void clear_config_cache(void)
+{
+	free(config_cache.file_name);
+
+	config_cache = {};
+}
+
+void drop_config_cache(void)
+{
+	std::lock_guard<std::mutex> cache_lock(config_cache_mutex);
+
+	clear_config_cache();
+}
+
+spu_err_t parse_config(const char *config_file, VM_config *config)
+{
+	Strings settings = map_parse(config_file);
+	if(settings.lines == NULL)
 	{
 		return SPU_INVALID_PARSE;
 	}
 
+	// sscanf needs a C string, and the lines of the mapping are ended by their '\n' only
+	char *line = (char *)calloc(settings.max_length + 1, sizeof(char));
+	if(line == NULL)
+	{
+		strings_dtor(&settings);
+
+		return SPU_UNABLE_TO_ALLOCATE;
+	}
+
 	#define IS_SETTING(setting)\
-		!strncmp(settings.tokens[set_ID], setting, LEN(setting))
+		!strncmp(line, setting, LEN(setting))
 
-	size_t regs_amount = 0;
-	size_t RAM_size    = 0;
+	config->regs_amount        = REGS_AMOUNT;
+	config->RAM_size           = 0;
+	config->user_stack_size    = STD_USER_STACK_SIZE;
+	config->ret_stack_size     = STD_RET_STACK_SIZE;
+	config->jit_enabled        = false;
+	config->output_buffer_size = STD_OUTPUT_BUFFER_SIZE;
+	config->binary_output      = false;
 
 	for(size_t set_ID = 0; set_ID < settings.amount; set_ID++)
 	{
+		copy_line(&settings, set_ID, line);
+
 		if(IS_SETTING("regs_amount:"))
 		{
-			sscanf(settings.tokens[set_ID], "%*[^:]%*2c%lu", &regs_amount);
-			vm->regs_amount = regs_amount;
+			sscanf(line, "%*[^:]%*2c%lu", &(config->regs_amount));
 
-			LOG("regs amount = %lu\n", regs_amount);
+			LOG("regs amount = %lu\n", config->regs_amount);
 		}
 		else if(IS_SETTING("RAM_size:"))
 		{
-			sscanf(settings.tokens[set_ID], "%*[^:]%*2c%lu", &RAM_size);
-			vm->rand_access_mem.RAM_size = RAM_size;
+			sscanf(line, "%*[^:]%*2c%lu", &(config->RAM_size));
+
+			LOG("ram size = %lu\n", config->RAM_size);
+		}
+		else if(IS_SETTING("user_stack_size:"))
+		{
+			sscanf(line, "%*[^:]%*2c%lu", &(config->user_stack_size));
+
+			LOG("user stack size = %lu\n", config->user_stack_size);
+		}
+		else if(IS_SETTING("ret_stack_size:"))
+		{
+			sscanf(line, "%*[^:]%*2c%lu", &(config->ret_stack_size));
+
+			LOG("ret stack size = %lu\n", config->ret_stack_size);
+		}
+		else if(IS_SETTING("jit:"))
+		{
+			int jit_enabled = 0;
+			sscanf(line, "%*[^:]%*2c%d", &jit_enabled);
+			config->jit_enabled = (jit_enabled != 0);
 
-			LOG("ram size = %lu\n", RAM_size);
+			LOG("jit = %d\n", jit_enabled);
+		}
+		else if(IS_SETTING("output_buffer_size:"))
+		{
+			sscanf(line, "%*[^:]%*2c%lu", &(config->output_buffer_size));
+
+			LOG("output buffer size = %lu\n", config->output_buffer_size);
+		}
+		else if(IS_SETTING("binary_output:"))
+		{
+			int binary_output = 0;
+			sscanf(line, "%*[^:]%*2c%d", &binary_output);
+			config->binary_output = (binary_output != 0);
+
+			LOG("binary output = %d\n", binary_output);
 		}
 	}
 
-	CALLOC(vm->registers, regs_amount, elem_t);
-	CALLOC(vm->rand_access_mem.user_RAM, RAM_size, elem_t);
+	#undef IS_SETTING
 
-	STACK_CTOR(&(vm->user_stack), STD_USER_STACK_SIZE);
-	STACK_CTOR(&(vm->ret_stack),  STD_RET_STACK_SIZE);
+	free(line);
+	strings_dtor(&settings);
 
 	return SPU_ALL_GOOD;
 }
 
+static spu_err_t unpack_loaded_byte_code(Byte_code *byte_code)
+{
+	if(!is_compact_code(byte_code->buf, byte_code->length))
+	{
+		return SPU_ALL_GOOD;
+	}
+
+	Byte_code unpacked = {};
+	spu_err_t error_code = unpack_byte_code(&unpacked, byte_code->buf, byte_code->length);
+
+	unpacked.file_name = byte_code->file_name;
+
+	unload_byte_code(byte_code);
+	*byte_code = unpacked;
+
+	return error_code;
+}
+
+spu_err_t unpack_byte_code(Byte_code *unpacked, const char *compact, size_t length)
+{
+	spu_err_t error_code = SPU_ALL_GOOD;
+
+	size_t legacy_length = unpacked_code_length(compact, length);
+	if(legacy_length == 0)
+	{
+		LOG("ERROR: The compact byte code has a damaged header or another version.\n");
+
+		return SPU_INVALID_BYTE_CODE;
+	}
+
+	CALLOC(unpacked->buf, legacy_length, char);
+	unpacked->length = legacy_length;
+	unpacked->mapped = false;
+
+	if(!unpack_compact_code(compact, length, unpacked->buf, legacy_length))
+	{
+		LOG("ERROR: The compact byte code is damaged.\n");
+
+		return SPU_INVALID_BYTE_CODE;
+	}
+
+	LOG("Unpacked %lu bytes of compact byte code into %lu.\n", length, legacy_length);
+
+	return error_code;
+}
+
+spu_err_t load_byte_code(Byte_code *byte_code, const char *bin_file)
+{
+	byte_code->file_name = bin_file;
+
+#ifdef SPU_MMAP_AVAILABLE
+	int bin_fd = open(bin_file, O_RDONLY);
+	if(bin_fd < 0)
+	{
+		LOG("\nERROR: Unable to open %s\n", bin_file);
+		return SPU_UNABLE_TO_OPEN_FILE;
+	}
+
+	struct stat bin_stat = {};
+	if(fstat(bin_fd, &bin_stat) == 0 && bin_stat.st_size > 0)
+	{
+		void *mapping = mmap(NULL, (size_t)bin_stat.st_size, PROT_READ, MAP_PRIVATE, bin_fd, 0);
+
+		if(mapping != MAP_FAILED)
+		{
+			close(bin_fd);
+
+			byte_code->buf    = (char *)mapping;
+			byte_code->length = (size_t)bin_stat.st_size;
+			byte_code->mapped = true;
+
+			return unpack_loaded_byte_code(byte_code);
+		}
+	}
+
+	close(bin_fd);
+#endif
+
+	WITH_OPEN
+	(
+		bin_file, "rb", bin_file_ptr,
+
+		byte_code->length = get_file_length(bin_file_ptr);
+
+		CALLOC(byte_code->buf, byte_code->length, char);
+
+		FREAD(byte_code->buf, sizeof(char), byte_code->length, bin_file_ptr);
+	)
+
+	byte_code->mapped = false;
+
+	return unpack_loaded_byte_code(byte_code);
+}
+
+void unload_byte_code(Byte_code *byte_code)
+{
+#ifdef SPU_MMAP_AVAILABLE
+	if(byte_code->mapped)
+	{
+		munmap(byte_code->buf, byte_code->length);
+	}
+	else
+	{
+		free(byte_code->buf);
+	}
+#else
+	free(byte_code->buf);
+#endif
+
+	*byte_code = {};
+}
+
 spu_err_t VM_dtor(struct VM *vm)
 {
+	sink_flush(&(vm->output));
+	free(vm->output.buf);
+	vm->output = {};
+
+#ifdef SPU_MMAP_AVAILABLE
+	if(vm->rand_access_mem.mapped)
+	{
+		munmap(vm->rand_access_mem.user_RAM, vm->rand_access_mem.RAM_size * sizeof(elem_t));
+	}
+	else
+	{
+		free(vm->rand_access_mem.user_RAM);
+	}
+#else
 	free(vm->rand_access_mem.user_RAM);
+#endif
 	free(vm->registers);
+	free(vm->int_registers);
+
+	vm->rand_access_mem.mapped = false;
 
 	vm->rand_access_mem.RAM_size = 0;
 
-	stack_dtor(&(vm->user_stack));
-	stack_dtor(&(vm->ret_stack));
+	free(vm->user_stack.data);
+	free(vm->ret_stack.data);
+
+	vm->user_stack = {};
+	vm->ret_stack  = {};
 
 	return SPU_ALL_GOOD;
 }
 
-#undef UPDATE_BYTE_CODE_CARRIAGE
-#undef MOVE_CARRIAGE
-
 void spu_write_log(const char *fmt, ...)
 {
-
-    static FILE *log_file = fopen("SPU_log.txt", "w");
-
-    if (log_file == NULL)
-	{
-        perror("Error opening log_file");
-        return;
-    }
-
-    va_list args = NULL;
+    va_list args;
 
     va_start(args, fmt);
 
-    vfprintf(log_file, fmt, args);
+    log_vwrite(LOG_SINK_SPU, fmt, args);
 
     va_end(args);
 }
@@ -241,9 +884,16 @@ void dump_vm(VM *vm)
 	printf("    REGISTERS\n");
 	for(unsigned char reg_ID = 0; reg_ID < vm->regs_amount; reg_ID++)
 	{
-		printf("[r%cx]: ", reg_ID + 'a');
+		char reg_name[REG_NAME_SIZE] = {};
+		write_reg_name(reg_name, REG_NAME_SIZE, reg_ID);
+
+		printf("[%s]: ", reg_name);
 		printf("%lf\n", vm->registers[reg_ID]);
 	}
+	for(size_t int_reg_ID = 0; int_reg_ID < INT_REGS_AMOUNT; int_reg_ID++)
+	{
+		printf("[i%lu]: %ld\n", int_reg_ID, vm->int_registers[int_reg_ID]);
+	}
 	printf("\n");
 
 	if(vm->user_stack.size != 0)
@@ -290,6 +940,38 @@ void dump_cmd(char command)
 		CASE(RET )
 		CASE(DRAW)
 		CASE(SQRT)
+		CASE(ADD_FUSED)
+		CASE(SUB_FUSED)
+		CASE(MUL_FUSED)
+		CASE(DIV_FUSED)
+		CASE(JAE_FUSED)
+		CASE(JA_FUSED )
+		CASE(JBE_FUSED)
+		CASE(JB_FUSED )
+		CASE(JE_FUSED )
+		CASE(JNE_FUSED)
+		CASE(FILL   )
+		CASE(COPY   )
+		CASE(COMPARE)
+		CASE(SNAP   )
+		CASE(IADD)
+		CASE(ISUB)
+		CASE(IMUL)
+		CASE(IJA )
+		CASE(IJB )
+		CASE(IJAE)
+		CASE(IJBE)
+		CASE(IJE )
+		CASE(IJNE)
+		CASE(IADD_FUSED)
+		CASE(ISUB_FUSED)
+		CASE(IMUL_FUSED)
+		CASE(IJAE_FUSED)
+		CASE(IJA_FUSED )
+		CASE(IJBE_FUSED)
+		CASE(IJB_FUSED )
+		CASE(IJE_FUSED )
+		CASE(IJNE_FUSED)
 		CASE(HLT )
 		default:
 		{
@@ -300,7 +982,7 @@ void dump_cmd(char command)
 
 #undef CASE
 
-void dump_stack(Stack *stk)
+void dump_stack(VM_stack *stk)
 {
 	for(size_t stk_ID = 0; stk_ID < stk->size; stk_ID++)
 	{
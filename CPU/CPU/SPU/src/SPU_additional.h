@@ -11,6 +11,7 @@
 #include "SPU.h"
 #include "secondary.h"
 #include "commands.h"
+#include "compact_code.h"
 
 /**
  * @brief Macro to log messages to a file.
@@ -19,16 +20,14 @@
  * Usage: LOG("Message to log");
  */
 #define LOG(...)\
-	spu_write_log(__VA_ARGS__);
+	LOG_AT(LOG_LEVEL_DEBUG, LOG_SINK_SPU, __VA_ARGS__);
 
 /**
- * @brief Logs a message to a file.
+ * @brief Logs a message into the SPU sink, for the callers which need a function.
  *
- * Logs a message to a file named "log.txt" with the specified format and additional information.
+ * Every thread writes its own buffered copy of "SPU_log.txt", so it may be called from several threads.
+ * It logs even if LOG_MIN_LEVEL is above LOG_LEVEL_DEBUG, so its callers check the level.
  *
- * @param file_name The name of the file where the log message originates.
- * @param func_name The name of the function where the log message originates.
- * @param line The line number in the source file where the log message originates.
  * @param fmt The format string for the log message.
  * @param ... Additional arguments to be formatted according to the format string.
  */
@@ -97,21 +96,168 @@ void spu_write_log(const char *fmt, ...);
         return SPU_UNABLE_TO_OPEN_FILE;								\
 	}
 
-const size_t STD_USER_STACK_SIZE = 10;
-const size_t STD_RET_STACK_SIZE  = 2;
+const size_t STD_USER_STACK_SIZE = 1024; /**< Operand stack capacity if the config has no user_stack_size. */
+const size_t STD_RET_STACK_SIZE  = 1024; /**< Return stack capacity if the config has no ret_stack_size. */
+
+/**
+ * @def SPU_THREADED_DISPATCH
+ * @brief Enables computed goto dispatch in process() on GCC/Clang.
+ *
+ * Every decoded instruction carries the address of its handler, and each handler jumps straight to the next one.
+ * Define SPU_SWITCH_DISPATCH to fall back to the switch loop. CPU_DEBUG always uses the switch loop.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SPU_SWITCH_DISPATCH) && !defined(CPU_DEBUG)
+	#define SPU_THREADED_DISPATCH
+#endif
+
+/**
+ * @def SPU_PROFILE
+ * @brief Define it to build process() with the profiler, see SPU_profile.h.
+ *
+ * The profiler hooks every dispatch and disables the JIT. Without the define the hooks expand to nothing.
+ */
+
+/**
+ * @def SPU_COUNT_CMDS
+ * @brief Define it to count the instructions every run of process() dispatches, see spu_cmds_executed().
+ *
+ * A fused instruction counts once. The counted runs disable the JIT as well.
+ */
+
+/**
+ * @def SPU_TRACE
+ * @brief Define it to build process() with the execution trace ring buffer, see SPU_trace.h.
+ *
+ * Unlike the CPU_DEBUG stepper the trace never stops the VM. It disables the JIT as well.
+ */
+
+/**
+ * @def SPU_MMAP_AVAILABLE
+ * @brief Enables loading the byte code as a read-only mapping of the binary file.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+	#define SPU_MMAP_AVAILABLE
+#endif
+
+/**
+ * @struct Byte_code
+ * @brief Structure representing the byte code loaded from the binary file.
+ */
+struct Byte_code
+{
+	char  *buf; /**< Byte code. */
+	size_t length; /**< Length of the byte code in bytes. */
+	bool   mapped; /**< The buffer is a read-only mapping of the file rather than a heap copy. */
+	const char *file_name; /**< Path to the binary file, which the label map is found by. */
+};
+
+/**
+ * @struct VM_config
+ * @brief Structure representing the settings of the config file.
+ */
+struct VM_config
+{
+	size_t regs_amount; /**< Amount of VM registers. */
+	size_t RAM_size; /**< Size of the VM RAM. */
+	size_t user_stack_size; /**< Capacity of the operand stack. */
+	size_t ret_stack_size; /**< Capacity of the return stack. */
+	bool   jit_enabled; /**< Run the program with the JIT tier. */
+	size_t output_buffer_size; /**< Size of the output buffer, 0 for unbuffered output. */
+	bool   binary_output; /**< Write raw values instead of text. */
+};
+
+/**
+ * @struct Config_cache
+ * @brief Structure representing the last parsed config file.
+ */
+struct Config_cache
+{
+	char     *file_name; /**< Name of the parsed config file, NULL if nothing is cached. */
+	VM_config config; /**< Parsed settings. */
+};
+
+/**
+ * @brief Loads the byte code from the binary file.
+ *
+ * The file is mapped read-only where the platform allows it, otherwise it is read into a heap buffer.
+ * Compact byte code is unpacked into a heap buffer of legacy slots.
+ *
+ * @param byte_code Pointer to the byte code to fill.
+ * @param bin_file Path to the binary file.
+ * @return spu_err_t Returns an error code indicating the status of the loading.
+ */
+spu_err_t load_byte_code(Byte_code *byte_code, const char *bin_file);
+
+/**
+ * @brief Unpacks the compact byte code into a heap buffer of legacy 8 byte slots.
+ *
+ * The decoder, the label map and snapshots all count legacy slots, so load_byte_code()
+ * unpacks the compact encoding right after loading it.
+ *
+ * @param unpacked Pointer to the byte code to fill, which the caller unloads.
+ * @param compact Compact byte code, see compact_code.h.
+ * @param length Length of the compact byte code in bytes.
+ * @return spu_err_t Returns SPU_INVALID_BYTE_CODE if the compact byte code is damaged.
+ */
+spu_err_t unpack_byte_code(Byte_code *unpacked, const char *compact, size_t length);
+
+/**
+ * @brief Unmaps or frees the byte code.
+ *
+ * @param byte_code Pointer to the byte code.
+ */
+void unload_byte_code(Byte_code *byte_code);
+
+/**
+ * @brief Gets the settings of the config file, parsing it only if it isn't the cached one.
+ *
+ * The cache is keyed by the file name, so call drop_config_cache() after changing the file.
+ * It is guarded by a mutex, so VMs may be constructed from several threads.
+ *
+ * @param config_file Path to the config file.
+ * @param config Pointer to the settings to copy the cached ones to.
+ * @return spu_err_t Returns an error code indicating the status of the parsing.
+ */
+spu_err_t get_config(const char *config_file, VM_config *config);
+
+/**
+ * @brief Drops the cached config, so the next VM_ctor parses the file again.
+ */
+void drop_config_cache(void);
+
+/**
+ * @brief Parses the config file.
+ *
+ * @param config_file Path to the config file.
+ * @param config Pointer to the settings to fill.
+ * @return spu_err_t Returns an error code indicating the status of the parsing.
+ */
+spu_err_t parse_config(const char *config_file, VM_config *config);
 
 /**
  * @brief Processes the byte code.
  *
- * @param bin_file Pointer to the binary file containing the byte code.
+ * The byte code is decoded once by decode_byte_code() and then run without any further decoding.
+ *
+ * @param byte_code Pointer to the loaded byte code, which process() does not free.
  * @param config_file Pointer to the configuration file.
  * @param output_file Pointer to the output file.
  * @param driver Pointer to the function driver.
+ * @param input Pointer to the source of the in command.
+ * @param snapshot Pointer to the snapshot files of the run.
  * @return spu_err_t Returns an error code indicating the status of the processing.
  */
-spu_err_t process(FILE *bin_file, const char *config_file,
-				FILE *output_file, void (*driver)(VM *, char *, FILE *));
+spu_err_t process(Byte_code *byte_code, const char *config_file, FILE *output_file,
+				void (*driver)(VM *, char *, FILE *), Input_source *input,
+				const Spu_snapshot *snapshot);
 
+/**
+ * @brief Converts a value of the operand stack for the integer commands.
+ *
+ * The fraction is cut off, NaN and the values out of the int64_t range become INT64_MIN,
+ * as cvttsd2si makes them in the native code.
+ */
+int64_t elem_to_int(elem_t value);
 
 /**
  * @brief Virtual Machine constructor.
@@ -164,7 +310,7 @@ spu_err_t VM_dtor(struct VM *vm);
 	*
 	* @param command The command value to be dumped.
 	*/
-	void dump_stack(Stack *stk);
+	void dump_stack(VM_stack *stk);
 
 	/**
 	* @brief Prints a frame of terminal dashes.
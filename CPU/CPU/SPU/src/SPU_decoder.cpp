@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SPU_decoder.h"
+#include "SPU_additional.h"
+
+/**
+ * @def CURRENT_BYTE_CODE
+ * @brief Macro representing the byte code under the carriage.
+ */
+#define CURRENT_BYTE_CODE\
+	(byte_code + byte_code_carriage)
+
+/**
+ * @def CUR_CMD
+ * @brief Macro representing the decoded instruction of the current slot.
+ */
+#define CUR_CMD\
+	program->cmds[byte_code_carriage / sizeof(double)]
+
+/**
+ * @def MODE
+ * @brief Macro representing the mode byte of the current command.
+ */
+#define MODE\
+	*(CURRENT_BYTE_CODE + sizeof(char))
+
+/**
+ * @def INT_ARG
+ * @brief Macro representing the register ID, RAM address or target slot of the current command.
+ */
+#define INT_ARG\
+	*(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int))
+
+/**
+ * @def IMM_ARG
+ * @brief Macro representing the immediate value that follows the current command.
+ */
+#define IMM_ARG\
+	*(elem_t *)(CURRENT_BYTE_CODE + sizeof(double))
+
+/**
+ * @def REG_A_ARG
+ * @brief Macro representing the first register operand of the current fused command.
+ */
+#define REG_A_ARG\
+	*(unsigned char *)(CURRENT_BYTE_CODE + 2 * sizeof(char))
+
+/**
+ * @def REG_B_ARG
+ * @brief Macro representing the second register operand of the current fused command.
+ */
+#define REG_B_ARG\
+	*(unsigned char *)(CURRENT_BYTE_CODE + 3 * sizeof(char))
+
+/**
+ * @def DECODE(decoded_type, decoded_arg)
+ * @brief Macro for filling the decoded instruction of the current slot.
+ */
+#define DECODE(decoded_type, decoded_arg)		\
+	CUR_CMD.type    = decoded_type;				\
+	CUR_CMD.command = command;					\
+	CUR_CMD.arg     = decoded_arg;				\
+	CUR_CMD.raw     = CURRENT_BYTE_CODE;
+
+#define MOVE_CARRIAGE byte_code_carriage += sizeof(double)
+
+/**
+ * @def DECODE_REG(decoded_type, int_type)
+ * @brief Macro for decoding a register operand, which is an index of the integer registers
+ * if its ID is past FIRST_INT_REG.
+ */
+#define DECODE_REG(decoded_type, int_type)							\
+	if(is_int_reg(INT_ARG))											\
+	{																\
+		DECODE(int_type, INT_ARG - (unsigned int)FIRST_INT_REG);	\
+	}																\
+	else															\
+	{																\
+		DECODE(decoded_type, INT_ARG);								\
+	}
+
+/**
+ * @def DECODE_FUSED_ARITHM_OF(op, first_reg, imm_field, imm_value)
+ * @brief Macro for decoding a fused arithmetic command.
+ *
+ * IMM_MASK means the second operand is an immediate in the next slot,
+ * REG_MASK means the result goes to the register in INT_ARG instead of the stack.
+ * The registers are counted from first_reg, which is FIRST_INT_REG for the integer commands.
+ */
+#define DECODE_FUSED_ARITHM_OF(op, first_reg, imm_field, imm_value)					\
+	unsigned int dst_arg = (MODE & REG_MASK) ? INT_ARG - (unsigned int)(first_reg) : INT_ARG;	\
+	if(MODE & IMM_MASK)																	\
+	{																					\
+		DECODE((MODE & REG_MASK) ? D_##op##_RI_TO_REG : D_##op##_RI, dst_arg);		\
+		CUR_CMD.imm_field = imm_value;													\
+	}																					\
+	else																				\
+	{																					\
+		DECODE((MODE & REG_MASK) ? D_##op##_RR_TO_REG : D_##op##_RR, dst_arg);		\
+		CUR_CMD.reg_B = (unsigned char)(REG_B_ARG - (first_reg));						\
+	}																					\
+	CUR_CMD.reg_A = (unsigned char)(REG_A_ARG - (first_reg));							\
+																						\
+	if(MODE & IMM_MASK)																	\
+	{																					\
+		MOVE_CARRIAGE;																	\
+	}																					\
+	MOVE_CARRIAGE;
+
+/**
+ * @def DECODE_FUSED_JUMP_OF(cond, first_reg, imm_field, imm_value)
+ * @brief Macro for decoding a fused compare-and-branch command.
+ *
+ * IMM_MASK means the second operand is an immediate in the next slot.
+ * The registers are counted from first_reg, which is FIRST_INT_REG for the integer commands.
+ */
+#define DECODE_FUSED_JUMP_OF(cond, first_reg, imm_field, imm_value)					\
+	if(MODE & IMM_MASK)																	\
+	{																					\
+		DECODE(D_##cond##_RI, INT_ARG);													\
+		CUR_CMD.imm_field = imm_value;													\
+	}																					\
+	else																				\
+	{																					\
+		DECODE(D_##cond##_RR, INT_ARG);													\
+		CUR_CMD.reg_B = (unsigned char)(REG_B_ARG - (first_reg));						\
+	}																					\
+	CUR_CMD.reg_A = (unsigned char)(REG_A_ARG - (first_reg));							\
+																						\
+	if(MODE & IMM_MASK)																	\
+	{																					\
+		MOVE_CARRIAGE;																	\
+	}																					\
+	MOVE_CARRIAGE;
+
+#define DECODE_FUSED_ARITHM(op)\
+	DECODE_FUSED_ARITHM_OF(op, 0, imm, IMM_ARG)
+
+#define DECODE_FUSED_JUMP(cond)\
+	DECODE_FUSED_JUMP_OF(cond, 0, imm, IMM_ARG)
+
+/**
+ * @def DECODE_INT_FUSED_ARITHM(op)
+ * @brief Macro for decoding a fused command of the integer registers, whose immediate is converted here once.
+ */
+#define DECODE_INT_FUSED_ARITHM(op)\
+	DECODE_FUSED_ARITHM_OF(op, FIRST_INT_REG, int_imm, elem_to_int(IMM_ARG))
+
+#define DECODE_INT_FUSED_JUMP(cond)\
+	DECODE_FUSED_JUMP_OF(cond, FIRST_INT_REG, int_imm, elem_to_int(IMM_ARG))
+
+#define ALLOCATION_CHECK(ptr)					\
+	if(ptr == NULL)								\
+	{											\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return SPU_UNABLE_TO_ALLOCATE;			\
+	}
+
+#define DEF_CMD(name, num, type, ...)	\
+	case num:							\
+	{									\
+		__VA_ARGS__						\
+		break;							\
+	}
+
+spu_err_t decode_byte_code(Decoded_program *program, char *byte_code, size_t byte_code_length)
+{
+	size_t slots_amount = (byte_code_length + sizeof(double) - 1) / sizeof(double);
+
+	program->size = slots_amount + 1;
+
+	CALLOC(program->cmds, program->size, Decoded_cmd);
+
+	size_t *next_slots = NULL;
+	CALLOC(next_slots, program->size, size_t);
+
+	for(size_t slot_ID = 0; slot_ID < program->size; slot_ID++)
+	{
+		next_slots[slot_ID] = slot_ID + 1;
+	}
+
+	size_t byte_code_carriage = 0;
+	size_t cmd_slot           = 0;
+	char   command            = (char)VOID;
+
+	while(byte_code_carriage < byte_code_length)
+	{
+		command  = *(CURRENT_BYTE_CODE);
+		cmd_slot = byte_code_carriage / sizeof(double);
+
+		switch(command)
+		{
+			#include "cmd_definitions.h"
+			default:
+			{
+				LOG("ERROR: Unknown command %d in the slot %lu.\n", command, cmd_slot);
+
+				free(next_slots);
+				decoded_program_dtor(program);
+
+				return SPU_UNKNOWN_COMMAND;
+			}
+		}
+
+		next_slots[cmd_slot] = byte_code_carriage / sizeof(double);
+	}
+
+	// sentinel: running off the end of the byte code halts the VM
+	program->cmds[slots_amount].type    = D_HLT;
+	program->cmds[slots_amount].command = (char)HLT;
+
+	count_stack_bounds(program, next_slots);
+
+	free(next_slots);
+
+	LOG("Byte code is decoded: %lu instructions.\n", program->size);
+
+	return SPU_ALL_GOOD;
+}
+
+#undef DEF_CMD
+#undef ALLOCATION_CHECK
+#undef DECODE_INT_FUSED_JUMP
+#undef DECODE_INT_FUSED_ARITHM
+#undef DECODE_FUSED_JUMP
+#undef DECODE_FUSED_ARITHM
+#undef DECODE_FUSED_JUMP_OF
+#undef DECODE_FUSED_ARITHM_OF
+#undef DECODE_REG
+#undef MOVE_CARRIAGE
+#undef DECODE
+#undef REG_B_ARG
+#undef REG_A_ARG
+#undef IMM_ARG
+#undef INT_ARG
+#undef MODE
+#undef CUR_CMD
+#undef CURRENT_BYTE_CODE
+
+// the commands after which the execution may go on elsewhere
+static constexpr Decoded_type BLOCK_END_TYPES[] =
+{
+	D_JMP,    D_JAE,    D_JA,     D_JBE,    D_JB,     D_JE,     D_JNE,
+	D_JAE_RR, D_JAE_RI, D_JA_RR,  D_JA_RI,  D_JBE_RR, D_JBE_RI,
+	D_JB_RR,  D_JB_RI,  D_JE_RR,  D_JE_RI,  D_JNE_RR, D_JNE_RI,
+	D_IJAE,   D_IJA,    D_IJBE,   D_IJB,    D_IJE,    D_IJNE,
+	D_IJAE_RR, D_IJAE_RI, D_IJA_RR,  D_IJA_RI,  D_IJBE_RR, D_IJBE_RI,
+	D_IJB_RR,  D_IJB_RI,  D_IJE_RR,  D_IJE_RI,  D_IJNE_RR, D_IJNE_RI,
+	D_CALL,   D_RET,    D_SNAP,   D_HLT,
+};
+
+struct Block_ends
+{
+	bool is_end[DECODED_TYPES_AMOUNT];
+};
+
+constexpr Block_ends fill_block_ends()
+{
+	Block_ends ends = {};
+
+	for(size_t type_ID = 0; type_ID < sizeof(BLOCK_END_TYPES) / sizeof(BLOCK_END_TYPES[0]); type_ID++)
+	{
+		ends.is_end[BLOCK_END_TYPES[type_ID]] = true;
+	}
+
+	return ends;
+}
+
+// a table filled at compile time, as the decoder asks it of every command
+static constexpr Block_ends BLOCK_ENDS = fill_block_ends();
+
+bool is_block_end(Decoded_type type)
+{
+	return BLOCK_ENDS.is_end[type];
+}
+
+#define DEF_DECODED_CMD(type, pops, pushes, ...)	\
+	case type:										\
+	{												\
+		cmd_pops   = pops;							\
+		cmd_pushes = pushes;						\
+		break;										\
+	}
+
+void count_stack_bounds(Decoded_program *program, const size_t *next_slots)
+{
+	for(size_t cmd_ID = program->size; cmd_ID-- > 0;)
+	{
+		Decoded_cmd *cmd = &(program->cmds[cmd_ID]);
+
+		long cmd_pops   = 0;
+		long cmd_pushes = 0;
+
+		switch(cmd->type)
+		{
+			#include "decoded_cmd_definitions.h"
+			case DECODED_TYPES_AMOUNT:
+			default:
+			{
+				break;
+			}
+		}
+
+		long net  = cmd_pushes - cmd_pops;
+		long need = cmd_pops;
+		long growth = (net > 0) ? net : 0;
+
+		size_t next_ID = next_slots[cmd_ID];
+
+		if(!is_block_end(cmd->type) && next_ID < program->size)
+		{
+			const Decoded_cmd *next = &(program->cmds[next_ID]);
+
+			if((long)next->stack_need - net > need)
+			{
+				need = (long)next->stack_need - net;
+			}
+
+			if(net + (long)next->stack_growth > growth)
+			{
+				growth = net + (long)next->stack_growth;
+			}
+		}
+
+		cmd->stack_need   = (size_t)need;
+		cmd->stack_growth = (size_t)growth;
+	}
+}
+
+#undef DEF_DECODED_CMD
+
+#define DEF_DECODED_CMD(type, ...)\
+	#type,
+
+static const char * const DECODED_TYPE_NAMES[] =
+{
+	#include "decoded_cmd_definitions.h"
+};
+
+#undef DEF_DECODED_CMD
+
+const char *decoded_type_name(Decoded_type type)
+{
+	return (type < DECODED_TYPES_AMOUNT) ? DECODED_TYPE_NAMES[type] : "D_UNKNOWN";
+}
+
+void decoded_program_dtor(Decoded_program *program)
+{
+	free(program->cmds);
+
+	program->cmds = NULL;
+	program->size = 0;
+}
@@ -0,0 +1,113 @@
+#ifndef SPU_DECODER
+#define SPU_DECODER
+
+/**
+ * @file SPU_decoder.h
+ * @brief Load-time decoding of the byte code into fixed-size instructions.
+ */
+
+#include "SPU.h"
+
+/**
+ * @def DEF_DECODED_CMD(type, ...)
+ * @brief Macro for listing the decoded command types.
+ */
+#define DEF_DECODED_CMD(type, pops, pushes, ...)\
+	type,
+
+/**
+ * @enum Decoded_type
+ * @brief Command types with the operand kind already split out.
+ */
+enum Decoded_type
+{
+	#include "decoded_cmd_definitions.h"
+	DECODED_TYPES_AMOUNT,
+};
+
+#undef DEF_DECODED_CMD
+
+/**
+ * @struct Decoded_cmd
+ * @brief Structure representing a single decoded instruction.
+ *
+ * Every 8 byte slot of the byte code gets its own Decoded_cmd, so jump
+ * and call targets stay plain slot indices. The second slot of a 16 byte
+ * instruction is left as D_NOP.
+ */
+struct Decoded_cmd
+{
+	void        *handler; /**< Handler address, resolved by the threaded interpreter. */
+	Decoded_type type; /**< Decoded command type. */
+	char         command; /**< Original opcode, kept for the debugger. */
+	unsigned int arg; /**< Register ID, RAM address or target instruction index. */
+	unsigned char reg_A; /**< First register operand of a fused command. */
+	unsigned char reg_B; /**< Second register operand of a fused command. */
+	union
+	{
+		elem_t   imm; /**< Immediate value. */
+		int64_t  int_imm; /**< Immediate value of an integer command. */
+	};
+	char        *raw; /**< Position of the command in the byte code. */
+	size_t       stack_need; /**< Operand stack values the block starting here pops below its entry depth. */
+	size_t       stack_growth; /**< Maximum operand stack growth of the block starting here. */
+};
+
+/**
+ * @struct Decoded_program
+ * @brief Structure representing the decoded byte code.
+ */
+struct Decoded_program
+{
+	Decoded_cmd *cmds; /**< Decoded instructions, terminated by D_HLT. */
+	size_t       size; /**< Amount of decoded instructions. */
+};
+
+/**
+ * @brief Decodes the byte code into an array of fixed-size instructions.
+ *
+ * The byte code must stay alive while the program runs: draw commands keep a pointer into it.
+ *
+ * @param program Pointer to the program to fill.
+ * @param byte_code Pointer to the byte code.
+ * @param byte_code_length Length of the byte code in bytes.
+ * @return spu_err_t Returns an error code indicating the status of the decoding.
+ */
+spu_err_t decode_byte_code(Decoded_program *program, char *byte_code, size_t byte_code_length);
+
+/**
+ * @brief Counts operand stack bounds of the block that starts at every instruction.
+ *
+ * A block runs straight from the instruction to the next jump, call, ret or hlt,
+ * falling through labels. The interpreter checks the bounds once on entering a block,
+ * so pushes and pops inside it need no checks of their own.
+ *
+ * @param program Pointer to the decoded program.
+ * @param next_slots Index of the instruction that follows each slot.
+ */
+void count_stack_bounds(Decoded_program *program, const size_t *next_slots);
+
+/**
+ * @brief Checks whether the command ends a block.
+ *
+ * @param type Decoded type of the command.
+ * @return bool Returns true for jumps, calls, returns, snap and hlt.
+ */
+bool is_block_end(Decoded_type type);
+
+/**
+ * @brief Gets the name of a decoded type, such as "D_PUSH_IMM".
+ *
+ * @param type Decoded type.
+ * @return const char * Returns the name of the type.
+ */
+const char *decoded_type_name(Decoded_type type);
+
+/**
+ * @brief Frees the decoded program.
+ *
+ * @param program Pointer to the program.
+ */
+void decoded_program_dtor(Decoded_program *program);
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "SPU_input.h"
+#include "SPU_additional.h"
+
+#define ALLOCATION_CHECK(ptr)					\
+	if(ptr == NULL)								\
+	{											\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return SPU_UNABLE_TO_ALLOCATE;			\
+	}
+
+const size_t STD_INPUT_CAPACITY = 64; /**< Starting capacity of the parsed values. */
+
+void input_interactive(Input_source *input)
+{
+	*input = {};
+
+	input->type = INPUT_INTERACTIVE;
+}
+
+void input_from_values(Input_source *input, const elem_t *values, size_t amount)
+{
+	*input = {};
+
+	input->type   = INPUT_VALUES;
+	input->values = values;
+	input->amount = amount;
+}
+
+spu_err_t input_from_text(Input_source *input, const char *text, size_t length)
+{
+	*input = {};
+
+	input->type = INPUT_VALUES;
+
+	char *terminated_text = NULL;
+	CALLOC(terminated_text, length + 1, char);
+	memcpy(terminated_text, text, length);
+
+	size_t capacity = STD_INPUT_CAPACITY;
+	CALLOC(input->owned_values, capacity, elem_t);
+
+	char *carriage = terminated_text;
+
+	while(true)
+	{
+		while(isspace((unsigned char)*carriage))
+		{
+			carriage++;
+		}
+
+		if(*carriage == '\0')
+		{
+			break;
+		}
+
+		char  *number_end = NULL;
+		elem_t value      = strtod(carriage, &number_end);
+
+		if(number_end == carriage)
+		{
+			LOG("ERROR: input contains a non-number on the position %ld.\n", carriage - terminated_text);
+
+			free(terminated_text);
+			input_dtor(input);
+
+			return SPU_INVALID_PARSE;
+		}
+
+		if(input->amount == capacity)
+		{
+			capacity *= 2;
+			REALLOC(input->owned_values, capacity, elem_t);
+		}
+
+		input->owned_values[input->amount++] = value;
+		carriage = number_end;
+	}
+
+	free(terminated_text);
+
+	input->values = input->owned_values;
+
+	return SPU_ALL_GOOD;
+}
+
+spu_err_t input_from_file(Input_source *input, const char *file_name)
+{
+	spu_err_t error_code = SPU_ALL_GOOD;
+
+	long  length = 0;
+	char *text   = NULL;
+
+	WITH_OPEN
+	(
+		file_name, "rb", input_file,
+
+		fseek(input_file, 0, SEEK_END);
+		length = ftell(input_file);
+		fseek(input_file, 0, SEEK_SET);
+
+		if(length < 0)
+		{
+			fclose(input_file);
+			return SPU_INVALID_FREAD;
+		}
+
+		CALLOC(text, (size_t)length + 1, char);
+
+		size_t read_elems = fread(text, sizeof(char), (size_t)length, input_file);
+		if(read_elems != (size_t)length)
+		{
+			LOG("ERROR: fread read %lu of %ld bytes of %s.\n", read_elems, length, file_name);
+
+			free(text);
+			fclose(input_file);
+
+			return SPU_INVALID_FREAD;
+		}
+	)
+
+	error_code = input_from_text(input, text, (size_t)length);
+
+	free(text);
+
+	return error_code;
+}
+
+void input_from_stream(Input_source *input, FILE *stream)
+{
+	*input = {};
+
+	input->type   = INPUT_BINARY;
+	input->stream = stream;
+}
+
+bool input_read(Input_source *input, elem_t *value)
+{
+	switch(input->type)
+	{
+		case INPUT_INTERACTIVE:
+		{
+			while(true)
+			{
+				printf("Please enter value: ");
+
+				int scanned = scanf("%lf", value);
+
+				if(scanned == EOF)
+				{
+					return false;
+				}
+
+				int symbol = 0;
+				while((symbol = getchar()) != '\n' && symbol != EOF);
+
+				if(scanned == 1)
+				{
+					return true;
+				}
+			}
+		}
+		case INPUT_VALUES:
+		{
+			if(input->carriage == input->amount)
+			{
+				return false;
+			}
+
+			*value = input->values[input->carriage++];
+
+			return true;
+		}
+		case INPUT_BINARY:
+		{
+			return fread(value, sizeof(elem_t), 1, input->stream) == 1;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+void input_dtor(Input_source *input)
+{
+	free(input->owned_values);
+
+	*input = {};
+}
+
+#undef ALLOCATION_CHECK
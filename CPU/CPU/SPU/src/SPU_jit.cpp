@@ -0,0 +1,1129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "SPU_jit.h"
+#include "SPU_additional.h"
+#include "SPU_output.h"
+#include "SPU_input.h"
+#include "SPU_ram.h"
+
+#ifdef SPU_JIT_AVAILABLE
+
+#include <sys/mman.h>
+
+#define ALLOCATION_CHECK(ptr)					\
+	if(ptr == NULL)								\
+	{											\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return SPU_UNABLE_TO_ALLOCATE;			\
+	}
+
+const unsigned char RAX  = 0;
+const unsigned char RCX  = 1;
+const unsigned char RBX  = 3;
+const unsigned char RBP  = 5; /**< int_registers */
+const unsigned char RSI  = 6;
+const unsigned char R12  = 12; /**< user_RAM */
+const unsigned char R13  = 13; /**< Operand stack top. */
+const unsigned char R14  = 14; /**< Return stack top. */
+const unsigned char R15  = 15; /**< Jit_context. */
+const unsigned char XMM0 = 0;
+const unsigned char XMM1 = 1;
+
+const unsigned char ADDSD  = 0x58;
+const unsigned char MULSD  = 0x59;
+const unsigned char SUBSD  = 0x5C;
+const unsigned char DIVSD  = 0x5E;
+const unsigned char SQRTSD = 0x51;
+
+const int    STACK_ELEM = (int)sizeof(elem_t);
+const double CMP_EPS    = 1e-7; /**< Same as in cmp_double. */
+
+const size_t EMIT_PADDING = 8; /**< Zeros EMIT appends to its bytes and doesn't emit. */
+
+/**
+ * @def EMIT(...)
+ * @brief Macro for emitting the listed bytes.
+ *
+ * The bytes are followed by EMIT_PADDING zeros, which aren't emitted, as -Wstack-protector warns
+ * about the functions whose local arrays are all shorter than 8 bytes, and most instructions are.
+ */
+#define EMIT(...)															\
+	{																		\
+		const unsigned char bytes[] = {__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0};	\
+		jit_emit(compiler, bytes, sizeof(bytes) - EMIT_PADDING);			\
+	}
+
+/**
+ * @def EMIT_VALUE(value)
+ * @brief Macro for emitting the bytes of a value.
+ */
+#define EMIT_VALUE(value)\
+	jit_emit(compiler, &(value), sizeof(value))
+
+/**
+ * @def CONTEXT_FIELD(field)
+ * @brief Macro representing the displacement of a Jit_context field.
+ */
+#define CONTEXT_FIELD(field)\
+	(int)offsetof(Jit_context, field)
+
+#define MOV_LOAD(reg, base, disp)\
+	jit_emit_mem(compiler, 0, true, 0x8B, reg, base, disp)
+
+#define MOV_STORE(base, disp, reg)\
+	jit_emit_mem(compiler, 0, true, 0x89, reg, base, disp)
+
+#define LEA(reg, base, disp)\
+	jit_emit_mem(compiler, 0, true, 0x8D, reg, base, disp)
+
+#define CMP_MEM(reg, base, disp)\
+	jit_emit_mem(compiler, 0, true, 0x3B, reg, base, disp)
+
+#define MOVSD_LOAD(xmm, base, disp)\
+	jit_emit_mem(compiler, 0xF2, false, 0x10, xmm, base, disp)
+
+#define MOVSD_STORE(base, disp, xmm)\
+	jit_emit_mem(compiler, 0xF2, false, 0x11, xmm, base, disp)
+
+#define SSE_MEM(op, xmm, base, disp)\
+	jit_emit_mem(compiler, 0xF2, false, op, xmm, base, disp)
+
+#define CVTTSD2SI(reg, base, disp)\
+	jit_emit_mem(compiler, 0xF2, true, 0x2C, reg, base, disp)
+
+#define CVTSI2SD(xmm, base, disp)\
+	jit_emit_mem(compiler, 0xF2, true, 0x2A, xmm, base, disp)
+
+/**
+ * @def CVTSI2SD_XMM0_RAX
+ * @brief Macro for emitting cvtsi2sd xmm0, rax.
+ */
+#define CVTSI2SD_XMM0_RAX\
+	EMIT(0xF2, 0x48, 0x0F, 0x2A, 0xC0);
+
+/**
+ * @def IADD_RAX_RCX
+ * @brief Macros for emitting the integer operations on rax and rcx, which wrap around like the interpreter ones.
+ */
+#define IADD_RAX_RCX EMIT(0x48, 0x01, 0xC8);
+#define ISUB_RAX_RCX EMIT(0x48, 0x29, 0xC8);
+#define IMUL_RAX_RCX EMIT(0x48, 0x0F, 0xAF, 0xC1);
+
+/**
+ * @def CMP_RAX_RCX
+ * @brief Macro for emitting cmp rax, rcx.
+ */
+#define CMP_RAX_RCX\
+	EMIT(0x48, 0x39, 0xC8);
+
+/**
+ * @def ADD_IMM(reg, value)
+ * @brief Macro for emitting add reg, imm32 on a 64-bit register.
+ */
+#define ADD_IMM(reg, value)																	\
+	{																						\
+		EMIT((unsigned char)(0x48 | (reg >> 3)), 0x81, (unsigned char)(0xC0 | (reg & 7)));	\
+		int imm32 = (value);																\
+		EMIT_VALUE(imm32);																	\
+	}
+
+/**
+ * @def MOV_RAX_IMM64(value)
+ * @brief Macro for emitting mov rax, imm64 with the bytes of a value.
+ */
+#define MOV_RAX_IMM64(value)	\
+	EMIT(0x48, 0xB8);			\
+	EMIT_VALUE(value);
+
+/**
+ * @def MOVQ_XMM1_RAX
+ * @brief Macro for emitting movq xmm1, rax.
+ */
+#define MOVQ_XMM1_RAX\
+	EMIT(0x66, 0x48, 0x0F, 0x6E, 0xC8);
+
+/**
+ * @def MOV_RCX_IMM64(value)
+ * @brief Macro for emitting mov rcx, imm64 with the bytes of a value.
+ */
+#define MOV_RCX_IMM64(value)	\
+	EMIT(0x48, 0xB9);			\
+	EMIT_VALUE(value);
+
+/**
+ * @def MOV_EAX(value)
+ * @brief Macro for emitting mov eax, imm32.
+ */
+#define MOV_EAX(value)			\
+	{							\
+		int imm32 = (value);	\
+		EMIT(0xB8);				\
+		EMIT_VALUE(imm32);		\
+	}
+
+/**
+ * @def CALL_C(function)
+ * @brief Macro for emitting an absolute call of a C function.
+ */
+#define CALL_C(function)					\
+	{										\
+		auto function_ptr = &function;		\
+		EMIT(0x48, 0xB8);					\
+		EMIT_VALUE(function_ptr);			\
+		EMIT(0xFF, 0xD0);					\
+	}
+
+/**
+ * @def PUSH_XMM0
+ * @brief Macro for pushing xmm0 on the operand stack.
+ */
+#define PUSH_XMM0						\
+	MOVSD_STORE(R13, 0, XMM0);			\
+	ADD_IMM(R13, STACK_ELEM);
+
+/**
+ * @def SHORT_JUMP(opcode, pos)
+ * @brief Macro for emitting a short jump, which is resolved by SHORT_JUMP_HERE.
+ */
+#define SHORT_JUMP(opcode, pos)	\
+	pos = compiler->size;		\
+	EMIT(opcode, 0x00);
+
+/**
+ * @def SHORT_JUMP_HERE(pos)
+ * @brief Macro for resolving a short jump to the current position.
+ */
+#define SHORT_JUMP_HERE(pos)													\
+	if(!compiler->overflow)														\
+	{																			\
+		compiler->code[pos + 1] = (unsigned char)(compiler->size - (pos + 2));	\
+	}
+
+/**
+ * @def JAE_CONDITION
+ * @brief Arguments of jit_emit_cond_jump, which mirror the conditions of the interpreter.
+ */
+#define JAE_CONDITION -1, JCC_NE
+#define JA_CONDITION   1, JCC_E
+#define JBE_CONDITION  1, JCC_NE
+#define JB_CONDITION  -1, JCC_E
+#define JE_CONDITION   0, JCC_E
+#define JNE_CONDITION  0, JCC_NE
+
+/**
+ * @def IJAE_JCC
+ * @brief Signed near jumps of the integer commands, which follow cmp rax, rcx.
+ */
+#define IJAE_JCC JCC_GE
+#define IJA_JCC  JCC_G
+#define IJBE_JCC JCC_LE
+#define IJB_JCC  JCC_L
+#define IJE_JCC  JCC_E
+#define IJNE_JCC JCC_NE
+
+spu_err_t jit_compile(Jit_code *jit, const Decoded_program *program)
+{
+	if(program->size > JIT_MAX_INDEX)
+	{
+		return SPU_JIT_UNSUPPORTED;
+	}
+
+	Jit_compiler compiler_state = {};
+	Jit_compiler *compiler      = &compiler_state;
+
+	compiler->capacity = program->size * JIT_MAX_CMD_SIZE + JIT_FRAME_SIZE;
+
+	bool *leaders = NULL;
+	CALLOC(leaders, program->size, bool);
+	CALLOC(compiler->cmd_offsets, program->size, size_t);
+	CALLOC(compiler->patches, program->size, Jit_patch);
+	CALLOC(jit->cmd_addresses, program->size, void *);
+
+	void *mapping = mmap(NULL, compiler->capacity, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(mapping == MAP_FAILED)
+	{
+		LOG("ERROR: Unable to map %lu bytes for the JIT.\n", compiler->capacity);
+
+		free(leaders);
+		free(compiler->cmd_offsets);
+		free(compiler->patches);
+		jit_dtor(jit);
+
+		return SPU_UNABLE_TO_ALLOCATE;
+	}
+
+	compiler->code = (unsigned char *)mapping;
+	jit->code      = compiler->code;
+	jit->capacity  = compiler->capacity;
+
+	// prologue: keep callee-saved registers and the 16 byte call alignment
+	EMIT(0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57);
+	EMIT(0x48, 0x83, 0xEC, 0x08);
+	EMIT(0x49, 0x89, 0xFF);
+
+	MOV_LOAD(RBX, R15, CONTEXT_FIELD(registers));
+	MOV_LOAD(RBP, R15, CONTEXT_FIELD(int_registers));
+	MOV_LOAD(R12, R15, CONTEXT_FIELD(user_RAM));
+	MOV_LOAD(R13, R15, CONTEXT_FIELD(user_stack_top));
+	MOV_LOAD(R14, R15, CONTEXT_FIELD(ret_stack_top));
+
+	size_t body_jump = jit_emit_jump(compiler, JIT_JMP);
+
+	// epilogue: the error code is in eax
+	compiler->epilogue_pos = compiler->size;
+
+	MOV_STORE(R15, CONTEXT_FIELD(user_stack_top), R13);
+	MOV_STORE(R15, CONTEXT_FIELD(ret_stack_top), R14);
+
+	EMIT(0x48, 0x83, 0xC4, 0x08);
+	EMIT(0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D, 0xC3);
+
+	compiler->underflow_pos = compiler->size;
+	MOV_EAX(SPU_STACK_UNDERFLOW);
+	jit_emit_jump_to(compiler, JIT_JMP, compiler->epilogue_pos);
+
+	compiler->overflow_pos = compiler->size;
+	MOV_EAX(SPU_STACK_OVERFLOW);
+	jit_emit_jump_to(compiler, JIT_JMP, compiler->epilogue_pos);
+
+	compiler->input_error_pos = compiler->size;
+	MOV_EAX(SPU_INPUT_EXHAUSTED);
+	jit_emit_jump_to(compiler, JIT_JMP, compiler->epilogue_pos);
+
+	jit_patch_rel(compiler, body_jump, compiler->size);
+
+	// stack bounds are checked where the interpreter checks them: on entering a block
+	bool translatable = true;
+
+	leaders[0] = true;
+
+	for(size_t cmd_ID = 0; cmd_ID < program->size; cmd_ID++)
+	{
+		Decoded_type type = program->cmds[cmd_ID].type;
+
+		if(!is_block_end(type))
+		{
+			continue;
+		}
+
+		if(cmd_ID + 1 < program->size)
+		{
+			leaders[cmd_ID + 1] = true;
+		}
+
+		if(type != D_RET && type != D_HLT)
+		{
+			if(program->cmds[cmd_ID].arg >= program->size)
+			{
+				translatable = false;
+				break;
+			}
+
+			leaders[program->cmds[cmd_ID].arg] = true;
+		}
+	}
+
+	for(size_t cmd_ID = 0; translatable && cmd_ID < program->size; cmd_ID++)
+	{
+		compiler->cmd_offsets[cmd_ID] = compiler->size;
+
+		if(leaders[cmd_ID])
+		{
+			jit_emit_stack_check(compiler, &(program->cmds[cmd_ID]));
+		}
+
+		translatable = jit_emit_cmd(compiler, program, cmd_ID);
+	}
+
+	for(size_t patch_ID = 0; patch_ID < compiler->patches_amount; patch_ID++)
+	{
+		Jit_patch *patch = &(compiler->patches[patch_ID]);
+
+		jit_patch_rel(compiler, patch->rel_pos, compiler->cmd_offsets[patch->target_ID]);
+	}
+
+	for(size_t cmd_ID = 0; cmd_ID < program->size; cmd_ID++)
+	{
+		jit->cmd_addresses[cmd_ID] = compiler->code + compiler->cmd_offsets[cmd_ID];
+	}
+
+	free(leaders);
+	free(compiler->cmd_offsets);
+	free(compiler->patches);
+
+	if(!translatable || compiler->overflow)
+	{
+		LOG("JIT: the program can't be translated.\n");
+		jit_dtor(jit);
+
+		return SPU_JIT_UNSUPPORTED;
+	}
+
+	if(mprotect(jit->code, jit->capacity, PROT_READ | PROT_EXEC) != 0)
+	{
+		LOG("ERROR: Unable to make the JIT code executable.\n");
+		jit_dtor(jit);
+
+		return SPU_JIT_UNSUPPORTED;
+	}
+
+	jit->entry = (Jit_function)(void *)jit->code;
+
+	LOG("JIT: %lu instructions translated into %lu bytes.\n", program->size, compiler->size);
+
+	return SPU_ALL_GOOD;
+}
+
+/**
+ * @def STACK_JUMP_CASE(cond)
+ * @brief Macro for translating a conditional jump on the two top stack values.
+ */
+#define STACK_JUMP_CASE(cond)											\
+	case D_##cond:														\
+	{																	\
+		MOVSD_LOAD(XMM0, R13, -2 * STACK_ELEM);							\
+		MOVSD_LOAD(XMM1, R13, -STACK_ELEM);								\
+		ADD_IMM(R13, -2 * STACK_ELEM);									\
+																		\
+		jit_emit_compare(compiler);										\
+		jit_emit_cond_jump(compiler, cond##_CONDITION, cmd->arg);		\
+		break;															\
+	}
+
+/**
+ * @def FUSED_JUMP_CASES(cond)
+ * @brief Macro for translating the register forms of a fused conditional jump.
+ */
+#define FUSED_JUMP_CASES(cond)											\
+	case D_##cond##_RR:													\
+	{																	\
+		MOVSD_LOAD(XMM0, RBX, reg_A_disp);								\
+		MOVSD_LOAD(XMM1, RBX, reg_B_disp);								\
+																		\
+		jit_emit_compare(compiler);										\
+		jit_emit_cond_jump(compiler, cond##_CONDITION, cmd->arg);		\
+		break;															\
+	}																	\
+	case D_##cond##_RI:													\
+	{																	\
+		MOVSD_LOAD(XMM0, RBX, reg_A_disp);								\
+		MOV_RAX_IMM64(cmd->imm);										\
+		MOVQ_XMM1_RAX;													\
+																		\
+		jit_emit_compare(compiler);										\
+		jit_emit_cond_jump(compiler, cond##_CONDITION, cmd->arg);		\
+		break;															\
+	}
+
+/**
+ * @def RAM_BLOCK_CASE(type, function, popped)
+ * @brief Macro for translating a block RAM command into a call of the C function with its three operands.
+ *
+ * The function returns the error code, which goes straight to the epilogue if it isn't SPU_ALL_GOOD.
+ */
+#define RAM_BLOCK_CASE(type, function, popped)							\
+	case D_##type:														\
+	{																	\
+		EMIT(0x4C, 0x89, 0xFF);				/* mov rdi, r15 */			\
+		LEA(RSI, R13, -3 * STACK_ELEM);									\
+		CALL_C(function);												\
+		EMIT(0x85, 0xC0);					/* test eax, eax */			\
+		jit_emit_jump_to(compiler, JCC_NE, compiler->epilogue_pos);		\
+		ADD_IMM(R13, -(popped) * STACK_ELEM);							\
+		break;															\
+	}
+
+/**
+ * @def STACK_ARITHM_CASE(op, sse_op)
+ * @brief Macro for translating an arithmetic command on the two top stack values.
+ */
+#define STACK_ARITHM_CASE(op, sse_op)									\
+	case D_##op:														\
+	{																	\
+		MOVSD_LOAD(XMM0, R13, -2 * STACK_ELEM);							\
+		SSE_MEM(sse_op, XMM0, R13, -STACK_ELEM);						\
+		MOVSD_STORE(R13, -2 * STACK_ELEM, XMM0);						\
+		ADD_IMM(R13, -STACK_ELEM);										\
+		break;															\
+	}
+
+#define FUSED_OPERANDS_RR(sse_op)										\
+	MOVSD_LOAD(XMM0, RBX, reg_A_disp);									\
+	SSE_MEM(sse_op, XMM0, RBX, reg_B_disp);
+
+#define FUSED_OPERANDS_RI(sse_op)										\
+	MOV_RAX_IMM64(cmd->imm);											\
+	MOVQ_XMM1_RAX;														\
+	MOVSD_LOAD(XMM0, RBX, reg_A_disp);									\
+	EMIT(0xF2, 0x0F, sse_op, 0xC1);
+
+/**
+ * @def FUSED_ARITHM_CASES(op, sse_op)
+ * @brief Macro for translating the register forms of a fused arithmetic command.
+ */
+#define FUSED_ARITHM_CASES(op, sse_op)									\
+	case D_##op##_RR:													\
+	{																	\
+		FUSED_OPERANDS_RR(sse_op);										\
+		PUSH_XMM0;														\
+		break;															\
+	}																	\
+	case D_##op##_RI:													\
+	{																	\
+		FUSED_OPERANDS_RI(sse_op);										\
+		PUSH_XMM0;														\
+		break;															\
+	}																	\
+	case D_##op##_RR_TO_REG:											\
+	{																	\
+		FUSED_OPERANDS_RR(sse_op);										\
+		MOVSD_STORE(RBX, arg_disp, XMM0);								\
+		break;															\
+	}																	\
+	case D_##op##_RI_TO_REG:											\
+	{																	\
+		FUSED_OPERANDS_RI(sse_op);										\
+		MOVSD_STORE(RBX, arg_disp, XMM0);								\
+		break;															\
+	}
+
+/**
+ * @def STACK_INT_ARITHM_CASE(op)
+ * @brief Macro for translating an integer arithmetic command on the two top stack values.
+ */
+#define STACK_INT_ARITHM_CASE(op)										\
+	case D_##op:														\
+	{																	\
+		CVTTSD2SI(RAX, R13, -2 * STACK_ELEM);							\
+		CVTTSD2SI(RCX, R13, -STACK_ELEM);								\
+		op##_RAX_RCX;													\
+		CVTSI2SD_XMM0_RAX;												\
+		MOVSD_STORE(R13, -2 * STACK_ELEM, XMM0);						\
+		ADD_IMM(R13, -STACK_ELEM);										\
+		break;															\
+	}
+
+/**
+ * @def STACK_INT_JUMP_CASE(cond)
+ * @brief Macro for translating an integer conditional jump on the two top stack values.
+ */
+#define STACK_INT_JUMP_CASE(cond)										\
+	case D_##cond:														\
+	{																	\
+		CVTTSD2SI(RAX, R13, -2 * STACK_ELEM);							\
+		CVTTSD2SI(RCX, R13, -STACK_ELEM);								\
+		ADD_IMM(R13, -2 * STACK_ELEM);									\
+																		\
+		CMP_RAX_RCX;													\
+		jit_emit_jump_to_cmd(compiler, cond##_JCC, cmd->arg);			\
+		break;															\
+	}
+
+/**
+ * @def INT_FUSED_ARITHM_CASES(op)
+ * @brief Macro for translating the forms of a fused integer arithmetic command.
+ */
+#define INT_FUSED_ARITHM_CASES(op)										\
+	case D_##op##_RR:													\
+	{																	\
+		MOV_LOAD(RAX, RBP, reg_A_disp);									\
+		MOV_LOAD(RCX, RBP, reg_B_disp);									\
+		op##_RAX_RCX;													\
+		CVTSI2SD_XMM0_RAX;												\
+		PUSH_XMM0;														\
+		break;															\
+	}																	\
+	case D_##op##_RI:													\
+	{																	\
+		MOV_LOAD(RAX, RBP, reg_A_disp);									\
+		MOV_RCX_IMM64(cmd->int_imm);									\
+		op##_RAX_RCX;													\
+		CVTSI2SD_XMM0_RAX;												\
+		PUSH_XMM0;														\
+		break;															\
+	}																	\
+	case D_##op##_RR_TO_REG:											\
+	{																	\
+		MOV_LOAD(RAX, RBP, reg_A_disp);									\
+		MOV_LOAD(RCX, RBP, reg_B_disp);									\
+		op##_RAX_RCX;													\
+		MOV_STORE(RBP, arg_disp, RAX);									\
+		break;															\
+	}																	\
+	case D_##op##_RI_TO_REG:											\
+	{																	\
+		MOV_LOAD(RAX, RBP, reg_A_disp);									\
+		MOV_RCX_IMM64(cmd->int_imm);									\
+		op##_RAX_RCX;													\
+		MOV_STORE(RBP, arg_disp, RAX);									\
+		break;															\
+	}
+
+/**
+ * @def INT_FUSED_JUMP_CASES(cond)
+ * @brief Macro for translating the register forms of a fused integer conditional jump.
+ */
+#define INT_FUSED_JUMP_CASES(cond)										\
+	case D_##cond##_RR:													\
+	{																	\
+		MOV_LOAD(RAX, RBP, reg_A_disp);									\
+		MOV_LOAD(RCX, RBP, reg_B_disp);									\
+		CMP_RAX_RCX;													\
+		jit_emit_jump_to_cmd(compiler, cond##_JCC, cmd->arg);			\
+		break;															\
+	}																	\
+	case D_##cond##_RI:													\
+	{																	\
+		MOV_LOAD(RAX, RBP, reg_A_disp);									\
+		MOV_RCX_IMM64(cmd->int_imm);									\
+		CMP_RAX_RCX;													\
+		jit_emit_jump_to_cmd(compiler, cond##_JCC, cmd->arg);			\
+		break;															\
+	}
+
+bool jit_emit_cmd(Jit_compiler *compiler, const Decoded_program *program, size_t cmd_ID)
+{
+	const Decoded_cmd *cmd = &(program->cmds[cmd_ID]);
+
+	if(cmd->arg > JIT_MAX_INDEX)
+	{
+		return false;
+	}
+
+	int arg_disp   = (int)(cmd->arg   * sizeof(elem_t));
+	int reg_A_disp = (int)(cmd->reg_A * sizeof(elem_t));
+	int reg_B_disp = (int)(cmd->reg_B * sizeof(elem_t));
+
+	switch(cmd->type)
+	{
+		case D_NOP:
+		{
+			break;
+		}
+		case D_PUSH_IMM:
+		{
+			MOV_RAX_IMM64(cmd->imm);
+			MOV_STORE(R13, 0, RAX);
+			ADD_IMM(R13, STACK_ELEM);
+			break;
+		}
+		case D_PUSH_REG:
+		{
+			MOV_LOAD(RAX, RBX, arg_disp);
+			MOV_STORE(R13, 0, RAX);
+			ADD_IMM(R13, STACK_ELEM);
+			break;
+		}
+		case D_PUSH_RAM_IMM:
+		{
+			MOV_LOAD(RAX, R12, arg_disp);
+			MOV_STORE(R13, 0, RAX);
+			ADD_IMM(R13, STACK_ELEM);
+			break;
+		}
+		case D_PUSH_RAM_REG:
+		{
+			CVTTSD2SI(RAX, RBX, arg_disp);
+			EMIT(0x89, 0xC0);					// mov eax, eax
+			EMIT(0x49, 0x8B, 0x04, 0xC4);		// mov rax, [r12 + rax * 8]
+			MOV_STORE(R13, 0, RAX);
+			ADD_IMM(R13, STACK_ELEM);
+			break;
+		}
+		case D_PUSH_IREG:
+		{
+			CVTSI2SD(XMM0, RBP, arg_disp);
+			PUSH_XMM0;
+			break;
+		}
+		case D_PUSH_RAM_IREG:
+		{
+			MOV_LOAD(RAX, RBP, arg_disp);
+			EMIT(0x89, 0xC0);					// mov eax, eax
+			EMIT(0x49, 0x8B, 0x04, 0xC4);		// mov rax, [r12 + rax * 8]
+			MOV_STORE(R13, 0, RAX);
+			ADD_IMM(R13, STACK_ELEM);
+			break;
+		}
+		case D_POP_REG:
+		{
+			ADD_IMM(R13, -STACK_ELEM);
+			MOV_LOAD(RAX, R13, 0);
+			MOV_STORE(RBX, arg_disp, RAX);
+			break;
+		}
+		case D_POP_RAM_IMM:
+		{
+			ADD_IMM(R13, -STACK_ELEM);
+			MOV_LOAD(RAX, R13, 0);
+			MOV_STORE(R12, arg_disp, RAX);
+			break;
+		}
+		case D_POP_RAM_REG:
+		{
+			CVTTSD2SI(RAX, RBX, arg_disp);
+			EMIT(0x89, 0xC0);					// mov eax, eax
+			ADD_IMM(R13, -STACK_ELEM);
+			MOV_LOAD(RCX, R13, 0);
+			EMIT(0x49, 0x89, 0x0C, 0xC4);		// mov [r12 + rax * 8], rcx
+			break;
+		}
+		case D_POP_IREG:
+		{
+			ADD_IMM(R13, -STACK_ELEM);
+			CVTTSD2SI(RAX, R13, 0);
+			MOV_STORE(RBP, arg_disp, RAX);
+			break;
+		}
+		case D_POP_RAM_IREG:
+		{
+			MOV_LOAD(RAX, RBP, arg_disp);
+			EMIT(0x89, 0xC0);					// mov eax, eax
+			ADD_IMM(R13, -STACK_ELEM);
+			MOV_LOAD(RCX, R13, 0);
+			EMIT(0x49, 0x89, 0x0C, 0xC4);		// mov [r12 + rax * 8], rcx
+			break;
+		}
+		case D_IN:
+		{
+			EMIT(0x4C, 0x89, 0xFF);				// mov rdi, r15
+			CALL_C(jit_in);
+			EMIT(0x41, 0x80, 0xBF);				// cmp byte [r15 + disp32], 0
+			int input_failed_disp = CONTEXT_FIELD(input_failed);
+			EMIT_VALUE(input_failed_disp);
+			EMIT(0x00);
+			jit_emit_jump_to(compiler, JCC_NE, compiler->input_error_pos);
+			PUSH_XMM0;
+			break;
+		}
+		STACK_ARITHM_CASE(ADD, ADDSD)
+		STACK_ARITHM_CASE(SUB, SUBSD)
+		STACK_ARITHM_CASE(MUL, MULSD)
+		STACK_ARITHM_CASE(DIV, DIVSD)
+		case D_OUT:
+		{
+			ADD_IMM(R13, -STACK_ELEM);
+			MOVSD_LOAD(XMM0, R13, 0);
+			EMIT(0x4C, 0x89, 0xFF);				// mov rdi, r15
+			CALL_C(jit_out);
+			break;
+		}
+		case D_RET:
+		{
+			CMP_MEM(R14, R15, CONTEXT_FIELD(ret_stack_base));
+			jit_emit_jump_to(compiler, JCC_BE, compiler->underflow_pos);
+
+			CVTTSD2SI(RAX, R14, -STACK_ELEM);
+			ADD_IMM(R14, -STACK_ELEM);
+
+			MOV_LOAD(RCX, R15, CONTEXT_FIELD(cmd_addresses));
+			EMIT(0xFF, 0x24, 0xC1);				// jmp [rcx + rax * 8]
+			break;
+		}
+		case D_JMP:
+		{
+			jit_emit_jump_to_cmd(compiler, JIT_JMP, cmd->arg);
+			break;
+		}
+		STACK_JUMP_CASE(JAE)
+		STACK_JUMP_CASE(JA)
+		STACK_JUMP_CASE(JBE)
+		STACK_JUMP_CASE(JB)
+		STACK_JUMP_CASE(JE)
+		STACK_JUMP_CASE(JNE)
+		case D_CALL:
+		{
+			CMP_MEM(R14, R15, CONTEXT_FIELD(ret_stack_limit));
+			jit_emit_jump_to(compiler, JCC_AE, compiler->overflow_pos);
+
+			elem_t ret_ID = (elem_t)(cmd_ID + 1);
+
+			MOV_RAX_IMM64(ret_ID);
+			MOV_STORE(R14, 0, RAX);
+			ADD_IMM(R14, STACK_ELEM);
+
+			jit_emit_jump_to_cmd(compiler, JIT_JMP, cmd->arg);
+			break;
+		}
+		case D_HLT:
+		{
+			EMIT(0x31, 0xC0);					// xor eax, eax
+			jit_emit_jump_to(compiler, JIT_JMP, compiler->epilogue_pos);
+			break;
+		}
+		case D_DRAW:
+		{
+			EMIT(0x4C, 0x89, 0xFF);				// mov rdi, r15
+			EMIT(0x48, 0xBE);					// mov rsi, imm64
+			EMIT_VALUE(cmd->raw);
+			CALL_C(jit_draw);
+			break;
+		}
+		case D_SQRT:
+		{
+			SSE_MEM(SQRTSD, XMM0, R13, -STACK_ELEM);
+			MOVSD_STORE(R13, -STACK_ELEM, XMM0);
+			break;
+		}
+		RAM_BLOCK_CASE(FILL,    jit_fill,    3)
+		RAM_BLOCK_CASE(COPY,    jit_copy,    3)
+		RAM_BLOCK_CASE(COMPARE, jit_compare, 2)
+		FUSED_ARITHM_CASES(ADD, ADDSD)
+		FUSED_ARITHM_CASES(SUB, SUBSD)
+		FUSED_ARITHM_CASES(MUL, MULSD)
+		FUSED_ARITHM_CASES(DIV, DIVSD)
+		FUSED_JUMP_CASES(JAE)
+		FUSED_JUMP_CASES(JA)
+		FUSED_JUMP_CASES(JBE)
+		FUSED_JUMP_CASES(JB)
+		FUSED_JUMP_CASES(JE)
+		FUSED_JUMP_CASES(JNE)
+		STACK_INT_ARITHM_CASE(IADD)
+		STACK_INT_ARITHM_CASE(ISUB)
+		STACK_INT_ARITHM_CASE(IMUL)
+		STACK_INT_JUMP_CASE(IJAE)
+		STACK_INT_JUMP_CASE(IJA)
+		STACK_INT_JUMP_CASE(IJBE)
+		STACK_INT_JUMP_CASE(IJB)
+		STACK_INT_JUMP_CASE(IJE)
+		STACK_INT_JUMP_CASE(IJNE)
+		INT_FUSED_ARITHM_CASES(IADD)
+		INT_FUSED_ARITHM_CASES(ISUB)
+		INT_FUSED_ARITHM_CASES(IMUL)
+		INT_FUSED_JUMP_CASES(IJAE)
+		INT_FUSED_JUMP_CASES(IJA)
+		INT_FUSED_JUMP_CASES(IJBE)
+		INT_FUSED_JUMP_CASES(IJB)
+		INT_FUSED_JUMP_CASES(IJE)
+		INT_FUSED_JUMP_CASES(IJNE)
+		case D_SNAP:
+		case DECODED_TYPES_AMOUNT:
+		default:
+		{
+			LOG("JIT: unsupported command %d in the slot %lu.\n", cmd->type, cmd_ID);
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#undef INT_FUSED_JUMP_CASES
+#undef INT_FUSED_ARITHM_CASES
+#undef STACK_INT_JUMP_CASE
+#undef STACK_INT_ARITHM_CASE
+#undef RAM_BLOCK_CASE
+#undef FUSED_ARITHM_CASES
+#undef FUSED_OPERANDS_RI
+#undef FUSED_OPERANDS_RR
+#undef STACK_ARITHM_CASE
+#undef FUSED_JUMP_CASES
+#undef STACK_JUMP_CASE
+
+void jit_emit_stack_check(Jit_compiler *compiler, const Decoded_cmd *cmd)
+{
+	if(cmd->stack_need > 0)
+	{
+		LEA(RAX, R13, -(int)cmd->stack_need * STACK_ELEM);
+		CMP_MEM(RAX, R15, CONTEXT_FIELD(user_stack_base));
+		jit_emit_jump_to(compiler, JCC_B, compiler->underflow_pos);
+	}
+
+	if(cmd->stack_growth > 0)
+	{
+		LEA(RAX, R13, (int)cmd->stack_growth * STACK_ELEM);
+		CMP_MEM(RAX, R15, CONTEXT_FIELD(user_stack_limit));
+		jit_emit_jump_to(compiler, JCC_A, compiler->overflow_pos);
+	}
+}
+
+void jit_emit_compare(Jit_compiler *compiler)
+{
+	size_t A_is_number = 0;
+	size_t B_is_number = 0;
+	size_t equal       = 0;
+	size_t close       = 0;
+	size_t greater     = 0;
+
+	// two NaNs are equal
+	EMIT(0x66, 0x0F, 0x2E, 0xC0);				// ucomisd xmm0, xmm0
+	SHORT_JUMP(0x7B, A_is_number);				// jnp
+	EMIT(0x66, 0x0F, 0x2E, 0xC9);				// ucomisd xmm1, xmm1
+	SHORT_JUMP(0x7B, B_is_number);				// jnp
+	EMIT(0x31, 0xC0);							// xor eax, eax
+	SHORT_JUMP(0xEB, equal);					// jmp
+
+	SHORT_JUMP_HERE(A_is_number);
+	SHORT_JUMP_HERE(B_is_number);
+
+	EMIT(0xF2, 0x0F, 0x5C, 0xC1);				// subsd xmm0, xmm1
+	EMIT(0x66, 0x48, 0x0F, 0x7E, 0xC0);			// movq rax, xmm0
+	EMIT(0x48, 0x0F, 0xBA, 0xF0, 0x3F);			// btr rax, 63
+	MOVQ_XMM1_RAX;
+	MOV_RAX_IMM64(CMP_EPS);
+	EMIT(0x66, 0x48, 0x0F, 0x6E, 0xD0);			// movq xmm2, rax
+
+	EMIT(0x31, 0xC0);							// xor eax, eax
+	EMIT(0x66, 0x0F, 0x2E, 0xD1);				// ucomisd xmm2, xmm1
+	SHORT_JUMP(0x77, close);					// ja
+	MOV_EAX(1);
+	EMIT(0x66, 0x0F, 0x2E, 0xC2);				// ucomisd xmm0, xmm2
+	SHORT_JUMP(0x77, greater);					// ja
+	MOV_EAX(-1);
+
+	SHORT_JUMP_HERE(equal);
+	SHORT_JUMP_HERE(close);
+	SHORT_JUMP_HERE(greater);
+}
+
+void jit_emit_cond_jump(Jit_compiler *compiler, signed char cmp_value, unsigned char jcc, size_t target_ID)
+{
+	EMIT(0x83, 0xF8, (unsigned char)cmp_value);	// cmp eax, imm8
+	jit_emit_jump_to_cmd(compiler, jcc, target_ID);
+}
+
+void jit_emit(Jit_compiler *compiler, const void *bytes, size_t amount)
+{
+	if(compiler->size + amount > compiler->capacity)
+	{
+		compiler->overflow = true;
+		return;
+	}
+
+	memcpy(compiler->code + compiler->size, bytes, amount);
+	compiler->size += amount;
+}
+
+void jit_emit_mem(Jit_compiler *compiler, unsigned char prefix, bool rex_w, unsigned char opcode,
+				  unsigned char reg, unsigned char base, int disp)
+{
+	unsigned char rex = (unsigned char)(0x40 | (rex_w ? 0x08 : 0) | ((reg >> 3) << 2) | (base >> 3));
+
+	if(prefix != 0)
+	{
+		EMIT(prefix);
+	}
+	if(rex != 0x40)
+	{
+		EMIT(rex);
+	}
+	if(prefix != 0)
+	{
+		EMIT(0x0F);
+	}
+
+	EMIT(opcode, (unsigned char)(0x80 | ((reg & 7) << 3) | (base & 7)));
+
+	if((base & 7) == 4)
+	{
+		EMIT(0x24);
+	}
+
+	EMIT_VALUE(disp);
+}
+
+size_t jit_emit_jump(Jit_compiler *compiler, unsigned char jcc)
+{
+	if(jcc == JIT_JMP)
+	{
+		EMIT(JIT_JMP);
+	}
+	else
+	{
+		EMIT(0x0F, jcc);
+	}
+
+	size_t rel_pos = compiler->size;
+	int    rel     = 0;
+
+	EMIT_VALUE(rel);
+
+	return rel_pos;
+}
+
+void jit_emit_jump_to(Jit_compiler *compiler, unsigned char jcc, size_t target_pos)
+{
+	size_t rel_pos = jit_emit_jump(compiler, jcc);
+
+	jit_patch_rel(compiler, rel_pos, target_pos);
+}
+
+void jit_emit_jump_to_cmd(Jit_compiler *compiler, unsigned char jcc, size_t target_ID)
+{
+	size_t rel_pos = jit_emit_jump(compiler, jcc);
+
+	compiler->patches[compiler->patches_amount++] =
+	{
+		.rel_pos   = rel_pos,
+		.target_ID = target_ID,
+	};
+}
+
+void jit_patch_rel(Jit_compiler *compiler, size_t rel_pos, size_t target_pos)
+{
+	if(compiler->overflow)
+	{
+		return;
+	}
+
+	int rel = (int)((long)target_pos - (long)(rel_pos + sizeof(int)));
+
+	memcpy(compiler->code + rel_pos, &rel, sizeof(int));
+}
+
+spu_err_t jit_run(Jit_code *jit, VM *vm, FILE *output_file,
+				  void (*driver)(VM *, char *, FILE *))
+{
+	Jit_context context =
+	{
+		.registers        = vm->registers,
+		.int_registers    = vm->int_registers,
+		.user_RAM         = vm->rand_access_mem.user_RAM,
+		.user_stack_base  = vm->user_stack.data,
+		.user_stack_limit = vm->user_stack.data + vm->user_stack.capacity,
+		.user_stack_top   = vm->user_stack.data + vm->user_stack.size,
+		.ret_stack_base   = vm->ret_stack.data,
+		.ret_stack_limit  = vm->ret_stack.data + vm->ret_stack.capacity,
+		.ret_stack_top    = vm->ret_stack.data + vm->ret_stack.size,
+		.cmd_addresses    = jit->cmd_addresses,
+		.vm               = vm,
+		.output_file      = output_file,
+		.driver           = driver,
+	};
+
+	spu_err_t error_code = jit->entry(&context);
+
+	vm->user_stack.size = (size_t)(context.user_stack_top - context.user_stack_base);
+	vm->ret_stack.size  = (size_t)(context.ret_stack_top  - context.ret_stack_base);
+
+	return error_code;
+}
+
+void jit_dtor(Jit_code *jit)
+{
+	if(jit->code != NULL)
+	{
+		munmap(jit->code, jit->capacity);
+	}
+
+	free(jit->cmd_addresses);
+
+	*jit = {};
+}
+
+void jit_out(Jit_context *context, elem_t value)
+{
+	sink_write_value(&(context->vm->output), value);
+}
+
+elem_t jit_in(Jit_context *context)
+{
+	elem_t user_entered_value = NAN;
+
+	context->input_failed = !input_read(context->vm->input, &user_entered_value);
+
+	return user_entered_value;
+}
+
+void jit_draw(Jit_context *context, char *raw)
+{
+	(*context->driver)(context->vm, raw, context->output_file);
+}
+
+spu_err_t jit_fill(Jit_context *context, elem_t *operands)
+{
+	return ram_fill(&(context->vm->rand_access_mem), operands[0], operands[1], operands[2]);
+}
+
+spu_err_t jit_copy(Jit_context *context, elem_t *operands)
+{
+	return ram_copy(&(context->vm->rand_access_mem), operands[0], operands[1], operands[2]);
+}
+
+spu_err_t jit_compare(Jit_context *context, elem_t *operands)
+{
+	return ram_compare(&(context->vm->rand_access_mem), operands[0], operands[1], operands[2], operands);
+}
+
+#undef IJNE_JCC
+#undef IJE_JCC
+#undef IJB_JCC
+#undef IJBE_JCC
+#undef IJA_JCC
+#undef IJAE_JCC
+#undef JNE_CONDITION
+#undef JE_CONDITION
+#undef JB_CONDITION
+#undef JBE_CONDITION
+#undef JA_CONDITION
+#undef JAE_CONDITION
+#undef SHORT_JUMP_HERE
+#undef SHORT_JUMP
+#undef PUSH_XMM0
+#undef CALL_C
+#undef MOV_EAX
+#undef MOVQ_XMM1_RAX
+#undef MOV_RCX_IMM64
+#undef MOV_RAX_IMM64
+#undef ADD_IMM
+#undef CMP_RAX_RCX
+#undef IMUL_RAX_RCX
+#undef ISUB_RAX_RCX
+#undef IADD_RAX_RCX
+#undef CVTSI2SD_XMM0_RAX
+#undef CVTSI2SD
+#undef CVTTSD2SI
+#undef SSE_MEM
+#undef MOVSD_STORE
+#undef MOVSD_LOAD
+#undef CMP_MEM
+#undef LEA
+#undef MOV_STORE
+#undef MOV_LOAD
+#undef CONTEXT_FIELD
+#undef EMIT_VALUE
+#undef EMIT
+#undef ALLOCATION_CHECK
+
+#endif
+
+bool jit_execute(VM *vm, const Decoded_program *program, FILE *output_file,
+				 void (*driver)(VM *, char *, FILE *), spu_err_t *error_code)
+{
+	if(!vm->jit_enabled)
+	{
+		return false;
+	}
+
+#ifdef SPU_JIT_AVAILABLE
+	Jit_code jit = {};
+
+	if(jit_compile(&jit, program) != SPU_ALL_GOOD)
+	{
+		LOG("JIT: falling back to the interpreter.\n");
+
+		return false;
+	}
+
+	*error_code = jit_run(&jit, vm, output_file, driver);
+
+	jit_dtor(&jit);
+
+	return true;
+#else
+	(void)program;
+	(void)output_file;
+	(void)driver;
+	(void)error_code;
+
+	LOG("JIT is not available on this target, falling back to the interpreter.\n");
+
+	return false;
+#endif
+}
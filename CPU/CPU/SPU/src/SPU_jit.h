@@ -0,0 +1,297 @@
+#ifndef SPU_JIT
+#define SPU_JIT
+
+/**
+ * @file SPU_jit.h
+ * @brief Optional x86-64 JIT tier, which translates the decoded program into native code.
+ *
+ * The tier is enabled by "jit: 1" in the config file. Native code keeps the VM state
+ * in memory: VM registers stay in VM::registers and VM::int_registers, RAM in user_RAM,
+ * and both stacks in their VM_stack buffers. in, out and draw call back into C.
+ * If the JIT is not available on the target, or the program can't be translated,
+ * process() falls back to the interpreter.
+ */
+
+#include "SPU.h"
+#include "SPU_decoder.h"
+
+/**
+ * @def SPU_JIT_AVAILABLE
+ * @brief Defined when native code can be generated for the target.
+ */
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__)) && !defined(CPU_DEBUG)
+	#define SPU_JIT_AVAILABLE
+#endif
+
+const size_t JIT_MAX_CMD_SIZE  = 128; /**< Upper bound of the native code size of one decoded instruction. */
+const size_t JIT_FRAME_SIZE    = 256; /**< Upper bound of the prologue, epilogue and error stubs size. */
+const size_t JIT_MAX_INDEX     = 0x0FFFFFFF; /**< Largest slot, register or RAM index that fits a disp32. */
+
+const unsigned char JIT_JMP = 0xE9; /**< Opcode of the near unconditional jump. */
+const unsigned char JCC_B   = 0x82; /**< Near jb. */
+const unsigned char JCC_AE  = 0x83; /**< Near jae. */
+const unsigned char JCC_E   = 0x84; /**< Near je. */
+const unsigned char JCC_NE  = 0x85; /**< Near jne. */
+const unsigned char JCC_BE  = 0x86; /**< Near jbe. */
+const unsigned char JCC_A   = 0x87; /**< Near ja. */
+const unsigned char JCC_L   = 0x8C; /**< Near jl. */
+const unsigned char JCC_GE  = 0x8D; /**< Near jge. */
+const unsigned char JCC_LE  = 0x8E; /**< Near jle. */
+const unsigned char JCC_G   = 0x8F; /**< Near jg. */
+
+/**
+ * @struct Jit_context
+ * @brief Structure passed to the native code, which holds everything it touches.
+ */
+struct Jit_context
+{
+	elem_t  *registers; /**< VM registers. */
+	int64_t *int_registers; /**< VM integer registers. */
+	elem_t  *user_RAM; /**< VM RAM. */
+	elem_t  *user_stack_base; /**< Bottom of the operand stack. */
+	elem_t  *user_stack_limit; /**< End of the operand stack buffer. */
+	elem_t  *user_stack_top; /**< Operand stack top, updated on exit. */
+	elem_t  *ret_stack_base; /**< Bottom of the return stack. */
+	elem_t  *ret_stack_limit; /**< End of the return stack buffer. */
+	elem_t  *ret_stack_top; /**< Return stack top, updated on exit. */
+	void   **cmd_addresses; /**< Native address of every decoded instruction, used by ret. */
+	VM      *vm; /**< The VM, passed to the driver. */
+	FILE    *output_file; /**< Output file of out and draw. */
+	void   (*driver)(VM *, char *, FILE *); /**< Driver of draw. */
+	bool     input_failed; /**< Set by jit_in when the input source has no values left. */
+};
+
+/**
+ * @typedef Jit_function
+ * @brief Native entry point of a translated program.
+ */
+typedef spu_err_t (*Jit_function)(Jit_context *context);
+
+/**
+ * @struct Jit_patch
+ * @brief Structure representing a jump whose target is resolved after the translation.
+ */
+struct Jit_patch
+{
+	size_t rel_pos; /**< Position of the rel32 field in the code. */
+	size_t target_ID; /**< Target decoded instruction. */
+};
+
+/**
+ * @struct Jit_compiler
+ * @brief Structure representing the state of a translation.
+ */
+struct Jit_compiler
+{
+	unsigned char *code; /**< Code buffer. */
+	size_t         size; /**< Amount of emitted bytes. */
+	size_t         capacity; /**< Size of the code buffer. */
+	bool           overflow; /**< Emission ran out of the buffer. */
+	size_t        *cmd_offsets; /**< Code offset of every decoded instruction. */
+	Jit_patch     *patches; /**< Unresolved jumps. */
+	size_t         patches_amount; /**< Amount of unresolved jumps. */
+	size_t         epilogue_pos; /**< Offset of the epilogue, which returns eax. */
+	size_t         underflow_pos; /**< Offset of the stack underflow exit. */
+	size_t         overflow_pos; /**< Offset of the stack overflow exit. */
+	size_t         input_error_pos; /**< Offset of the exhausted input exit. */
+};
+
+/**
+ * @struct Jit_code
+ * @brief Structure representing a translated program.
+ */
+struct Jit_code
+{
+	unsigned char *code; /**< Executable mapping. */
+	size_t         capacity; /**< Size of the mapping. */
+	void         **cmd_addresses; /**< Native address of every decoded instruction. */
+	Jit_function   entry; /**< Entry point. */
+};
+
+/**
+ * @brief Translates the program with the JIT and runs it if the JIT is enabled in the VM.
+ *
+ * @param vm Pointer to the Virtual Machine.
+ * @param program Pointer to the decoded program.
+ * @param output_file Pointer to the output file.
+ * @param driver Pointer to the function driver.
+ * @param error_code Pointer to the error code of the native run.
+ * @return bool Returns true if the program was run natively, false if the interpreter has to run it.
+ */
+bool jit_execute(VM *vm, const Decoded_program *program, FILE *output_file,
+				 void (*driver)(VM *, char *, FILE *), spu_err_t *error_code);
+
+/**
+ * @brief Translates the decoded program into native code.
+ *
+ * @param jit Pointer to the translated program to fill.
+ * @param program Pointer to the decoded program.
+ * @return spu_err_t Returns SPU_JIT_UNSUPPORTED if the program can't be translated.
+ */
+spu_err_t jit_compile(Jit_code *jit, const Decoded_program *program);
+
+/**
+ * @brief Runs the translated program on the VM.
+ *
+ * @param jit Pointer to the translated program.
+ * @param vm Pointer to the Virtual Machine.
+ * @param output_file Pointer to the output file.
+ * @param driver Pointer to the function driver.
+ * @return spu_err_t Returns the error code the program halted with.
+ */
+spu_err_t jit_run(Jit_code *jit, VM *vm, FILE *output_file,
+				  void (*driver)(VM *, char *, FILE *));
+
+/**
+ * @brief Frees the translated program.
+ *
+ * @param jit Pointer to the translated program.
+ */
+void jit_dtor(Jit_code *jit);
+
+/**
+ * @brief Translates one decoded instruction.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param program Pointer to the decoded program.
+ * @param cmd_ID Index of the instruction.
+ * @return bool Returns false for instructions the JIT can't translate.
+ */
+bool jit_emit_cmd(Jit_compiler *compiler, const Decoded_program *program, size_t cmd_ID);
+
+/**
+ * @brief Emits the operand stack check of the block that starts at the instruction.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param cmd Pointer to the instruction.
+ */
+void jit_emit_stack_check(Jit_compiler *compiler, const Decoded_cmd *cmd);
+
+/**
+ * @brief Emits cmp_double(xmm0, xmm1) with the result in eax.
+ *
+ * @param compiler Pointer to the translation state.
+ */
+void jit_emit_compare(Jit_compiler *compiler);
+
+/**
+ * @brief Emits a jump to the instruction taken if cmp_double result compares to the value as requested.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param cmp_value Value the cmp_double result is compared with.
+ * @param jcc Second opcode byte of the near conditional jump.
+ * @param target_ID Target decoded instruction.
+ */
+void jit_emit_cond_jump(Jit_compiler *compiler, signed char cmp_value, unsigned char jcc, size_t target_ID);
+
+/**
+ * @brief Emits bytes.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param bytes Bytes to emit.
+ * @param amount Amount of bytes.
+ */
+void jit_emit(Jit_compiler *compiler, const void *bytes, size_t amount);
+
+/**
+ * @brief Emits an instruction with a [base + disp32] memory operand.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param prefix Mandatory SSE prefix followed by the 0x0F escape, 0 for none.
+ * @param rex_w Whether the operation is 64-bit.
+ * @param opcode Opcode byte.
+ * @param reg Register operand.
+ * @param base Base register of the memory operand.
+ * @param disp Displacement of the memory operand.
+ */
+void jit_emit_mem(Jit_compiler *compiler, unsigned char prefix, bool rex_w, unsigned char opcode,
+				  unsigned char reg, unsigned char base, int disp);
+
+/**
+ * @brief Emits a near jump with an unresolved rel32.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param jcc Second opcode byte of the conditional jump, JIT_JMP for the unconditional one.
+ * @return size_t Returns the position of the rel32 field.
+ */
+size_t jit_emit_jump(Jit_compiler *compiler, unsigned char jcc);
+
+/**
+ * @brief Emits a near jump to an already emitted position.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param jcc Second opcode byte of the conditional jump, JIT_JMP for the unconditional one.
+ * @param target_pos Target position in the code.
+ */
+void jit_emit_jump_to(Jit_compiler *compiler, unsigned char jcc, size_t target_pos);
+
+/**
+ * @brief Emits a near jump to a decoded instruction, resolved after the translation.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param jcc Second opcode byte of the conditional jump, JIT_JMP for the unconditional one.
+ * @param target_ID Target decoded instruction.
+ */
+void jit_emit_jump_to_cmd(Jit_compiler *compiler, unsigned char jcc, size_t target_ID);
+
+/**
+ * @brief Writes the rel32 field of a jump.
+ *
+ * @param compiler Pointer to the translation state.
+ * @param rel_pos Position of the rel32 field.
+ * @param target_pos Target position in the code.
+ */
+void jit_patch_rel(Jit_compiler *compiler, size_t rel_pos, size_t target_pos);
+
+/**
+ * @brief Out command called from the native code.
+ *
+ * @param context Pointer to the native run context.
+ * @param value Value to print.
+ */
+void jit_out(Jit_context *context, elem_t value);
+
+/**
+ * @brief In command called from the native code.
+ *
+ * @param context Pointer to the native run context, whose input_failed is set if the source ran out.
+ * @return elem_t Returns the value read from the input source.
+ */
+elem_t jit_in(Jit_context *context);
+
+/**
+ * @brief Draw command called from the native code.
+ *
+ * @param context Pointer to the native run context.
+ * @param raw Position of the draw command in the byte code.
+ */
+void jit_draw(Jit_context *context, char *raw);
+
+/**
+ * @brief Fill command called from the native code.
+ *
+ * @param context Pointer to the native run context.
+ * @param operands Pointer to the popped operands: address, amount and value.
+ * @return spu_err_t Returns the error code of ram_fill().
+ */
+spu_err_t jit_fill(Jit_context *context, elem_t *operands);
+
+/**
+ * @brief Copy command called from the native code.
+ *
+ * @param context Pointer to the native run context.
+ * @param operands Pointer to the popped operands: destination, source and amount.
+ * @return spu_err_t Returns the error code of ram_copy().
+ */
+spu_err_t jit_copy(Jit_context *context, elem_t *operands);
+
+/**
+ * @brief Compare command called from the native code.
+ *
+ * @param context Pointer to the native run context.
+ * @param operands Pointer to the popped operands: both addresses and amount, the result is written over the first one.
+ * @return spu_err_t Returns the error code of ram_compare().
+ */
+spu_err_t jit_compare(Jit_context *context, elem_t *operands);
+
+#endif
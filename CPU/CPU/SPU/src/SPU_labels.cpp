@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SPU_labels.h"
+#include "SPU_additional.h"
+
+#define ALLOCATION_CHECK(ptr)					\
+	if(ptr == NULL)								\
+	{											\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return SPU_UNABLE_TO_ALLOCATE;			\
+	}
+
+const size_t STD_LABELS_CAPACITY = 16; /**< Starting capacity of the label map. */
+
+static int cmp_labels(const void *first, const void *second)
+{
+	size_t first_slot  = ((const Spu_label *)first)->slot;
+	size_t second_slot = ((const Spu_label *)second)->slot;
+
+	return (first_slot > second_slot) - (first_slot < second_slot);
+}
+
+spu_err_t load_label_map(Label_map *map, const char *bin_file)
+{
+	*map = {};
+
+	if(bin_file == NULL)
+	{
+		return SPU_ALL_GOOD;
+	}
+
+	const size_t extension_length = LEN(".bin");
+
+	size_t name_length = strlen(bin_file);
+	if(name_length >= extension_length && !strcmp(bin_file + name_length - extension_length, ".bin"))
+	{
+		name_length -= extension_length;
+	}
+
+	char *map_file_name = NULL;
+	CALLOC(map_file_name, name_length + sizeof(".labels"), char);
+	memcpy(map_file_name, bin_file, name_length);
+	strcpy(map_file_name + name_length, ".labels");
+
+	FILE *map_file = fopen(map_file_name, "r");
+	free(map_file_name);
+
+	if(map_file == NULL)
+	{
+		return SPU_ALL_GOOD;
+	}
+
+	size_t capacity = 0;
+	size_t slot     = 0;
+	char   name[MAX_TOKEN_SIZE] = {};
+
+	while(fscanf(map_file, "%lu %255s", &slot, name) == 2)
+	{
+		Spu_label *labels = map->labels;
+
+		if(map->amount == capacity)
+		{
+			capacity = (capacity == 0) ? STD_LABELS_CAPACITY : capacity * 2;
+			labels   = (Spu_label *)realloc(map->labels, capacity * sizeof(Spu_label));
+
+			if(labels != NULL)
+			{
+				map->labels = labels;
+			}
+		}
+
+		char *label_name = (labels == NULL) ? NULL : strdup(name);
+
+		if(label_name == NULL)
+		{
+			LOG("ERROR: Unable to allocate the label map.\n");
+
+			fclose(map_file);
+			label_map_dtor(map);
+
+			return SPU_UNABLE_TO_ALLOCATE;
+		}
+
+		map->labels[map->amount].slot = slot;
+		map->labels[map->amount].name = label_name;
+		map->amount++;
+	}
+
+	fclose(map_file);
+
+	qsort(map->labels, map->amount, sizeof(Spu_label), cmp_labels);
+
+	return SPU_ALL_GOOD;
+}
+
+size_t find_label(const Label_map *map, size_t slot)
+{
+	size_t left  = 0;
+	size_t right = map->amount;
+
+	while(left < right)
+	{
+		size_t middle = left + (right - left) / 2;
+
+		if(map->labels[middle].slot <= slot)
+		{
+			left = middle + 1;
+		}
+		else
+		{
+			right = middle;
+		}
+	}
+
+	return (left == 0) ? map->amount : left - 1;
+}
+
+void label_map_dtor(Label_map *map)
+{
+	for(size_t label_ID = 0; label_ID < map->amount; label_ID++)
+	{
+		free(map->labels[label_ID].name);
+	}
+
+	free(map->labels);
+
+	*map = {};
+}
+
+#undef ALLOCATION_CHECK
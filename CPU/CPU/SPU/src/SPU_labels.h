@@ -0,0 +1,58 @@
+#ifndef SPU_LABELS
+#define SPU_LABELS
+
+/**
+ * @file SPU_labels.h
+ * @brief Label map written by the assembler next to the binary file.
+ */
+
+#include "SPU.h"
+
+/**
+ * @struct Spu_label
+ * @brief Structure representing a label of the program.
+ */
+struct Spu_label
+{
+	size_t slot; /**< Index of the labeled instruction. */
+	char  *name; /**< Name of the label. */
+};
+
+/**
+ * @struct Label_map
+ * @brief Structure representing the labels of the program sorted by their slots.
+ */
+struct Label_map
+{
+	Spu_label *labels; /**< Labels. */
+	size_t     amount; /**< Amount of labels. */
+};
+
+/**
+ * @brief Loads the label map of the binary file: "root.labels" for "root.bin".
+ *
+ * A missing map is not an error, the map is just left empty.
+ *
+ * @param map Pointer to the map to fill.
+ * @param bin_file Path to the binary file, NULL for byte code which didn't come from a file.
+ * @return spu_err_t Returns an error code indicating the status of the loading.
+ */
+spu_err_t load_label_map(Label_map *map, const char *bin_file);
+
+/**
+ * @brief Finds the label the instruction belongs to: the closest one at or before it.
+ *
+ * @param map Pointer to the map.
+ * @param slot Index of the instruction.
+ * @return size_t Returns the index of the label, map->amount if the instruction precedes all labels.
+ */
+size_t find_label(const Label_map *map, size_t slot);
+
+/**
+ * @brief Frees the label map.
+ *
+ * @param map Pointer to the map.
+ */
+void label_map_dtor(Label_map *map);
+
+#endif
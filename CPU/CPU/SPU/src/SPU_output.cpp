@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "SPU_output.h"
+#include "utils.h"
+
+const double FAST_FORMAT_LIMIT = 4e6; /**< Keeps value * 1000 below 2^32, where it is exact to 1e-6. */
+const double ROUNDING_TIE_GAP  = 1e-3; /**< Fractions this close to a half are left to snprintf. */
+
+void sink_write(Output_sink *sink, const void *data, size_t size)
+{
+	if(sink->size + size > sink->capacity)
+	{
+		sink_flush(sink);
+
+		if(size > sink->capacity)
+		{
+			fwrite(data, sizeof(char), size, sink->file);
+			return;
+		}
+	}
+
+	memcpy(sink->buf + sink->size, data, size);
+	sink->size += size;
+}
+
+void sink_write_char(Output_sink *sink, char symbol)
+{
+	sink_write(sink, &symbol, sizeof(char));
+}
+
+void sink_write_value(Output_sink *sink, elem_t value)
+{
+	if(sink->binary)
+	{
+		sink_write(sink, &value, sizeof(elem_t));
+		return;
+	}
+
+	char text[DOUBLE_TEXT_MAX] = {};
+
+	size_t text_length = format_double(text, value);
+
+	sink_write(sink, "RESULT: ", LEN("RESULT: "));
+	sink_write(sink, text, text_length);
+	sink_write_char(sink, '\n');
+}
+
+void sink_flush(Output_sink *sink)
+{
+	if(sink->size != 0 && sink->file != NULL)
+	{
+		fwrite(sink->buf, sizeof(char), sink->size, sink->file);
+	}
+
+	sink->size = 0;
+}
+
+size_t format_double(char *buf, elem_t value)
+{
+	double scaled = fabs(value) * 1000;
+	double whole  = floor(scaled);
+	double frac   = scaled - whole;
+
+	if(!isfinite(value) || fabs(value) >= FAST_FORMAT_LIMIT || fabs(frac - 0.5) < ROUNDING_TIE_GAP)
+	{
+		int length = snprintf(buf, DOUBLE_TEXT_MAX, "%.3lf", value);
+
+		return (length < 0) ? 0 : (size_t)length;
+	}
+
+	unsigned long thousandths = (unsigned long)whole + ((frac > 0.5) ? 1 : 0);
+	unsigned long int_part    = thousandths / 1000;
+	unsigned long frac_part   = thousandths % 1000;
+
+	size_t length = 0;
+
+	if(signbit(value))
+	{
+		buf[length++] = '-';
+	}
+
+	char   digits[DOUBLE_TEXT_MAX] = {};
+	size_t digits_amount           = 0;
+
+	do
+	{
+		digits[digits_amount++] = (char)('0' + int_part % 10);
+		int_part /= 10;
+	} while(int_part != 0);
+
+	while(digits_amount > 0)
+	{
+		buf[length++] = digits[--digits_amount];
+	}
+
+	buf[length++] = '.';
+	buf[length++] = (char)('0' + frac_part / 100);
+	buf[length++] = (char)('0' + frac_part / 10 % 10);
+	buf[length++] = (char)('0' + frac_part % 10);
+	buf[length]   = '\0';
+
+	return length;
+}
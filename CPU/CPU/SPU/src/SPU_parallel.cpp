@@ -0,0 +1,102 @@
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "SPU.h"
+#include "SPU_additional.h"
+
+const size_t MAX_RESULT_FILE_NAME = 64; /**< Length of the default output file name of a job. */
+
+/**
+ * @brief Runs the job of the shared byte code with its own VM.
+ *
+ * @param byte_code Pointer to the shared byte code.
+ * @param config_file Path to the configuration file.
+ * @param driver Pointer to the driver function for the Virtual Machine.
+ * @param job Pointer to the job.
+ * @param job_ID Index of the job.
+ * @return spu_err_t Returns the error code of the run.
+ */
+static spu_err_t run_job(Byte_code *byte_code, const char *config_file,
+						 void (*driver)(VM *, char *, FILE *), Spu_job *job, size_t job_ID)
+{
+	char default_name[MAX_RESULT_FILE_NAME] = {};
+
+	const char *output_file_name = job->output_file;
+	if(output_file_name == NULL)
+	{
+		snprintf(default_name, sizeof(default_name), "execution_result_%lu.txt", job_ID);
+		output_file_name = default_name;
+	}
+
+	FILE *output_file = fopen(output_file_name, "w");
+	if(output_file == NULL)
+	{
+		LOG("\nERROR: Unable to open %s\n", output_file_name);
+		return SPU_UNABLE_TO_OPEN_FILE;
+	}
+
+	Spu_snapshot snapshot =
+	{
+		.save_file    = NULL,
+		.restore_file = job->restore_file,
+	};
+
+	spu_err_t error_code = process(byte_code, config_file, output_file, driver, job->input, &snapshot);
+
+	fclose(output_file);
+
+	return error_code;
+}
+
+spu_err_t execute_parallel(const char *bin_file, const char *config_file,
+						   void (*driver)(VM *, char *, FILE *),
+						   Spu_job *jobs, size_t jobs_amount, size_t threads_amount)
+{
+	spu_err_t error_code = SPU_ALL_GOOD;
+
+	Byte_code byte_code = {};
+	CALL(load_byte_code(&byte_code, bin_file));
+
+	if(threads_amount == 0)
+	{
+		threads_amount = std::thread::hardware_concurrency();
+	}
+	if(threads_amount == 0)
+	{
+		threads_amount = 1;
+	}
+	if(threads_amount > jobs_amount)
+	{
+		threads_amount = jobs_amount;
+	}
+
+	std::atomic<size_t> next_job(0);
+
+	auto worker = [&]()
+	{
+		for(size_t job_ID = next_job++; job_ID < jobs_amount; job_ID = next_job++)
+		{
+			jobs[job_ID].error_code = run_job(&byte_code, config_file, driver, jobs + job_ID, job_ID);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve(threads_amount);
+
+	for(size_t thread_ID = 0; thread_ID < threads_amount; thread_ID++)
+	{
+		pool.emplace_back(worker);
+	}
+
+	for(std::thread &thread : pool)
+	{
+		thread.join();
+	}
+
+	unload_byte_code(&byte_code);
+
+	return SPU_ALL_GOOD;
+}
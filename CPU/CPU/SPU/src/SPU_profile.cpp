@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+#include "SPU_profile.h"
+#include "SPU_labels.h"
+#include "SPU_additional.h"
+
+#define ALLOCATION_CHECK(ptr)					\
+	if(ptr == NULL)								\
+	{											\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return SPU_UNABLE_TO_ALLOCATE;			\
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	static const char * const TICKS_UNIT = "cycles";
+#else
+	static const char * const TICKS_UNIT = "ns";
+#endif
+
+static int cmp_rows(const void *first, const void *second)
+{
+	const Profile_row *first_row  = (const Profile_row *)first;
+	const Profile_row *second_row = (const Profile_row *)second;
+
+	if(first_row->ticks != second_row->ticks)
+	{
+		return (first_row->ticks < second_row->ticks) ? 1 : -1;
+	}
+
+	return (first_row->executions < second_row->executions) - (first_row->executions > second_row->executions);
+}
+
+uint64_t profile_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec now = {};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#endif
+}
+
+spu_err_t profile_ctor(Profile *profile, size_t size)
+{
+	*profile = {};
+
+	profile->size = size;
+
+	CALLOC(profile->executions, size, size_t);
+	CALLOC(profile->ticks, size, uint64_t);
+	CALLOC(profile->calls, size, size_t);
+
+	return SPU_ALL_GOOD;
+}
+
+void profile_cmd(Profile *profile, size_t cmd_ID, const Decoded_cmd *cmd)
+{
+	uint64_t now = profile_clock();
+
+	if(profile->started)
+	{
+		profile->ticks[profile->last_cmd] += now - profile->last_tick;
+	}
+
+	profile->started   = true;
+	profile->last_cmd  = cmd_ID;
+	profile->executions[cmd_ID]++;
+
+	if(cmd->type == D_CALL && cmd->arg < profile->size)
+	{
+		profile->calls[cmd->arg]++;
+	}
+
+	profile->last_tick = profile_clock();
+}
+
+spu_err_t profile_report(Profile *profile, const Decoded_program *program,
+						 const char *bin_file, const char *report_file)
+{
+	spu_err_t error_code = SPU_ALL_GOOD;
+
+	if(profile->started)
+	{
+		profile->ticks[profile->last_cmd] += profile_clock() - profile->last_tick;
+		profile->started = false;
+	}
+
+	Label_map map = {};
+	CALL(load_label_map(&map, bin_file));
+
+	Profile_row *rows = NULL;
+	size_t rows_amount = DECODED_TYPES_AMOUNT + map.amount + 1 + profile->size;
+
+	rows = (Profile_row *)calloc(rows_amount, sizeof(Profile_row));
+	if(rows == NULL)
+	{
+		label_map_dtor(&map);
+
+		return SPU_UNABLE_TO_ALLOCATE;
+	}
+
+	Profile_row *type_rows  = rows;
+	Profile_row *label_rows = type_rows + DECODED_TYPES_AMOUNT;
+	Profile_row *call_rows  = label_rows + map.amount + 1;
+
+	for(size_t type = 0; type < DECODED_TYPES_AMOUNT; type++)
+	{
+		type_rows[type].name = decoded_type_name((Decoded_type)type);
+	}
+
+	for(size_t label_ID = 0; label_ID < map.amount; label_ID++)
+	{
+		label_rows[label_ID].name = map.labels[label_ID].name;
+	}
+	label_rows[map.amount].name = "(before the first label)";
+
+	uint64_t total_ticks  = 0;
+	size_t   calls_amount = 0;
+
+	for(size_t cmd_ID = 0; cmd_ID < profile->size; cmd_ID++)
+	{
+		size_t   executions = profile->executions[cmd_ID];
+		uint64_t ticks      = profile->ticks[cmd_ID];
+
+		total_ticks += ticks;
+
+		type_rows[program->cmds[cmd_ID].type].executions += executions;
+		type_rows[program->cmds[cmd_ID].type].ticks      += ticks;
+
+		size_t label_ID = find_label(&map, cmd_ID);
+		label_rows[label_ID].executions += executions;
+		label_rows[label_ID].ticks      += ticks;
+
+		if(profile->calls[cmd_ID] != 0)
+		{
+			call_rows[calls_amount].name       = (label_ID < map.amount && map.labels[label_ID].slot == cmd_ID)
+												 ? map.labels[label_ID].name : "(unnamed)";
+			call_rows[calls_amount].executions = profile->calls[cmd_ID];
+			calls_amount++;
+		}
+	}
+
+	FILE *report = fopen(report_file, "w");
+	if(report == NULL)
+	{
+		free(rows);
+		label_map_dtor(&map);
+
+		LOG("\nERROR: Unable to open %s\n", report_file);
+		return SPU_UNABLE_TO_OPEN_FILE;
+	}
+
+	fprintf(report, "Total: %lu %s\n", (unsigned long)total_ticks, TICKS_UNIT);
+
+	write_profile_rows(report, "Command types", type_rows, DECODED_TYPES_AMOUNT, total_ticks);
+	write_profile_rows(report, "Labels", label_rows, map.amount + 1, total_ticks);
+	write_profile_rows(report, "Call targets", call_rows, calls_amount, 0);
+
+	fclose(report);
+
+	free(rows);
+	label_map_dtor(&map);
+
+	return SPU_ALL_GOOD;
+}
+
+void write_profile_rows(FILE *report, const char *title, Profile_row *rows, size_t amount,
+						uint64_t total_ticks)
+{
+	qsort(rows, amount, sizeof(Profile_row), cmp_rows);
+
+	fprintf(report, "\n%s:\n", title);
+
+	if(total_ticks == 0)
+	{
+		fprintf(report, "%-32s %14s\n", "name", "executions");
+	}
+	else
+	{
+		fprintf(report, "%-32s %14s %16s %12s %8s\n", "name", "executions", TICKS_UNIT, "per exec", "share");
+	}
+
+	for(size_t row_ID = 0; row_ID < amount; row_ID++)
+	{
+		const Profile_row *row = rows + row_ID;
+
+		if(row->executions == 0)
+		{
+			continue;
+		}
+
+		if(total_ticks == 0)
+		{
+			fprintf(report, "%-32s %14lu\n", row->name, row->executions);
+		}
+		else
+		{
+			fprintf(report, "%-32s %14lu %16lu %12.1lf %7.2lf%%\n", row->name, row->executions,
+					(unsigned long)row->ticks, (double)row->ticks / (double)row->executions,
+					100.0 * (double)row->ticks / (double)total_ticks);
+		}
+	}
+}
+
+void profile_dtor(Profile *profile)
+{
+	free(profile->executions);
+	free(profile->ticks);
+	free(profile->calls);
+
+	*profile = {};
+}
+
+#undef ALLOCATION_CHECK
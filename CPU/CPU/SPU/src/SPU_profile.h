@@ -0,0 +1,103 @@
+#ifndef SPU_PROFILE_H
+#define SPU_PROFILE_H
+
+/**
+ * @file SPU_profile.h
+ * @brief Execution profiler of the interpreter, built into process() by SPU_PROFILE.
+ *
+ * Every dispatch charges the ticks since the previous one to the previous instruction.
+ * Ticks are TSC cycles on x86-64 and nanoseconds elsewhere. At hlt the counters are
+ * summed up per command type, per label of the assembler label map and per call
+ * target, and written sorted to PROFILE_FILE_NAME.
+ */
+
+#include <stdint.h>
+
+#include "SPU.h"
+#include "SPU_decoder.h"
+
+const char * const PROFILE_FILE_NAME = "SPU_profile.txt"; /**< Report of the profiler. */
+
+/**
+ * @struct Profile
+ * @brief Structure representing the counters of a profiled run.
+ */
+struct Profile
+{
+	size_t   *executions; /**< Executions of every decoded instruction. */
+	uint64_t *ticks; /**< Ticks spent in every decoded instruction. */
+	size_t   *calls; /**< Calls with every decoded instruction as the target. */
+	size_t    size; /**< Amount of decoded instructions. */
+	size_t    last_cmd; /**< Instruction the current ticks are charged to. */
+	uint64_t  last_tick; /**< Tick of the last dispatch. */
+	bool      started; /**< Something was dispatched already. */
+};
+
+/**
+ * @struct Profile_row
+ * @brief Structure representing a row of the profiler report.
+ */
+struct Profile_row
+{
+	const char *name; /**< Name of the command type, label or call target. */
+	size_t      executions; /**< Executions, or calls of a call target. */
+	uint64_t    ticks; /**< Ticks spent. */
+};
+
+/**
+ * @brief Reads the profiler clock.
+ *
+ * @return uint64_t Returns the TSC on x86-64, monotonic nanoseconds elsewhere.
+ */
+uint64_t profile_clock(void);
+
+/**
+ * @brief Profile constructor.
+ *
+ * @param profile Pointer to the profile.
+ * @param size Amount of decoded instructions.
+ * @return spu_err_t Returns an error code indicating the status of the constructor.
+ */
+spu_err_t profile_ctor(Profile *profile, size_t size);
+
+/**
+ * @brief Counts the dispatch of an instruction.
+ *
+ * @param profile Pointer to the profile.
+ * @param cmd_ID Index of the dispatched instruction.
+ * @param cmd Pointer to the dispatched instruction.
+ */
+void profile_cmd(Profile *profile, size_t cmd_ID, const Decoded_cmd *cmd);
+
+/**
+ * @brief Writes the sorted report of the run.
+ *
+ * @param profile Pointer to the profile.
+ * @param program Pointer to the decoded program.
+ * @param bin_file Path to the binary file, whose label map names the labels.
+ * @param report_file Path to the report.
+ * @return spu_err_t Returns an error code indicating the status of the report.
+ */
+spu_err_t profile_report(Profile *profile, const Decoded_program *program,
+						 const char *bin_file, const char *report_file);
+
+/**
+ * @brief Writes a section of the report sorted by ticks, or by executions if nothing was timed.
+ *
+ * @param report Pointer to the report file.
+ * @param title Title of the section.
+ * @param rows Pointer to the rows, sorted in place.
+ * @param amount Amount of rows.
+ * @param total_ticks Ticks of the whole run.
+ */
+void write_profile_rows(FILE *report, const char *title, Profile_row *rows, size_t amount,
+						uint64_t total_ticks);
+
+/**
+ * @brief Profile destructor.
+ *
+ * @param profile Pointer to the profile.
+ */
+void profile_dtor(Profile *profile);
+
+#endif
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "SPU_ram.h"
+#include "SPU_additional.h"
+
+bool ram_range(const RAM *ram, elem_t start, elem_t amount, size_t *start_ID, size_t *amount_ID)
+{
+	if(!(start >= 0) || !(amount >= 0) ||
+	   start >= (elem_t)ram->RAM_size || amount > (elem_t)ram->RAM_size)
+	{
+		LOG("ERROR: RAM range [%lf, %lf + %lf) is out of the %lu cells.\n",
+			start, start, amount, ram->RAM_size);
+
+		return false;
+	}
+
+	*start_ID  = (size_t)start;
+	*amount_ID = (size_t)amount;
+
+	if(*amount_ID > ram->RAM_size - *start_ID)
+	{
+		LOG("ERROR: RAM range [%lu, %lu + %lu) is out of the %lu cells.\n",
+			*start_ID, *start_ID, *amount_ID, ram->RAM_size);
+
+		return false;
+	}
+
+	return true;
+}
+
+spu_err_t ram_fill(RAM *ram, elem_t dst, elem_t amount, elem_t value)
+{
+	size_t dst_ID    = 0;
+	size_t amount_ID = 0;
+
+	if(!ram_range(ram, dst, amount, &dst_ID, &amount_ID))
+	{
+		return SPU_RAM_OUT_OF_RANGE;
+	}
+
+	elem_t *cells = ram->user_RAM + dst_ID;
+
+	// the loop is vectorized, memset only fits the all-zero bytes of +0.0
+	if(fpclassify(value) == FP_ZERO && !signbit(value))
+	{
+		memset(cells, 0, amount_ID * sizeof(elem_t));
+	}
+	else
+	{
+		for(size_t cell_ID = 0; cell_ID < amount_ID; cell_ID++)
+		{
+			cells[cell_ID] = value;
+		}
+	}
+
+	return SPU_ALL_GOOD;
+}
+
+spu_err_t ram_copy(RAM *ram, elem_t dst, elem_t src, elem_t amount)
+{
+	size_t dst_ID    = 0;
+	size_t src_ID    = 0;
+	size_t amount_ID = 0;
+
+	if(!ram_range(ram, dst, amount, &dst_ID, &amount_ID) ||
+	   !ram_range(ram, src, amount, &src_ID, &amount_ID))
+	{
+		return SPU_RAM_OUT_OF_RANGE;
+	}
+
+	memmove(ram->user_RAM + dst_ID, ram->user_RAM + src_ID, amount_ID * sizeof(elem_t));
+
+	return SPU_ALL_GOOD;
+}
+
+spu_err_t ram_compare(RAM *ram, elem_t first, elem_t second, elem_t amount, elem_t *result)
+{
+	size_t first_ID  = 0;
+	size_t second_ID = 0;
+	size_t amount_ID = 0;
+
+	if(!ram_range(ram, first,  amount, &first_ID,  &amount_ID) ||
+	   !ram_range(ram, second, amount, &second_ID, &amount_ID))
+	{
+		return SPU_RAM_OUT_OF_RANGE;
+	}
+
+	const elem_t *first_cells  = ram->user_RAM + first_ID;
+	const elem_t *second_cells = ram->user_RAM + second_ID;
+
+	*result = 1;
+
+	// equal bytes are the common case, cmp_double is only needed past the first mismatch
+	if(memcmp(first_cells, second_cells, amount_ID * sizeof(elem_t)) == 0)
+	{
+		return SPU_ALL_GOOD;
+	}
+
+	for(size_t cell_ID = 0; cell_ID < amount_ID; cell_ID++)
+	{
+		if(cmp_double(first_cells[cell_ID], second_cells[cell_ID]) != 0)
+		{
+			*result = 0;
+
+			break;
+		}
+	}
+
+	return SPU_ALL_GOOD;
+}
@@ -0,0 +1,60 @@
+#ifndef SPU_RAM
+#define SPU_RAM
+
+/**
+ * @file SPU_ram.h
+ * @brief Block operations on the VM RAM, shared by the interpreter and the JIT.
+ *
+ * Operands come from the operand stack as elem_t. Addresses and lengths are truncated
+ * like the ones of push [reg] and pop [reg], but every range is checked to fit RAM_size.
+ */
+
+#include "SPU.h"
+
+/**
+ * @brief Fills a range of the RAM with a value.
+ *
+ * @param ram Pointer to the RAM.
+ * @param dst First address of the range.
+ * @param amount Amount of cells.
+ * @param value Value to fill the range with.
+ * @return spu_err_t Returns SPU_RAM_OUT_OF_RANGE if the range doesn't fit the RAM.
+ */
+spu_err_t ram_fill(RAM *ram, elem_t dst, elem_t amount, elem_t value);
+
+/**
+ * @brief Copies a range of the RAM, the ranges may overlap.
+ *
+ * @param ram Pointer to the RAM.
+ * @param dst First address of the destination.
+ * @param src First address of the source.
+ * @param amount Amount of cells.
+ * @return spu_err_t Returns SPU_RAM_OUT_OF_RANGE if a range doesn't fit the RAM.
+ */
+spu_err_t ram_copy(RAM *ram, elem_t dst, elem_t src, elem_t amount);
+
+/**
+ * @brief Compares two ranges of the RAM with cmp_double.
+ *
+ * @param ram Pointer to the RAM.
+ * @param first First address of the first range.
+ * @param second First address of the second range.
+ * @param amount Amount of cells.
+ * @param result Pointer to the result: 1 if the ranges are equal, 0 otherwise.
+ * @return spu_err_t Returns SPU_RAM_OUT_OF_RANGE if a range doesn't fit the RAM.
+ */
+spu_err_t ram_compare(RAM *ram, elem_t first, elem_t second, elem_t amount, elem_t *result);
+
+/**
+ * @brief Checks that a range given by elem_t operands fits the RAM.
+ *
+ * @param ram Pointer to the RAM.
+ * @param start First address of the range.
+ * @param amount Amount of cells.
+ * @param start_ID Pointer to the first address as an index.
+ * @param amount_ID Pointer to the amount of cells as a size.
+ * @return bool Returns true if the range fits.
+ */
+bool ram_range(const RAM *ram, elem_t start, elem_t amount, size_t *start_ID, size_t *amount_ID);
+
+#endif
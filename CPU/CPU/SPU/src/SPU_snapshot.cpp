@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SPU_snapshot.h"
+
+#ifdef SPU_MMAP_AVAILABLE
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+
+uint64_t byte_code_hash(const Byte_code *byte_code)
+{
+	return hash_bytes(HASH_OFFSET_BASIS, byte_code->buf, byte_code->length);
+}
+
+static size_t ram_offset(const Snapshot_header *header)
+{
+	size_t state_end = sizeof(Snapshot_header) +
+					   (header->regs_amount + header->int_regs_amount + header->user_stack_size + header->ret_stack_size) * sizeof(elem_t);
+
+	return (state_end + SNAPSHOT_RAM_ALIGNMENT - 1) / SNAPSHOT_RAM_ALIGNMENT * SNAPSHOT_RAM_ALIGNMENT;
+}
+
+static bool write_elems(const elem_t *elems, size_t amount, FILE *file)
+{
+	return fwrite(elems, sizeof(elem_t), amount, file) == amount;
+}
+
+static bool read_elems(elem_t *elems, size_t amount, FILE *file)
+{
+	return fread(elems, sizeof(elem_t), amount, file) == amount;
+}
+
+static bool write_ints(const int64_t *ints, size_t amount, FILE *file)
+{
+	return fwrite(ints, sizeof(int64_t), amount, file) == amount;
+}
+
+static bool read_ints(int64_t *ints, size_t amount, FILE *file)
+{
+	return fread(ints, sizeof(int64_t), amount, file) == amount;
+}
+
+spu_err_t snapshot_save(const VM *vm, const Byte_code *byte_code, size_t cmd_ID, const char *file_name)
+{
+	Snapshot_header header = {};
+
+	header.magic           = SNAPSHOT_MAGIC;
+	header.version         = SNAPSHOT_VERSION;
+	header.byte_code_hash  = byte_code_hash(byte_code);
+	header.cmd_ID          = cmd_ID;
+	header.regs_amount     = vm->regs_amount;
+	header.int_regs_amount = INT_REGS_AMOUNT;
+	header.RAM_size        = vm->rand_access_mem.RAM_size;
+	header.user_stack_size = vm->user_stack.size;
+	header.ret_stack_size  = vm->ret_stack.size;
+	header.RAM_offset      = ram_offset(&header);
+
+	FILE *snapshot_file = fopen(file_name, "wb");
+	FILE_PTR_CHECK(snapshot_file);
+
+	bool written = fwrite(&header, sizeof(Snapshot_header), 1, snapshot_file) == 1 &&
+				   write_elems(vm->registers, vm->regs_amount, snapshot_file) &&
+				   write_ints(vm->int_registers, INT_REGS_AMOUNT, snapshot_file) &&
+				   write_elems(vm->user_stack.data, vm->user_stack.size, snapshot_file) &&
+				   write_elems(vm->ret_stack.data, vm->ret_stack.size, snapshot_file) &&
+				   fseek(snapshot_file, (long)header.RAM_offset, SEEK_SET) == 0 &&
+				   write_elems(vm->rand_access_mem.user_RAM, vm->rand_access_mem.RAM_size, snapshot_file);
+
+	fclose(snapshot_file);
+
+	if(!written)
+	{
+		LOG("ERROR: Unable to write the snapshot %s.\n", file_name);
+
+		return SPU_INVALID_FWRITE;
+	}
+
+	LOG("Snapshot %s at the slot %lu.\n", file_name, cmd_ID);
+
+	return SPU_ALL_GOOD;
+}
+
+static bool header_fits(const Snapshot_header *header, const VM *vm, const Byte_code *byte_code)
+{
+	return header->magic           == SNAPSHOT_MAGIC						&&
+		   header->version         == SNAPSHOT_VERSION						&&
+		   header->byte_code_hash  == byte_code_hash(byte_code)				&&
+		   header->regs_amount     == vm->regs_amount						&&
+		   header->int_regs_amount == INT_REGS_AMOUNT						&&
+		   header->RAM_size        == vm->rand_access_mem.RAM_size			&&
+		   header->user_stack_size <= vm->user_stack.capacity				&&
+		   header->ret_stack_size  <= vm->ret_stack.capacity				&&
+		   header->RAM_offset      == ram_offset(header);
+}
+
+static bool map_ram(RAM *ram, FILE *snapshot_file, size_t RAM_offset)
+{
+#ifdef SPU_MMAP_AVAILABLE
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	if(ram->RAM_size == 0 || page_size <= 0 || RAM_offset % (size_t)page_size != 0)
+	{
+		return false;
+	}
+
+	void *mapping = mmap(NULL, ram->RAM_size * sizeof(elem_t), PROT_READ | PROT_WRITE, MAP_PRIVATE,
+						 fileno(snapshot_file), (off_t)RAM_offset);
+
+	if(mapping == MAP_FAILED)
+	{
+		return false;
+	}
+
+	free(ram->user_RAM);
+
+	ram->user_RAM = (elem_t *)mapping;
+	ram->mapped   = true;
+
+	return true;
+#else
+	(void)ram;
+	(void)snapshot_file;
+	(void)RAM_offset;
+
+	return false;
+#endif
+}
+
+spu_err_t snapshot_restore(VM *vm, const Byte_code *byte_code, size_t *cmd_ID, const char *file_name)
+{
+	FILE *snapshot_file = fopen(file_name, "rb");
+	FILE_PTR_CHECK(snapshot_file);
+
+	Snapshot_header header = {};
+
+	if(fread(&header, sizeof(Snapshot_header), 1, snapshot_file) != 1 ||
+	   !header_fits(&header, vm, byte_code))
+	{
+		LOG("ERROR: The snapshot %s doesn't fit the program or the config.\n", file_name);
+		fclose(snapshot_file);
+
+		return SPU_INVALID_SNAPSHOT;
+	}
+
+	bool read = read_elems(vm->registers, header.regs_amount, snapshot_file) &&
+				read_ints(vm->int_registers, header.int_regs_amount, snapshot_file) &&
+				read_elems(vm->user_stack.data, header.user_stack_size, snapshot_file) &&
+				read_elems(vm->ret_stack.data, header.ret_stack_size, snapshot_file);
+
+	if(read && !map_ram(&(vm->rand_access_mem), snapshot_file, header.RAM_offset))
+	{
+		read = fseek(snapshot_file, (long)header.RAM_offset, SEEK_SET) == 0 &&
+			   read_elems(vm->rand_access_mem.user_RAM, header.RAM_size, snapshot_file);
+	}
+
+	fclose(snapshot_file);
+
+	if(!read)
+	{
+		LOG("ERROR: The snapshot %s is truncated.\n", file_name);
+
+		return SPU_INVALID_SNAPSHOT;
+	}
+
+	vm->user_stack.size = header.user_stack_size;
+	vm->ret_stack.size  = header.ret_stack_size;
+	*cmd_ID             = header.cmd_ID;
+
+	LOG("Restored %s at the slot %lu, RAM is %s.\n", file_name, *cmd_ID,
+		vm->rand_access_mem.mapped ? "mapped" : "read");
+
+	return SPU_ALL_GOOD;
+}
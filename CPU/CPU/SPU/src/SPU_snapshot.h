@@ -0,0 +1,72 @@
+#ifndef SPU_SNAPSHOT
+#define SPU_SNAPSHOT
+
+/**
+ * @file SPU_snapshot.h
+ * @brief Snapshot of the full VM state, written by the snap command and restored by process().
+ *
+ * The file is the header, the registers, the integer registers, both stacks and, at a SNAPSHOT_RAM_ALIGNMENT
+ * offset, the RAM image, so it can be mapped straight into the VM.
+ */
+
+#include <stdint.h>
+
+#include "SPU.h"
+#include "SPU_additional.h"
+
+const uint32_t SNAPSHOT_MAGIC          = 0x53555053; /**< First bytes of a snapshot, "SPUS" in little-endian. */
+const uint32_t SNAPSHOT_VERSION        = 2; /**< Version of the snapshot layout. */
+const size_t   SNAPSHOT_RAM_ALIGNMENT  = 1 << 14; /**< Offset alignment of the RAM image, a multiple of the usual page sizes. */
+
+/**
+ * @struct Snapshot_header
+ * @brief Structure representing the header of a snapshot file.
+ */
+struct Snapshot_header
+{
+	uint32_t magic; /**< SNAPSHOT_MAGIC. */
+	uint32_t version; /**< SNAPSHOT_VERSION. */
+	uint64_t byte_code_hash; /**< Hash of the byte code the snapshot was taken of. */
+	uint64_t cmd_ID; /**< Instruction to resume from. */
+	uint64_t regs_amount; /**< Amount of registers. */
+	uint64_t int_regs_amount; /**< Amount of integer registers. */
+	uint64_t RAM_size; /**< Amount of RAM cells. */
+	uint64_t user_stack_size; /**< Amount of values on the operand stack. */
+	uint64_t ret_stack_size; /**< Amount of values on the return stack. */
+	uint64_t RAM_offset; /**< Offset of the RAM image in the file. */
+};
+
+/**
+ * @brief Hashes the byte code, which ties a snapshot to its program.
+ *
+ * @param byte_code Pointer to the byte code.
+ * @return uint64_t Returns the FNV-1a hash of the byte code.
+ */
+uint64_t byte_code_hash(const Byte_code *byte_code);
+
+/**
+ * @brief Writes the state of the VM to a snapshot file.
+ *
+ * @param vm Pointer to the Virtual Machine.
+ * @param byte_code Pointer to the byte code the VM runs.
+ * @param cmd_ID Instruction to resume from.
+ * @param file_name Path to the snapshot file.
+ * @return spu_err_t Returns an error code indicating the status of the writing.
+ */
+spu_err_t snapshot_save(const VM *vm, const Byte_code *byte_code, size_t cmd_ID, const char *file_name);
+
+/**
+ * @brief Restores the state of the VM from a snapshot file.
+ *
+ * The VM has to be constructed with the config the snapshot was taken with. The RAM
+ * image is mapped copy-on-write where the platform allows it, otherwise it is read.
+ *
+ * @param vm Pointer to the Virtual Machine.
+ * @param byte_code Pointer to the byte code the VM runs.
+ * @param cmd_ID Pointer to the instruction to resume from.
+ * @param file_name Path to the snapshot file.
+ * @return spu_err_t Returns SPU_INVALID_SNAPSHOT if the snapshot doesn't fit the program or the VM.
+ */
+spu_err_t snapshot_restore(VM *vm, const Byte_code *byte_code, size_t *cmd_ID, const char *file_name);
+
+#endif
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+
+#include "SPU_trace.h"
+#include "SPU_additional.h"
+
+#define ALLOCATION_CHECK(ptr)					\
+	if(ptr == NULL)								\
+	{											\
+		LOG("Unable to allocate"#ptr".\n");	\
+		return SPU_UNABLE_TO_ALLOCATE;			\
+	}
+
+static volatile sig_atomic_t trace_dump_requested = 0;
+
+#ifdef SIGUSR1
+static void trace_signal_handler(int)
+{
+	request_trace_dump();
+}
+#endif
+
+spu_err_t trace_ctor(Trace *trace, size_t regs_amount)
+{
+	*trace = {};
+
+	trace->regs_amount = regs_amount;
+
+	CALLOC(trace->records, TRACE_CAPACITY, Trace_record);
+	CALLOC(trace->shadow_regs, regs_amount, elem_t);
+	CALLOC(trace->shadow_int_regs, INT_REGS_AMOUNT, int64_t);
+
+#ifdef SIGUSR1
+	signal(SIGUSR1, trace_signal_handler);
+#endif
+
+	return SPU_ALL_GOOD;
+}
+
+void trace_cmd(Trace *trace, size_t cmd_ID, const Decoded_cmd *cmd, const VM *vm)
+{
+	Trace_record *record = trace->records + (trace->head & (TRACE_CAPACITY - 1));
+
+	size_t stack_size = vm->user_stack.size;
+
+	record->cmd_ID     = (uint32_t)cmd_ID;
+	record->type       = (unsigned char)cmd->type;
+	record->stack_size = (stack_size > TRACE_MAX_DEPTH) ? TRACE_MAX_DEPTH : (uint16_t)stack_size;
+	record->top        = (stack_size == 0) ? NAN : vm->user_stack.data[stack_size - 1];
+	record->reg        = TRACE_NO_REG;
+	record->reg_value  = 0;
+
+	for(size_t reg_ID = 0; reg_ID < trace->regs_amount && reg_ID < FIRST_INT_REG; reg_ID++)
+	{
+		if(memcmp(vm->registers + reg_ID, trace->shadow_regs + reg_ID, sizeof(elem_t)) != 0)
+		{
+			record->reg               = (unsigned char)reg_ID;
+			record->reg_value         = vm->registers[reg_ID];
+			trace->shadow_regs[reg_ID] = vm->registers[reg_ID];
+
+			break;
+		}
+	}
+
+	for(size_t reg_ID = 0; record->reg == TRACE_NO_REG && reg_ID < INT_REGS_AMOUNT; reg_ID++)
+	{
+		if(vm->int_registers[reg_ID] != trace->shadow_int_regs[reg_ID])
+		{
+			record->reg                    = (unsigned char)(FIRST_INT_REG + reg_ID);
+			record->reg_value              = (elem_t)vm->int_registers[reg_ID];
+			trace->shadow_int_regs[reg_ID] = vm->int_registers[reg_ID];
+
+			break;
+		}
+	}
+
+	__atomic_store_n(&(trace->head), trace->head + 1, __ATOMIC_RELEASE);
+
+	if(trace_dump_requested)
+	{
+		trace_dump_requested = 0;
+
+		trace_dump(trace, TRACE_FILE_NAME);
+	}
+}
+
+spu_err_t trace_dump(const Trace *trace, const char *dump_file)
+{
+	size_t head   = __atomic_load_n(&(trace->head), __ATOMIC_ACQUIRE);
+	size_t amount = (head < TRACE_CAPACITY) ? head : TRACE_CAPACITY;
+	size_t oldest = head - amount;
+
+	Trace_header header =
+	{
+		.magic       = TRACE_MAGIC,
+		.version     = TRACE_VERSION,
+		.record_size = sizeof(Trace_record),
+		.reserved    = 0,
+		.written     = head,
+		.amount      = amount,
+	};
+
+	FILE *dump = fopen(dump_file, "wb");
+	if(dump == NULL)
+	{
+		LOG("\nERROR: Unable to open %s\n", dump_file);
+		return SPU_UNABLE_TO_OPEN_FILE;
+	}
+
+	fwrite(&header, sizeof(Trace_header), 1, dump);
+
+	size_t first_pos = oldest & (TRACE_CAPACITY - 1);
+	size_t tail      = (first_pos + amount > TRACE_CAPACITY) ? TRACE_CAPACITY - first_pos : amount;
+
+	fwrite(trace->records + first_pos, sizeof(Trace_record), tail, dump);
+	fwrite(trace->records, sizeof(Trace_record), amount - tail, dump);
+
+	fclose(dump);
+
+	return SPU_ALL_GOOD;
+}
+
+void request_trace_dump(void)
+{
+	trace_dump_requested = 1;
+}
+
+void trace_dtor(Trace *trace)
+{
+	free(trace->records);
+	free(trace->shadow_regs);
+	free(trace->shadow_int_regs);
+
+	*trace = {};
+}
+
+#undef ALLOCATION_CHECK
@@ -0,0 +1,109 @@
+#ifndef SPU_TRACE_H
+#define SPU_TRACE_H
+
+/**
+ * @file SPU_trace.h
+ * @brief Execution trace of the interpreter, built into process() by SPU_TRACE.
+ *
+ * Every dispatch appends a Trace_record to a fixed-size ring buffer, so the
+ * last TRACE_CAPACITY instructions are always at hand without stopping the VM.
+ * The ring is written by the VM alone and published with a release store of
+ * the head, so a dump never takes a lock. It is dumped to TRACE_FILE_NAME
+ * when the program halts with an error, or on SIGUSR1 where signals exist.
+ * trace_decoder.out turns the dump into text annotated with the labels.
+ */
+
+#include <stdint.h>
+
+#include "SPU.h"
+#include "SPU_decoder.h"
+
+const size_t        TRACE_CAPACITY  = 1 << 16; /**< Records kept by the ring buffer, a power of two. */
+const uint32_t      TRACE_VERSION   = 1; /**< Version of the dump format. */
+const unsigned char TRACE_NO_REG    = 0xFF; /**< Register ID of a record without a register change. */
+const uint16_t      TRACE_MAX_DEPTH = 0xFFFF; /**< Stack sizes above it are saturated. */
+const char * const  TRACE_FILE_NAME = "SPU_trace.bin"; /**< Dump of the trace. */
+const uint32_t      TRACE_MAGIC     = 0x54555053; /**< First bytes of the dump, "SPUT" in little-endian. */
+
+/**
+ * @struct Trace_record
+ * @brief Structure representing the state of the VM when an instruction is dispatched.
+ */
+struct Trace_record
+{
+	uint32_t      cmd_ID; /**< Index of the instruction. */
+	unsigned char type; /**< Decoded type of the instruction. */
+	unsigned char reg; /**< Register changed since the previous record, TRACE_NO_REG if none, from FIRST_INT_REG on an integer one. */
+	uint16_t      stack_size; /**< Operand stack size, saturated at TRACE_MAX_DEPTH. */
+	elem_t        top; /**< Operand stack top, NAN on an empty stack. */
+	elem_t        reg_value; /**< New value of the changed register. */
+};
+
+/**
+ * @struct Trace_header
+ * @brief Structure representing the beginning of a trace dump, followed by the records oldest first.
+ */
+struct Trace_header
+{
+	uint32_t magic; /**< TRACE_MAGIC. */
+	uint32_t version; /**< TRACE_VERSION. */
+	uint32_t record_size; /**< Size of a Trace_record. */
+	uint32_t reserved; /**< Zero. */
+	uint64_t written; /**< Amount of records written during the run. */
+	uint64_t amount; /**< Amount of records in the dump. */
+};
+
+/**
+ * @struct Trace
+ * @brief Structure representing the trace of a run.
+ */
+struct Trace
+{
+	Trace_record *records; /**< Ring buffer of TRACE_CAPACITY records. */
+	size_t        head; /**< Amount of written records, the next one goes to head % TRACE_CAPACITY. */
+	elem_t       *shadow_regs; /**< Register values as of the previous record. */
+	size_t        regs_amount; /**< Amount of registers. */
+	int64_t      *shadow_int_regs; /**< Integer register values as of the previous record. */
+};
+
+/**
+ * @brief Trace constructor, which also installs the SIGUSR1 dump request handler.
+ *
+ * @param trace Pointer to the trace.
+ * @param regs_amount Amount of VM registers.
+ * @return spu_err_t Returns an error code indicating the status of the constructor.
+ */
+spu_err_t trace_ctor(Trace *trace, size_t regs_amount);
+
+/**
+ * @brief Records the dispatch of an instruction, and dumps the trace if it was requested.
+ *
+ * @param trace Pointer to the trace.
+ * @param cmd_ID Index of the dispatched instruction.
+ * @param cmd Pointer to the dispatched instruction.
+ * @param vm Pointer to the VM.
+ */
+void trace_cmd(Trace *trace, size_t cmd_ID, const Decoded_cmd *cmd, const VM *vm);
+
+/**
+ * @brief Writes the records of the ring buffer to a file, oldest first.
+ *
+ * @param trace Pointer to the trace.
+ * @param dump_file Path to the dump.
+ * @return spu_err_t Returns an error code indicating the status of the dump.
+ */
+spu_err_t trace_dump(const Trace *trace, const char *dump_file);
+
+/**
+ * @brief Asks the running trace to dump itself on the next dispatch. Safe to call from a signal handler.
+ */
+void request_trace_dump(void);
+
+/**
+ * @brief Trace destructor.
+ *
+ * @param trace Pointer to the trace.
+ */
+void trace_dtor(Trace *trace);
+
+#endif
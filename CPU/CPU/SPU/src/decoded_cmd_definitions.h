@@ -0,0 +1,553 @@
+/**
+ * @def DEF_FUSED_ARITHM(op, sign)
+ * @brief Macro for defining register-register and register-immediate forms of an arithmetic command.
+ */
+#define DEF_FUSED_ARITHM(op, sign)												\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RR, 0, 1,														\
+																				\
+		USER_PUSH(REG_A sign REG_B);											\
+																				\
+		NEXT_CMD;																\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RI, 0, 1,														\
+																				\
+		USER_PUSH(REG_A sign CUR_CMD.imm);										\
+																				\
+		NEXT_CMD;																\
+		NEXT_CMD;																\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RR_TO_REG, 0, 0,												\
+																				\
+		vm.registers[CUR_CMD.arg] = REG_A sign REG_B;							\
+																				\
+		NEXT_CMD;																\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RI_TO_REG, 0, 0,												\
+																				\
+		vm.registers[CUR_CMD.arg] = REG_A sign CUR_CMD.imm;						\
+																				\
+		NEXT_CMD;																\
+		NEXT_CMD;																\
+	)
+
+/**
+ * @def DEF_FUSED_JUMP(cond, condition)
+ * @brief Macro for defining register-register and register-immediate forms of a compare-and-branch command.
+ */
+#define DEF_FUSED_JUMP(cond, condition)											\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##cond##_RR, 0, 0,													\
+																				\
+		cmp_result = cmp_double(REG_A, REG_B);									\
+																				\
+		BRANCH(condition, 1);													\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##cond##_RI, 0, 0,													\
+																				\
+		cmp_result = cmp_double(REG_A, CUR_CMD.imm);							\
+																				\
+		BRANCH(condition, 2);													\
+	)
+
+/**
+ * @def DEF_INT_FUSED_ARITHM(op, sign)
+ * @brief Macro for defining the forms of an integer arithmetic command, which are DEF_FUSED_ARITHM ones
+ * on the integer registers.
+ */
+#define DEF_INT_FUSED_ARITHM(op, sign)											\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RR, 0, 1,														\
+																				\
+		USER_PUSH((elem_t)INT_OP(INT_REG_A, sign, INT_REG_B));					\
+																				\
+		NEXT_CMD;																\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RI, 0, 1,														\
+																				\
+		USER_PUSH((elem_t)INT_OP(INT_REG_A, sign, CUR_CMD.int_imm));			\
+																				\
+		NEXT_CMD;																\
+		NEXT_CMD;																\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RR_TO_REG, 0, 0,												\
+																				\
+		vm.int_registers[CUR_CMD.arg] = INT_OP(INT_REG_A, sign, INT_REG_B);		\
+																				\
+		NEXT_CMD;																\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op##_RI_TO_REG, 0, 0,												\
+																				\
+		vm.int_registers[CUR_CMD.arg] = INT_OP(INT_REG_A, sign, CUR_CMD.int_imm);	\
+																				\
+		NEXT_CMD;																\
+		NEXT_CMD;																\
+	)
+
+/**
+ * @def DEF_INT_FUSED_JUMP(cond, condition)
+ * @brief Macro for defining the forms of an integer compare-and-branch command, which compares exactly.
+ */
+#define DEF_INT_FUSED_JUMP(cond, condition)										\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##cond##_RR, 0, 0,													\
+																				\
+		cmp_result = CMP_INT(INT_REG_A, INT_REG_B);								\
+																				\
+		BRANCH(condition, 1);													\
+	)																			\
+																				\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##cond##_RI, 0, 0,													\
+																				\
+		cmp_result = CMP_INT(INT_REG_A, CUR_CMD.int_imm);						\
+																				\
+		BRANCH(condition, 2);													\
+	)
+
+/**
+ * @def DEF_INT_ARITHM(op, sign)
+ * @brief Macro for defining an integer arithmetic command on the two top stack values.
+ */
+#define DEF_INT_ARITHM(op, sign)												\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##op, 2, 1,															\
+																				\
+		value_B = USER_POP;														\
+		value_A = USER_POP;														\
+																				\
+		USER_PUSH((elem_t)INT_OP(elem_to_int(value_A), sign, elem_to_int(value_B)));	\
+																				\
+		NEXT_CMD;																\
+	)
+
+/**
+ * @def DEF_INT_JUMP(cond, condition)
+ * @brief Macro for defining an integer compare-and-branch command on the two top stack values.
+ */
+#define DEF_INT_JUMP(cond, condition)											\
+	DEF_DECODED_CMD																\
+	(																			\
+		D_##cond, 2, 0,															\
+																				\
+		value_B = USER_POP;														\
+		value_A = USER_POP;														\
+																				\
+		cmp_result = CMP_INT(elem_to_int(value_A), elem_to_int(value_B));		\
+																				\
+		BRANCH(condition, 1);													\
+	)
+
+DEF_DECODED_CMD
+(
+	D_NOP, 0, 0,
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_PUSH_IMM, 0, 1,
+
+	USER_PUSH(CUR_CMD.imm);
+
+	NEXT_CMD;
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_PUSH_REG, 0, 1,
+
+	USER_PUSH(vm.registers[CUR_CMD.arg]);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_PUSH_RAM_IMM, 0, 1,
+
+	USER_PUSH(vm.rand_access_mem.user_RAM[CUR_CMD.arg]);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_PUSH_RAM_REG, 0, 1,
+
+	RAM_address = (unsigned int)vm.registers[CUR_CMD.arg];
+
+	USER_PUSH(vm.rand_access_mem.user_RAM[RAM_address]);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_PUSH_IREG, 0, 1,
+
+	USER_PUSH((elem_t)vm.int_registers[CUR_CMD.arg]);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_PUSH_RAM_IREG, 0, 1,
+
+	RAM_address = (unsigned int)vm.int_registers[CUR_CMD.arg];
+
+	USER_PUSH(vm.rand_access_mem.user_RAM[RAM_address]);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_POP_REG, 1, 0,
+
+	vm.registers[CUR_CMD.arg] = USER_POP;
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_POP_RAM_IMM, 1, 0,
+
+	vm.rand_access_mem.user_RAM[CUR_CMD.arg] = USER_POP;
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_POP_RAM_REG, 1, 0,
+
+	RAM_address = (unsigned int)vm.registers[CUR_CMD.arg];
+
+	vm.rand_access_mem.user_RAM[RAM_address] = USER_POP;
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_POP_IREG, 1, 0,
+
+	vm.int_registers[CUR_CMD.arg] = elem_to_int(USER_POP);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_POP_RAM_IREG, 1, 0,
+
+	RAM_address = (unsigned int)vm.int_registers[CUR_CMD.arg];
+
+	vm.rand_access_mem.user_RAM[RAM_address] = USER_POP;
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_IN, 0, 1,
+
+	if(!input_read(vm.input, &user_entered_value))
+	{
+		ERROR_HALT(SPU_INPUT_EXHAUSTED);
+	}
+
+	USER_PUSH(user_entered_value);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_ADD, 2, 1,
+
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	USER_PUSH(value_A + value_B);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_SUB, 2, 1,
+
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	USER_PUSH(value_A - value_B);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_MUL, 2, 1,
+
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	USER_PUSH(value_A * value_B);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_DIV, 2, 1,
+
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	USER_PUSH(value_A / value_B);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_OUT, 1, 0,
+
+	value = USER_POP;
+
+	sink_write_value(&(vm.output), value);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_RET, 0, 0,
+
+	if(vm.ret_stack.size == 0)
+	{
+		ERROR_HALT(SPU_STACK_UNDERFLOW);
+	}
+
+	cmd_ID = (size_t)RET_POP;
+
+	CHECK_STACK_BOUNDS;
+)
+
+DEF_DECODED_CMD
+(
+	D_JMP, 0, 0,
+
+	JUMP;
+)
+
+DEF_DECODED_CMD
+(
+	D_JAE, 2, 0,
+
+	COND_JUMP(cmp_result == 1 || cmp_result == 0);
+)
+
+DEF_DECODED_CMD
+(
+	D_JA, 2, 0,
+
+	COND_JUMP(cmp_result == 1);
+)
+
+DEF_DECODED_CMD
+(
+	D_JBE, 2, 0,
+
+	COND_JUMP(cmp_result == -1 || cmp_result == 0);
+)
+
+DEF_DECODED_CMD
+(
+	D_JB, 2, 0,
+
+	COND_JUMP(cmp_result == -1);
+)
+
+DEF_DECODED_CMD
+(
+	D_JE, 2, 0,
+
+	COND_JUMP(cmp_result == 0);
+)
+
+DEF_DECODED_CMD
+(
+	D_JNE, 2, 0,
+
+	COND_JUMP(cmp_result != 0);
+)
+
+DEF_DECODED_CMD
+(
+	D_CALL, 0, 0,
+
+	if(vm.ret_stack.size >= vm.ret_stack.capacity)
+	{
+		ERROR_HALT(SPU_STACK_OVERFLOW);
+	}
+
+	RET_PUSH((elem_t)(cmd_ID + 1));
+
+	JUMP;
+)
+
+DEF_DECODED_CMD
+(
+	D_HLT, 0, 0,
+
+	HALT;
+)
+
+DEF_DECODED_CMD
+(
+	D_DRAW, 0, 0,
+
+	(*driver)(&vm, CUR_CMD.raw, output_file);
+
+	NEXT_CMD;
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_SQRT, 1, 1,
+
+	value = USER_POP;
+
+	USER_PUSH(sqrt(value));
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_FILL, 3, 0,
+
+	value   = USER_POP;
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	CALL_OR_HALT(ram_fill(&(vm.rand_access_mem), value_A, value_B, value));
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_COPY, 3, 0,
+
+	value   = USER_POP;
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	CALL_OR_HALT(ram_copy(&(vm.rand_access_mem), value_A, value_B, value));
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_COMPARE, 3, 1,
+
+	value   = USER_POP;
+	value_B = USER_POP;
+	value_A = USER_POP;
+
+	CALL_OR_HALT(ram_compare(&(vm.rand_access_mem), value_A, value_B, value, &value));
+
+	USER_PUSH(value);
+
+	NEXT_CMD;
+)
+
+DEF_DECODED_CMD
+(
+	D_SNAP, 0, 0,
+
+	if(snapshot != NULL && snapshot->save_file != NULL)
+	{
+		CALL_OR_HALT(snapshot_save(&vm, byte_code, cmd_ID + 1, snapshot->save_file));
+	}
+
+	NEXT_CMD;
+)
+
+DEF_FUSED_ARITHM(ADD, +)
+DEF_FUSED_ARITHM(SUB, -)
+DEF_FUSED_ARITHM(MUL, *)
+DEF_FUSED_ARITHM(DIV, /)
+
+DEF_FUSED_JUMP(JAE, cmp_result == 1 || cmp_result == 0)
+DEF_FUSED_JUMP(JA,  cmp_result == 1)
+DEF_FUSED_JUMP(JBE, cmp_result == -1 || cmp_result == 0)
+DEF_FUSED_JUMP(JB,  cmp_result == -1)
+DEF_FUSED_JUMP(JE,  cmp_result == 0)
+DEF_FUSED_JUMP(JNE, cmp_result != 0)
+
+DEF_INT_ARITHM(IADD, +)
+DEF_INT_ARITHM(ISUB, -)
+DEF_INT_ARITHM(IMUL, *)
+
+DEF_INT_JUMP(IJAE, cmp_result == 1 || cmp_result == 0)
+DEF_INT_JUMP(IJA,  cmp_result == 1)
+DEF_INT_JUMP(IJBE, cmp_result == -1 || cmp_result == 0)
+DEF_INT_JUMP(IJB,  cmp_result == -1)
+DEF_INT_JUMP(IJE,  cmp_result == 0)
+DEF_INT_JUMP(IJNE, cmp_result != 0)
+
+DEF_INT_FUSED_ARITHM(IADD, +)
+DEF_INT_FUSED_ARITHM(ISUB, -)
+DEF_INT_FUSED_ARITHM(IMUL, *)
+
+DEF_INT_FUSED_JUMP(IJAE, cmp_result == 1 || cmp_result == 0)
+DEF_INT_FUSED_JUMP(IJA,  cmp_result == 1)
+DEF_INT_FUSED_JUMP(IJBE, cmp_result == -1 || cmp_result == 0)
+DEF_INT_FUSED_JUMP(IJB,  cmp_result == -1)
+DEF_INT_FUSED_JUMP(IJE,  cmp_result == 0)
+DEF_INT_FUSED_JUMP(IJNE, cmp_result != 0)
+
+#undef DEF_INT_JUMP
+#undef DEF_INT_ARITHM
+#undef DEF_INT_FUSED_JUMP
+#undef DEF_INT_FUSED_ARITHM
+#undef DEF_FUSED_JUMP
+#undef DEF_FUSED_ARITHM
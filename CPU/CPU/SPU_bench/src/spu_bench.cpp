@@ -0,0 +1,502 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "SPU.h"
+#include "SPU_additional.h"
+#include "SPU_jit.h"
+#include "assembler.h"
+#include "utils.h"
+
+/**
+ * @file spu_bench.cpp
+ * @brief Per-opcode microbenchmarks of the SPU.
+ *
+ * Every benchmark is a small assembler program, which runs its body in a counted loop.
+ * The time of the bare loop is subtracted, so the load, the decoding and the loop control
+ * don't count, and the rest is divided by the amount of body instructions as they are
+ * written in the source, before the assembler fuses them.
+ * The output of every program is checked, and the time is compared with the baseline file.
+ */
+
+const size_t      BENCH_ITERATIONS    = 1 << 20; /**< Loop iterations if the command line has none. */
+const size_t      BENCH_REPEATS       = 5; /**< Runs of every benchmark, the fastest one counts. */
+const double      BENCH_TOLERANCE     = 0.25; /**< Slowdown against the baseline reported as a regression. */
+const double      BENCH_NOISE_NS      = 0.5; /**< Smaller slowdowns are timer noise rather than regressions. */
+const double      BENCH_RESULT_GAP    = 1e-3; /**< Allowed difference of the printed result. */
+const size_t      BENCH_MAX_BASELINES = 128; /**< Capacity of the baseline table. */
+const size_t      BENCH_SOURCE_SIZE   = 1024; /**< Size of the generated program text. */
+const char *const BENCH_PREFIX        = "spu_bench_"; /**< Prefix of the generated files. */
+const char *const BENCH_RESULT_FILE   = "execution_result.txt";
+
+/**
+ * @struct Bench
+ * @brief Structure representing a microbenchmark.
+ */
+struct Bench
+{
+	const char *name; /**< Name, which the baseline is keyed by. */
+	const char *setup; /**< Code run once before the loop. */
+	const char *body; /**< Measured code run by every iteration. */
+	const char *tail; /**< Code after hlt, such as subroutines. */
+	size_t      ops; /**< Amount of instructions of the body, written in the source. */
+	double      result; /**< Expected value of rax after the loop. */
+	double      result_per_iteration; /**< Growth of the expected value with every iteration. */
+};
+
+/**
+ * @struct Bench_mode
+ * @brief Structure representing a way of running the byte code.
+ */
+struct Bench_mode
+{
+	const char *name; /**< Name, which the baseline is keyed by. */
+	const char *config_file; /**< Config the VM is built with. */
+	bool        jit; /**< The config enables the JIT. */
+};
+
+/**
+ * @struct Bench_baseline
+ * @brief Structure representing a stored timing.
+ */
+struct Bench_baseline
+{
+	char   name[MAX_TOKEN_SIZE]; /**< Name of the benchmark. */
+	char   mode[MAX_TOKEN_SIZE]; /**< Name of the mode. */
+	double ns_per_op; /**< Time of one body instruction. */
+};
+
+/**
+ * @brief Bare loop, which is subtracted from every other benchmark.
+ */
+static const Bench LOOP_BENCH = {"loop", "", "", "", 0, 0, 0};
+
+/**
+ * @brief Benchmarks, whose setup starts with rax = 0, rcx = 7 and zeroed RAM.
+ */
+static const Bench BENCHES[] =
+{
+	{"push_pop_imm",   "",
+	 "push 1\npop rax\n", "", 2, 1, 0},
+	{"push_pop_reg",   "",
+	 "push rcx\npop rax\n", "", 2, 7, 0},
+	{"push_pop_ram",   "push 5\npop [rcx]\n",
+	 "push [rcx]\npop [3]\npush [3]\npop rax\n", "", 4, 5, 0},
+	{"stack_arithm",   "",
+	 "push 3\npush 2\nadd\npush 4\nmul\npush 2\ndiv\npush 1\nsub\npop rax\n", "", 10, 9, 0},
+	{"fused_add_imm",  "",
+	 "push rax\npush 1\nadd\npop rax\n", "", 4, 0, 1},
+	{"fused_add_reg",  "",
+	 "push rax\npush rcx\nadd\npop rax\n", "", 4, 0, 7},
+	{"jmp",            "",
+	 "jmp next\n:next\n", "", 1, 0, 0},
+	{"cond_jump",      "",
+	 "push 1\npush 2\njb taken\n:taken\n", "", 3, 0, 0},
+	{"fused_jump",     "",
+	 "push rcx\npush 0\nja taken\n:taken\n", "", 3, 0, 0},
+	{"call_ret",       "",
+	 "call func\n", ":func\nret\n", 2, 0, 0},
+	{"draw",           "",
+	 "draw 0 100\n", "", 1, 0, 0},
+	{"fill",           "",
+	 "push 0\npush 64\npush 1\nfill\npush [63]\npop rax\n", "", 6, 1, 0},
+	{"copy",           "push 0\npush 64\npush 3\nfill\n",
+	 "push 64\npush 0\npush 64\ncopy\npush [127]\npop rax\n", "", 6, 3, 0},
+	// the code of the midend strength rules before and after the rewrite, compare their ns/iter
+	{"mul_two",        "",
+	 "push rcx\npush 2\nmul\npop rax\n", "", 4, 14, 0},
+	{"add_self",       "",
+	 "push rcx\npush rcx\nadd\npop rax\n", "", 4, 14, 0},
+	{"div_const",      "",
+	 "push rcx\npush 4\ndiv\npop rax\n", "", 4, 1.75, 0},
+	{"mul_reciprocal", "",
+	 "push rcx\npush 0.25\nmul\npop rax\n", "", 4, 1.75, 0},
+	{"add_consts",     "",
+	 "push rcx\npush 1\nadd\npush 2\nadd\npop rax\n", "", 6, 10, 0},
+	{"add_gathered",   "",
+	 "push rcx\npush 3\nadd\npop rax\n", "", 4, 10, 0},
+};
+
+#ifdef SPU_THREADED_DISPATCH
+	static const Bench_mode MODES[] =
+	{
+		{"threaded", "spu_bench_config",     false},
+	#ifdef SPU_JIT_AVAILABLE
+		{"jit",      "spu_bench_jit_config", true },
+	#endif
+	};
+#else
+	static const Bench_mode MODES[] =
+	{
+		{"switch",   "spu_bench_config",     false},
+	};
+#endif
+
+static elem_t draw_checksum = 0;
+
+/**
+ * @brief Driver of the draw benchmark, which only reads the drawn cells.
+ */
+static void bench_draw(VM *vm, char *current_byte_code, FILE *)
+{
+	unsigned int head = *(unsigned int *)(current_byte_code + sizeof(double));
+	unsigned int end  = *(unsigned int *)(current_byte_code + sizeof(double) + sizeof(int));
+
+	for(unsigned int address = head; address < end; address++)
+	{
+		draw_checksum += vm->rand_access_mem.user_RAM[address];
+	}
+}
+
+static double get_time_ns(void)
+{
+	struct timespec now = {};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static bool write_configs(void)
+{
+	for(size_t mode_ID = 0; mode_ID < sizeof(MODES) / sizeof(Bench_mode); mode_ID++)
+	{
+		FILE *config = fopen(MODES[mode_ID].config_file, "w");
+		if(config == NULL)
+		{
+			return false;
+		}
+
+		fprintf(config, "RAM_size: 256\n"
+						"user_stack_size: 1024\n"
+						"ret_stack_size: 1024\n"
+						"jit: %d\n"
+						"output_buffer_size: 4096\n"
+						"binary_output: 0\n", MODES[mode_ID].jit ? 1 : 0);
+		fclose(config);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Writes the program of the benchmark and assembles it.
+ *
+ * @param bench Pointer to the benchmark.
+ * @param iterations Amount of loop iterations.
+ * @param bin_file Buffer of MAX_TOKEN_SIZE the binary file name is written to.
+ */
+static bool build_bench(const Bench *bench, size_t iterations, char *bin_file)
+{
+	char asm_file[MAX_TOKEN_SIZE]   = {};
+	char source[BENCH_SOURCE_SIZE] = {};
+
+	snprintf(asm_file, MAX_TOKEN_SIZE, "%s%s", BENCH_PREFIX, bench->name);
+	snprintf(bin_file, MAX_TOKEN_SIZE, "%s.bin", asm_file);
+
+	int length = snprintf(source, BENCH_SOURCE_SIZE,
+						  ":main\n"
+						  "push 0\npop rax\n"
+						  "push 7\npop rcx\n"
+						  "push %lu\npop rdx\n"
+						  "%s"
+						  ":loop\n"
+						  "%s"
+						  "push rdx\npush 1\nsub\npop rdx\n"
+						  "push rdx\npush 0\nja loop\n"
+						  "push rax\nout\n"
+						  "hlt\n"
+						  "%s",
+						  iterations, bench->setup, bench->body, bench->tail);
+
+	if(length < 0 || (size_t)length >= BENCH_SOURCE_SIZE)
+	{
+		return false;
+	}
+
+	FILE *program = fopen(asm_file, "w");
+	if(program == NULL)
+	{
+		return false;
+	}
+
+	fputs(source, program);
+	fclose(program);
+
+	return compile(asm_file) == ASM_ALL_GOOD;
+}
+
+static bool read_result(double *result)
+{
+	FILE *output = fopen(BENCH_RESULT_FILE, "r");
+	if(output == NULL)
+	{
+		return false;
+	}
+
+	int read = fscanf(output, "RESULT: %lf", result);
+	fclose(output);
+
+	return read == 1;
+}
+
+/**
+ * @brief Runs the binary file several times.
+ *
+ * @param bin_file Path to the binary file.
+ * @param mode Pointer to the mode to run it in.
+ * @param time_ns Pointer to the time of the fastest run.
+ * @param result Pointer to the printed value.
+ */
+static bool time_bench(const char *bin_file, const Bench_mode *mode, double *time_ns, double *result)
+{
+	Input_source input = {};
+	input.type = INPUT_VALUES;
+
+	*time_ns = INFINITY;
+
+	for(size_t repeat = 0; repeat < BENCH_REPEATS; repeat++)
+	{
+		input.carriage = 0;
+
+		double    start      = get_time_ns();
+		spu_err_t error_code = execute_with_input(bin_file, mode->config_file, &bench_draw, &input);
+		double    time       = get_time_ns() - start;
+
+		if(error_code != SPU_ALL_GOOD)
+		{
+			fprintf(stderr, "ERROR: %s failed in %s mode with %d\n", bin_file, mode->name, error_code);
+
+			return false;
+		}
+
+		if(time < *time_ns)
+		{
+			*time_ns = time;
+		}
+	}
+
+	return read_result(result);
+}
+
+static size_t load_baselines(const char *baseline_file, Bench_baseline *baselines)
+{
+	FILE *file = fopen(baseline_file, "r");
+	if(file == NULL)
+	{
+		return 0;
+	}
+
+	char   line[BENCH_SOURCE_SIZE] = {};
+	size_t amount                  = 0;
+
+	while(amount < BENCH_MAX_BASELINES && fgets(line, BENCH_SOURCE_SIZE, file) != NULL)
+	{
+		Bench_baseline *baseline = &baselines[amount];
+
+		if(line[0] != '#' &&
+		   sscanf(line, "%255s %255s %lf", baseline->name, baseline->mode, &baseline->ns_per_op) == 3)
+		{
+			amount++;
+		}
+	}
+
+	fclose(file);
+
+	return amount;
+}
+
+static bool save_baselines(const char *baseline_file, const Bench_baseline *baselines, size_t amount)
+{
+	FILE *file = fopen(baseline_file, "w");
+	if(file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "# SPU microbenchmark baseline, rewritten by spu_bench --update.\n"
+				  "# benchmark mode ns_per_instruction\n");
+
+	for(size_t baseline_ID = 0; baseline_ID < amount; baseline_ID++)
+	{
+		fprintf(file, "%-16s %-10s %.3lf\n", baselines[baseline_ID].name,
+				baselines[baseline_ID].mode, baselines[baseline_ID].ns_per_op);
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+static Bench_baseline *find_baseline(Bench_baseline *baselines, size_t *amount,
+									 const char *name, const char *mode, bool add)
+{
+	for(size_t baseline_ID = 0; baseline_ID < *amount; baseline_ID++)
+	{
+		if(!strcmp(baselines[baseline_ID].name, name) && !strcmp(baselines[baseline_ID].mode, mode))
+		{
+			return &baselines[baseline_ID];
+		}
+	}
+
+	if(!add || *amount == BENCH_MAX_BASELINES)
+	{
+		return NULL;
+	}
+
+	Bench_baseline *baseline = &baselines[(*amount)++];
+
+	snprintf(baseline->name, MAX_TOKEN_SIZE, "%s", name);
+	snprintf(baseline->mode, MAX_TOKEN_SIZE, "%s", mode);
+
+	return baseline;
+}
+
+int main(int argc, const char *argv[])
+{
+	if(argc < 2 || argc > 4)
+	{
+		fprintf(stderr, "usage: %s <baseline file> [--update] [iterations, %lu by default]\n",
+				argv[0], BENCH_ITERATIONS);
+
+		return EXIT_FAILURE;
+	}
+
+	const char *baseline_file = argv[1];
+	bool        update        = false;
+	size_t      iterations    = BENCH_ITERATIONS;
+
+	for(int arg_ID = 2; arg_ID < argc; arg_ID++)
+	{
+		if(!strcmp(argv[arg_ID], "--update"))
+		{
+			update = true;
+		}
+		else if(sscanf(argv[arg_ID], "%lu", &iterations) != 1 || iterations == 0)
+		{
+			fprintf(stderr, "ERROR: bad iterations amount %s\n", argv[arg_ID]);
+
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!write_configs())
+	{
+		fprintf(stderr, "ERROR: unable to write the bench configs\n");
+
+		return EXIT_FAILURE;
+	}
+
+	Bench_baseline baselines[BENCH_MAX_BASELINES] = {};
+	size_t         baselines_amount               = load_baselines(baseline_file, baselines);
+	size_t         failed                         = 0;
+	size_t         slower                         = 0;
+	char           loop_bin[MAX_TOKEN_SIZE]       = {};
+
+	if(!build_bench(&LOOP_BENCH, iterations, loop_bin))
+	{
+		fprintf(stderr, "ERROR: unable to assemble the loop benchmark\n");
+
+		return EXIT_FAILURE;
+	}
+
+	printf("%-16s %-10s %12s %14s %10s %10s  %s\n", "benchmark", "mode", "ns/instr", "instr/s", "ns/iter",
+		   "baseline", "result");
+
+	for(size_t mode_ID = 0; mode_ID < sizeof(MODES) / sizeof(Bench_mode); mode_ID++)
+	{
+		const Bench_mode *mode = &MODES[mode_ID];
+
+		double loop_time   = 0;
+		double loop_result = 0;
+
+		if(!time_bench(loop_bin, mode, &loop_time, &loop_result))
+		{
+			return EXIT_FAILURE;
+		}
+
+		printf("%-16s %-10s %12s %14s %10.3lf %10s  %s\n", LOOP_BENCH.name, mode->name,
+			   "-", "-", loop_time / (double)iterations, "-", "subtracted");
+
+		for(size_t bench_ID = 0; bench_ID < sizeof(BENCHES) / sizeof(Bench); bench_ID++)
+		{
+			const Bench *bench                    = &BENCHES[bench_ID];
+			char         bin_file[MAX_TOKEN_SIZE] = {};
+			double       time                     = 0;
+			double       result                   = 0;
+
+			if(!build_bench(bench, iterations, bin_file))
+			{
+				fprintf(stderr, "ERROR: unable to assemble %s\n", bench->name);
+
+				return EXIT_FAILURE;
+			}
+
+			bool   ran      = time_bench(bin_file, mode, &time, &result);
+			double expected = bench->result + bench->result_per_iteration * (double)iterations;
+			bool   correct  = ran && fabs(result - expected) < BENCH_RESULT_GAP;
+
+			double ns_per_op = (time - loop_time) / (double)(iterations * bench->ops);
+			if(ns_per_op < 0)
+			{
+				ns_per_op = 0;
+			}
+
+			char baseline_text[MAX_TOKEN_SIZE] = "-";
+
+			Bench_baseline *baseline = find_baseline(baselines, &baselines_amount,
+													 bench->name, mode->name, update);
+			if(update && baseline != NULL)
+			{
+				baseline->ns_per_op = ns_per_op;
+			}
+			else if(baseline != NULL && baseline->ns_per_op > 0)
+			{
+				double ratio = ns_per_op / baseline->ns_per_op;
+
+				snprintf(baseline_text, MAX_TOKEN_SIZE, "%+.0lf%%", (ratio - 1) * 100);
+
+				if(ratio > 1 + BENCH_TOLERANCE && ns_per_op - baseline->ns_per_op > BENCH_NOISE_NS)
+				{
+					slower++;
+				}
+			}
+
+			char speed_text[MAX_TOKEN_SIZE] = "-";
+			if(ns_per_op > 0)
+			{
+				snprintf(speed_text, MAX_TOKEN_SIZE, "%.3le", 1e9 / ns_per_op);
+			}
+
+			printf("%-16s %-10s %12.3lf %14s %10.3lf %10s  %s\n", bench->name, mode->name,
+				   ns_per_op, speed_text, ns_per_op * (double)bench->ops, baseline_text, correct ? "ok" : "WRONG");
+
+			if(!correct)
+			{
+				failed++;
+
+				if(ran)
+				{
+					fprintf(stderr, "ERROR: %s printed %.3lf instead of %.3lf in %s mode\n",
+							bench->name, result, expected, mode->name);
+				}
+			}
+		}
+	}
+
+	if(update && !save_baselines(baseline_file, baselines, baselines_amount))
+	{
+		fprintf(stderr, "ERROR: unable to write %s\n", baseline_file);
+
+		return EXIT_FAILURE;
+	}
+
+	if(slower != 0)
+	{
+		printf("%lu benchmarks are more than %.0lf%% slower than the baseline\n",
+			   slower, BENCH_TOLERANCE * 100);
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SPU_trace.h"
+#include "SPU_labels.h"
+#include "utils.h"
+#include "secondary.h"
+
+/**
+ * @brief Prints a record with the register change of the instruction it recorded.
+ *
+ * @param map Pointer to the label map.
+ * @param record Pointer to the record.
+ * @param next Pointer to the following record, which holds the register change, NULL for the last one.
+ * @param record_ID Number of the record in the whole run.
+ */
+static void print_record(const Label_map *map, const Trace_record *record,
+						 const Trace_record *next, unsigned long record_ID)
+{
+	char   place[MAX_TOKEN_SIZE] = {};
+	size_t label_ID              = find_label(map, record->cmd_ID);
+
+	if(label_ID == map->amount)
+	{
+		snprintf(place, sizeof(place), "%u", record->cmd_ID);
+	}
+	else
+	{
+		snprintf(place, sizeof(place), "%s+%lu", map->labels[label_ID].name,
+				 record->cmd_ID - map->labels[label_ID].slot);
+	}
+
+	printf("%10lu  %6u  %-24s %-16s depth %5u  top %14.3lf",
+		   record_ID, record->cmd_ID, place, decoded_type_name((Decoded_type)record->type),
+		   record->stack_size, record->top);
+
+	if(next != NULL && next->reg != TRACE_NO_REG)
+	{
+		char reg_name[REG_NAME_SIZE] = {};
+		write_reg_name(reg_name, REG_NAME_SIZE, next->reg);
+
+		printf("  %s = %.3lf", reg_name, next->reg_value);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, const char *argv[])
+{
+	if(argc < 2 || argc > 3)
+	{
+		fprintf(stderr, "usage: %s <trace dump> [binary file, root.bin by default]\n", argv[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	FILE *dump = fopen(argv[1], "rb");
+	if(dump == NULL)
+	{
+		fprintf(stderr, "ERROR: unable to open %s\n", argv[1]);
+
+		return EXIT_FAILURE;
+	}
+
+	Trace_header header = {};
+
+	if(fread(&header, sizeof(Trace_header), 1, dump) != 1 ||
+	   header.magic != TRACE_MAGIC                        ||
+	   header.version != TRACE_VERSION                    ||
+	   header.record_size != sizeof(Trace_record))
+	{
+		fprintf(stderr, "ERROR: %s is not a trace dump of this SPU version\n", argv[1]);
+		fclose(dump);
+
+		return EXIT_FAILURE;
+	}
+
+	Trace_record *records = (Trace_record *)calloc(header.amount + 1, sizeof(Trace_record));
+	if(records == NULL)
+	{
+		fprintf(stderr, "ERROR: unable to allocate %lu records\n", (unsigned long)header.amount);
+		fclose(dump);
+
+		return EXIT_FAILURE;
+	}
+
+	size_t amount = fread(records, sizeof(Trace_record), header.amount, dump);
+	fclose(dump);
+
+	if(amount != header.amount)
+	{
+		fprintf(stderr, "WARNING: the dump is cut, %lu of %lu records read\n",
+				amount, (unsigned long)header.amount);
+	}
+
+	Label_map map = {};
+	if(load_label_map(&map, (argc == 3) ? argv[2] : "root.bin") != SPU_ALL_GOOD)
+	{
+		fprintf(stderr, "WARNING: unable to load the label map\n");
+	}
+
+	printf("%lu records of %lu executed instructions\n", amount, (unsigned long)header.written);
+
+	unsigned long first_ID = (unsigned long)(header.written - header.amount);
+
+	for(size_t record_ID = 0; record_ID < amount; record_ID++)
+	{
+		print_record(&map, records + record_ID,
+					 (record_ID + 1 < amount) ? records + record_ID + 1 : NULL, first_ID + record_ID);
+	}
+
+	label_map_dtor(&map);
+	free(records);
+
+	return EXIT_SUCCESS;
+}
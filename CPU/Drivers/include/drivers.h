@@ -4,25 +4,31 @@
 // for some reason cant just do #include "SPU.h"
 #include "SPU.h"
 
+const size_t RGBA_SIZE = 4; /**< Bytes of a window_draw pixel. */
+
 /**
  * @brief Draws the content of the virtual machine's user RAM to a file.
  *
  * This function reads the specified range of addresses from the virtual machine's
  * user RAM and prints the corresponding characters to the specified output file.
  * The characters are printed in a grid format to represent the content.
+ * They go through the VM output sink, which owns the output file, and in binary
+ * output mode every cell is written as a single byte without the grid.
  *
  * @param vm Pointer to the virtual machine.
  * @param current_byte_code Pointer to the current byte code.
- * @param output_file Pointer to the output file where the content will be printed.
+ * @param output_file Unused, the output file is taken from the VM output sink.
  */
 void file_draw(VM *vm, char *current_byte_code, FILE *output_file);
 
 /**
  * @brief Draws the content of the virtual machine's user RAM to an SFML window.
  *
- * This function reads the specified range of addresses from the virtual machine's
- * user RAM and draws the corresponding pixels to an SFML window. The pixels are
- * drawn as red rectangles on a black background to represent the content graphically.
+ * The window is opened by the first draw command and stays open between them.
+ * The RAM range is turned into the pixels of a single texture in one pass: cells
+ * other than '.' are red on the black background. A frame whose RAM didn't change
+ * since the previous one is not uploaded again. The function polls the window events
+ * and returns to the VM right away, so animated programs keep running.
  *
  * @param vm Pointer to the virtual machine.
  * @param current_byte_code Pointer to the current byte code.
@@ -30,4 +36,11 @@ void file_draw(VM *vm, char *current_byte_code, FILE *output_file);
  */
 void window_draw(VM *vm, char * current_byte_code, FILE *junk);
 
+/**
+ * @brief Keeps the last frame of window_draw on the screen until the window is closed, then frees it.
+ *
+ * Nothing happens if nothing was drawn.
+ */
+void window_draw_finish(void);
+
 #endif
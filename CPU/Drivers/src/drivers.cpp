@@ -1,64 +1,177 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <SFML/Graphics.hpp>
 #include "drivers.h"
+#include "SPU_output.h"
 #include "utils.h"
 
-void file_draw(VM *vm, char *current_byte_code, FILE *output_file)
+void file_draw(VM *vm, char *current_byte_code, FILE *)
 {
 	unsigned int head = *(unsigned int *)(current_byte_code + sizeof(double));
 	unsigned int end  = *(unsigned int *)(current_byte_code + sizeof(double) + sizeof(int));
 
 	size_t screen_size = (size_t)sqrt(end - head + 1); // sqrt тяжело
 
+	Output_sink *sink = &(vm->output);
+
 	for(unsigned int address = head; address < end; address++)
 	{
-		fprintf(output_file, "%c  ", (char)vm->rand_access_mem.user_RAM[address]);
+		sink_write_char(sink, (char)vm->rand_access_mem.user_RAM[address]);
 
-		if((address + 1) % screen_size == 0)
+		if(!sink->binary)
 		{
-			fprintf(output_file, "\n");
+			sink_write_char(sink, ' ');
+			sink_write_char(sink, ' ');
+
+			if((address + 1) % screen_size == 0)
+			{
+				sink_write_char(sink, '\n');
+			}
 		}
 
 	}
 }
 
-void window_draw(VM *vm, char * current_byte_code, FILE *junk)
+/**
+ * @struct Framebuffer
+ * @brief Structure representing the window of window_draw, which stays open between draw commands.
+ */
+struct Framebuffer
+{
+	sf::RenderWindow window; /**< Window. */
+	sf::Texture      texture; /**< Texture the frame is uploaded to. */
+	sf::Sprite       sprite; /**< Sprite of the texture. */
+	sf::Uint8       *pixels; /**< RGBA pixels of the frame. */
+	elem_t          *shown_cells; /**< RAM cells of the frame on the screen. */
+	size_t           cells_amount; /**< Amount of drawn RAM cells. */
+	unsigned int     screen_size; /**< Width and height of the window. */
+	bool             has_frame; /**< Something was drawn already. */
+};
+
+static Framebuffer *framebuffer = NULL;
+
+static bool open_framebuffer(unsigned int screen_size, size_t cells_amount)
+{
+	framebuffer = new Framebuffer();
+
+	framebuffer->screen_size  = screen_size;
+	framebuffer->cells_amount = cells_amount;
+	framebuffer->pixels       = (sf::Uint8 *)calloc((size_t)screen_size * screen_size * RGBA_SIZE, sizeof(sf::Uint8));
+	framebuffer->shown_cells  = (elem_t *)calloc(cells_amount, sizeof(elem_t));
+
+	if(framebuffer->pixels == NULL || framebuffer->shown_cells == NULL ||
+	   !framebuffer->texture.create(screen_size, screen_size))
+	{
+		window_draw_finish();
+
+		return false;
+	}
+
+	framebuffer->sprite.setTexture(framebuffer->texture, true);
+	framebuffer->window.create(sf::VideoMode(screen_size, screen_size), "SFML Window");
+
+	return true;
+}
+
+static void show_frame(void)
+{
+	framebuffer->window.clear(sf::Color::Black);
+	framebuffer->window.draw(framebuffer->sprite);
+	framebuffer->window.display();
+}
+
+void window_draw(VM *vm, char * current_byte_code, FILE *)
 {
 	unsigned int head = *(unsigned int *)(current_byte_code + sizeof(double));
 	unsigned int end  = *(unsigned int *)(current_byte_code + sizeof(double) + sizeof(int));
 
+	unsigned int screen_size  = (unsigned int)sqrt(end - head + 1);
+	size_t       cells_amount = end - head;
 
-	unsigned int screen_size = (unsigned int)sqrt(end - head + 1);
+	if(framebuffer != NULL && (framebuffer->screen_size != screen_size || framebuffer->cells_amount != cells_amount))
+	{
+		window_draw_finish();
+	}
 
-	sf::RenderWindow window(sf::VideoMode(screen_size, screen_size), "SFML Window");
+	if(framebuffer == NULL && !open_framebuffer(screen_size, cells_amount))
+	{
+		return;
+	}
 
-	while(window.isOpen())
-    {
-        sf::Event event;
-        while (window.pollEvent(event))
-        {
-            if (event.type == sf::Event::Closed)
-			{
-                window.close();
-			}
-        }
+	sf::Event event;
+	while(framebuffer->window.pollEvent(event))
+	{
+		if(event.type == sf::Event::Closed)
+		{
+			framebuffer->window.close();
+		}
+	}
 
-        window.clear(sf::Color::Black);
+	if(!framebuffer->window.isOpen())
+	{
+		return;
+	}
+
+	const elem_t *cells = vm->rand_access_mem.user_RAM + head;
+
+	if(framebuffer->has_frame && !memcmp(framebuffer->shown_cells, cells, cells_amount * sizeof(elem_t)))
+	{
+		return;
+	}
+
+	memcpy(framebuffer->shown_cells, cells, cells_amount * sizeof(elem_t));
+	framebuffer->has_frame = true;
+
+	size_t pixels_amount = (size_t)screen_size * screen_size;
 
-		for(size_t pixel_ID = head; pixel_ID < end; pixel_ID++)
+	for(size_t pixel_ID = 0; pixel_ID < pixels_amount; pixel_ID++)
+	{
+		bool lit = pixel_ID < cells_amount && cmp_double(cells[pixel_ID], 46);
+
+		sf::Uint8 *pixel = framebuffer->pixels + pixel_ID * RGBA_SIZE;
+
+		pixel[0] = lit ? sf::Color::Red.r : sf::Color::Black.r;
+		pixel[1] = lit ? sf::Color::Red.g : sf::Color::Black.g;
+		pixel[2] = lit ? sf::Color::Red.b : sf::Color::Black.b;
+		pixel[3] = 255;
+	}
+
+	framebuffer->texture.update(framebuffer->pixels);
+
+	show_frame();
+}
+
+void window_draw_finish(void)
+{
+	if(framebuffer == NULL)
+	{
+		return;
+	}
+
+	while(framebuffer->has_frame && framebuffer->window.isOpen())
+	{
+		sf::Event event;
+		if(!framebuffer->window.waitEvent(event))
 		{
-			if(cmp_double(vm->rand_access_mem.user_RAM[pixel_ID], 46))
-			{
-				sf::RectangleShape rectangle(sf::Vector2f(1, 1));
-        		rectangle.setFillColor(sf::Color::Red);
-        		rectangle.setPosition(pixel_ID % screen_size , pixel_ID / screen_size);
+			break;
+		}
 
-				window.draw(rectangle);
-			}
+		if(event.type == sf::Event::Closed)
+		{
+			framebuffer->window.close();
 		}
+		else
+		{
+			show_frame();
+		}
+	}
+
+	free(framebuffer->pixels);
+	free(framebuffer->shown_cells);
 
-        window.display();
-    }
+	delete framebuffer;
+	framebuffer = NULL;
 }
@@ -2,41 +2,31 @@ DEF_CMD
 (
 	"push", PUSH, WRITE_CMD_W_8_BYTE_ARG,
 
-	if(*(CURRENT_BYTE_CODE + sizeof(char)) & RAM_MASK)
+	if(MODE & RAM_MASK)
 	{
-		if(*(CURRENT_BYTE_CODE + sizeof(char)) & IMM_MASK)
+		if(MODE & IMM_MASK)
 		{
-			RAM_address = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int));
-
-			value = vm.rand_access_mem.user_RAM[RAM_address];
-
-			STACK_PUSH(&(vm.user_stack), value);
+			DECODE(D_PUSH_RAM_IMM, INT_ARG);
 		}
-		else if(*(CURRENT_BYTE_CODE + sizeof(char)) & REG_MASK)
+		else if(MODE & REG_MASK)
 		{
-			reg_type = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int));
-
-			RAM_address = (unsigned int)vm.registers[reg_type];
-
-			value = vm.rand_access_mem.user_RAM[RAM_address];
-
-			STACK_PUSH(&(vm.user_stack), value);
+			DECODE_REG(D_PUSH_RAM_REG, D_PUSH_RAM_IREG);
 		}
 		else
 		{
 			return INVALID_RAM_MODE;
 		}
 	}
-	else if(*(CURRENT_BYTE_CODE + sizeof(char)) & IMM_MASK)
+	else if(MODE & IMM_MASK)
 	{
-		MOVE_CARRIAGE;
+		DECODE(D_PUSH_IMM, 0);
+		CUR_CMD.imm = IMM_ARG;
 
-		STACK_PUSH(&(vm.user_stack), *(elem_t *)CURRENT_BYTE_CODE);
+		MOVE_CARRIAGE;
 	}
-	else if(*(CURRENT_BYTE_CODE + sizeof(char)) & REG_MASK)
+	else if(MODE & REG_MASK)
 	{
-		reg_type = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int));
-		STACK_PUSH(&(vm.user_stack), vm.registers[reg_type]);
+		DECODE_REG(D_PUSH_REG, D_PUSH_IREG);
 	}
 
 	MOVE_CARRIAGE;
@@ -46,31 +36,20 @@ DEF_CMD
 (
 	"pop", POP, WRITE_CMD_W_4_BYTE_ARG,
 
-	if(*(CURRENT_BYTE_CODE + sizeof(char)) & RAM_MASK)
+	if(MODE & RAM_MASK)
 	{
-		if(*(CURRENT_BYTE_CODE + sizeof(char)) & IMM_MASK)
+		if(MODE & IMM_MASK)
 		{
-			RAM_address = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int));
-
-			vm.rand_access_mem.user_RAM[RAM_address] =
-				STACK_POP(&(vm.user_stack)).deleted_element;
+			DECODE(D_POP_RAM_IMM, INT_ARG);
 		}
-		else if(*(CURRENT_BYTE_CODE + sizeof(char)) & REG_MASK)
+		else if(MODE & REG_MASK)
 		{
-			reg_type = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int));
-
-			RAM_address = (unsigned int)vm.registers[reg_type];
-
-			vm.rand_access_mem.user_RAM[RAM_address] =
-				STACK_POP(&(vm.user_stack)).deleted_element;
+			DECODE_REG(D_POP_RAM_REG, D_POP_RAM_IREG);
 		}
 	}
-	else if(*(CURRENT_BYTE_CODE + sizeof(char)) & REG_MASK)
+	else if(MODE & REG_MASK)
 	{
-		reg_type = *(unsigned int *)(CURRENT_BYTE_CODE + sizeof(int));
-
-		vm.registers[reg_type] =
-			STACK_POP(&(vm.user_stack)).deleted_element;
+		DECODE_REG(D_POP_REG, D_POP_IREG);
 	}
 
 
@@ -81,12 +60,7 @@ DEF_CMD
 (
 	"in", IN, WRITE_CMD_W_NO_ARG,
 
-	printf("Please enter value: ");
-
-	scanf("%lf", &user_entered_value);
-	clear_buffer();
-
-	STACK_PUSH(&(vm.user_stack), user_entered_value);
+	DECODE(D_IN, 0);
 
 	MOVE_CARRIAGE;
 )
@@ -95,10 +69,7 @@ DEF_CMD
 (
 	"add", ADD, WRITE_CMD_W_NO_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	STACK_PUSH(&(vm.user_stack), value_A + value_B);
+	DECODE(D_ADD, 0);
 
 	MOVE_CARRIAGE;
 )
@@ -107,10 +78,7 @@ DEF_CMD
 (
 	"sub", SUB, WRITE_CMD_W_NO_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	STACK_PUSH(&(vm.user_stack), value_A - value_B);
+	DECODE(D_SUB, 0);
 
 	MOVE_CARRIAGE;
 )
@@ -119,10 +87,7 @@ DEF_CMD
 (
 	"mul", MUL, WRITE_CMD_W_NO_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	STACK_PUSH(&(vm.user_stack), value_A * value_B);
+	DECODE(D_MUL, 0);
 
 	MOVE_CARRIAGE;
 )
@@ -131,10 +96,7 @@ DEF_CMD
 (
 	"div", DIV, WRITE_CMD_W_NO_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	STACK_PUSH(&(vm.user_stack), value_A / value_B);
+	DECODE(D_DIV, 0);
 
 	MOVE_CARRIAGE;
 )
@@ -143,9 +105,7 @@ DEF_CMD
 (
 	"out", OUT, WRITE_CMD_W_NO_ARG,
 
-	value = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	fprintf(output_file, "RESULT: %.3lf\n", value);
+	DECODE(D_OUT, 0);
 
 	MOVE_CARRIAGE;
 )
@@ -154,151 +114,97 @@ DEF_CMD
 (
 	"ret", RET, WRITE_CMD_W_NO_ARG,
 
-	byte_code_carriage = (size_t)STACK_POP(&(vm.ret_stack)).deleted_element;
+	DECODE(D_RET, 0);
+
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"jmp", JMP, WRITE_CMD_W_LABEL_ARG,
 
-	UPDATE_BYTE_CODE_CARRIAGE;
+	DECODE(D_JMP, INT_ARG);
+
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"jae", JAE, WRITE_CMD_W_LABEL_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
+	DECODE(D_JAE, INT_ARG);
 
-	cmp_result = cmp_double(value_A, value_B);
-
-	if(cmp_result == 1 || cmp_result == 0)
-	{
-		UPDATE_BYTE_CODE_CARRIAGE;
-	}
-	else
-	{
-		MOVE_CARRIAGE;
-	}
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"ja", JA, WRITE_CMD_W_LABEL_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	cmp_result = cmp_double(value_A, value_B);
+	DECODE(D_JA, INT_ARG);
 
-	if(cmp_result == 1)
-	{
-		UPDATE_BYTE_CODE_CARRIAGE;
-	}
-	else
-	{
-		MOVE_CARRIAGE;
-	}
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"jbe", JBE, WRITE_CMD_W_LABEL_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
+	DECODE(D_JBE, INT_ARG);
 
-	cmp_result = cmp_double(value_A, value_B);
-
-	if(cmp_result == -1 || cmp_result == 0)
-	{
-		UPDATE_BYTE_CODE_CARRIAGE;
-	}
-	else
-	{
-		MOVE_CARRIAGE;
-	}
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"jb", JB, WRITE_CMD_W_LABEL_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	cmp_result = cmp_double(value_A, value_B);
+	DECODE(D_JB, INT_ARG);
 
-	if(cmp_result == -1)
-	{
-		UPDATE_BYTE_CODE_CARRIAGE;
-	}
-	else
-	{
-		MOVE_CARRIAGE;
-	}
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"je", JE, WRITE_CMD_W_LABEL_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
+	DECODE(D_JE, INT_ARG);
 
-	cmp_result = cmp_double(value_A, value_B);
-
-	if(cmp_result == 0)
-	{
-		UPDATE_BYTE_CODE_CARRIAGE;
-	}
-	else
-	{
-		MOVE_CARRIAGE;
-	}
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"jne", JNE, WRITE_CMD_W_LABEL_ARG,
 
-	value_B = STACK_POP(&(vm.user_stack)).deleted_element;
-	value_A = STACK_POP(&(vm.user_stack)).deleted_element;
-
-	cmp_result = cmp_double(value_A, value_B);
+	DECODE(D_JNE, INT_ARG);
 
-	if(cmp_result != 0)
-	{
-		UPDATE_BYTE_CODE_CARRIAGE;
-	}
-	else
-	{
-		MOVE_CARRIAGE;
-	}
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"call", CALL, WRITE_CMD_W_LABEL_ARG,
 
-	STACK_PUSH(&(vm.ret_stack), byte_code_carriage + sizeof(double));
+	DECODE(D_CALL, INT_ARG);
 
-	UPDATE_BYTE_CODE_CARRIAGE;
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"hlt", HLT, WRITE_CMD_W_NO_ARG,
 
-	return SPU_ALL_GOOD;
+	DECODE(D_HLT, 0);
+
+	MOVE_CARRIAGE;
 )
 
 DEF_CMD
 (
 	"draw", DRAW, WRITE_CMD_W_2_ARGS,
 
-	(*driver)(&vm, CURRENT_BYTE_CODE, output_file);
+	DECODE(D_DRAW, 0);
 
 	MOVE_CARRIAGE;
 	MOVE_CARRIAGE;
@@ -308,16 +214,264 @@ DEF_CMD
 (
 	"sqrt", SQRT, WRITE_CMD_W_NO_ARG,
 
-	value = STACK_POP(&(vm.user_stack)).deleted_element;
+	DECODE(D_SQRT, 0);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"fill", FILL, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_FILL, 0);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"copy", COPY, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_COPY, 0);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"compare", COMPARE, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_COMPARE, 0);
 
-	STACK_PUSH(&(vm.user_stack), sqrt(value));
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"snap", SNAP, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_SNAP, 0);
 
 	MOVE_CARRIAGE;
 )
 
+DEF_CMD
+(
+	"add_fused", ADD_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_ARITHM(ADD);
+)
+
+DEF_CMD
+(
+	"sub_fused", SUB_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_ARITHM(SUB);
+)
+
+DEF_CMD
+(
+	"mul_fused", MUL_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_ARITHM(MUL);
+)
+
+DEF_CMD
+(
+	"div_fused", DIV_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_ARITHM(DIV);
+)
+
+DEF_CMD
+(
+	"jae_fused", JAE_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_JUMP(JAE);
+)
+
+DEF_CMD
+(
+	"ja_fused", JA_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_JUMP(JA);
+)
+
+DEF_CMD
+(
+	"jbe_fused", JBE_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_JUMP(JBE);
+)
+
+DEF_CMD
+(
+	"jb_fused", JB_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_JUMP(JB);
+)
+
+DEF_CMD
+(
+	"je_fused", JE_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_JUMP(JE);
+)
+
+DEF_CMD
+(
+	"jne_fused", JNE_FUSED, WRITE_FUSED,
+
+	DECODE_FUSED_JUMP(JNE);
+)
+
+DEF_CMD
+(
+	"iadd", IADD, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_IADD, 0);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"isub", ISUB, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_ISUB, 0);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"imul", IMUL, WRITE_CMD_W_NO_ARG,
+
+	DECODE(D_IMUL, 0);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"ijae", IJAE, WRITE_CMD_W_LABEL_ARG,
+
+	DECODE(D_IJAE, INT_ARG);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"ija", IJA, WRITE_CMD_W_LABEL_ARG,
+
+	DECODE(D_IJA, INT_ARG);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"ijbe", IJBE, WRITE_CMD_W_LABEL_ARG,
+
+	DECODE(D_IJBE, INT_ARG);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"ijb", IJB, WRITE_CMD_W_LABEL_ARG,
+
+	DECODE(D_IJB, INT_ARG);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"ije", IJE, WRITE_CMD_W_LABEL_ARG,
+
+	DECODE(D_IJE, INT_ARG);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"ijne", IJNE, WRITE_CMD_W_LABEL_ARG,
+
+	DECODE(D_IJNE, INT_ARG);
+
+	MOVE_CARRIAGE;
+)
+
+DEF_CMD
+(
+	"iadd_fused", IADD_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_ARITHM(IADD);
+)
+
+DEF_CMD
+(
+	"isub_fused", ISUB_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_ARITHM(ISUB);
+)
+
+DEF_CMD
+(
+	"imul_fused", IMUL_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_ARITHM(IMUL);
+)
+
+DEF_CMD
+(
+	"ijae_fused", IJAE_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_JUMP(IJAE);
+)
+
+DEF_CMD
+(
+	"ija_fused", IJA_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_JUMP(IJA);
+)
+
+DEF_CMD
+(
+	"ijbe_fused", IJBE_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_JUMP(IJBE);
+)
+
+DEF_CMD
+(
+	"ijb_fused", IJB_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_JUMP(IJB);
+)
+
+DEF_CMD
+(
+	"ije_fused", IJE_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_JUMP(IJE);
+)
+
+DEF_CMD
+(
+	"ijne_fused", IJNE_FUSED, WRITE_FUSED,
+
+	DECODE_INT_FUSED_JUMP(IJNE);
+)
+
 DEF_CMD
 (
 	":", VOID, WRITE_LABEL,
 
-	;
+	MOVE_CARRIAGE;
 )
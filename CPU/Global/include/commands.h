@@ -32,6 +32,43 @@ enum Command
 	RET  = 17,
 	DRAW = 18,
 	SQRT = 19,
+
+	ADD_FUSED = 20,
+	SUB_FUSED = 21,
+	MUL_FUSED = 22,
+	DIV_FUSED = 23,
+	JAE_FUSED = 24,
+	JA_FUSED  = 25,
+	JBE_FUSED = 26,
+	JB_FUSED  = 27,
+	JE_FUSED  = 28,
+	JNE_FUSED = 29,
+
+	FILL    = 30,
+	COPY    = 31,
+	COMPARE = 32,
+	SNAP    = 33,
+
+	IADD = 34,
+	ISUB = 35,
+	IMUL = 36,
+	IJA  = 37,
+	IJB  = 38,
+	IJAE = 39,
+	IJBE = 40,
+	IJE  = 41,
+	IJNE = 42,
+
+	IADD_FUSED = 43,
+	ISUB_FUSED = 44,
+	IMUL_FUSED = 45,
+	IJAE_FUSED = 46,
+	IJA_FUSED  = 47,
+	IJBE_FUSED = 48,
+	IJB_FUSED  = 49,
+	IJE_FUSED  = 50,
+	IJNE_FUSED = 51,
+
 	HLT  = -1,
 };
 
@@ -0,0 +1,87 @@
+#ifndef COMPACT_CODE_H
+#define COMPACT_CODE_H
+
+/**
+ * @file compact_code.h
+ * @brief Compact variable-length encoding of the byte code.
+ *
+ * The legacy byte code gives every instruction at least one 8 byte slot, and jump
+ * targets, the label map and snapshots count those slots. The compact encoding packs
+ * the same instructions tightly:
+ *
+ * - a 1 byte opcode, which folds the command and its addressing mode together;
+ * - 1 byte register operands;
+ * - RAM addresses, jump targets and draw ranges as unsigned LEB128 varints;
+ * - immediates as a tagged varint: an even tag is a zigzag integer shifted left by one,
+ *   an odd tag is followed by the 8 bytes of the double.
+ *
+ * A Compact_header starts the file, so the loader can tell the formats apart: the
+ * legacy byte code always starts with the main jump. Unpacking rebuilds the legacy
+ * slots exactly, so jump targets stay slot indices.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint32_t COMPACT_MAGIC   = 0x43555053; /**< First bytes of the compact byte code, "SPUC" in little-endian. */
+const uint32_t COMPACT_VERSION = 1; /**< Version of the compact encoding. */
+
+/**
+ * @struct Compact_header
+ * @brief Structure representing the header of the compact byte code.
+ */
+struct Compact_header
+{
+	uint32_t magic; /**< COMPACT_MAGIC. */
+	uint32_t version; /**< COMPACT_VERSION. */
+	uint64_t legacy_length; /**< Length of the unpacked byte code in bytes. */
+};
+
+/**
+ * @brief Checks whether the byte code starts with the compact header.
+ *
+ * @param byte_code Byte code.
+ * @param length Length of the byte code in bytes.
+ * @return bool Returns true for the compact encoding of any version.
+ */
+bool is_compact_code(const char *byte_code, size_t length);
+
+/**
+ * @brief Gets the buffer size enough for the compact encoding of a byte code.
+ *
+ * @param legacy_length Length of the legacy byte code in bytes.
+ * @return size_t Returns the size in bytes.
+ */
+size_t compact_code_bound(size_t legacy_length);
+
+/**
+ * @brief Packs the legacy byte code into the compact encoding.
+ *
+ * @param legacy Legacy byte code.
+ * @param legacy_length Length of the legacy byte code in bytes.
+ * @param compact Buffer of at least compact_code_bound(legacy_length) bytes.
+ * @return size_t Returns the length of the compact byte code, 0 if the legacy one has an unknown command.
+ */
+size_t pack_compact_code(const char *legacy, size_t legacy_length, char *compact);
+
+/**
+ * @brief Gets the length of the byte code the compact one unpacks to.
+ *
+ * @param compact Compact byte code.
+ * @param length Length of the compact byte code in bytes.
+ * @return size_t Returns the length in bytes, 0 if the header is damaged or of another version.
+ */
+size_t unpacked_code_length(const char *compact, size_t length);
+
+/**
+ * @brief Unpacks the compact byte code into the legacy slots.
+ *
+ * @param compact Compact byte code.
+ * @param length Length of the compact byte code in bytes.
+ * @param legacy Zeroed buffer of unpacked_code_length() bytes.
+ * @param legacy_length Size of the buffer.
+ * @return bool Returns false if the compact byte code is damaged.
+ */
+bool unpack_compact_code(const char *compact, size_t length, char *legacy, size_t legacy_length);
+
+#endif
@@ -20,6 +20,27 @@ const  char    RAM_MASK                  = (const char)(1 << 7);
 const  char    REG_MASK                  = (const char)(1 << 6);
 const  char    IMM_MASK                  = (const char)(1 << 5);
 
+/**
+ * @def SPU_REGS_AMOUNT
+ * @brief Amount of VM registers, which the assembler encodes and the backend allocates variables to.
+ *
+ * The first four registers are named rax, rbx, rcx and rdx, the rest r4, r5 and so on.
+ * As many integer registers, named i0, i1 and so on, follow them in the register IDs.
+ * Define it in the build flags to change the register file.
+ */
+#ifndef SPU_REGS_AMOUNT
+	#define SPU_REGS_AMOUNT 16
+#endif
+
+const  size_t  REGS_AMOUNT               = SPU_REGS_AMOUNT; /**< Amount of VM registers. */
+const  size_t  INT_REGS_AMOUNT           = SPU_REGS_AMOUNT; /**< Amount of integer VM registers. */
+const  size_t  FIRST_INT_REG             = REGS_AMOUNT; /**< ID of the integer register i0. */
+const  size_t  LETTER_REGS_AMOUNT        = 4; /**< Amount of registers named r?x. */
+const  size_t  REG_NAME_SIZE             = 8; /**< Buffer size enough for any register name. */
+
+static_assert(SPU_REGS_AMOUNT >= LETTER_REGS_AMOUNT && SPU_REGS_AMOUNT <= 127,
+			  "SPU_REGS_AMOUNT must be in [4, 127]");
+
 
 /**
  * @brief Prints the binary representation of a buffer.
@@ -52,4 +73,27 @@ void clear_buffer(void);
  */
 size_t max_len(const char *str_1, const char *str_2);
 
+/**
+ * @brief Parses the register name at the start of a string.
+ *
+ * @param str String starting with the register name, such as "rbx", "r12" or "i3".
+ * @param reg_ID Pointer to the register ID to fill.
+ * @return size_t Returns the length of the name, 0 if the string doesn't start with a register of the VM.
+ */
+size_t read_reg_name(const char *str, unsigned char *reg_ID);
+
+/**
+ * @brief Writes the name of a register.
+ *
+ * @param buf Buffer of at least REG_NAME_SIZE chars.
+ * @param size Size of the buffer.
+ * @param reg_ID Register ID.
+ */
+void write_reg_name(char *buf, size_t size, unsigned char reg_ID);
+
+/**
+ * @brief Checks whether the register ID is one of the integer registers.
+ */
+bool is_int_reg(size_t reg_ID);
+
 #endif
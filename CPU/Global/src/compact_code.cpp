@@ -0,0 +1,491 @@
+#include <limits.h>
+#include <string.h>
+
+#include "compact_code.h"
+#include "commands.h"
+#include "secondary.h"
+
+const size_t SLOT_SIZE      = sizeof(double); /**< Size of a legacy slot. */
+const size_t MODE_OFFSET    = sizeof(char); /**< Offset of the mode byte in the legacy slot. */
+const size_t REG_A_OFFSET   = 2 * sizeof(char); /**< Offset of the first fused register. */
+const size_t REG_B_OFFSET   = 3 * sizeof(char); /**< Offset of the second fused register. */
+const size_t INT_OFFSET     = sizeof(int); /**< Offset of the register ID, RAM address or target. */
+const size_t IMM_OFFSET     = sizeof(double); /**< Offset of the immediate in the next slot. */
+const size_t RANGE_OFFSET   = sizeof(double); /**< Offset of the draw range in the next slot. */
+const size_t VARINT_MAX     = 10; /**< Longest LEB128 encoding of a 64 bit value. */
+
+const uint64_t IMM_DOUBLE_TAG  = 1; /**< Tag of an immediate stored as the raw double. */
+const double   IMM_INT_LIMIT   = 4503599627370496.0; /**< 2^52, immediates below it may be packed as integers. */
+
+/**
+ * @enum Compact_operand
+ * @brief Operands of a compact command, in the order they are written.
+ */
+enum Compact_operand
+{
+	OP_REG_A   = 1 << 0, /**< 1 byte first fused register. */
+	OP_REG_B   = 1 << 1, /**< 1 byte second fused register. */
+	OP_INT_REG = 1 << 2, /**< 1 byte register ID in place of the int argument. */
+	OP_INT     = 1 << 3, /**< Varint RAM address or target in place of the int argument. */
+	OP_IMM     = 1 << 4, /**< Tagged varint immediate from the next slot. */
+	OP_RANGE   = 1 << 5, /**< Varint head and end of the draw range from the next slot. */
+};
+
+/**
+ * @struct Compact_op
+ * @brief Structure representing a compact opcode.
+ */
+struct Compact_op
+{
+	char     command; /**< Legacy opcode. */
+	char     mode; /**< Legacy mode byte. */
+	unsigned operands; /**< Compact_operand flags. */
+};
+
+#define FUSED_ARITHM_OPS(cmd)												\
+	{(char)cmd, 0,                              OP_REG_A | OP_REG_B},				\
+	{(char)cmd, IMM_MASK,                       OP_REG_A | OP_IMM},					\
+	{(char)cmd, REG_MASK,                       OP_REG_A | OP_REG_B | OP_INT_REG},	\
+	{(char)cmd, (char)(REG_MASK | IMM_MASK),    OP_REG_A | OP_IMM   | OP_INT_REG},
+
+#define FUSED_JUMP_OPS(cmd)													\
+	{(char)cmd, 0,        OP_REG_A | OP_REG_B | OP_INT},						\
+	{(char)cmd, IMM_MASK, OP_REG_A | OP_IMM   | OP_INT},
+
+/**
+ * @brief Compact opcodes, the index in the table is the opcode.
+ *
+ * Append new entries at the end and bump COMPACT_VERSION if an opcode changes.
+ */
+static const Compact_op COMPACT_OPS[] =
+{
+	{(char)VOID,    0,                           0},
+	{(char)HLT,     0,                           0},
+	{(char)PUSH,    IMM_MASK,                    OP_IMM},
+	{(char)PUSH,    REG_MASK,                    OP_INT_REG},
+	{(char)PUSH,    (char)(RAM_MASK | IMM_MASK), OP_INT},
+	{(char)PUSH,    (char)(RAM_MASK | REG_MASK), OP_INT_REG},
+	{(char)POP,     REG_MASK,                    OP_INT_REG},
+	{(char)POP,     (char)(RAM_MASK | IMM_MASK), OP_INT},
+	{(char)POP,     (char)(RAM_MASK | REG_MASK), OP_INT_REG},
+	{(char)ADD,     0,                           0},
+	{(char)SUB,     0,                           0},
+	{(char)MUL,     0,                           0},
+	{(char)DIV,     0,                           0},
+	{(char)OUT,     0,                           0},
+	{(char)IN,      0,                           0},
+	{(char)JMP,     0,                           OP_INT},
+	{(char)JA,      0,                           OP_INT},
+	{(char)JB,      0,                           OP_INT},
+	{(char)JAE,     0,                           OP_INT},
+	{(char)JBE,     0,                           OP_INT},
+	{(char)JE,      0,                           OP_INT},
+	{(char)JNE,     0,                           OP_INT},
+	{(char)CALL,    0,                           OP_INT},
+	{(char)RET,     0,                           0},
+	{(char)DRAW,    0,                           OP_RANGE},
+	{(char)SQRT,    0,                           0},
+	{(char)FILL,    0,                           0},
+	{(char)COPY,    0,                           0},
+	{(char)COMPARE, 0,                           0},
+	{(char)SNAP,    0,                           0},
+
+	FUSED_ARITHM_OPS(ADD_FUSED)
+	FUSED_ARITHM_OPS(SUB_FUSED)
+	FUSED_ARITHM_OPS(MUL_FUSED)
+	FUSED_ARITHM_OPS(DIV_FUSED)
+
+	FUSED_JUMP_OPS(JAE_FUSED)
+	FUSED_JUMP_OPS(JA_FUSED)
+	FUSED_JUMP_OPS(JBE_FUSED)
+	FUSED_JUMP_OPS(JB_FUSED)
+	FUSED_JUMP_OPS(JE_FUSED)
+	FUSED_JUMP_OPS(JNE_FUSED)
+
+	{(char)IADD,    0,                           0},
+	{(char)ISUB,    0,                           0},
+	{(char)IMUL,    0,                           0},
+	{(char)IJA,     0,                           OP_INT},
+	{(char)IJB,     0,                           OP_INT},
+	{(char)IJAE,    0,                           OP_INT},
+	{(char)IJBE,    0,                           OP_INT},
+	{(char)IJE,     0,                           OP_INT},
+	{(char)IJNE,    0,                           OP_INT},
+
+	FUSED_ARITHM_OPS(IADD_FUSED)
+	FUSED_ARITHM_OPS(ISUB_FUSED)
+	FUSED_ARITHM_OPS(IMUL_FUSED)
+
+	FUSED_JUMP_OPS(IJAE_FUSED)
+	FUSED_JUMP_OPS(IJA_FUSED)
+	FUSED_JUMP_OPS(IJBE_FUSED)
+	FUSED_JUMP_OPS(IJB_FUSED)
+	FUSED_JUMP_OPS(IJE_FUSED)
+	FUSED_JUMP_OPS(IJNE_FUSED)
+};
+
+#undef FUSED_JUMP_OPS
+#undef FUSED_ARITHM_OPS
+
+const size_t COMPACT_OPS_AMOUNT = sizeof(COMPACT_OPS) / sizeof(Compact_op);
+
+static_assert(sizeof(COMPACT_OPS) / sizeof(Compact_op) <= 256, "compact opcodes must fit a byte");
+
+static size_t op_slots(const Compact_op *op)
+{
+	return (op->operands & (OP_IMM | OP_RANGE)) ? 2 : 1;
+}
+
+static int find_compact_op(char command, char mode)
+{
+	for(size_t op_ID = 0; op_ID < COMPACT_OPS_AMOUNT; op_ID++)
+	{
+		if(COMPACT_OPS[op_ID].command == command && COMPACT_OPS[op_ID].mode == mode)
+		{
+			return (int)op_ID;
+		}
+	}
+
+	return -1;
+}
+
+static size_t write_varint(char *buf, uint64_t value)
+{
+	size_t length = 0;
+
+	do
+	{
+		unsigned char byte = (unsigned char)(value & 0x7f);
+		value >>= 7;
+
+		if(value != 0)
+		{
+			byte |= 0x80;
+		}
+
+		buf[length++] = (char)byte;
+	}
+	while(value != 0);
+
+	return length;
+}
+
+static bool read_varint(const char *buf, size_t length, size_t *pos, uint64_t *value)
+{
+	*value = 0;
+
+	for(size_t shift = 0; shift < 64 && *pos < length; shift += 7)
+	{
+		unsigned char byte = (unsigned char)buf[(*pos)++];
+
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+
+		if(!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static size_t write_imm(char *buf, double imm)
+{
+	if(imm > -IMM_INT_LIMIT && imm < IMM_INT_LIMIT)
+	{
+		int64_t integer = (int64_t)imm;
+		double  back    = (double)integer;
+
+		// compares the bits, so -0.0 keeps its sign
+		if(memcmp(&back, &imm, sizeof(double)) == 0)
+		{
+			uint64_t zigzag = (integer >= 0) ? (uint64_t)integer * 2
+											 : (uint64_t)(-(integer + 1)) * 2 + 1;
+
+			return write_varint(buf, zigzag << 1);
+		}
+	}
+
+	size_t length = write_varint(buf, IMM_DOUBLE_TAG);
+	memcpy(buf + length, &imm, sizeof(double));
+
+	return length + sizeof(double);
+}
+
+static bool read_imm(const char *buf, size_t length, size_t *pos, double *imm)
+{
+	uint64_t tag = 0;
+
+	if(!read_varint(buf, length, pos, &tag))
+	{
+		return false;
+	}
+
+	if(tag == IMM_DOUBLE_TAG)
+	{
+		if(length - *pos < sizeof(double))
+		{
+			return false;
+		}
+
+		memcpy(imm, buf + *pos, sizeof(double));
+		*pos += sizeof(double);
+
+		return true;
+	}
+
+	if(tag & 1)
+	{
+		return false;
+	}
+
+	uint64_t zigzag  = tag >> 1;
+	int64_t  integer = (zigzag & 1) ? -(int64_t)(zigzag >> 1) - 1 : (int64_t)(zigzag >> 1);
+
+	*imm = (double)integer;
+
+	return true;
+}
+
+static bool read_byte(const char *buf, size_t length, size_t *pos, char *byte)
+{
+	if(*pos >= length)
+	{
+		return false;
+	}
+
+	*byte = buf[(*pos)++];
+
+	return true;
+}
+
+static bool read_uint(const char *buf, size_t length, size_t *pos, char *dst)
+{
+	uint64_t value = 0;
+
+	if(!read_varint(buf, length, pos, &value) || value > UINT32_MAX)
+	{
+		return false;
+	}
+
+	unsigned int int_value = (unsigned int)value;
+	memcpy(dst, &int_value, sizeof(int));
+
+	return true;
+}
+
+bool is_compact_code(const char *byte_code, size_t length)
+{
+	if(length < sizeof(Compact_header))
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	memcpy(&magic, byte_code, sizeof(uint32_t));
+
+	return magic == COMPACT_MAGIC;
+}
+
+size_t compact_code_bound(size_t legacy_length)
+{
+	// no command takes more bytes than its slots, see COMPACT_OPS
+	return sizeof(Compact_header) + legacy_length + VARINT_MAX;
+}
+
+size_t pack_compact_code(const char *legacy, size_t legacy_length, char *compact)
+{
+	if(legacy_length % SLOT_SIZE != 0)
+	{
+		return 0;
+	}
+
+	Compact_header header = {};
+	header.magic         = COMPACT_MAGIC;
+	header.version       = COMPACT_VERSION;
+	header.legacy_length = legacy_length;
+
+	memcpy(compact, &header, sizeof(Compact_header));
+
+	size_t pos      = sizeof(Compact_header);
+	size_t carriage = 0;
+
+	while(carriage < legacy_length)
+	{
+		const char *slot = legacy + carriage;
+
+		int op_ID = find_compact_op(slot[0], slot[MODE_OFFSET]);
+		if(op_ID < 0)
+		{
+			return 0;
+		}
+
+		const Compact_op *op = &COMPACT_OPS[op_ID];
+
+		if(legacy_length - carriage < op_slots(op) * SLOT_SIZE)
+		{
+			return 0;
+		}
+
+		compact[pos++] = (char)op_ID;
+
+		unsigned int int_arg = 0;
+		memcpy(&int_arg, slot + INT_OFFSET, sizeof(int));
+
+		if(op->operands & OP_REG_A)
+		{
+			compact[pos++] = slot[REG_A_OFFSET];
+		}
+
+		if(op->operands & OP_REG_B)
+		{
+			compact[pos++] = slot[REG_B_OFFSET];
+		}
+
+		if(op->operands & OP_INT_REG)
+		{
+			if(int_arg > UCHAR_MAX)
+			{
+				return 0;
+			}
+
+			compact[pos++] = (char)int_arg;
+		}
+
+		if(op->operands & OP_INT)
+		{
+			pos += write_varint(compact + pos, int_arg);
+		}
+
+		if(op->operands & OP_IMM)
+		{
+			double imm = 0;
+			memcpy(&imm, slot + IMM_OFFSET, sizeof(double));
+
+			pos += write_imm(compact + pos, imm);
+		}
+
+		if(op->operands & OP_RANGE)
+		{
+			unsigned int head = 0;
+			unsigned int end  = 0;
+			memcpy(&head, slot + RANGE_OFFSET, sizeof(int));
+			memcpy(&end,  slot + RANGE_OFFSET + sizeof(int), sizeof(int));
+
+			pos += write_varint(compact + pos, head);
+			pos += write_varint(compact + pos, end);
+		}
+
+		carriage += op_slots(op) * SLOT_SIZE;
+	}
+
+	return pos;
+}
+
+size_t unpacked_code_length(const char *compact, size_t length)
+{
+	if(!is_compact_code(compact, length))
+	{
+		return 0;
+	}
+
+	Compact_header header = {};
+	memcpy(&header, compact, sizeof(Compact_header));
+
+	if(header.version != COMPACT_VERSION || header.legacy_length % SLOT_SIZE != 0)
+	{
+		return 0;
+	}
+
+	return (size_t)header.legacy_length;
+}
+
+bool unpack_compact_code(const char *compact, size_t length, char *legacy, size_t legacy_length)
+{
+	if(unpacked_code_length(compact, length) != legacy_length)
+	{
+		return false;
+	}
+
+	size_t pos      = sizeof(Compact_header);
+	size_t carriage = 0;
+
+	while(carriage < legacy_length)
+	{
+		char *slot  = legacy + carriage;
+		char  op_ID = 0;
+
+		if(!read_byte(compact, length, &pos, &op_ID) ||
+		   (unsigned char)op_ID >= COMPACT_OPS_AMOUNT)
+		{
+			return false;
+		}
+
+		const Compact_op *op = &COMPACT_OPS[(unsigned char)op_ID];
+
+		if(legacy_length - carriage < op_slots(op) * SLOT_SIZE)
+		{
+			return false;
+		}
+
+		slot[0]           = op->command;
+		slot[MODE_OFFSET] = op->mode;
+
+		if(op->operands & OP_REG_A)
+		{
+			if(!read_byte(compact, length, &pos, slot + REG_A_OFFSET))
+			{
+				return false;
+			}
+		}
+
+		if(op->operands & OP_REG_B)
+		{
+			if(!read_byte(compact, length, &pos, slot + REG_B_OFFSET))
+			{
+				return false;
+			}
+		}
+
+		if(op->operands & OP_INT_REG)
+		{
+			if(!read_byte(compact, length, &pos, slot + INT_OFFSET))
+			{
+				return false;
+			}
+		}
+
+		if(op->operands & OP_INT)
+		{
+			if(!read_uint(compact, length, &pos, slot + INT_OFFSET))
+			{
+				return false;
+			}
+		}
+
+		if(op->operands & OP_IMM)
+		{
+			double imm = 0;
+
+			if(!read_imm(compact, length, &pos, &imm))
+			{
+				return false;
+			}
+
+			memcpy(slot + IMM_OFFSET, &imm, sizeof(double));
+		}
+
+		if(op->operands & OP_RANGE)
+		{
+			if(!read_uint(compact, length, &pos, slot + RANGE_OFFSET) ||
+			   !read_uint(compact, length, &pos, slot + RANGE_OFFSET + sizeof(int)))
+			{
+				return false;
+			}
+		}
+
+		carriage += op_slots(op) * SLOT_SIZE;
+	}
+
+	return pos == length;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "secondary.h"
 
@@ -45,3 +46,84 @@ size_t max_len(const char *str_1, const char *str_2)
 		return size_2;
 	}
 }
+
+static size_t read_reg_number(const char *str, size_t *ID, size_t limit)
+{
+	size_t length = 1;
+
+	*ID = 0;
+
+	while(isdigit((unsigned char)str[length]) && *ID < limit)
+	{
+		*ID = *ID * 10 + (size_t)(str[length] - '0');
+		length++;
+	}
+
+	if(length == 1 || *ID >= limit || isalnum((unsigned char)str[length]))
+	{
+		return 0;
+	}
+
+	return length;
+}
+
+size_t read_reg_name(const char *str, unsigned char *reg_ID)
+{
+	size_t ID = 0;
+
+	if(str[0] == 'i')
+	{
+		size_t length = read_reg_number(str, &ID, INT_REGS_AMOUNT);
+		if(length != 0)
+		{
+			*reg_ID = (unsigned char)(FIRST_INT_REG + ID);
+		}
+
+		return length;
+	}
+
+	if(str[0] != 'r')
+	{
+		return 0;
+	}
+
+	if(str[1] >= 'a' && str[1] < 'a' + (char)LETTER_REGS_AMOUNT && str[2] == 'x' &&
+	   !isalnum((unsigned char)str[3]))
+	{
+		*reg_ID = (unsigned char)(str[1] - 'a');
+
+		return 3;
+	}
+
+	size_t length = read_reg_number(str, &ID, REGS_AMOUNT);
+
+	if(length == 0 || ID < LETTER_REGS_AMOUNT)
+	{
+		return 0;
+	}
+
+	*reg_ID = (unsigned char)ID;
+
+	return length;
+}
+
+void write_reg_name(char *buf, size_t size, unsigned char reg_ID)
+{
+	if(is_int_reg(reg_ID))
+	{
+		snprintf(buf, size, "i%lu", reg_ID - FIRST_INT_REG);
+	}
+	else if(reg_ID < LETTER_REGS_AMOUNT)
+	{
+		snprintf(buf, size, "r%cx", 'a' + reg_ID);
+	}
+	else
+	{
+		snprintf(buf, size, "r%u", reg_ID);
+	}
+}
+
+bool is_int_reg(size_t reg_ID)
+{
+	return reg_ID >= FIRST_INT_REG && reg_ID < FIRST_INT_REG + INT_REGS_AMOUNT;
+}
@@ -1,10 +1,7 @@
 #ifndef STACK_H
 #define STACK_H
 
-#define DEBUG
-#define CANARY_PROTECTION
-#define HASH_PROTECTION
-#define LOGGING
+#include "stack_config.h"
 
 #ifdef DEBUG
 	#define STACK_DUMP(stk, error_code) stack_dump(stk, #stk, error_code);
@@ -17,6 +14,10 @@
 #define STACK_CTOR(stk, starter_capacity) stack_ctor(  (stk), starter_capacity,\
 														__FILE__, __LINE__, __func__,\
 														#stk "_log");
+#else
+#define STACK_PUSH(stk, push_value) stack_push((stk), (push_value));
+#define STACK_POP(stk) stack_pop((stk))
+#define STACK_CTOR(stk, starter_capacity) stack_ctor((stk), starter_capacity);
 #endif
 
 #ifdef DEBUG
@@ -36,7 +37,6 @@
 #endif
 
 //#define ELEM_T_SPECIFIER #%d ???????????????????????????????????????????????????????
-// stack_config.h
 
 typedef double elem_t;
 
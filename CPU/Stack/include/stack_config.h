@@ -0,0 +1,25 @@
+#ifndef STACK_CONFIG_H
+#define STACK_CONFIG_H
+
+/**
+ * @file stack_config.h
+ * @brief Compile-time protection and logging policy of the stack.
+ *
+ * By default the stack is built in release mode: no invocation tracking,
+ * canaries, hashes, dumps or per-operation log. Define STACK_CHECKED here
+ * or pass -D STACK_CHECKED to every library that includes stack.h to get
+ * the checked stack back. Single features can also be enabled one by one.
+ * All translation units must agree on the policy, because it changes the
+ * layout of struct Stack.
+ */
+
+// #define STACK_CHECKED
+
+#ifdef STACK_CHECKED
+	#define DEBUG
+	#define CANARY_PROTECTION
+	#define HASH_PROTECTION
+	#define LOGGING
+#endif
+
+#endif
@@ -16,7 +16,9 @@ enum Err_ID stack_ctor( Stack *stk, size_t starter_capacity
 					#endif
 					  )
 {
-	enum Err_ID error_code = ALL_GOOD;
+	#ifdef DEBUG
+		enum Err_ID error_code = ALL_GOOD;
+	#endif
 
 	#ifdef LOGGING
 		#ifdef DEBUG
@@ -89,7 +91,7 @@ enum Err_ID stack_ctor( Stack *stk, size_t starter_capacity
 		STACK_DUMP(stk, error_code);
 	#else
 		#ifdef LOGGING
-			print_data_elems(stk, log_file);
+			print_data_elems(stk, stk->log_file);
 		#endif
 	#endif
 
@@ -117,14 +119,14 @@ enum Err_ID stack_push( Stack *stk, elem_t value
 		update_stack_invocation_position(stk, file_name, line, func_name);
 	#endif
 
-	if((error_code = stack_verifier(stk)) != ALL_GOOD)
-	{
-		#ifdef DEBUG
+	#ifdef DEBUG
+		if((error_code = stack_verifier(stk)) != ALL_GOOD)
+		{
 			STACK_DUMP(stk, error_code);
-		#endif
 
-		return error_code;
-	}
+			return error_code;
+		}
+	#endif
 
 	if(stk->size >= stk->capacity)
 	{
@@ -155,7 +157,7 @@ enum Err_ID stack_push( Stack *stk, elem_t value
 		STACK_DUMP(stk, error_code);
 	#else
 		#ifdef LOGGING
-			print_data_elems(stk, log_file);
+			print_data_elems(stk, stk->log_file);
 		#endif
 	#endif
 
@@ -183,14 +185,14 @@ struct Stack_pop_result stack_pop(  Stack *stk
 		update_stack_invocation_position(stk, file_name, line, func_name);
 	#endif
 
-	if((result.error_code = stack_verifier(stk)) != ALL_GOOD)
-	{
-		#ifdef DEBUG
+	#ifdef DEBUG
+		if((result.error_code = stack_verifier(stk)) != ALL_GOOD)
+		{
 			STACK_DUMP(stk, result.error_code);
-		#endif
 
-		return result;
-	}
+			return result;
+		}
+	#endif
 
 	if(stk->size == 0)
 	{
@@ -230,7 +232,7 @@ struct Stack_pop_result stack_pop(  Stack *stk
 		STACK_DUMP(stk, result.error_code);
 	#else
 		#ifdef LOGGING
-			print_data_elems(stk, log_file);
+			print_data_elems(stk, stk->log_file);
 		#endif
 	#endif
 
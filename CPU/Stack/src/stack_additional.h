@@ -2,8 +2,7 @@
 #define STACK_ADDITIONAL_H
 
 #include "utils.h"
-
-#define LOGGING
+#include "stack_config.h"
 
 #ifdef LOGGING
 	#define LOG_FUNC(stk) fprintf((stk)->log_file ,"\n%s LOG:\n", __func__)
@@ -11,26 +11,53 @@ struct Buffer_w_info
     size_t length; /**< Length of the buffer. */
 };
 
+/**
+ * @struct Line
+ * @brief Structure representing a line of a text, without its '\n'.
+ */
+struct Line
+{
+	size_t offset; /**< Offset of the start of the line in the text. */
+	size_t length; /**< Length of the line. */
+};
+
+/**
+ * @brief The lines of a text, which is never written, so a mapped file stays shared with the page cache.
+ *
+ * Every line is followed by its '\n' or by a '\0' after the text, and copy_line() makes a C string
+ * of it for the parsers which need one. The text is owned by the lines and released with strings_dtor().
+ */
 typedef struct
 {
-	char * *tokens;
-	size_t  amount;
+	struct Line *lines; /**< The lines in the order of the text. */
+	size_t       amount; /**< Amount of the lines. */
+	size_t       capacity; /**< Amount of the lines the index has room for. */
+	size_t       max_length; /**< Length of the longest line. */
+	struct Buffer_w_info text; /**< The text the lines are in. */
+	bool         mapped; /**< The text is a read-only mapping of the file rather than a heap buffer. */
 }Strings;
 
 /**
- * @brief Counts the number of lines in a buffer.
- * @param buf_n_len The buffer with its length.
- * @return The number of lines in the buffer.
+ * @brief Splits the text of strs into lines in one pass and appends them to its index.
+ *
+ * The newlines are found 32 bytes at a time with AVX2, 16 at a time with SSE2 or one at a time
+ * otherwise. A line starts at the text and after every newline but the last byte.
+ * The index grows by doubling.
+ *
+ * @param strs The lines with the text to split.
+ * @return false if the index could not be grown.
  */
-size_t count_file_lines(struct Buffer_w_info buf_n_len);
+bool split_lines(Strings *strs);
 
 /**
- * @brief Arranges pointers to each line in the buffer.
- * @param str_ptrs Array of pointers to each line.
- * @param buf_n_len The buffer with its length.
- * @return Returns ASM_ALL_GOOD if successful, otherwise returns an error code.
+ * @brief Copies a line into the buffer and ends it with '\0'.
+ *
+ * @param strs The lines.
+ * @param line_ID Number of the line.
+ * @param line Buffer of at least max_length + 1 bytes.
+ * @return The buffer.
  */
-void ptr_arranger    (char * *str_ptrs, struct Buffer_w_info buf_n_len);
+char *copy_line(const Strings *strs, size_t line_ID, char *line);
 
 /**
  * @brief Gets the length of a file.
@@ -45,13 +72,28 @@ size_t get_file_length(FILE *file_ptr);
 /**
  * @brief Parses a file and returns its content as an array of lines.
  *
- * This function reads the content of a file into a buffer, counts the number of lines,
- * and rearranges pointers to the start of each line in the buffer.
+ * This function reads the content of a file into a buffer and splits it with split_lines().
  *
  * @param file_ptr Pointer to the input file.
- * @return A Strings structure containing the parsed lines.
+ * @return A Strings structure containing the parsed lines, with NULL lines on an error or an empty file.
  */
 Strings file_parse(FILE *file_ptr);
 
+/**
+ * @brief Maps a file read-only and splits it into lines, without reading it into a buffer.
+ *
+ * No page of the mapping is written, so none of them is copied. A file which fills its last page
+ * and has no final newline has no '\0' after its last line, so it is read with file_parse().
+ *
+ * @param file_name Name of the input file.
+ * @return A Strings structure containing the parsed lines, with NULL lines on an error or an empty file.
+ */
+Strings map_parse(const char *file_name);
+
+/**
+ * @brief Releases the lines and the text they point into.
+ */
+void strings_dtor(Strings *strs);
+
 
 #endif
@@ -1,8 +1,31 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+/**
+ * @def FILE_PARSER_MMAP
+ * @brief Maps the files with POSIX mmap in map_parse(); otherwise they are read.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+	#define FILE_PARSER_MMAP
+
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
 #include "file_parser.h"
 
+// the index is sized for lines of this length up front, so a usual text never regrows it
+const size_t EXPECTED_LINE_LENGTH = 16;
+
 /**
  * @brief Checks if a pointer is NULL and prints an error message if it is.
  *
@@ -59,36 +82,145 @@
 		return void_strs;													\
 	}
 
-size_t count_file_lines(struct Buffer_w_info buf_n_len)
+static bool reserve_lines(Strings *strs, size_t amount)
 {
-	size_t amount_of_lines = 0;
-	for (size_t buf_ID = 0; buf_ID < buf_n_len.length; buf_ID++)
-    {
-        if(buf_n_len.buf[buf_ID] == '\n')
-        {
-            amount_of_lines++;
-        }
-    }
-
-	return amount_of_lines;
+	if(amount <= strs->capacity)
+	{
+		return true;
+	}
+
+	size_t capacity = strs->capacity == 0 ? amount : strs->capacity * 2;
+	if(capacity < amount)
+	{
+		capacity = amount;
+	}
+
+	struct Line *lines = (struct Line *)realloc(strs->lines, capacity * sizeof(struct Line));
+	if(lines == NULL)
+	{
+		return false;
+	}
+
+	strs->lines    = lines;
+	strs->capacity = capacity;
+
+	return true;
 }
 
-void ptr_arranger(char * *str_ptrs, struct Buffer_w_info buf_n_len)
+static bool add_line(Strings *strs, size_t offset, size_t length)
 {
-	str_ptrs[0] = buf_n_len.buf;
-	size_t line_ID = 1;
-    for (size_t buf_ID = 0; buf_ID < buf_n_len.length; buf_ID++)
-    {
-        if(buf_n_len.buf[buf_ID] == '\n')
-        {
-            buf_n_len.buf[buf_ID] = '\0';
-			if(buf_ID + 1 < buf_n_len.length)
-			{
-            	str_ptrs[line_ID] = &(buf_n_len.buf[buf_ID + 1]);
-            	line_ID++;
-			}
-        }
-    }
+	if(!reserve_lines(strs, strs->amount + 1))
+	{
+		return false;
+	}
+
+	strs->lines[strs->amount++] = {.offset = offset, .length = length};
+
+	if(length > strs->max_length)
+	{
+		strs->max_length = length;
+	}
+
+	return true;
+}
+
+static bool end_line(Strings *strs, size_t *line_start, size_t newline_ID)
+{
+	bool added = add_line(strs, *line_start, newline_ID - *line_start);
+
+	*line_start = newline_ID + 1;
+
+	return added;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static bool end_masked_lines(Strings *strs, size_t *line_start, size_t block_ID, unsigned mask)
+{
+	while(mask != 0)
+	{
+		if(!end_line(strs, line_start, block_ID + (size_t)__builtin_ctz(mask)))
+		{
+			return false;
+		}
+
+		mask &= mask - 1;
+	}
+
+	return true;
+}
+#endif
+
+bool split_lines(Strings *strs)
+{
+	const char *text   = strs->text.buf;
+	size_t      length = strs->text.length;
+
+	if(length == 0)
+	{
+		return true;
+	}
+
+	if(!reserve_lines(strs, strs->amount + length / EXPECTED_LINE_LENGTH + 1))
+	{
+		return false;
+	}
+
+	size_t line_start = 0;
+	size_t buf_ID     = 0;
+
+#if defined(__AVX2__)
+	const __m256i newlines = _mm256_set1_epi8('\n');
+
+	for(; buf_ID + sizeof(__m256i) <= length; buf_ID += sizeof(__m256i))
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)(text + buf_ID));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newlines));
+
+		if(!end_masked_lines(strs, &line_start, buf_ID, mask))
+		{
+			return false;
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128i newlines = _mm_set1_epi8('\n');
+
+	for(; buf_ID + sizeof(__m128i) <= length; buf_ID += sizeof(__m128i))
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)(text + buf_ID));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines));
+
+		if(!end_masked_lines(strs, &line_start, buf_ID, mask))
+		{
+			return false;
+		}
+	}
+#endif
+
+	for(; buf_ID < length; buf_ID++)
+	{
+		if(text[buf_ID] == '\n' && !end_line(strs, &line_start, buf_ID))
+		{
+			return false;
+		}
+	}
+
+	// the last line has no '\n'
+	if(line_start < length)
+	{
+		return add_line(strs, line_start, length - line_start);
+	}
+
+	return true;
+}
+
+char *copy_line(const Strings *strs, size_t line_ID, char *line)
+{
+	const struct Line *src = &(strs->lines[line_ID]);
+
+	memcpy(line, strs->text.buf + src->offset, src->length);
+	line[src->length] = '\0';
+
+	return line;
 }
 
 size_t get_file_length(FILE *file_ptr)
@@ -115,20 +247,104 @@ Strings file_parse(FILE *file_ptr)
 		return void_strs;
 	}
 
-	CALLOC(buf_w_len.buf, buf_w_len.length, char);
+	// the '\0' after the text ends the last line if it has no '\n'
+	CALLOC(buf_w_len.buf, buf_w_len.length + 1, char);
 
 	FREAD(buf_w_len.buf, sizeof(char), buf_w_len.length, file_ptr);
 
 
 	Strings strs = {};
 
-	strs.amount = count_file_lines(buf_w_len);
+	strs.text = buf_w_len;
 
-	CALLOC(strs.tokens, strs.amount, char *);
+	if(!split_lines(&strs))
+	{
+		strings_dtor(&strs);
+
+		ALLOCATION_CHECK(strs.lines);
+	}
 
-	ptr_arranger(strs.tokens,  buf_w_len);
+	return strs;
+}
+
+Strings map_parse(const char *file_name)
+{
+#ifdef FILE_PARSER_MMAP
+	int file = open(file_name, O_RDONLY);
+	if(file < 0)
+	{
+		fprintf(stderr, "Unable to open %s.\n", file_name);
+		Strings void_strs = {};
+		return void_strs;
+	}
+
+	struct stat file_stat = {};
+	if(fstat(file, &file_stat) == 0 && file_stat.st_size > 0)
+	{
+		size_t length  = (size_t)file_stat.st_size;
+		void  *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
 
+		if(mapping != MAP_FAILED)
+		{
+			char *text = (char *)mapping;
+
+			// the rest of the last page reads as zeros and ends the last line
+			if(text[length - 1] == '\n' || length % (size_t)sysconf(_SC_PAGESIZE) != 0)
+			{
+				close(file);
+
+				Strings strs = {};
+
+				strs.text.buf    = text;
+				strs.text.length = length;
+				strs.mapped      = true;
+
+				if(!split_lines(&strs))
+				{
+					strings_dtor(&strs);
+
+					ALLOCATION_CHECK(strs.lines);
+				}
+
+				return strs;
+			}
+
+			munmap(mapping, length);
+		}
+	}
+
+	close(file);
+#endif
+
+	FILE *file_ptr = fopen(file_name, "r");
+	if(file_ptr == NULL)
+	{
+		fprintf(stderr, "Unable to open %s.\n", file_name);
+		Strings void_strs = {};
+		return void_strs;
+	}
+
+	Strings strs = file_parse(file_ptr);
+
+	fclose(file_ptr);
 
 	return strs;
 }
 
+void strings_dtor(Strings *strs)
+{
+	free(strs->lines);
+
+#ifdef FILE_PARSER_MMAP
+	if(strs->mapped)
+	{
+		munmap(strs->text.buf, strs->text.length);
+	}
+	else
+#endif
+	{
+		free(strs->text.buf);
+	}
+
+	*strs = {};
+}
@@ -2,6 +2,7 @@
 #define BACKEND_H
 
 #include "assembler.h"
+#include "asm_ir.h"
 #include "SPU.h"
 #include "drivers.h"
 #include "b_tree.h"
@@ -20,8 +21,24 @@ typedef enum
 	BKD_UNKNWON_TYPE        = 1 << 5,
 	BKD_INVALID_NODE        = 1 << 6,
 	BKD_INVALID_COND_EXPR   = 1 << 7,
+	BKD_COMPILE_ERROR       = 1 << 8,
 } bkd_err_t;
 
+/**
+ * @brief Generates the program of the tree and writes name.bin and name.labels.
+ */
 bkd_err_t assembly(B_tree_node *root, const char *name);
 
+/**
+ * @brief Generates the program of the tree into ir, which is left in memory for ir_assemble().
+ *
+ * The commands are emitted, placed into the registers and rewritten by the peephole pass.
+ * name names the peephole report and the BKD_DUMP_ASM dump.
+ *
+ * @param root Root of the optimized tree.
+ * @param ir Program made by ir_ctor(), freed by the caller.
+ * @param name Name the files of the program are named after.
+ */
+bkd_err_t generate_program(B_tree_node *root, Ir_program *ir, const char *name);
+
 #endif
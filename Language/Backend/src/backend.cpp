@@ -1,20 +1,88 @@
 #include "backend_secondary.h"
+#include "backend_peephole.h"
+#include "backend_regalloc.h"
+#include "backend_types.h"
 
-bkd_err_t assembly(B_tree_node *root, const char *name)
+/**
+ * @def BKD_DUMP_ASM
+ * @brief Define it to write the assembly code of the program, which compile() accepts, for debugging.
+ */
+
+#ifdef BKD_DUMP_ASM
+static bkd_err_t dump_asm(Ir_program *ir, const char *name)
 {
-	bkd_err_t error_code = BKD_ALL_GOOD;
 	WITH_OPEN
 	(
 		name, "w", asm_file,
 
-		LOG("%s: asm_file is opened.\n", __func__);
+		ir_dump(ir, asm_file);
+	)
 
-		Nm_tbl_mngr nm_tbl_mngr = {};
+	return BKD_ALL_GOOD;
+}
+#endif
 
-		CALL(asmbl(root, asm_file, &nm_tbl_mngr));
+bkd_err_t generate_program(B_tree_node *root, Ir_program *ir, const char *name)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
 
-		WRITE_ASM("hlt\n");
-	)
+	Var_types types = {};
+	CALL(var_types_ctor(&types));
+
+	Nm_tbl_mngr nm_tbl_mngr = {};
+	nm_tbl_mngr.types = &types;
+
+	error_code = asmbl(root, ir, &nm_tbl_mngr);
+	var_types_dtor(&types);
+	CALL(error_code);
+
+	EMIT(IR_HLT, ir_no_arg());
+
+	CALL(allocate_regs(ir));
+
+#ifndef BKD_NO_PEEPHOLE
+	CALL(peephole(ir, name));
+#endif
+
+#ifdef BKD_DUMP_ASM
+	CALL(dump_asm(ir, name));
+#endif
+
+	return error_code;
+}
+
+static bkd_err_t emit_program(B_tree_node *root, Ir_program *ir, const char *name)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	CALL(generate_program(root, ir, name));
+
+	asm_err_t asm_error = ir_compile(ir, name);
+	if(asm_error != ASM_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tir_compile error: %d.\n", __func__, asm_error);
+
+		return BKD_COMPILE_ERROR;
+	}
+
+	return error_code;
+}
+
+bkd_err_t assembly(B_tree_node *root, const char *name)
+{
+	Ir_program ir = {};
+	if(ir_ctor(&ir) != ASM_ALL_GOOD)
+	{
+		ir_dtor(&ir);
+
+		return BKD_UNABLE_TO_ALLOCATE;
+	}
+
+	LOG("%s: the program is created.\n", __func__);
+
+	bkd_err_t error_code = emit_program(root, &ir, name);
+
+	ir_dtor(&ir);
 
 	return error_code;
 }
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "backend_peephole.h"
+
+#define CMD(ID)\
+	pass->ir->cmds[ID]
+
+#define REPORT(...)\
+	fprintf(pass->report, __VA_ARGS__);
+
+#define REPORT_CMD(ID)\
+	ir_print_cmd(pass->ir, &CMD(ID), pass->report);
+
+static bool is_label(const Ir_cmd *cmd)
+{
+	return cmd->op == IR_LABEL;
+}
+
+static bool is_jump(const Ir_cmd *cmd)
+{
+	return ir_is_jump(cmd->op) && cmd->op != IR_CALL;
+}
+
+static bool is_zero_imm(const Ir_arg *arg)
+{
+	return arg->type == IR_IMM_ARG && fpclassify(arg->imm) == FP_ZERO;
+}
+
+static size_t next_alive(Peephole *pass, size_t cmd_ID)
+{
+	for(size_t next_ID = cmd_ID + 1; next_ID < pass->ir->size; next_ID++)
+	{
+		if(!pass->removed[next_ID])
+		{
+			return next_ID;
+		}
+	}
+
+	return NO_CMD;
+}
+
+static size_t next_cmd(Peephole *pass, size_t cmd_ID)
+{
+	size_t next_ID = next_alive(pass, cmd_ID);
+
+	while(next_ID != NO_CMD && is_label(&CMD(next_ID)))
+	{
+		next_ID = next_alive(pass, next_ID);
+	}
+
+	return next_ID;
+}
+
+static void remove_cmd(Peephole *pass, size_t cmd_ID)
+{
+	pass->removed[cmd_ID] = true;
+}
+
+bkd_err_t peephole_ctor(Peephole *pass, Ir_program *ir)
+{
+	*pass = {};
+
+	pass->ir = ir;
+
+	// calloc(0) may give NULL, so both arrays get one spare element
+	CALLOC(pass->removed,    ir->size + 1,          bool);
+	CALLOC(pass->label_cmds, ir->labels_amount + 1, size_t);
+
+	for(size_t label_ID = 0; label_ID < ir->labels_amount; label_ID++)
+	{
+		pass->label_cmds[label_ID] = NO_CMD;
+	}
+
+	// labels are never removed, so their positions stay valid for the whole pass
+	for(size_t cmd_ID = 0; cmd_ID < ir->size; cmd_ID++)
+	{
+		if(is_label(&CMD(cmd_ID)))
+		{
+			pass->label_cmds[CMD(cmd_ID).arg.value] = cmd_ID;
+		}
+	}
+
+	return BKD_ALL_GOOD;
+}
+
+void peephole_dtor(Peephole *pass)
+{
+	free(pass->removed);
+	free(pass->label_cmds);
+
+	*pass = {};
+}
+
+static bool remove_dead_code(Peephole *pass, size_t cmd_ID)
+{
+	Ir_op op = CMD(cmd_ID).op;
+
+	if(op != IR_RET && op != IR_HLT && op != IR_JMP && op != IR_TAIL_CALL)
+	{
+		return false;
+	}
+
+	bool   changed = false;
+	size_t dead_ID = next_alive(pass, cmd_ID);
+
+	// code after the command runs only if a label leads to it
+	while(dead_ID != NO_CMD && !is_label(&CMD(dead_ID)))
+	{
+		REPORT("line %lu: removed unreachable \"", dead_ID + 1);
+		REPORT_CMD(dead_ID);
+		REPORT("\"\n");
+
+		remove_cmd(pass, dead_ID);
+		pass->stats.dead++;
+		changed = true;
+
+		dead_ID = next_alive(pass, dead_ID);
+	}
+
+	return changed;
+}
+
+static bool remove_pair(Peephole *pass, size_t cmd_ID)
+{
+	if(CMD(cmd_ID).op != IR_PUSH)
+	{
+		return false;
+	}
+
+	size_t pair_ID = next_alive(pass, cmd_ID);
+	if(pair_ID == NO_CMD || is_label(&CMD(pair_ID)))
+	{
+		return false;
+	}
+
+	const Ir_arg *push_arg = &CMD(cmd_ID).arg;
+
+	if(CMD(pair_ID).op == IR_POP && ir_same_arg(push_arg, &CMD(pair_ID).arg))
+	{
+		pass->stats.push_pop++;
+	}
+	else if((CMD(pair_ID).op == IR_ADD  || CMD(pair_ID).op == IR_SUB ||
+			 CMD(pair_ID).op == IR_IADD || CMD(pair_ID).op == IR_ISUB) && is_zero_imm(push_arg))
+	{
+		pass->stats.push_zero++;
+	}
+	else
+	{
+		return false;
+	}
+
+	REPORT("line %lu: removed \"", cmd_ID + 1);
+	REPORT_CMD(cmd_ID);
+	REPORT("\" / \"");
+	REPORT_CMD(pair_ID);
+	REPORT("\"\n");
+
+	remove_cmd(pass, cmd_ID);
+	remove_cmd(pass, pair_ID);
+
+	return true;
+}
+
+static bool remove_jump_to_next(Peephole *pass, size_t cmd_ID)
+{
+	if(CMD(cmd_ID).op != IR_JMP)
+	{
+		return false;
+	}
+
+	size_t target = CMD(cmd_ID).arg.value;
+
+	for(size_t label_ID = next_alive(pass, cmd_ID);
+		label_ID != NO_CMD && is_label(&CMD(label_ID));
+		label_ID = next_alive(pass, label_ID))
+	{
+		if(CMD(label_ID).arg.value == target)
+		{
+			REPORT("line %lu: removed \"", cmd_ID + 1);
+			REPORT_CMD(cmd_ID);
+			REPORT("\" to the next instruction\n");
+
+			remove_cmd(pass, cmd_ID);
+			pass->stats.jump_next++;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool thread_jump(Peephole *pass, size_t cmd_ID)
+{
+	if(!is_jump(&CMD(cmd_ID)))
+	{
+		return false;
+	}
+
+	size_t target = CMD(cmd_ID).arg.value;
+	size_t final  = target;
+
+	// the hops are bounded, so a jmp that leads back to itself is left alone
+	for(size_t hop = 0; hop < pass->ir->labels_amount; hop++)
+	{
+		size_t label_cmd = pass->label_cmds[final];
+		if(label_cmd == NO_CMD)
+		{
+			break;
+		}
+
+		size_t dst_ID = next_cmd(pass, label_cmd);
+		if(dst_ID == NO_CMD || CMD(dst_ID).op != IR_JMP || dst_ID == cmd_ID)
+		{
+			break;
+		}
+
+		final = CMD(dst_ID).arg.value;
+	}
+
+	if(final == target)
+	{
+		return false;
+	}
+
+	REPORT("line %lu: threaded \"", cmd_ID + 1);
+	REPORT_CMD(cmd_ID);
+
+	CMD(cmd_ID).arg.value = final;
+
+	REPORT("\" to \"");
+	REPORT_CMD(cmd_ID);
+	REPORT("\"\n");
+
+	pass->stats.threaded++;
+
+	return true;
+}
+
+bool peephole_step(Peephole *pass)
+{
+	bool changed = false;
+
+	for(size_t cmd_ID = 0; cmd_ID < pass->ir->size; cmd_ID++)
+	{
+		if(pass->removed[cmd_ID] || is_label(&CMD(cmd_ID)))
+		{
+			continue;
+		}
+
+		if(thread_jump(pass, cmd_ID))
+		{
+			changed = true;
+		}
+
+		if(remove_jump_to_next(pass, cmd_ID) || remove_pair(pass, cmd_ID))
+		{
+			changed = true;
+
+			continue;
+		}
+
+		if(remove_dead_code(pass, cmd_ID))
+		{
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+size_t compact_ir(Peephole *pass)
+{
+	size_t alive_amount = 0;
+
+	for(size_t cmd_ID = 0; cmd_ID < pass->ir->size; cmd_ID++)
+	{
+		if(!pass->removed[cmd_ID])
+		{
+			CMD(alive_amount++) = CMD(cmd_ID);
+		}
+	}
+
+	pass->ir->size = alive_amount;
+
+	return alive_amount;
+}
+
+bkd_err_t peephole(Ir_program *ir, const char *name)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	Peephole pass = {};
+
+	error_code = peephole_ctor(&pass, ir);
+	if(error_code != BKD_ALL_GOOD)
+	{
+		peephole_dtor(&pass);
+
+		return error_code;
+	}
+
+	char *report_name = create_file_name(name, "_peephole.txt");
+	if(report_name == NULL)
+	{
+		peephole_dtor(&pass);
+
+		return BKD_UNABLE_TO_ALLOCATE;
+	}
+
+	pass.report = fopen(report_name, "w");
+	free(report_name);
+
+	if(pass.report == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to open the peephole report.\n", __func__);
+		peephole_dtor(&pass);
+
+		return BKD_UNABLE_TO_OPEN_FILE;
+	}
+
+	fprintf(pass.report, "peephole report of %s\n", name);
+
+	while(peephole_step(&pass));
+
+	size_t amount       = ir->size;
+	size_t alive_amount = compact_ir(&pass);
+
+	fprintf(pass.report,
+			"%lu -> %lu lines: push 0 / op: %lu, push / pop: %lu, jumps to the next line: %lu, "
+			"threaded jumps: %lu, unreachable: %lu\n",
+			amount, alive_amount, pass.stats.push_zero, pass.stats.push_pop,
+			pass.stats.jump_next, pass.stats.threaded, pass.stats.dead);
+
+	fclose(pass.report);
+
+	LOG("%s: %lu -> %lu lines.\n", __func__, amount, alive_amount);
+
+	peephole_dtor(&pass);
+
+	return error_code;
+}
+
+#undef REPORT_CMD
+#undef REPORT
+#undef CMD
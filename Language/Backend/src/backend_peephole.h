@@ -0,0 +1,49 @@
+#ifndef BACKEND_PEEPHOLE_H
+#define BACKEND_PEEPHOLE_H
+
+#include "backend_secondary.h"
+
+/**
+ * @def BKD_NO_PEEPHOLE
+ * @brief Define it to lower the program exactly as the tree is walked.
+ */
+
+const size_t NO_CMD = (size_t)-1;
+
+struct Peephole_stats
+{
+	size_t push_zero;
+	size_t push_pop;
+	size_t jump_next;
+	size_t threaded;
+	size_t dead;
+};
+
+struct Peephole
+{
+	Ir_program     *ir;
+	bool           *removed;
+	size_t         *label_cmds;
+	Peephole_stats  stats;
+	FILE           *report;
+};
+
+/**
+ * @brief Rewrites the program in place, removing the waste the tree walk leaves:
+ * push 0 / add (and sub, iadd, isub), push X / pop X, jumps to the next instruction, jumps to jumps
+ * and the code after ret, hlt and jmp that no label leads to.
+ *
+ * Every rewrite is written to the <name>_peephole.txt report, the lines are the ones
+ * of the program dumped before the pass.
+ */
+bkd_err_t   peephole         (Ir_program *ir, const char *name);
+
+bkd_err_t   peephole_ctor    (Peephole *pass, Ir_program *ir);
+
+void        peephole_dtor    (Peephole *pass);
+
+bool        peephole_step    (Peephole *pass);
+
+size_t      compact_ir       (Peephole *pass);
+
+#endif
@@ -0,0 +1,947 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend_regalloc.h"
+
+#define CMD(ID)\
+	alloc->ir->cmds[ID]
+
+#define RANGE(ID)\
+	alloc->ranges[ID]
+
+#define LIVE_IN(ID)\
+	(alloc->live_in + ((ID) - alloc->begin) * alloc->set_size)
+
+static bool has_var(const Ir_cmd *cmd)
+{
+	return (cmd->op == IR_PUSH || cmd->op == IR_POP) && cmd->arg.type == IR_VAR_ARG;
+}
+
+static void set_bit(uint64_t *set, size_t bit)
+{
+	set[bit / SET_WORD_BITS] |= (uint64_t)1 << (bit % SET_WORD_BITS);
+}
+
+static void clear_bit(uint64_t *set, size_t bit)
+{
+	set[bit / SET_WORD_BITS] &= ~((uint64_t)1 << (bit % SET_WORD_BITS));
+}
+
+bkd_err_t reg_alloc_ctor(Reg_alloc *alloc, Ir_program *ir)
+{
+	*alloc = {};
+
+	alloc->ir = ir;
+
+	// calloc(0) may give NULL, so every array gets one spare element
+	CALLOC(alloc->label_cmds, ir->labels_amount + 1, size_t);
+	CALLOC(alloc->var_locs,   ir->vars_amount   + 1, Ir_arg);
+	CALLOC(alloc->var_ranges, ir->vars_amount   + 1, size_t);
+	CALLOC(alloc->range_vars, ir->vars_amount   + 1, size_t);
+	CALLOC(alloc->ranges,     ir->vars_amount   + 1, Live_range);
+	CALLOC(alloc->weights,    ir->size          + 1, double);
+
+	for(size_t label_ID = 0; label_ID < ir->labels_amount; label_ID++)
+	{
+		alloc->label_cmds[label_ID] = NO_POS;
+	}
+
+	for(size_t cmd_ID = 0; cmd_ID < ir->size; cmd_ID++)
+	{
+		if(CMD(cmd_ID).op == IR_LABEL)
+		{
+			alloc->label_cmds[CMD(cmd_ID).arg.value] = cmd_ID;
+		}
+	}
+
+	for(size_t var_ID = 0; var_ID < ir->vars_amount; var_ID++)
+	{
+		alloc->var_ranges[var_ID] = NO_RANGE;
+	}
+
+	return BKD_ALL_GOOD;
+}
+
+void reg_alloc_dtor(Reg_alloc *alloc)
+{
+	free(alloc->label_cmds);
+	free(alloc->var_locs);
+	free(alloc->var_ranges);
+	free(alloc->range_vars);
+	free(alloc->ranges);
+	free(alloc->calls);
+	free(alloc->frames);
+	free(alloc->saves);
+	free(alloc->weights);
+	free(alloc->live_in);
+	free(alloc->live_out);
+
+	*alloc = {};
+}
+
+static size_t jump_target(Reg_alloc *alloc, size_t cmd_ID)
+{
+	size_t target = alloc->label_cmds[CMD(cmd_ID).arg.value];
+
+	if(target < alloc->begin || target >= alloc->end)
+	{
+		return NO_POS;
+	}
+
+	return target;
+}
+
+static size_t get_succs(Reg_alloc *alloc, size_t cmd_ID, size_t *succs)
+{
+	size_t amount = 0;
+	Ir_op  op     = CMD(cmd_ID).op;
+
+	// the function a tail call goes to returns to the caller, so nothing lives after it
+	if(op == IR_RET || op == IR_HLT || op == IR_TAIL_CALL)
+	{
+		return amount;
+	}
+
+	// the callee never touches the variables of the caller
+	if(ir_is_jump(op) && op != IR_CALL)
+	{
+		size_t target = jump_target(alloc, cmd_ID);
+		if(target != NO_POS)
+		{
+			succs[amount++] = target;
+		}
+
+		if(op == IR_JMP)
+		{
+			return amount;
+		}
+	}
+
+	if(cmd_ID + 1 < alloc->end)
+	{
+		succs[amount++] = cmd_ID + 1;
+	}
+
+	return amount;
+}
+
+static void get_live_out(Reg_alloc *alloc, size_t cmd_ID)
+{
+	size_t succs[2]     = {};
+	size_t succs_amount = get_succs(alloc, cmd_ID, succs);
+
+	memset(alloc->live_out, 0, alloc->set_size * sizeof(uint64_t));
+
+	for(size_t succ_ID = 0; succ_ID < succs_amount; succ_ID++)
+	{
+		const uint64_t *live_in = LIVE_IN(succs[succ_ID]);
+
+		for(size_t word_ID = 0; word_ID < alloc->set_size; word_ID++)
+		{
+			alloc->live_out[word_ID] |= live_in[word_ID];
+		}
+	}
+}
+
+static void collect_ranges(Reg_alloc *alloc)
+{
+	for(size_t cmd_ID = alloc->begin; cmd_ID < alloc->end; cmd_ID++)
+	{
+		if(!has_var(&CMD(cmd_ID)))
+		{
+			continue;
+		}
+
+		size_t var_ID = CMD(cmd_ID).arg.value;
+		if(alloc->var_ranges[var_ID] != NO_RANGE)
+		{
+			continue;
+		}
+
+		Live_range *range = &RANGE(alloc->ranges_amount);
+
+		*range = {};
+		range->var_ID   = var_ID;
+		range->start    = NO_POS;
+		range->hint_reg = NO_REG;
+		range->hint_var = NO_VAR;
+
+		alloc->range_vars[alloc->ranges_amount] = var_ID;
+		alloc->var_ranges[var_ID]               = alloc->ranges_amount++;
+	}
+}
+
+static bkd_err_t weigh_loops(Reg_alloc *alloc)
+{
+	long *depth_diffs = NULL;
+	CALLOC(depth_diffs, alloc->end - alloc->begin + 1, long);
+
+	// every loop ends with the jump back to its start
+	for(size_t cmd_ID = alloc->begin; cmd_ID < alloc->end; cmd_ID++)
+	{
+		if(!ir_is_jump(CMD(cmd_ID).op) || CMD(cmd_ID).op == IR_CALL)
+		{
+			continue;
+		}
+
+		size_t target = jump_target(alloc, cmd_ID);
+		if(target != NO_POS && target <= cmd_ID)
+		{
+			depth_diffs[target - alloc->begin]++;
+			depth_diffs[cmd_ID + 1 - alloc->begin]--;
+		}
+	}
+
+	long depth = 0;
+
+	for(size_t cmd_ID = alloc->begin; cmd_ID < alloc->end; cmd_ID++)
+	{
+		depth += depth_diffs[cmd_ID - alloc->begin];
+
+		double weight = 1;
+		for(long loop_ID = 0; loop_ID < depth; loop_ID++)
+		{
+			weight *= LOOP_WEIGHT;
+		}
+
+		alloc->weights[cmd_ID] = weight;
+	}
+
+	free(depth_diffs);
+
+	return BKD_ALL_GOOD;
+}
+
+bkd_err_t solve_liveness(Reg_alloc *alloc)
+{
+	alloc->set_size = alloc->ranges_amount / SET_WORD_BITS + 1;
+
+	free(alloc->live_in);
+	free(alloc->live_out);
+	alloc->live_in  = NULL;
+	alloc->live_out = NULL;
+
+	CALLOC(alloc->live_in,  (alloc->end - alloc->begin) * alloc->set_size, uint64_t);
+	CALLOC(alloc->live_out, alloc->set_size,                               uint64_t);
+
+	bool changed = true;
+
+	// the commands are walked backwards, so a pass without loops settles everything
+	while(changed)
+	{
+		changed = false;
+
+		for(size_t cmd_ID = alloc->end; cmd_ID-- > alloc->begin;)
+		{
+			get_live_out(alloc, cmd_ID);
+
+			if(has_var(&CMD(cmd_ID)))
+			{
+				size_t range_ID = alloc->var_ranges[CMD(cmd_ID).arg.value];
+
+				if(CMD(cmd_ID).op == IR_POP)
+				{
+					clear_bit(alloc->live_out, range_ID);
+				}
+				else
+				{
+					set_bit(alloc->live_out, range_ID);
+				}
+			}
+
+			if(memcmp(LIVE_IN(cmd_ID), alloc->live_out, alloc->set_size * sizeof(uint64_t)))
+			{
+				memcpy(LIVE_IN(cmd_ID), alloc->live_out, alloc->set_size * sizeof(uint64_t));
+				changed = true;
+			}
+		}
+	}
+
+	return BKD_ALL_GOOD;
+}
+
+static void extend_range(Live_range *range, size_t cmd_ID)
+{
+	if(range->start == NO_POS || range->start > cmd_ID)
+	{
+		range->start = cmd_ID;
+	}
+
+	if(range->end < cmd_ID)
+	{
+		range->end = cmd_ID;
+	}
+}
+
+static size_t find_copy(Reg_alloc *alloc, size_t cmd_ID)
+{
+	size_t depth = 0;
+
+	// the value a pop takes was pushed before it, the one a push gives is popped after it
+	if(CMD(cmd_ID).op == IR_POP)
+	{
+		for(size_t pair_ID = cmd_ID; pair_ID-- > alloc->begin;)
+		{
+			if(CMD(pair_ID).op == IR_POP)
+			{
+				depth++;
+			}
+			else if(CMD(pair_ID).op != IR_PUSH)
+			{
+				break;
+			}
+			else if(depth == 0)
+			{
+				return pair_ID;
+			}
+			else
+			{
+				depth--;
+			}
+		}
+	}
+	else
+	{
+		for(size_t pair_ID = cmd_ID + 1; pair_ID < alloc->end; pair_ID++)
+		{
+			if(CMD(pair_ID).op == IR_PUSH)
+			{
+				depth++;
+			}
+			else if(CMD(pair_ID).op != IR_POP)
+			{
+				break;
+			}
+			else if(depth == 0)
+			{
+				return pair_ID;
+			}
+			else
+			{
+				depth--;
+			}
+		}
+	}
+
+	return NO_POS;
+}
+
+static void add_hint(Reg_alloc *alloc, Live_range *range, size_t cmd_ID)
+{
+	if(range->hint_reg != NO_REG || range->hint_var != NO_VAR)
+	{
+		return;
+	}
+
+	size_t pair_ID = find_copy(alloc, cmd_ID);
+	if(pair_ID == NO_POS)
+	{
+		return;
+	}
+
+	const Ir_arg *pair_arg = &CMD(pair_ID).arg;
+
+	if(pair_arg->type == IR_REG_ARG)
+	{
+		range->hint_reg = pair_arg->value;
+	}
+	else if(pair_arg->type == IR_VAR_ARG && pair_arg->value != range->var_ID)
+	{
+		range->hint_var = pair_arg->value;
+	}
+}
+
+static void build_ranges(Reg_alloc *alloc)
+{
+	for(size_t cmd_ID = alloc->begin; cmd_ID < alloc->end; cmd_ID++)
+	{
+		get_live_out(alloc, cmd_ID);
+
+		const uint64_t *live_in = LIVE_IN(cmd_ID);
+
+		for(size_t word_ID = 0; word_ID < alloc->set_size; word_ID++)
+		{
+			uint64_t live = live_in[word_ID] | alloc->live_out[word_ID];
+			uint64_t after_call = CMD(cmd_ID).op == IR_CALL ? alloc->live_out[word_ID] : 0;
+
+			for(size_t bit = 0; live != 0; bit++, live >>= 1, after_call >>= 1)
+			{
+				if(live & 1)
+				{
+					extend_range(&RANGE(word_ID * SET_WORD_BITS + bit), cmd_ID);
+				}
+
+				if(after_call & 1)
+				{
+					RANGE(word_ID * SET_WORD_BITS + bit).call_weight += alloc->weights[cmd_ID];
+				}
+			}
+		}
+
+		if(has_var(&CMD(cmd_ID)))
+		{
+			Live_range *range = &RANGE(alloc->var_ranges[CMD(cmd_ID).arg.value]);
+
+			extend_range(range, cmd_ID);
+			range->spill_cost += alloc->weights[cmd_ID];
+
+			add_hint(alloc, range, cmd_ID);
+		}
+	}
+}
+
+static int compare_starts(const void *first, const void *second)
+{
+	const Live_range *first_range  = (const Live_range *)first;
+	const Live_range *second_range = (const Live_range *)second;
+
+	if(first_range->start != second_range->start)
+	{
+		return first_range->start < second_range->start ? -1 : 1;
+	}
+
+	return first_range->var_ID < second_range->var_ID ? -1 : 1;
+}
+
+static bool is_int_range(Reg_alloc *alloc, const Live_range *range)
+{
+	return alloc->ir->var_types[range->var_ID] == IR_INT_VAR;
+}
+
+// a variable only goes to a register of its own bank
+static bool is_free(const size_t *owners, size_t reg_ID, bool is_int)
+{
+	return reg_ID < ALL_REGS_AMOUNT && reg_ID != RET_REG && reg_ID != ADDR_REG &&
+		   is_int_reg(reg_ID) == is_int && owners[reg_ID] == NO_RANGE;
+}
+
+static bool is_callee_saved(size_t reg_ID)
+{
+	return reg_ID >= (is_int_reg(reg_ID) ? FIRST_CALLEE_SAVED_INT : FIRST_CALLEE_SAVED);
+}
+
+static size_t pick_reg(Reg_alloc *alloc, const size_t *owners, const Live_range *range)
+{
+	size_t hints[2] = {range->hint_reg, NO_REG};
+
+	if(range->hint_var != NO_VAR && alloc->var_locs[range->hint_var].type == IR_REG_ARG)
+	{
+		hints[1] = alloc->var_locs[range->hint_var].value;
+	}
+
+	// a range across calls costs nothing in a callee-saved register, the others leave them free
+	bool crosses_calls = range->call_weight > 0;
+	bool is_int        = is_int_range(alloc, range);
+
+	for(size_t pass = 0; pass < 2; pass++)
+	{
+		bool callee_saved = crosses_calls == (pass == 0);
+
+		for(size_t hint_ID = 0; hint_ID < 2; hint_ID++)
+		{
+			if(is_free(owners, hints[hint_ID], is_int) && is_callee_saved(hints[hint_ID]) == callee_saved)
+			{
+				return hints[hint_ID];
+			}
+		}
+
+		for(size_t reg_ID = 0; reg_ID < ALL_REGS_AMOUNT; reg_ID++)
+		{
+			if(is_free(owners, reg_ID, is_int) && is_callee_saved(reg_ID) == callee_saved)
+			{
+				return reg_ID;
+			}
+		}
+	}
+
+	return NO_REG;
+}
+
+static size_t pick_victim(Reg_alloc *alloc, const size_t *owners, const Live_range *range)
+{
+	size_t victim    = NO_REG;
+	double least_cost = range->spill_cost;
+	bool   is_int     = is_int_range(alloc, range);
+
+	for(size_t reg_ID = 0; reg_ID < ALL_REGS_AMOUNT; reg_ID++)
+	{
+		if(owners[reg_ID] != NO_RANGE && is_int_reg(reg_ID) == is_int &&
+		   RANGE(owners[reg_ID]).spill_cost < least_cost)
+		{
+			victim     = reg_ID;
+			least_cost = RANGE(owners[reg_ID]).spill_cost;
+		}
+	}
+
+	return victim;
+}
+
+static bkd_err_t spill_ranges(Reg_alloc *alloc)
+{
+	size_t *cell_ends = NULL;
+	CALLOC(cell_ends, alloc->ranges_amount, size_t);
+
+	// the spilled ranges, which are sorted by the start, share the cells greedily
+	size_t cells_amount = 0;
+
+	for(size_t range_ID = 0; range_ID < alloc->ranges_amount; range_ID++)
+	{
+		Live_range *range = &RANGE(range_ID);
+		if(!range->spilled)
+		{
+			alloc->stats.in_regs++;
+
+			continue;
+		}
+
+		size_t cell_ID = 0;
+		while(cell_ID < cells_amount && cell_ends[cell_ID] >= range->start)
+		{
+			cell_ID++;
+		}
+
+		if(cell_ID == cells_amount)
+		{
+			cells_amount++;
+		}
+
+		cell_ends[cell_ID] = range->end;
+		alloc->var_locs[range->var_ID] = ir_ram_arg(cell_ID);
+
+		alloc->stats.spilled++;
+	}
+
+	if(cells_amount > alloc->stats.RAM_cells)
+	{
+		alloc->stats.RAM_cells = cells_amount;
+	}
+
+	free(cell_ends);
+
+	return BKD_ALL_GOOD;
+}
+
+bkd_err_t scan_ranges(Reg_alloc *alloc)
+{
+	qsort(alloc->ranges, alloc->ranges_amount, sizeof(Live_range), compare_starts);
+
+	size_t owners[ALL_REGS_AMOUNT] = {};
+	for(size_t reg_ID = 0; reg_ID < ALL_REGS_AMOUNT; reg_ID++)
+	{
+		owners[reg_ID] = NO_RANGE;
+	}
+
+	for(size_t range_ID = 0; range_ID < alloc->ranges_amount; range_ID++)
+	{
+		Live_range *range = &RANGE(range_ID);
+
+		for(size_t reg_ID = 0; reg_ID < ALL_REGS_AMOUNT; reg_ID++)
+		{
+			if(owners[reg_ID] != NO_RANGE && RANGE(owners[reg_ID]).end < range->start)
+			{
+				owners[reg_ID] = NO_RANGE;
+			}
+		}
+
+		size_t reg_ID = pick_reg(alloc, owners, range);
+
+		if(reg_ID == NO_REG)
+		{
+			reg_ID = pick_victim(alloc, owners, range);
+
+			if(reg_ID == NO_REG)
+			{
+				range->spilled = true;
+
+				continue;
+			}
+
+			RANGE(owners[reg_ID]).spilled = true;
+		}
+
+		owners[reg_ID] = range_ID;
+		alloc->var_locs[range->var_ID] = ir_reg_arg((unsigned char)reg_ID);
+	}
+
+	return spill_ranges(alloc);
+}
+
+#define GROW(array, amount, capacity, type)							\
+	if(amount >= capacity)												\
+	{																	\
+		capacity = (amount + 1) * REALLOC_COEFF;						\
+		REALLOC(array, capacity, type);									\
+	}
+
+bkd_err_t add_save(Reg_alloc *alloc, Ir_arg loc)
+{
+	GROW(alloc->saves, alloc->saves_amount, alloc->saves_capacity, Ir_arg);
+
+	alloc->saves[alloc->saves_amount++] = loc;
+
+	return BKD_ALL_GOOD;
+}
+
+static bkd_err_t pair_calls(Reg_alloc *alloc)
+{
+	size_t *starts        = NULL;
+	size_t  starts_amount = 0;
+	CALLOC(starts, alloc->end - alloc->begin + 1, size_t);
+
+	// the call sequences nest, as the arguments may call too
+	for(size_t cmd_ID = alloc->begin; cmd_ID < alloc->end; cmd_ID++)
+	{
+		if(CMD(cmd_ID).op == IR_CALL_START)
+		{
+			starts[starts_amount++] = cmd_ID;
+		}
+		else if(CMD(cmd_ID).op == IR_CALL && starts_amount != 0)
+		{
+			GROW(alloc->calls, alloc->calls_amount, alloc->calls_capacity, Call_site);
+
+			Call_site *site = &alloc->calls[alloc->calls_amount++];
+
+			*site = {};
+			site->start = starts[--starts_amount];
+			site->call  = cmd_ID;
+		}
+	}
+
+	free(starts);
+
+	return BKD_ALL_GOOD;
+}
+
+static bool is_caller_saved(const Ir_arg *loc)
+{
+	return loc->type == IR_RAM_IMM_ARG || (loc->type == IR_REG_ARG && !is_callee_saved(loc->value));
+}
+
+bkd_err_t record_saves(Reg_alloc *alloc, size_t first_call)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	for(size_t call_ID = first_call; call_ID < alloc->calls_amount; call_ID++)
+	{
+		Call_site *site = &alloc->calls[call_ID];
+
+		site->first_save = alloc->saves_amount;
+
+		get_live_out(alloc, site->call);
+
+		for(size_t range_ID = 0; range_ID < alloc->ranges_amount; range_ID++)
+		{
+			Ir_arg loc = alloc->var_locs[alloc->range_vars[range_ID]];
+
+			if(((alloc->live_out[range_ID / SET_WORD_BITS] >> (range_ID % SET_WORD_BITS)) & 1) &&
+			   is_caller_saved(&loc))
+			{
+				CALL(add_save(alloc, loc));
+			}
+		}
+
+		site->saves_amount       = alloc->saves_amount - site->first_save;
+		alloc->stats.call_saves += site->saves_amount;
+	}
+
+	if(!alloc->is_func)
+	{
+		return error_code;
+	}
+
+	GROW(alloc->frames, alloc->frames_amount, alloc->frames_capacity, Func_frame);
+
+	Func_frame *frame = &alloc->frames[alloc->frames_amount++];
+
+	*frame = {};
+	frame->entry      = alloc->begin;
+	frame->end        = alloc->end;
+	frame->first_save = alloc->saves_amount;
+
+	for(size_t cmd_ID = alloc->begin; cmd_ID < alloc->end; cmd_ID++)
+	{
+		if(CMD(cmd_ID).op == IR_RET || CMD(cmd_ID).op == IR_TAIL_CALL)
+		{
+			frame->rets_amount++;
+		}
+	}
+
+	for(size_t reg_ID = FIRST_CALLEE_SAVED; reg_ID < ALL_REGS_AMOUNT; reg_ID++)
+	{
+		if(!is_callee_saved(reg_ID))
+		{
+			continue;
+		}
+
+		for(size_t range_ID = 0; range_ID < alloc->ranges_amount; range_ID++)
+		{
+			Ir_arg loc = alloc->var_locs[alloc->range_vars[range_ID]];
+
+			if(loc.type == IR_REG_ARG && loc.value == reg_ID)
+			{
+				CALL(add_save(alloc, loc));
+
+				break;
+			}
+		}
+	}
+
+	frame->saves_amount        = alloc->saves_amount - frame->first_save;
+	alloc->stats.callee_saves += frame->saves_amount;
+
+	return error_code;
+}
+
+bkd_err_t allocate_func(Reg_alloc *alloc, size_t begin, size_t end)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	alloc->begin         = begin;
+	alloc->end           = end;
+	alloc->ranges_amount = 0;
+
+	size_t first_call = alloc->calls_amount;
+
+	CALL(pair_calls(alloc));
+
+	collect_ranges(alloc);
+
+	if(alloc->ranges_amount == 0)
+	{
+		return error_code;
+	}
+
+	CALL(weigh_loops(alloc));
+	CALL(solve_liveness(alloc));
+
+	build_ranges(alloc);
+
+	for(size_t range_ID = 0; range_ID < alloc->ranges_amount; range_ID++)
+	{
+		alloc->var_ranges[RANGE(range_ID).var_ID] = NO_RANGE;
+	}
+
+	alloc->stats.vars += alloc->ranges_amount;
+
+	CALL(scan_ranges(alloc));
+	CALL(record_saves(alloc, first_call));
+
+	return error_code;
+}
+
+#define PUT(cmd)\
+	cmds[size++] = cmd;
+
+static Ir_cmd stack_cmd(Ir_op op, Ir_arg arg)
+{
+	Ir_cmd cmd = {};
+
+	cmd.op  = op;
+	cmd.arg = arg;
+
+	return cmd;
+}
+
+static void put_saves(Ir_cmd *cmds, size_t *size, const Ir_arg *saves, size_t amount, Ir_op op)
+{
+	for(size_t save_ID = 0; save_ID < amount; save_ID++)
+	{
+		// the pops go in the reverse order of the pushes
+		size_t loc_ID = op == IR_PUSH ? save_ID : amount - 1 - save_ID;
+
+		cmds[(*size)++] = stack_cmd(op, saves[loc_ID]);
+	}
+}
+
+bkd_err_t rewrite_program(Reg_alloc *alloc)
+{
+	size_t *site_of_cmd = NULL;
+	CALLOC(site_of_cmd, alloc->ir->size + 1, size_t);
+
+	for(size_t cmd_ID = 0; cmd_ID < alloc->ir->size; cmd_ID++)
+	{
+		site_of_cmd[cmd_ID] = NO_POS;
+	}
+
+	size_t capacity = alloc->ir->size + 1;
+
+	for(size_t call_ID = 0; call_ID < alloc->calls_amount; call_ID++)
+	{
+		site_of_cmd[alloc->calls[call_ID].start] = call_ID;
+		site_of_cmd[alloc->calls[call_ID].call]  = call_ID;
+
+		capacity += alloc->calls[call_ID].saves_amount * 2;
+	}
+
+	for(size_t frame_ID = 0; frame_ID < alloc->frames_amount; frame_ID++)
+	{
+		capacity += alloc->frames[frame_ID].saves_amount * (alloc->frames[frame_ID].rets_amount + 1);
+	}
+
+	Ir_cmd *cmds = (Ir_cmd *)calloc(capacity, sizeof(Ir_cmd));
+	if(cmds == NULL)
+	{
+		free(site_of_cmd);
+
+		LOG("%s: ERROR:\n\tUnable to allocate the commands.\n", __func__);
+
+		return BKD_UNABLE_TO_ALLOCATE;
+	}
+
+	size_t size     = 0;
+	size_t frame_ID = 0;
+
+	for(size_t cmd_ID = 0; cmd_ID < alloc->ir->size; cmd_ID++)
+	{
+		Ir_cmd cmd = CMD(cmd_ID);
+
+		while(frame_ID < alloc->frames_amount && cmd_ID >= alloc->frames[frame_ID].end)
+		{
+			frame_ID++;
+		}
+
+		const Func_frame *frame = frame_ID < alloc->frames_amount &&
+								  cmd_ID >= alloc->frames[frame_ID].entry ?
+								  &alloc->frames[frame_ID] : NULL;
+
+		const Call_site *site = site_of_cmd[cmd_ID] == NO_POS ? NULL :
+								&alloc->calls[site_of_cmd[cmd_ID]];
+
+		if(cmd.arg.type == IR_VAR_ARG)
+		{
+			cmd.arg = alloc->var_locs[cmd.arg.value];
+
+			if(cmd.arg.type == IR_NO_ARG)
+			{
+				LOG("%s: ERROR:\n\tVariable %lu has no location.\n", __func__, CMD(cmd_ID).arg.value);
+
+				free(site_of_cmd);
+				free(cmds);
+
+				return BKD_UNKNOWN_VAR;
+			}
+		}
+
+		if(cmd.op == IR_CALL_START)
+		{
+			if(site != NULL)
+			{
+				put_saves(cmds, &size, alloc->saves + site->first_save, site->saves_amount, IR_PUSH);
+			}
+
+			continue;
+		}
+
+		if((cmd.op == IR_RET || cmd.op == IR_TAIL_CALL) && frame != NULL)
+		{
+			put_saves(cmds, &size, alloc->saves + frame->first_save, frame->saves_amount, IR_POP);
+		}
+
+		PUT(cmd);
+
+		if(cmd.op == IR_CALL && site != NULL)
+		{
+			put_saves(cmds, &size, alloc->saves + site->first_save, site->saves_amount, IR_POP);
+		}
+
+		if(frame != NULL && cmd_ID == frame->entry)
+		{
+			put_saves(cmds, &size, alloc->saves + frame->first_save, frame->saves_amount, IR_PUSH);
+		}
+	}
+
+	free(site_of_cmd);
+	free(alloc->ir->cmds);
+
+	alloc->ir->cmds     = cmds;
+	alloc->ir->size     = size;
+	alloc->ir->capacity = capacity;
+
+	return BKD_ALL_GOOD;
+}
+
+#undef PUT
+#undef GROW
+
+static bkd_err_t allocate_funcs(Reg_alloc *alloc)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	bool *is_entry = NULL;
+	bool *is_func  = NULL;
+	CALLOC(is_entry, alloc->ir->size + 1, bool);
+	CALLOC(is_func,  alloc->ir->size + 1, bool);
+
+	for(size_t cmd_ID = 0; cmd_ID < alloc->ir->size; cmd_ID++)
+	{
+		if(CMD(cmd_ID).op == IR_CALL || CMD(cmd_ID).op == IR_TAIL_CALL)
+		{
+			size_t entry = alloc->label_cmds[CMD(cmd_ID).arg.value];
+			if(entry != NO_POS)
+			{
+				is_entry[entry] = true;
+				is_func[entry]  = true;
+			}
+		}
+	}
+
+	size_t main_label = ir_find_label(alloc->ir, MAIN_LABEL);
+	if(main_label != IR_NO_LABEL && alloc->label_cmds[main_label] != NO_POS)
+	{
+		is_entry[alloc->label_cmds[main_label]] = true;
+	}
+
+	// no code but a call leads into a function, so each one is allocated apart
+	size_t begin = 0;
+
+	for(size_t cmd_ID = 1; cmd_ID <= alloc->ir->size && error_code == BKD_ALL_GOOD; cmd_ID++)
+	{
+		if(cmd_ID == alloc->ir->size || is_entry[cmd_ID])
+		{
+			alloc->is_func = is_func[begin];
+
+			error_code = allocate_func(alloc, begin, cmd_ID);
+			begin      = cmd_ID;
+		}
+	}
+
+	free(is_entry);
+	free(is_func);
+
+	return error_code;
+}
+
+bkd_err_t allocate_regs(Ir_program *ir)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	Reg_alloc alloc = {};
+
+	error_code = reg_alloc_ctor(&alloc, ir);
+	if(error_code == BKD_ALL_GOOD)
+	{
+		error_code = allocate_funcs(&alloc);
+	}
+
+	if(error_code == BKD_ALL_GOOD)
+	{
+		error_code = rewrite_program(&alloc);
+	}
+
+	if(error_code == BKD_ALL_GOOD)
+	{
+		LOG("%s: %lu variables: %lu in registers, %lu in %lu RAM cells, "
+			"%lu saves at %lu calls, %lu callee-saved registers.\n", __func__,
+			alloc.stats.vars, alloc.stats.in_regs, alloc.stats.spilled, alloc.stats.RAM_cells,
+			alloc.stats.call_saves, alloc.calls_amount, alloc.stats.callee_saves);
+	}
+
+	reg_alloc_dtor(&alloc);
+
+	return error_code;
+}
+
+#undef LIVE_IN
+#undef RANGE
+#undef CMD
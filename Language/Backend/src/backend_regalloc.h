@@ -0,0 +1,123 @@
+#ifndef BACKEND_REGALLOC_H
+#define BACKEND_REGALLOC_H
+
+#include <stdint.h>
+
+#include "backend_secondary.h"
+
+const size_t NO_RANGE      = (size_t)-1;
+const size_t NO_VAR        = (size_t)-1;
+const size_t NO_REG        = (size_t)-1;
+const size_t NO_POS        = (size_t)-1;
+const size_t SET_WORD_BITS = 64;
+const double LOOP_WEIGHT   = 10;
+
+const char   MAIN_LABEL[]  = "main";
+
+struct Live_range
+{
+	size_t  var_ID;
+	size_t  start;
+	size_t  end;
+	double  spill_cost;
+	double  call_weight;
+	size_t  hint_reg;
+	size_t  hint_var;
+	bool    spilled;
+};
+
+struct Call_site
+{
+	size_t start;
+	size_t call;
+	size_t first_save;
+	size_t saves_amount;
+};
+
+struct Func_frame
+{
+	size_t entry;
+	size_t end;
+	size_t first_save;
+	size_t saves_amount;
+	size_t rets_amount;
+};
+
+struct Reg_alloc_stats
+{
+	size_t vars;
+	size_t in_regs;
+	size_t spilled;
+	size_t RAM_cells;
+	size_t call_saves;
+	size_t callee_saves;
+};
+
+struct Reg_alloc
+{
+	Ir_program      *ir;
+	size_t          *label_cmds;
+	Ir_arg          *var_locs;
+	size_t          *var_ranges;
+	size_t          *range_vars;
+	Live_range      *ranges;
+	size_t           ranges_amount;
+	double          *weights;
+	uint64_t        *live_in;
+	uint64_t        *live_out;
+	size_t           set_size;
+	size_t           begin;
+	size_t           end;
+	bool             is_func;
+	Call_site       *calls;
+	size_t           calls_amount;
+	size_t           calls_capacity;
+	Func_frame      *frames;
+	size_t           frames_amount;
+	size_t           frames_capacity;
+	Ir_arg          *saves;
+	size_t           saves_amount;
+	size_t           saves_capacity;
+	Reg_alloc_stats  stats;
+};
+
+/**
+ * @brief Places the variables of the program into registers and RAM cells and lowers the calls.
+ *
+ * Every function, which starts at a label some call goes to, and main are allocated on their own:
+ * the liveness of the variables is solved over the jumps, then the live ranges
+ * are scanned in the start order. A range gets a free register, the register of the
+ * variable it is copied from or to if that one is free; if none is free, the range
+ * with the least spill cost goes to RAM. Each push and pop of a variable costs
+ * LOOP_WEIGHT to the power of the amount of loops around it, the loops being the
+ * jumps back, which only the while loops make. rax is never given out, it holds the
+ * return values, neither is i0, it holds the address of readram.
+ *
+ * The integer variables take the integer registers and the others take the floating point ones,
+ * a range only spills a range of its own bank. Both banks spill to the same RAM cells, the
+ * integers going through the stack as doubles.
+ *
+ * A range that lives across a call prefers the callee-saved registers, the others prefer
+ * the caller-saved ones. At every call_start the values in the caller-saved registers and RAM
+ * that live after the call are pushed, and they are popped right after it. A function pushes
+ * the callee-saved registers it writes at its label and pops them before every ret and tail call.
+ */
+bkd_err_t   allocate_regs     (Ir_program *ir);
+
+bkd_err_t   reg_alloc_ctor    (Reg_alloc *alloc, Ir_program *ir);
+
+void        reg_alloc_dtor    (Reg_alloc *alloc);
+
+bkd_err_t   allocate_func     (Reg_alloc *alloc, size_t begin, size_t end);
+
+bkd_err_t   solve_liveness    (Reg_alloc *alloc);
+
+bkd_err_t   scan_ranges       (Reg_alloc *alloc);
+
+bkd_err_t   add_save          (Reg_alloc *alloc, Ir_arg loc);
+
+bkd_err_t   record_saves      (Reg_alloc *alloc, size_t first_call);
+
+bkd_err_t   rewrite_program   (Reg_alloc *alloc);
+
+#endif
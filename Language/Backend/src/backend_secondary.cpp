@@ -1,66 +1,65 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <wchar.h>
 
 #include "backend_secondary.h"
+#include "backend_types.h"
 
 #define CUR_LVL\
 	nm_tbl_mngr->cur_lvl
 
-#define CUR_TABLE\
-	nm_tbl_mngr->name_tables[CUR_LVL]
-
+// the header's check, logged: an error of a nested write goes up to generate_program
+#undef CHECK_ERROR
 #define CHECK_ERROR										\
 	if(error_code != BKD_ALL_GOOD)						\
 	{													\
 		LOG("%s: ERROR: %d\n", __func__, error_code);	\
-		return BKD_ALL_GOOD;							\
+		return error_code;								\
 	}
 
 #define IS_FUNC(kwd)\
 	!strncmp(node->value.var_value, kwd, MAX_TOKEN_SIZE)
 
-static size_t label_ct = 0;
+static bool is_chain(Node_type type)
+{
+	return type == SEMICOLON || type == SCOPE_START || type == SCOPE_END;
+}
 
-bkd_err_t asmbl(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+static bkd_err_t asmbl_node(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	if(node == NULL)
-	{
-		return error_code;
-	}
+	// the integer values set it after their operands, so it tells of the last value pushed
+	nm_tbl_mngr->pushed_int = false;
 
 	switch(node->type)
 	{
 		case SCOPE_START:
 		{
 			CALL(upgrade_n_table(nm_tbl_mngr));
-			goto asmbl_children;
+
+			break;
 		}
 		case SCOPE_END:
 		{
 			CALL(downgrade_n_table(nm_tbl_mngr));
-			goto asmbl_children;
+
+			break;
 		}
 		case SEMICOLON:
 		{
-			asmbl_children:
-
-			ASMBL(node->left);
-			ASMBL(node->right);
-
 			break;
 		}
 		case WHILE:
 		{
-			CALL(write_while(node, asm_file, nm_tbl_mngr));
+			CALL(write_while(node, ir, nm_tbl_mngr));
 
 			break;
 		}
 		case IF:
 		{
-			CALL(write_if(node, asm_file, nm_tbl_mngr));
+			CALL(write_if(node, ir, nm_tbl_mngr));
 
 			break;
 		}
@@ -70,12 +69,32 @@ bkd_err_t asmbl(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 			{
 				case GETVAR:
 				{
-					write_getvar(node, asm_file, nm_tbl_mngr);
+					CALL(write_getvar(node, ir, nm_tbl_mngr));
 					break;
 				}
 				case PUTEXPR:
 				{
-					write_putexpr(node, asm_file, nm_tbl_mngr);
+					CALL(write_putexpr(node, ir, nm_tbl_mngr));
+					break;
+				}
+				case FILLRAM:
+				{
+					CALL(write_ram_block(node, ir, nm_tbl_mngr, IR_FILL));
+					break;
+				}
+				case COPYRAM:
+				{
+					CALL(write_ram_block(node, ir, nm_tbl_mngr, IR_COPY));
+					break;
+				}
+				case CMPRAM:
+				{
+					CALL(write_ram_block(node, ir, nm_tbl_mngr, IR_COMPARE));
+					break;
+				}
+				case READRAM:
+				{
+					CALL(write_readram(node, ir, nm_tbl_mngr));
 					break;
 				}
 				default:
@@ -86,54 +105,62 @@ bkd_err_t asmbl(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 				}
 			}
 
+			// the arguments may be integers, the value read from the RAM is not
+			nm_tbl_mngr->pushed_int = false;
+
 			break;
 		}
 		case FUNC:
 		case CMD_FUNC:
 		{
-			CALL(write_func(node, asm_file, nm_tbl_mngr));
+			CALL(write_func(node, ir, nm_tbl_mngr));
+
+			nm_tbl_mngr->pushed_int = false;
 
 			break;
 		}
 		case FUNC_DECL:
 		{
-			CALL(write_func_decl(node, asm_file));
+			CALL(write_func_decl(node, ir, nm_tbl_mngr->types));
 
 			break;
 		}
 		case RETURN:
 		{
-			CALL(write_return(node, asm_file, nm_tbl_mngr));
+			CALL(write_return(node, ir, nm_tbl_mngr));
 
 			break;
 		}
 		case MAIN:
 		{
-			CALL(write_main(node, asm_file));
+			CALL(write_main(node, ir, nm_tbl_mngr->types));
 
 			break;
 		}
 		case OP:
 		{
-			CALL(write_op(node, asm_file, nm_tbl_mngr));
+			CALL(write_op(node, ir, nm_tbl_mngr));
 
 			break;
 		}
 		case UNR_OP:
 		{
-			CALL(write_op(node, asm_file, nm_tbl_mngr));
+			CALL(write_op(node, ir, nm_tbl_mngr));
 
 			break;
 		}
 		case VAR:
 		{
-			CALL(write_var(node->value.var_value, asm_file, nm_tbl_mngr));
+			CALL(write_var(node, ir, nm_tbl_mngr));
 
 			break;
 		}
 		case NUM:
 		{
-			write_num(node->value.num_value, asm_file);
+			CALL(write_num(node->value.num_value, ir));
+
+			nm_tbl_mngr->pushed_int   = is_int_num(node->value.num_value);
+			nm_tbl_mngr->pushed_range = {.lo = node->value.num_value, .hi = node->value.num_value};
 
 			break;
 		}
@@ -144,7 +171,7 @@ bkd_err_t asmbl(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 		case EQUAL:
 		case NOT_EQUAL:
 		{
-			write_cond_expr(node, asm_file, nm_tbl_mngr);
+			CALL(write_cond_expr(node, ir, nm_tbl_mngr));
 
 			break;
 		}
@@ -172,149 +199,241 @@ bkd_err_t asmbl(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 	return error_code;
 }
 
-bkd_err_t write_cond_expr(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+static Visit_action asmbl_visit(B_tree_node *node, void *context)
 {
-	bkd_err_t error_code = BKD_ALL_GOOD;
-	const char *cond = get_cond_type(node->type);
-	if(cond == NULL)
+	Asmbl_walk *walk = (Asmbl_walk *)context;
+
+	walk->error_code = asmbl_node(node, walk->ir, walk->nm_tbl_mngr);
+	if(walk->error_code != BKD_ALL_GOOD)
 	{
-		return BKD_INVALID_COND_EXPR;
+		return VISIT_STOP;
 	}
 
-	WRITE_ASM("push 0\n");
+	// only the chains are walked here, every statement assembles its own children
+	return is_chain(node->type) ? VISIT_CONTINUE : VISIT_SKIP;
+}
+
+bkd_err_t asmbl(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
+{
+	Asmbl_walk walk = {.ir = ir, .nm_tbl_mngr = nm_tbl_mngr, .error_code = BKD_ALL_GOOD};
 
-	ASMBL(node->right);
+	if(visit_tree(node, &asmbl_visit, NULL, &walk) != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the walk stack.\n", __func__);
+
+		return BKD_UNABLE_TO_ALLOCATE;
+	}
+
+	return walk.error_code;
+}
+
+bkd_err_t write_cond_expr(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	size_t break_label = 0;
+	CALL(new_label(ir, &break_label, "break", ir->labels_amount));
+
+	EMIT(IR_PUSH, ir_imm_arg(0));
+
+	CALL(write_cond_jump(node, ir, nm_tbl_mngr, break_label));
+
+	EMIT(IR_PUSH, ir_imm_arg(1));
+	EMIT(IR_ADD, ir_no_arg());
+	DEFINE_LABEL(break_label);
+
+	nm_tbl_mngr->pushed_int   = true;
+	nm_tbl_mngr->pushed_range = {.lo = 0, .hi = 1};
+
+	return error_code;
+}
+
+static bool is_cond_expr(Node_type type)
+{
+	return type == ABOVE       || type == BELOW       ||
+		   type == ABOVE_EQUAL || type == BELOW_EQUAL ||
+		   type == EQUAL       || type == NOT_EQUAL;
+}
+
+bkd_err_t write_cond_jump(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr, size_t false_label)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	if(!is_cond_expr(node->type))
+	{
+		ASMBL(node);
+
+		EMIT(IR_PUSH, ir_imm_arg(0));
+		EMIT(nm_tbl_mngr->pushed_int ? IR_IJE : IR_JE, ir_label_arg(false_label));
+
+		return error_code;
+	}
+
+	// a relation right in the condition branches on itself, without the 0 or 1 value
 	ASMBL(node->left);
+	bool left_int = nm_tbl_mngr->pushed_int;
+	ASMBL(node->right);
+
+	// two integers are compared exactly, without the epsilon
+	Ir_op cond = IR_JMP;
+	CALL(get_cond_type(node->type, left_int && nm_tbl_mngr->pushed_int, &cond));
 
-	WRITE_ASM("%s break_%lu\n", cond, label_ct);
-	WRITE_ASM("push 1\n");
-	WRITE_ASM("add\n");
-	WRITE_ASM(":break_%lu\n", label_ct++);
-	WRITE_ASM("push 0\n");
-	WRITE_ASM("add\n");
+	EMIT(cond, ir_label_arg(false_label));
 
 	return error_code;
 }
 
-const char *get_cond_type(Node_type type)
+bkd_err_t get_cond_type(Node_type type, bool is_int, Ir_op *cond)
 {
 	switch(type)
 	{
 		case ABOVE:
 		{
-			return "jbe";
+			*cond = is_int ? IR_IJBE : IR_JBE;
+			break;
 		}
 		case BELOW:
 		{
-			return "jae";
+			*cond = is_int ? IR_IJAE : IR_JAE;
+			break;
 		}
 		case ABOVE_EQUAL:
 		{
-			return "jb";
+			*cond = is_int ? IR_IJB : IR_JB;
+			break;
 		}
 		case BELOW_EQUAL:
 		{
-			return "ja";
+			*cond = is_int ? IR_IJA : IR_JA;
+			break;
 		}
 		case EQUAL:
 		{
-			return "jne";
+			*cond = is_int ? IR_IJNE : IR_JNE;
+			break;
 		}
 		case NOT_EQUAL:
 		{
-			return "jne";
+			*cond = is_int ? IR_IJE : IR_JE;
+			break;
 		}
 		default:
 		{
 			LOG("%s: ERROR:\n\tInvalid cond expr.\n", __func__);
-			return NULL;
+			return BKD_INVALID_COND_EXPR;
 		}
 	}
+
+	return BKD_ALL_GOOD;
 }
 
-bkd_err_t write_func(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t new_label(Ir_program *ir, size_t *label_ID, const char *prefix, size_t number)
 {
-	bkd_err_t error_code = BKD_ALL_GOOD;
+	char name[LABEL_NAME_SIZE] = {};
+	snprintf(name, LABEL_NAME_SIZE, "%s_%lu", prefix, number);
 
-	CALL(push_all(nm_tbl_mngr, asm_file));
+	if(ir_new_label(ir, label_ID, name) != ASM_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the label.\n", __func__);
 
-	B_tree_node *cur_node = node->left;
+		return BKD_UNABLE_TO_ALLOCATE;
+	}
 
+	return BKD_ALL_GOOD;
+}
 
-	size_t arg_counter = 0;
+bkd_err_t get_func_label(Ir_program *ir, const wchar_t *name, size_t *label_ID)
+{
+	char label_name[LABEL_NAME_SIZE] = {};
+	snprintf(label_name, LABEL_NAME_SIZE, "%ls", name);
 
-	while(cur_node != NULL)
+	// a function is called before its declaration as well as after it
+	*label_ID = ir_find_label(ir, label_name);
+	if(*label_ID != IR_NO_LABEL)
 	{
-		ASMBL(cur_node->left);
-
-		arg_counter++;
-
-		cur_node = cur_node->right;
+		return BKD_ALL_GOOD;
 	}
 
-	for(size_t arg_id = arg_counter; arg_id >= 1; arg_id--)
+	if(ir_new_label(ir, label_ID, label_name) != ASM_ALL_GOOD)
 	{
-		char *loc = get_loc_in_order(arg_id, &error_code);
-		WRITE_ASM("pop %s\n", loc);
+		LOG("%s: ERROR:\n\tUnable to allocate the label.\n", __func__);
+
+		return BKD_UNABLE_TO_ALLOCATE;
 	}
 
-	WRITE_ASM("call %ls\n", node->value.var_value);
+	return BKD_ALL_GOOD;
+}
 
-	// pops all exept return register (wich is rax)
-	CALL(pop_all(nm_tbl_mngr, asm_file));
+bkd_err_t write_func(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	if(CUR_LVL == 0 && CUR_TABLE.size == 0)
-	{
-		if(node->type == FUNC)
-		{
-			WRITE_ASM("push rax\n");
-		}
-	}
-	else
+	// the register allocator saves here what lives across the call
+	EMIT(IR_CALL_START, ir_no_arg());
+
+	CALL(write_args(node, ir, nm_tbl_mngr));
+
+	size_t func_label = 0;
+	CALL(get_func_label(ir, node->value.var_value, &func_label));
+
+	EMIT(IR_CALL, ir_label_arg(func_label));
+
+	if(node->type == FUNC)
 	{
-		CALL(save_ret_reg(asm_file, node->type, nm_tbl_mngr));
+		EMIT(IR_PUSH, ir_reg_arg(RET_REG));
 	}
 
+	return error_code;
+}
+
+bkd_err_t write_tail_call(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	// nothing lives after the call, so no value is saved and the callee returns in place of this function
+	CALL(write_args(node, ir, nm_tbl_mngr));
+
+	size_t func_label = 0;
+	CALL(get_func_label(ir, node->value.var_value, &func_label));
+
+	EMIT(IR_TAIL_CALL, ir_label_arg(func_label));
 
 	return error_code;
 }
 
-bkd_err_t save_ret_reg(FILE *asm_file, Node_type type, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_args(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	if(type == FUNC)
+	B_tree_node *cur_node = node->left;
+
+	size_t arg_counter = 0;
+
+	while(cur_node != NULL)
 	{
-		char *exch_reg = get_loc(L"_temp_exch", nm_tbl_mngr, true, &error_code);
-		if(error_code != BKD_ALL_GOOD)
-		{
-			return error_code;
-		}
+		ASMBL(cur_node->left);
 
-		WRITE_ASM("pop %s\n", exch_reg);
-		WRITE_ASM("push rax\n");
-		WRITE_ASM("push %s\n", exch_reg);
-		WRITE_ASM("pop rax\n");
+		arg_counter++;
 
-		//deinit exch
+		cur_node = cur_node->right;
 	}
-	else
+
+	for(size_t arg_id = arg_counter; arg_id >= 1; arg_id--)
 	{
-		WRITE_ASM("pop rax\n");
+		EMIT(IR_POP, get_loc_in_order(arg_id));
 	}
 
 	return error_code;
 }
 
-
-
-bkd_err_t write_getvar(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_getvar(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	WRITE_ASM("in\n");
+	EMIT(IR_IN, ir_no_arg());
 
-	char *loc = get_loc(node->right->value.var_value, nm_tbl_mngr, true, &error_code);
+	Ir_arg loc = get_loc(node->right->value.sym_ID, node->right->value.var_value, ir, nm_tbl_mngr,
+						 true, &error_code);
 
 	if(error_code != BKD_ALL_GOOD)
 	{
@@ -323,54 +442,118 @@ bkd_err_t write_getvar(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mn
 		return error_code;
 	}
 
-	WRITE_ASM("pop %s\n", loc);
+	EMIT(IR_POP, loc);
 
 	return error_code;
 }
 
-bkd_err_t write_putexpr(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_putexpr(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
 	ASMBL(node->right);
-	WRITE_ASM("out\n");
+	EMIT(IR_OUT, ir_no_arg());
 
 	return error_code;
 }
 
-void write_num(double num, FILE *asm_file)
+bkd_err_t write_ram_block(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr,
+						  Ir_op cmd)
 {
-	WRITE_ASM("push %lf\n", num);
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	// the arguments are pushed in order, the command pops them all
+	for(B_tree_node *arg = node->right; arg != NULL; arg = arg->right)
+	{
+		ASMBL(arg->left);
+	}
+
+	EMIT(cmd, ir_no_arg());
+
+	return error_code;
 }
 
-bkd_err_t write_var(wchar_t *var, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_readram(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	char *loc = get_loc(var, nm_tbl_mngr, false, &error_code);
+	// the address register is never allocated, and it holds the address as an integer
+	ASMBL(node->right);
+	EMIT(IR_POP,  ir_reg_arg(ADDR_REG));
+	EMIT(IR_PUSH, ir_ram_reg_arg(ADDR_REG));
+
+	return error_code;
+}
 
-	if(error_code != BKD_ALL_GOOD)
+bkd_err_t write_num(double num, Ir_program *ir)
+{
+	EMIT(IR_PUSH, ir_imm_arg(num));
+
+	return BKD_ALL_GOOD;
+}
+
+bkd_err_t write_var(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	Ir_arg loc = get_loc(node->value.sym_ID, node->value.var_value, ir, nm_tbl_mngr,
+						 false, &error_code);
+
+	if(error_code != BKD_ALL_GOOD || loc.type == IR_NO_ARG)
 	{
 		LOG("%s: ERROR:\n\tUnknown var.\n", __func__);
-		return error_code;
+		return BKD_UNKNOWN_VAR;
 	}
 
-	WRITE_ASM("push %s\n", loc);
+	EMIT(IR_PUSH, loc);
+
+	nm_tbl_mngr->pushed_int   = loc.type == IR_VAR_ARG && ir->var_types[loc.value] == IR_INT_VAR;
+	nm_tbl_mngr->pushed_range = get_sym_range(nm_tbl_mngr->types, node->value.sym_ID);
 
 	return error_code;
 }
 
-#define CASE(op, name)			\
-	case op:					\
-	{							\
-		ASMBL(node->left);		\
-		ASMBL(node->right);		\
-		WRITE_ASM(name"\n");	\
-								\
-		break;					\
-	}							\
+#define CASE(op, cmd)					\
+	case op:							\
+	{									\
+		ASMBL(node->left);				\
+		ASMBL(node->right);				\
+		EMIT(cmd, ir_no_arg());			\
+										\
+		nm_tbl_mngr->pushed_int = false;	\
+		break;							\
+	}									\
+
+/**
+ * @def INT_CASE(op, cmd, int_cmd)
+ * @brief Macro for an operation which takes the integer command if both operands are integers
+ * and its result is proven to fit.
+ */
+#define INT_CASE(op, cmd, int_cmd)											\
+	case op:																\
+	{																		\
+		ASMBL(node->left);													\
+		bool      left_int   = nm_tbl_mngr->pushed_int;						\
+		Int_range left_range = nm_tbl_mngr->pushed_range;					\
+		ASMBL(node->right);													\
+		Int_range range  = {};												\
+		bool      is_int = left_int && nm_tbl_mngr->pushed_int &&			\
+						   int_op_range(op, left_range, nm_tbl_mngr->pushed_range, &range);	\
+		EMIT(is_int ? int_cmd : cmd, ir_no_arg());							\
+																			\
+		nm_tbl_mngr->pushed_int   = is_int;									\
+		nm_tbl_mngr->pushed_range = range;									\
+		break;																\
+	}
+
+#define UNSUPPORTED_CASE(op)														\
+	case op:																		\
+	{																				\
+		LOG("%s: ERROR:\n\tThe processor has no "#op" command.\n", __func__);	\
+		return BKD_UNKNOWN_OPERATION;												\
+	}
 
-bkd_err_t write_op(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_op(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
@@ -380,7 +563,8 @@ bkd_err_t write_op(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 		{
 			ASMBL(node->right);
 
-			char *loc = get_loc(node->left->value.var_value, nm_tbl_mngr, true, &error_code);
+			Ir_arg loc = get_loc(node->left->value.sym_ID, node->left->value.var_value, ir,
+								 nm_tbl_mngr, true, &error_code);
 
 			if(error_code != BKD_ALL_GOOD)
 			{
@@ -390,20 +574,19 @@ bkd_err_t write_op(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 			}
 
 
-			WRITE_ASM("pop %s\n", loc);
-			// WRITE_ASM("pop [temp_loc for %s]\n", node->left->value.var_value);
+			EMIT(IR_POP, loc);
 
 			break;
 		}
-		CASE(ADD,  "add")
-		CASE(SUB,  "sub")
-		CASE(MUL,  "mul")
-		CASE(DIV,  "div")
-		CASE(POW,  "pow")
-		CASE(LN,   "ln")
-		CASE(SIN,  "sin")
-		CASE(COS,  "cos")
-		CASE(SQRT, "sqrt")
+		INT_CASE(ADD, IR_ADD, IR_IADD)
+		INT_CASE(SUB, IR_SUB, IR_ISUB)
+		INT_CASE(MUL, IR_MUL, IR_IMUL)
+		CASE(DIV,  IR_DIV)
+		CASE(SQRT, IR_SQRT)
+		UNSUPPORTED_CASE(POW)
+		UNSUPPORTED_CASE(LN)
+		UNSUPPORTED_CASE(SIN)
+		UNSUPPORTED_CASE(COS)
 		case DO_NOTHING:
 		{
 			LOG("%s: ERROR:\n\tInvalid operation: %d\n", __func__, node->value.op_value);
@@ -419,91 +602,89 @@ bkd_err_t write_op(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
 	return error_code;
 }
 
+#undef UNSUPPORTED_CASE
+#undef INT_CASE
 #undef CASE
 
-bkd_err_t write_while(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_while(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	WRITE_ASM(":while_%lu\n", label_ct);
-	size_t while_id = label_ct;
-	label_ct++;
+	// the labels are numbered by the program, so a loop needs no counter of its own
+	size_t label_number = ir->labels_amount;
 
-	ASMBL(node->left);
+	size_t while_label = 0;
+	size_t break_label = 0;
+	CALL(new_label(ir, &while_label, "while", label_number));
+	CALL(new_label(ir, &break_label, "break", label_number));
 
-	WRITE_ASM("push 0\n");
-	WRITE_ASM("je break_%lu\n", while_id);
+	DEFINE_LABEL(while_label);
+
+	CALL(write_cond_jump(node->left, ir, nm_tbl_mngr, break_label));
 
 	ASMBL(node->right);
 
-	WRITE_ASM("jmp while_%lu\n", while_id);
-	WRITE_ASM(":break_%lu\n", while_id);
+	EMIT(IR_JMP, ir_label_arg(while_label));
+	DEFINE_LABEL(break_label);
 
 	return error_code;
 }
 
-bkd_err_t write_main(B_tree_node *node, FILE *asm_file)
+bkd_err_t write_main(B_tree_node *node, Ir_program *ir, Var_types *types)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
+	CALL(infer_types(types, NULL, node->right));
+
 	Nm_tbl_mngr nm_tbl_mngr = {};
-	init_name_tables(&nm_tbl_mngr);
+	CALL(init_name_tables(&nm_tbl_mngr));
 	nm_tbl_mngr.in_func_start = true;
+	nm_tbl_mngr.types         = types;
 
-	WRITE_ASM(":main\n")
+	size_t main_label = 0;
+	CALL(get_func_label(ir, L"main", &main_label));
 
-	asmbl(node->right, asm_file, &nm_tbl_mngr);
+	DEFINE_LABEL(main_label);
+
+	CALL(asmbl(node->right, ir, &nm_tbl_mngr));
 
 	return error_code;
 }
 
-bkd_err_t write_if(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_if(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
-	ASMBL(node->left);
+	size_t break_label = 0;
+	CALL(new_label(ir, &break_label, "break", ir->labels_amount));
 
-	WRITE_ASM("push 0\n");
-	WRITE_ASM("je break_%lu\n", label_ct);
+	CALL(write_cond_jump(node->left, ir, nm_tbl_mngr, break_label));
 
 	ASMBL(node->right);
 
-	WRITE_ASM(":break_%lu\n", label_ct);
-	label_ct++;
+	DEFINE_LABEL(break_label);
 
 	return error_code;
 }
 
 
 
-void bkd_write_log(const char *file_name, const char *fmt, ...)
-{
-    static FILE *log_file = fopen(file_name, "w");
-
-    if (log_file == NULL)
-	{
-        perror("Error opening log_file");
-        return;
-    }
-
-    va_list args = NULL;
-
-    va_start(args, fmt);
-
-    vfprintf(log_file, fmt, args);
-
-    va_end(args);
-}
-
 bkd_err_t init_name_tables(Nm_tbl_mngr *nm_tbl_mngr)
 {
-	CUR_LVL = 0;
+	*nm_tbl_mngr = {};
 
-	CALLOC(nm_tbl_mngr->name_tables, CUR_LVL + 1, Name_table);
+	nm_tbl_mngr->capacity        = ST_CELLS_AMOUNT;
+	nm_tbl_mngr->scopes_capacity = ST_CELLS_AMOUNT;
+	nm_tbl_mngr->map.capacity    = SYM_MAP_START_CAPACITY;
 
-	CUR_TABLE.capacity = ST_CELLS_AMOUNT;
-	CUR_TABLE.size     = 0;
-	CALLOC(CUR_TABLE.cells, ST_CELLS_AMOUNT, Table_cell);
+	CALLOC(nm_tbl_mngr->cells,        ST_CELLS_AMOUNT,        Table_cell);
+	CALLOC(nm_tbl_mngr->scope_starts, ST_CELLS_AMOUNT,        size_t);
+	CALLOC(nm_tbl_mngr->map.entries,  SYM_MAP_START_CAPACITY, Sym_map_entry);
+
+	for(size_t entry_ID = 0; entry_ID < SYM_MAP_START_CAPACITY; entry_ID++)
+	{
+		nm_tbl_mngr->map.entries[entry_ID].sym_ID = NO_SYM;
+	}
 
 	LOG("Manager inited.\n");
 
@@ -526,12 +707,14 @@ bkd_err_t upgrade_n_table(Nm_tbl_mngr *nm_tbl_mngr)
 
 	CUR_LVL++;
 
-	REALLOC(nm_tbl_mngr->name_tables, CUR_LVL + 1, Name_table);
-
-	CUR_TABLE.capacity = ST_CELLS_AMOUNT;
-	CUR_TABLE.size     = 0;
+	if(CUR_LVL >= nm_tbl_mngr->scopes_capacity)
+	{
+		nm_tbl_mngr->scopes_capacity = (CUR_LVL + 1) * REALLOC_COEFF;
+		REALLOC(nm_tbl_mngr->scope_starts, nm_tbl_mngr->scopes_capacity, size_t);
+	}
 
-	CALLOC((CUR_TABLE).cells, ST_CELLS_AMOUNT, Table_cell);
+	// the declarations after the mark are the undo log of the scope
+	nm_tbl_mngr->scope_starts[CUR_LVL] = nm_tbl_mngr->size;
 
 	LOG("Successful upgrade.\n");
 
@@ -551,14 +734,17 @@ bkd_err_t downgrade_n_table(Nm_tbl_mngr *nm_tbl_mngr)
 		return error_code;
 	}
 
-	CUR_TABLE.capacity = 0;
-	CUR_TABLE.size     = 0;
-	free(CUR_TABLE.cells);
-	CUR_TABLE.cells = NULL;
+	size_t scope_start = nm_tbl_mngr->scope_starts[CUR_LVL];
 
-	CUR_LVL--;
+	// the shadowed bindings come back in the reverse order of the declarations
+	while(nm_tbl_mngr->size > scope_start)
+	{
+		Table_cell *cell = &nm_tbl_mngr->cells[--nm_tbl_mngr->size];
 
-	REALLOC(nm_tbl_mngr->name_tables, CUR_LVL + 1, Name_table);
+		find_sym(&nm_tbl_mngr->map, cell->sym_ID)->cell_ID = cell->shadowed;
+	}
+
+	CUR_LVL--;
 
 	LOG("Successful downgrade.\n");
 
@@ -567,33 +753,81 @@ bkd_err_t downgrade_n_table(Nm_tbl_mngr *nm_tbl_mngr)
 
 bkd_err_t dtor_name_tables(Nm_tbl_mngr *nm_tbl_mngr)
 {
-	while(CUR_LVL)
+	free(nm_tbl_mngr->cells);
+	free(nm_tbl_mngr->scope_starts);
+	free(nm_tbl_mngr->map.entries);
+
+	// the types outlive the tables, the top level goes on to the functions after it
+	Var_types *types = nm_tbl_mngr->types;
+
+	*nm_tbl_mngr = {};
+	nm_tbl_mngr->types = types;
+
+	LOG("Manager dtored.\n");
+
+	return BKD_ALL_GOOD;
+}
+
+static size_t hash_sym(size_t sym_ID)
+{
+	return (sym_ID * 11400714819323198485ul) >> 32;
+}
+
+Sym_map_entry *find_sym(Sym_map *map, size_t sym_ID)
+{
+	size_t mask = map->capacity - 1;
+
+	for(size_t entry_ID = hash_sym(sym_ID) & mask;; entry_ID = (entry_ID + 1) & mask)
+	{
+		Sym_map_entry *entry = &map->entries[entry_ID];
+
+		if(entry->sym_ID == sym_ID || entry->sym_ID == NO_SYM)
+		{
+			return entry;
+		}
+	}
+}
+
+bkd_err_t bind_sym(Sym_map *map, size_t sym_ID, size_t cell_ID)
+{
+	// the entries are never removed, an unbound symbol keeps NO_CELL
+	if((map->size + 1) * 2 > map->capacity)
 	{
-		free(CUR_TABLE.cells);
+		Sym_map_entry *old_entries  = map->entries;
+		size_t         old_capacity = map->capacity;
 
-		CUR_TABLE.cells = NULL;
-		CUR_TABLE.capacity  = 0;
-		CUR_TABLE.size      = 0;
+		map->capacity = old_capacity * REALLOC_COEFF;
+		CALLOC(map->entries, map->capacity, Sym_map_entry);
+
+		for(size_t entry_ID = 0; entry_ID < map->capacity; entry_ID++)
+		{
+			map->entries[entry_ID].sym_ID = NO_SYM;
+		}
+
+		for(size_t entry_ID = 0; entry_ID < old_capacity; entry_ID++)
+		{
+			if(old_entries[entry_ID].sym_ID != NO_SYM)
+			{
+				*find_sym(map, old_entries[entry_ID].sym_ID) = old_entries[entry_ID];
+			}
+		}
 
-		CUR_LVL--;
+		free(old_entries);
 	}
 
-	free(nm_tbl_mngr->name_tables);
-	nm_tbl_mngr->name_tables = NULL;
+	Sym_map_entry *entry = find_sym(map, sym_ID);
 
-	nm_tbl_mngr = NULL;
+	if(entry->sym_ID == NO_SYM)
+	{
+		entry->sym_ID = sym_ID;
+		map->size++;
+	}
 
-	LOG("Manager dtored.\n");
+	entry->cell_ID = cell_ID;
 
 	return BKD_ALL_GOOD;
 }
 
-#define IS_VAR(table_name)\
-	!wcsncmp(table_name, var, MAX_TOKEN_SIZE)
-
-#define NAME_TABLE\
-	nm_tbl_mngr->name_tables[lvl_id]
-
 #undef ALLOCATION_CHECK
 
 #define ALLOCATION_CHECK(ptr)					\
@@ -601,216 +835,183 @@ bkd_err_t dtor_name_tables(Nm_tbl_mngr *nm_tbl_mngr)
 	{											\
 		LOG("Unable to allocate"#ptr".\n");		\
 		*error_code = BKD_UNABLE_TO_ALLOCATE;	\
-		return NULL;							\
+		return ir_no_arg();						\
 	}
 
-char *get_loc(wchar_t *var, Nm_tbl_mngr *nm_tbl_mngr, bool init_flag, bkd_err_t *error_code)
+Ir_arg get_loc(size_t sym_ID, wchar_t *name, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr,
+			   bool init_flag, bkd_err_t *error_code)
 {
-	size_t overall_size = 0;
-
-	for(long lvl_id = (long)CUR_LVL; lvl_id >= 0; lvl_id--)
+	if(nm_tbl_mngr->map.capacity != 0)
 	{
-		overall_size += NAME_TABLE.size;
+		Sym_map_entry *entry = find_sym(&nm_tbl_mngr->map, sym_ID);
 
-		for(size_t cell_id = 0; cell_id < NAME_TABLE.size; cell_id++)
+		if(entry->sym_ID == sym_ID && entry->cell_ID != NO_CELL)
 		{
-			if(IS_VAR(NAME_TABLE.cells[cell_id].name))
-			{
-				char *loc = get_init_var(&(NAME_TABLE.cells[cell_id]), error_code);
-
-				return loc;
-			}
+			return get_init_var(&nm_tbl_mngr->cells[entry->cell_ID], error_code);
 		}
 	}
 
-
+	// the register allocator places the variable after the whole program is emitted,
+	// in the bank of its type
 	if(init_flag)
 	{
-		char *loc = init_var(var, &(CUR_TABLE), error_code, overall_size);
+		Ir_var_type type   = get_sym_type(nm_tbl_mngr->types, sym_ID) == SYM_INT ? IR_INT_VAR : IR_FLOAT_VAR;
+		size_t      var_ID = 0;
+
+		if(ir_new_var(ir, type, &var_ID) != ASM_ALL_GOOD)
+		{
+			*error_code = BKD_UNABLE_TO_ALLOCATE;
+
+			return ir_no_arg();
+		}
 
-		return loc;
+		return init_var(sym_ID, name, nm_tbl_mngr, error_code, ir_var_arg(var_ID));
 	}
 	else
 	{
-		return NULL;
+		return ir_no_arg();
 	}
 }
 
-char *get_loc_in_order(size_t arg_counter, bkd_err_t *error_code)
+Ir_arg get_loc_in_order(size_t arg_counter)
 {
-	char *loc = NULL;
-	CALLOC(loc, LOC_SIZE, char);
-
-	if(arg_counter >= AMOUNT_OF_REGS)
+	if(arg_counter >= FIRST_CALLEE_SAVED)
 	{
-		snprintf(loc, LOC_SIZE - 1, "[%lu]", arg_counter - AMOUNT_OF_REGS);
+		return ir_ram_arg(arg_counter - FIRST_CALLEE_SAVED);
 	}
 	else
 	{
-		snprintf(loc, LOC_SIZE - 1, "r%cx", (char)arg_counter + 'a');
+		return ir_reg_arg((unsigned char)arg_counter);
 	}
-
-	return loc;
 }
 
-char *get_init_var(Table_cell *cell, bkd_err_t *error_code)
+Ir_arg get_init_var(Table_cell *cell, bkd_err_t *error_code)
 {
-	char *loc = NULL;
-	CALLOC(loc, LOC_SIZE, char);
-
-	switch(cell->type)
+	if(cell->loc.type == IR_NO_ARG)
 	{
-		case REG:
-		{
-			snprintf(loc, LOC_SIZE - 1, "r%cx", cell->loc.reg_id + 'a');
-
-			return loc;
-		}
-		case RAM:
-		{
-			snprintf(loc, LOC_SIZE - 1, "[%lu]", cell->loc.RAM_address);
-
-			return loc;
-		}
-		default:
-		{
-			free(loc);
-			*error_code = BKD_UNKNOWN_VAR;
-			return NULL;
-		}
+		*error_code = BKD_UNKNOWN_VAR;
 	}
+
+	return cell->loc;
 }
 
-char *init_var(wchar_t *var, struct Name_table *cur_table,
-			   bkd_err_t *error_code, size_t overall_size)
+Ir_arg init_var(size_t sym_ID, wchar_t *name, Nm_tbl_mngr *nm_tbl_mngr,
+				bkd_err_t *error_code, Ir_arg loc)
 {
-	char *loc = NULL;
-	CALLOC(loc, LOC_SIZE, char);
-
-	if(cur_table->size >= cur_table->capacity)
+	if(nm_tbl_mngr->size >= nm_tbl_mngr->capacity)
 	{
-		cur_table->capacity *= REALLOC_COEFF;
-		REALLOC(cur_table->cells, cur_table->capacity, Table_cell)
+		nm_tbl_mngr->capacity = (nm_tbl_mngr->size + 1) * REALLOC_COEFF;
+		REALLOC(nm_tbl_mngr->cells, nm_tbl_mngr->capacity, Table_cell)
 		LOG("Cells reallocated.\n");
 	}
 
-	cur_table->cells[cur_table->size].name = var;
-
-	if(overall_size >= AMOUNT_OF_REGS)
-	{
-		cur_table->cells[cur_table->size].type            = RAM;
-		cur_table->cells[cur_table->size].loc.RAM_address = overall_size - AMOUNT_OF_REGS;
-
-		snprintf(loc, LOC_SIZE - 1, "[%lu]",
-					cur_table->cells[cur_table->size].loc.RAM_address);
-	}
-	else
+	if(nm_tbl_mngr->map.capacity == 0)
 	{
-		cur_table->cells[cur_table->size].type       = REG;
-		cur_table->cells[cur_table->size].loc.reg_id = (unsigned char)overall_size;
-
-		snprintf(loc, LOC_SIZE - 1, "r%cx",
-					cur_table->cells[cur_table->size].loc.reg_id + 'a');
-	}
-
-	cur_table->size++;
-
-
-	return loc;
-}
+		nm_tbl_mngr->map.capacity = SYM_MAP_START_CAPACITY;
+		CALLOC(nm_tbl_mngr->map.entries, SYM_MAP_START_CAPACITY, Sym_map_entry);
 
-bkd_err_t push_all(Nm_tbl_mngr *nm_tbl_mngr, FILE *asm_file)
-{
-	bkd_err_t error_code = BKD_ALL_GOOD;
-
-	for(long lvl_id = (long)CUR_LVL; lvl_id >= 0; lvl_id--)
-	{
-		for(size_t cell_id = 0; cell_id < NAME_TABLE.size; cell_id++)
+		for(size_t entry_ID = 0; entry_ID < SYM_MAP_START_CAPACITY; entry_ID++)
 		{
-			char *loc = get_init_var(&(NAME_TABLE.cells[cell_id]), &error_code);
-
-			WRITE_ASM("push %s\n", loc);
+			nm_tbl_mngr->map.entries[entry_ID].sym_ID = NO_SYM;
 		}
 	}
 
-	return error_code;
-}
+	size_t      cell_ID = nm_tbl_mngr->size;
+	Table_cell *cell    = &nm_tbl_mngr->cells[cell_ID];
 
-bkd_err_t pop_all(Nm_tbl_mngr *nm_tbl_mngr, FILE *asm_file)
-{
-	bkd_err_t error_code = BKD_ALL_GOOD;
+	Sym_map_entry *entry = find_sym(&nm_tbl_mngr->map, sym_ID);
+
+	cell->sym_ID   = sym_ID;
+	cell->name     = name;
+	cell->loc      = loc;
+	cell->shadowed = entry->sym_ID == sym_ID ? entry->cell_ID : NO_CELL;
 
-	for(long lvl_id = 0; lvl_id <= (long)CUR_LVL; lvl_id++)
+	if(bind_sym(&nm_tbl_mngr->map, sym_ID, cell_ID) != BKD_ALL_GOOD)
 	{
-		for(long cell_id = (long)NAME_TABLE.size - 1; cell_id >= 0; cell_id--)
-		{
-			char *loc = get_init_var(&(NAME_TABLE.cells[cell_id]), &error_code);
+		*error_code = BKD_UNABLE_TO_ALLOCATE;
 
-			if(!(cell_id == 0 && lvl_id == 0))
-			{
-				WRITE_ASM("pop %s\n", loc);
-			}
-		}
+		return ir_no_arg();
 	}
 
-	return  error_code;
-}
+	nm_tbl_mngr->size++;
 
-#undef NAME_TABLE
-#undef IS_VAR
+	return get_init_var(cell, error_code);
+}
 
-#undef CUR_TABLE
 #undef CUR_LVL
 
 
 #define CUR_LVL\
 	nm_tbl_mngr.cur_lvl
 
-#define CUR_TABLE\
-	nm_tbl_mngr.name_tables[CUR_LVL]
-
 
-bkd_err_t write_func_decl(B_tree_node *node, FILE *asm_file)
+bkd_err_t write_func_decl(B_tree_node *node, Ir_program *ir, Var_types *types)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
+	CALL(infer_types(types, node->left, node->right));
 
 	Nm_tbl_mngr nm_tbl_mngr = {};
-	init_name_tables(&nm_tbl_mngr);
+	CALL(init_name_tables(&nm_tbl_mngr));
 	nm_tbl_mngr.in_func_start = true;
+	nm_tbl_mngr.types         = types;
 
 	B_tree_node *cur_node = node->left;
 
-	init_var(L"_ret_var", &(CUR_TABLE), &error_code, 0);
 	size_t arg_counter = 1;
 
+	size_t func_label = 0;
+	CALL(get_func_label(ir, node->value.var_value, &func_label));
 
+	DEFINE_LABEL(func_label);
+
+	// the arguments come in order, they are all saved before any of them is moved
 	while(cur_node != NULL)
 	{
-		init_var(cur_node->left->value.var_value, &(CUR_TABLE), &error_code, arg_counter);
+		size_t var_ID = 0;
+		if(ir_new_var(ir, IR_FLOAT_VAR, &var_ID) != ASM_ALL_GOOD)
+		{
+			return BKD_UNABLE_TO_ALLOCATE;
+		}
+
+		init_var(cur_node->left->value.sym_ID, cur_node->left->value.var_value, &nm_tbl_mngr,
+				 &error_code, ir_var_arg(var_ID));
+		CHECK_ERROR;
+
+		EMIT(IR_PUSH, get_loc_in_order(arg_counter));
 		arg_counter++;
 
 		cur_node = cur_node->right;
 	}
 
-	WRITE_ASM(":%ls\n", node->value.var_value);
+	for(size_t arg_id = arg_counter - 1; arg_id >= 1; arg_id--)
+	{
+		EMIT(IR_POP, nm_tbl_mngr.cells[arg_id - 1].loc);
+	}
 
-	asmbl(node->right, asm_file, &nm_tbl_mngr);
+	CALL(asmbl(node->right, ir, &nm_tbl_mngr));
 
-	WRITE_ASM("ret\n");
+	EMIT(IR_RET, ir_no_arg());
 
 	return error_code;
 }
 
-bkd_err_t write_return(B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr)
+bkd_err_t write_return(B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr)
 {
 	bkd_err_t error_code = BKD_ALL_GOOD;
 
+	if(node->right->type == FUNC)
+	{
+		CALL(write_tail_call(node->right, ir, nm_tbl_mngr));
+
+		return error_code;
+	}
+
 	ASMBL(node->right);
 
-	WRITE_ASM("pop rax\n");
+	EMIT(IR_POP, ir_reg_arg(RET_REG));
 
-	WRITE_ASM("ret\n");
+	EMIT(IR_RET, ir_no_arg());
 
 	return error_code;
 }
@@ -2,35 +2,50 @@
 #define BACKEND_SECONDAARY_H
 
 #include "backend.h"
+#include "asm_ir.h"
 #include "utils.h"
+#include "secondary.h"
+#include "backend_types.h"
 
-const size_t ST_CELLS_AMOUNT = 10;
-const size_t LOC_SIZE        = 20;
-const size_t REALLOC_COEFF   = 2;
-const size_t AMOUNT_OF_REGS  = 4;
+const size_t        ST_CELLS_AMOUNT = 10;
+const size_t        REALLOC_COEFF   = 2;
+const size_t        AMOUNT_OF_REGS  = REGS_AMOUNT;
+const size_t        ALL_REGS_AMOUNT = FIRST_INT_REG + INT_REGS_AMOUNT;
+const size_t        LABEL_NAME_SIZE = MAX_TOKEN_SIZE * 4;
 
-enum Loc_type
-{
-	REG = 0,
-	RAM = 1,
-};
+// calling convention: the arguments come in the caller-saved registers from rbx on and then in
+// the RAM cells from [0] on, the result is returned in rax, the callee restores the callee-saved
+// registers it writes
+const unsigned char RET_REG            = 0;
+const size_t        FIRST_CALLEE_SAVED = AMOUNT_OF_REGS / 2;
+
+// the integer registers carry no arguments, readram addresses the RAM through i0, which is never
+// given out either, the upper half of the others is callee-saved
+const unsigned char ADDR_REG               = (unsigned char)FIRST_INT_REG;
+const size_t        FIRST_CALLEE_SAVED_INT = FIRST_INT_REG + INT_REGS_AMOUNT / 2;
+
+const size_t        NO_CELL         = (size_t)-1;
+const size_t        NO_SYM          = (size_t)-1;
+const size_t        SYM_MAP_START_CAPACITY = 16;
 
-union Loc
-{
-	unsigned char reg_id;
-	size_t        RAM_address;
-};
 
 struct Table_cell
 {
+	size_t      sym_ID;
 	wchar_t    *name;
-	Loc_type    type;
-	Loc         loc;
+	Ir_arg      loc;
+	size_t      shadowed;
 };
 
-struct Name_table
+struct Sym_map_entry
 {
-	Table_cell *cells;
+	size_t sym_ID;
+	size_t cell_ID;
+};
+
+struct Sym_map
+{
+	Sym_map_entry *entries;
 	size_t capacity;
 	size_t size;
 };
@@ -38,13 +53,28 @@ struct Name_table
 struct Nm_tbl_mngr
 {
 	size_t cur_lvl;
-	Name_table *name_tables;
+	Table_cell *cells;
+	size_t size;
+	size_t capacity;
+	size_t *scope_starts;
+	size_t scopes_capacity;
+	Sym_map map;
 	bool in_func_start;
+	Var_types *types;
+	bool pushed_int;
+	Int_range pushed_range;
+};
+
+struct Asmbl_walk
+{
+	Ir_program  *ir;
+	Nm_tbl_mngr *nm_tbl_mngr;
+	bkd_err_t    error_code;
 };
 
 
 #define ASMBL(node)											\
-	error_code = asmbl(node, asm_file, nm_tbl_mngr);		\
+	error_code = asmbl(node, ir, nm_tbl_mngr);				\
 	if(error_code != BKD_ALL_GOOD)							\
 	{														\
 		LOG("%s: ERROR:\n\tasmbl error: %d.\n", __func__);	\
@@ -52,10 +82,23 @@ struct Nm_tbl_mngr
 	}
 
 #define LOG(...)\
-	bkd_write_log("backend_log", __VA_ARGS__);
+	LOG_AT(LOG_LEVEL_DEBUG, LOG_SINK_BACKEND, __VA_ARGS__);
+
+#define EMIT(op, arg)															\
+	if(ir_emit(ir, op, arg) != ASM_ALL_GOOD)									\
+	{																			\
+		LOG("%s: ERROR:\n\tUnable to emit the command.\n", __func__);			\
+																				\
+		return BKD_UNABLE_TO_ALLOCATE;											\
+	}
 
-#define WRITE_ASM(...)\
-	fprintf(asm_file, __VA_ARGS__);
+#define DEFINE_LABEL(label_ID)													\
+	if(ir_define(ir, label_ID) != ASM_ALL_GOOD)								\
+	{																			\
+		LOG("%s: ERROR:\n\tUnable to define the label.\n", __func__);			\
+																				\
+		return BKD_UNABLE_TO_ALLOCATE;											\
+	}
 
 #define FILE_PTR_CHECK(file_ptr)									\
 	if(file_ptr == NULL)											\
@@ -76,19 +119,17 @@ struct Nm_tbl_mngr
 	if(error_code != BKD_ALL_GOOD)									\
 		return error_code;
 
-void        write_num        (double num, FILE *asm_file);
-
-bkd_err_t   asmbl            (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_num        (double num, Ir_program *ir);
 
-void        bkd_write_log    (const char *file_name, const char *fmt, ...);
+bkd_err_t   asmbl            (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_while      (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_while      (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_if         (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_if         (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_var        (wchar_t *var, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_var        (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_op         (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_op         (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
 bkd_err_t   init_name_tables (Nm_tbl_mngr *nm_tbl_mngr);
 
@@ -98,36 +139,49 @@ bkd_err_t   downgrade_n_table(Nm_tbl_mngr *nm_tbl_mngr);
 
 bkd_err_t   dtor_name_tables (Nm_tbl_mngr *nm_tbl_mngr);
 
-char       *get_loc          (wchar_t *var, Nm_tbl_mngr *nm_tbl_mngr,
+Ir_arg      get_loc          (size_t sym_ID, wchar_t *name, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr,
 		  					  bool init_flag, bkd_err_t *error_code);
 
-bkd_err_t   write_getvar     (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_getvar     (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
+
+bkd_err_t   write_putexpr    (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
+
+bkd_err_t   write_ram_block  (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr,
+							  Ir_op cmd);
+
+bkd_err_t   write_readram    (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
+
+Ir_arg      init_var         (size_t sym_ID, wchar_t *name, Nm_tbl_mngr *nm_tbl_mngr,
+		  	                  bkd_err_t *error_code, Ir_arg loc);
+
+Sym_map_entry *find_sym      (Sym_map *map, size_t sym_ID);
+
+bkd_err_t   bind_sym         (Sym_map *map, size_t sym_ID, size_t cell_ID);
 
-bkd_err_t   write_putexpr    (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+Ir_arg      get_init_var     (Table_cell *cell, bkd_err_t *error_code);
 
-char       *init_var         (wchar_t *var, struct Name_table *cur_table,
-		  	                  bkd_err_t *error_code, size_t overall_size);
+bkd_err_t   write_func_decl  (B_tree_node *node, Ir_program *ir, Var_types *types);
 
-char       *get_init_var     (Table_cell *cell, bkd_err_t *error_code);
+bkd_err_t   write_return     (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_func_decl  (B_tree_node *node, FILE *asm_file);
+bkd_err_t   write_main       (B_tree_node *node, Ir_program *ir, Var_types *types);
 
-bkd_err_t   write_return     (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   write_func       (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_main       (B_tree_node *node, FILE *asm_file);
+bkd_err_t   write_tail_call  (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   push_all         (Nm_tbl_mngr *nm_tbl_mngr, FILE *asm_file);
+bkd_err_t   write_args       (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   write_func       (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+Ir_arg      get_loc_in_order (size_t arg_counter);
 
-char       *get_loc_in_order (size_t arg_counter, bkd_err_t *error_code);
+bkd_err_t   write_cond_expr  (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr);
 
-bkd_err_t   pop_all          (Nm_tbl_mngr *nm_tbl_mngr, FILE *asm_file);
+bkd_err_t   write_cond_jump  (B_tree_node *node, Ir_program *ir, Nm_tbl_mngr *nm_tbl_mngr, size_t false_label);
 
-bkd_err_t   write_cond_expr  (B_tree_node *node, FILE *asm_file, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   get_cond_type    (Node_type type, bool is_int, Ir_op *cond);
 
-const char *get_cond_type    (Node_type type);
+bkd_err_t   new_label        (Ir_program *ir, size_t *label_ID, const char *prefix, size_t number);
 
-bkd_err_t   save_ret_reg     (FILE *asm_file, Node_type type, Nm_tbl_mngr *nm_tbl_mngr);
+bkd_err_t   get_func_label   (Ir_program *ir, const wchar_t *name, size_t *label_ID);
 
 #endif
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "backend_types.h"
+#include "backend_secondary.h"
+
+const double MAX_EXACT_INT      = 9007199254740992.0; /**< 2^53, the doubles of the stack are exact up to it. */
+const size_t RANGE_WIDEN_ROUND  = 8; /**< Round from which a range that still grows has no proven bound. */
+
+static const Int_range EMPTY_RANGE = {.lo = HUGE_VAL, .hi = -HUGE_VAL};
+
+bkd_err_t var_types_ctor(Var_types *types)
+{
+	*types = {};
+
+	CALLOC(types->entries, SYM_TYPES_START_CAPACITY, Sym_type_entry);
+	CALLOC(types->assigns, SYM_TYPES_START_CAPACITY, Type_assign);
+	CALLOC(types->loops,   SYM_TYPES_START_CAPACITY, Type_loop);
+
+	types->capacity         = SYM_TYPES_START_CAPACITY;
+	types->assigns_capacity = SYM_TYPES_START_CAPACITY;
+	types->loops_capacity   = SYM_TYPES_START_CAPACITY;
+
+	return BKD_ALL_GOOD;
+}
+
+void var_types_dtor(Var_types *types)
+{
+	free(types->entries);
+	free(types->assigns);
+	free(types->loops);
+
+	*types = {};
+}
+
+bool is_int_num(double num)
+{
+	// -0 would come back as 0 from an integer register
+	return fpclassify(num - trunc(num)) == FP_ZERO && fabs(num) <= MAX_EXACT_INT &&
+		   !(fpclassify(num) == FP_ZERO && signbit(num));
+}
+
+Sym_type get_sym_type(const Var_types *types, size_t sym_ID)
+{
+	// the entries of the other functions are stale, so there is nothing to clear between them
+	if(types == NULL || sym_ID >= types->capacity || types->entries[sym_ID].func_ID != types->func_ID)
+	{
+		return SYM_UNKNOWN;
+	}
+
+	return types->entries[sym_ID].type;
+}
+
+Int_range get_sym_range(const Var_types *types, size_t sym_ID)
+{
+	if(get_sym_type(types, sym_ID) != SYM_INT)
+	{
+		return EMPTY_RANGE;
+	}
+
+	return types->entries[sym_ID].range;
+}
+
+static bkd_err_t set_sym_type(Var_types *types, size_t sym_ID, Sym_type type)
+{
+	if(sym_ID >= types->capacity)
+	{
+		size_t old_capacity = types->capacity;
+
+		types->capacity = (sym_ID + 1) * REALLOC_COEFF;
+		REALLOC(types->entries, types->capacity, Sym_type_entry);
+
+		for(size_t entry_ID = old_capacity; entry_ID < types->capacity; entry_ID++)
+		{
+			types->entries[entry_ID] = {};
+		}
+	}
+
+	// a variable gets its values only once it is an integer one
+	types->entries[sym_ID].type    = type;
+	types->entries[sym_ID].func_ID = types->func_ID;
+	types->entries[sym_ID].range   = EMPTY_RANGE;
+
+	return BKD_ALL_GOOD;
+}
+
+static bool is_empty_range(Int_range range)
+{
+	return range.lo > range.hi;
+}
+
+static bool range_fits(Int_range range)
+{
+	return is_empty_range(range) || (range.lo >= -MAX_EXACT_INT && range.hi <= MAX_EXACT_INT);
+}
+
+static bool is_relation(Node_type type)
+{
+	return type == ABOVE || type == BELOW || type == ABOVE_EQUAL || type == BELOW_EQUAL ||
+		   type == EQUAL || type == NOT_EQUAL;
+}
+
+bool int_op_range(Ops op, Int_range left, Int_range right, Int_range *range)
+{
+	if(op != ADD && op != SUB && op != MUL)
+	{
+		return false;
+	}
+
+	// an operand without values yet gives none either
+	if(is_empty_range(left) || is_empty_range(right))
+	{
+		*range = EMPTY_RANGE;
+
+		return true;
+	}
+
+	if(op == ADD)
+	{
+		*range = {.lo = left.lo + right.lo, .hi = left.hi + right.hi};
+	}
+	else if(op == SUB)
+	{
+		*range = {.lo = left.lo - right.hi, .hi = left.hi - right.lo};
+	}
+	else
+	{
+		// the operands are within 2^53, so the products are finite
+		double lo_lo = left.lo * right.lo;
+		double lo_hi = left.lo * right.hi;
+		double hi_lo = left.hi * right.lo;
+		double hi_hi = left.hi * right.hi;
+
+		*range = {.lo = fmin(fmin(lo_lo, lo_hi), fmin(hi_lo, hi_hi)),
+				  .hi = fmax(fmax(lo_lo, lo_hi), fmax(hi_lo, hi_hi))};
+	}
+
+	return range_fits(*range);
+}
+
+static bool expr_range(const Var_types *types, const B_tree_node *node, Int_range *range)
+{
+	if(node == NULL)
+	{
+		return false;
+	}
+
+	if(node->type == NUM)
+	{
+		*range = {.lo = node->value.num_value, .hi = node->value.num_value};
+
+		return is_int_num(node->value.num_value);
+	}
+
+	if(node->type == VAR)
+	{
+		*range = get_sym_range(types, node->value.sym_ID);
+
+		return get_sym_type(types, node->value.sym_ID) == SYM_INT;
+	}
+
+	if(is_relation(node->type))
+	{
+		*range = {.lo = 0, .hi = 1};
+
+		return true;
+	}
+
+	Int_range left  = {};
+	Int_range right = {};
+
+	return node->type == OP && expr_range(types, node->left, &left) && expr_range(types, node->right, &right) &&
+		   int_op_range(node->value.op_value, left, right, range);
+}
+
+struct Types_walk
+{
+	Var_types *types;
+	bkd_err_t  error_code;
+	bool       changed;
+	size_t     loop_ID;
+};
+
+static bkd_err_t add_assign(Var_types *types, B_tree_node *node, size_t loop_ID)
+{
+	if(types->assigns_amount >= types->assigns_capacity)
+	{
+		types->assigns_capacity *= REALLOC_COEFF;
+		REALLOC(types->assigns, types->assigns_capacity, Type_assign);
+	}
+
+	types->assigns[types->assigns_amount++] = {.node = node, .loop_ID = loop_ID, .step = 0, .steps_sum = 0,
+											   .bound = NULL};
+
+	return BKD_ALL_GOOD;
+}
+
+static bkd_err_t add_loop(Var_types *types, const B_tree_node *node, size_t *loop_ID)
+{
+	if(types->loops_amount >= types->loops_capacity)
+	{
+		types->loops_capacity *= REALLOC_COEFF;
+		REALLOC(types->loops, types->loops_capacity, Type_loop);
+	}
+
+	types->loops[types->loops_amount] = {.node = node, .parent_ID = *loop_ID,
+										 .assigns_start = types->assigns_amount,
+										 .assigns_end   = types->assigns_amount};
+
+	*loop_ID = types->loops_amount++;
+
+	return BKD_ALL_GOOD;
+}
+
+static Visit_action collect_assigns(B_tree_node *node, void *context)
+{
+	Types_walk *walk = (Types_walk *)context;
+
+	if(node->type == FUNC_DECL || node->type == MAIN)
+	{
+		return VISIT_SKIP;
+	}
+
+	if(node->type == STD_FUNC && node->value.func == GETVAR)
+	{
+		walk->error_code = set_sym_type(walk->types, node->right->value.sym_ID, SYM_FLOAT);
+	}
+	else if(node->type == OP && node->value.op_value == ASS)
+	{
+		walk->error_code = add_assign(walk->types, node, walk->loop_ID);
+	}
+	else if(node->type == WHILE)
+	{
+		walk->error_code = add_loop(walk->types, node, &walk->loop_ID);
+	}
+
+	return walk->error_code == BKD_ALL_GOOD ? VISIT_CONTINUE : VISIT_STOP;
+}
+
+static Visit_action close_loops(B_tree_node *node, void *context)
+{
+	Types_walk *walk = (Types_walk *)context;
+
+	if(node->type == WHILE)
+	{
+		Type_loop *loop = &walk->types->loops[walk->loop_ID];
+
+		loop->assigns_end = walk->types->assigns_amount;
+		walk->loop_ID     = loop->parent_ID;
+	}
+
+	return VISIT_CONTINUE;
+}
+
+static bool is_sym_var(const B_tree_node *node, size_t sym_ID)
+{
+	return node != NULL && node->type == VAR && node->value.sym_ID == sym_ID;
+}
+
+// v = v + c, v = c + v or v = v - c with a nonzero integral c
+static bool get_counter_step(const B_tree_node *assign, double *step)
+{
+	size_t             sym_ID = assign->left->value.sym_ID;
+	const B_tree_node *value  = assign->right;
+
+	if(value->type != OP || value->left == NULL || value->right == NULL)
+	{
+		return false;
+	}
+
+	const B_tree_node *constant = NULL;
+	double             sign     = 1;
+
+	if(value->value.op_value == ADD && is_sym_var(value->left, sym_ID))
+	{
+		constant = value->right;
+	}
+	else if(value->value.op_value == ADD && is_sym_var(value->right, sym_ID))
+	{
+		constant = value->left;
+	}
+	else if(value->value.op_value == SUB && is_sym_var(value->left, sym_ID))
+	{
+		constant = value->right;
+		sign     = -1;
+	}
+
+	if(constant == NULL || constant->type != NUM || !is_int_num(constant->value.num_value) ||
+	   fpclassify(constant->value.num_value) == FP_ZERO)
+	{
+		return false;
+	}
+
+	*step = sign * constant->value.num_value;
+
+	return true;
+}
+
+// the value the condition keeps a rising counter below or a falling one above
+static const B_tree_node *get_counter_bound(const B_tree_node *cond, size_t sym_ID, bool rising)
+{
+	bool is_below = cond->type == BELOW || cond->type == BELOW_EQUAL;
+	bool is_above = cond->type == ABOVE || cond->type == ABOVE_EQUAL;
+
+	if(is_sym_var(cond->left, sym_ID) && (rising ? is_below : is_above))
+	{
+		return cond->right;
+	}
+
+	if(is_sym_var(cond->right, sym_ID) && (rising ? is_above : is_below))
+	{
+		return cond->left;
+	}
+
+	return NULL;
+}
+
+/*
+ * A step of a counter is bound by its loop if the condition of the innermost loop around it keeps the
+ * counter on the side the step moves away from, and every assignment of the counter in the loop body
+ * is such a step of the same loop and direction. At most the sum of the steps is then added past the
+ * bound of the condition in one pass of the body.
+ */
+static void find_counter_steps(Var_types *types)
+{
+	for(size_t assign_ID = 0; assign_ID < types->assigns_amount; assign_ID++)
+	{
+		Type_assign *assign = &types->assigns[assign_ID];
+		size_t       sym_ID = assign->node->left->value.sym_ID;
+		double       step   = 0;
+
+		if(assign->loop_ID == NO_TYPE_LOOP || !get_counter_step(assign->node, &step))
+		{
+			continue;
+		}
+
+		const Type_loop   *loop  = &types->loops[assign->loop_ID];
+		const B_tree_node *bound = get_counter_bound(loop->node->left, sym_ID, step > 0);
+
+		double steps_sum  = 0;
+		bool   only_steps = bound != NULL;
+
+		for(size_t other_ID = loop->assigns_start; other_ID < loop->assigns_end && only_steps; other_ID++)
+		{
+			const Type_assign *other      = &types->assigns[other_ID];
+			double             other_step = 0;
+
+			if(other->node->left->value.sym_ID != sym_ID)
+			{
+				continue;
+			}
+
+			only_steps = other->loop_ID == assign->loop_ID && get_counter_step(other->node, &other_step) &&
+						 (other_step > 0) == (step > 0);
+
+			steps_sum += fabs(other_step);
+		}
+
+		if(only_steps)
+		{
+			assign->step      = step;
+			assign->steps_sum = steps_sum;
+			assign->bound     = bound;
+		}
+	}
+}
+
+static bool assign_range(const Var_types *types, const Type_assign *assign, Int_range *range)
+{
+	Int_range bound = {};
+
+	if(assign->bound == NULL || !expr_range(types, assign->bound, &bound))
+	{
+		return expr_range(types, assign->node->right, range);
+	}
+
+	Int_range counter = get_sym_range(types, assign->node->left->value.sym_ID);
+
+	if(is_empty_range(counter) || is_empty_range(bound))
+	{
+		*range = EMPTY_RANGE;
+	}
+	else if(assign->step > 0)
+	{
+		*range = {.lo = counter.lo + assign->step, .hi = bound.hi + assign->steps_sum};
+	}
+	else
+	{
+		*range = {.lo = bound.lo - assign->steps_sum, .hi = counter.hi + assign->step};
+	}
+
+	return range_fits(*range);
+}
+
+// widens the ranges by the values assigned, a variable without a proven range becomes floating point
+static bkd_err_t solve_ranges(Types_walk *walk, size_t round)
+{
+	bkd_err_t  error_code = BKD_ALL_GOOD;
+	Var_types *types      = walk->types;
+
+	for(size_t assign_ID = 0; assign_ID < types->assigns_amount; assign_ID++)
+	{
+		const Type_assign *assign = &types->assigns[assign_ID];
+		size_t             sym_ID = assign->node->left->value.sym_ID;
+
+		if(get_sym_type(types, sym_ID) != SYM_INT)
+		{
+			continue;
+		}
+
+		Int_range value = {};
+		Int_range old   = types->entries[sym_ID].range;
+
+		if(!assign_range(types, assign, &value))
+		{
+			walk->changed = true;
+
+			CALL(set_sym_type(types, sym_ID, SYM_FLOAT));
+
+			continue;
+		}
+
+		Int_range joined = {.lo = fmin(old.lo, value.lo), .hi = fmax(old.hi, value.hi)};
+
+		if(joined.lo < old.lo || joined.hi > old.hi)
+		{
+			walk->changed = true;
+
+			if(round >= RANGE_WIDEN_ROUND)
+			{
+				CALL(set_sym_type(types, sym_ID, SYM_FLOAT));
+			}
+			else
+			{
+				types->entries[sym_ID].range = joined;
+			}
+		}
+	}
+
+	return error_code;
+}
+
+bkd_err_t infer_types(Var_types *types, B_tree_node *params, B_tree_node *body)
+{
+	bkd_err_t error_code = BKD_ALL_GOOD;
+
+	types->func_ID++;
+	types->assigns_amount = 0;
+	types->loops_amount   = 0;
+
+	for(B_tree_node *param = params; param != NULL; param = param->right)
+	{
+		CALL(set_sym_type(types, param->left->value.sym_ID, SYM_FLOAT));
+	}
+
+	Types_walk walk = {.types = types, .error_code = BKD_ALL_GOOD, .changed = false, .loop_ID = NO_TYPE_LOOP};
+
+	if(visit_tree(body, &collect_assigns, &close_loops, &walk) != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the walk stack.\n", __func__);
+
+		return BKD_UNABLE_TO_ALLOCATE;
+	}
+
+	CALL(walk.error_code);
+
+	for(size_t assign_ID = 0; assign_ID < types->assigns_amount; assign_ID++)
+	{
+		size_t sym_ID = types->assigns[assign_ID].node->left->value.sym_ID;
+
+		if(get_sym_type(types, sym_ID) == SYM_UNKNOWN)
+		{
+			CALL(set_sym_type(types, sym_ID, SYM_INT));
+		}
+	}
+
+	find_counter_steps(types);
+
+	walk.changed = true;
+
+	// the types only go from the integer to the floating point and the ranges only grow until
+	// they are widened, so the loop ends
+	for(size_t round = 0; walk.changed; round++)
+	{
+		walk.changed = false;
+
+		CALL(solve_ranges(&walk, round));
+	}
+
+	return error_code;
+}
@@ -0,0 +1,115 @@
+#ifndef BACKEND_TYPES_H
+#define BACKEND_TYPES_H
+
+#include "backend.h"
+
+const size_t SYM_TYPES_START_CAPACITY = 64;
+const size_t NO_TYPE_LOOP             = (size_t)-1;
+
+enum Sym_type
+{
+	SYM_UNKNOWN = 0,
+	SYM_INT     = 1,
+	SYM_FLOAT   = 2,
+};
+
+/**
+ * @brief Bounds of the values an integer expression takes, empty while lo is above hi.
+ */
+struct Int_range
+{
+	double lo;
+	double hi;
+};
+
+struct Sym_type_entry
+{
+	Sym_type  type;
+	size_t    func_ID;
+	Int_range range;
+};
+
+struct Type_assign
+{
+	B_tree_node       *node;
+	size_t             loop_ID; /**< Innermost loop around the assignment, NO_TYPE_LOOP if none. */
+	double             step; /**< Constant added by a counter step bound by its loop, 0 if it isn't one. */
+	double             steps_sum; /**< Sum of the steps of the counter over one pass of the loop body. */
+	const B_tree_node *bound; /**< Value the loop condition compares the counter with. */
+};
+
+struct Type_loop
+{
+	const B_tree_node *node;
+	size_t             parent_ID;
+	size_t             assigns_start; /**< The assignments of the loop body are the ones from start to end. */
+	size_t             assigns_end;
+};
+
+struct Var_types
+{
+	Sym_type_entry  *entries;
+	size_t           capacity;
+	size_t           func_ID;
+	Type_assign     *assigns;
+	size_t           assigns_amount;
+	size_t           assigns_capacity;
+	Type_loop       *loops;
+	size_t           loops_amount;
+	size_t           loops_capacity;
+};
+
+/**
+ * @brief Infers which variables of a function hold integers only, so they get the integer registers.
+ *
+ * A variable is an integer one if every value assigned to it is: an integral number up to 2^53,
+ * an integer variable, a relation, or the sum, the difference or the product of integer values,
+ * and if the range of its values is proven to stay within 2^53, so the int64 registers never wrap
+ * and the doubles of the stack and the RAM hold the values exactly. The ranges are solved over all
+ * the assignments of the function at once. A counter stepped by a constant in a loop whose condition
+ * bounds it, such as i = i + 1 under i < n, gets the range up to the bound. A range that still grows
+ * after a few rounds, such as the one of x = x * 10 in a loop, has no proven bound, so its variable
+ * is a floating point one.
+ *
+ * The arguments and the variables read by getvar are floating point, as is everything that divides,
+ * takes a root or comes from a call or the RAM. Only what is assigned to a variable picks its type:
+ * an integer variable read into a floating point operation, a relation, a call or a return stays
+ * integer, as its value crosses the stack as a double anyway. The variables start as the integer
+ * ones and are turned into the floating point ones until nothing changes.
+ *
+ * The types are kept until the next function is inferred, the nested function declarations are
+ * left to themselves.
+ *
+ * @param types Types made by var_types_ctor().
+ * @param params Chain of the arguments of the function, NULL for main.
+ * @param body Body of the function.
+ */
+bkd_err_t   infer_types      (Var_types *types, B_tree_node *params, B_tree_node *body);
+
+/**
+ * @brief Gets the inferred type of the symbol, SYM_UNKNOWN if the current function never assigns it.
+ */
+Sym_type    get_sym_type     (const Var_types *types, size_t sym_ID);
+
+/**
+ * @brief Gets the range of the values of an integer variable of the current function.
+ */
+Int_range   get_sym_range    (const Var_types *types, size_t sym_ID);
+
+/**
+ * @brief Gets the range of the integer operation on the operand ranges.
+ *
+ * @return bool Whether the operation is an integer one and its values are within 2^53.
+ */
+bool        int_op_range     (Ops op, Int_range left, Int_range right, Int_range *range);
+
+/**
+ * @brief Checks whether the number is integral and is exact in an integer register and on the stack.
+ */
+bool        is_int_num       (double num);
+
+bkd_err_t   var_types_ctor   (Var_types *types);
+
+void        var_types_dtor   (Var_types *types);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include <stdint.h>
+
+#include "b_tree.h"
+
+/**
+ * @file compile_cache.h
+ * @brief Content-addressed cache of the compilation results.
+ *
+ * An entry is keyed by the hash of the source file, the compiler version, the
+ * contents of the compiler executable and the build options, and holds the source,
+ * the optimized AST in the binary format of save_compact_tree(), the byte code,
+ * the label map and the assembly code if the backend dumps it. A hit
+ * compares the stored source byte for byte, so a hash collision is a miss.
+ * The entries are evicted least recently used first once the cache directory
+ * outgrows its size limit.
+ */
+
+#define STRINGIFY_OPTION(option) #option
+#define OPTION_VALUE(option) STRINGIFY_OPTION(option)
+
+#ifdef BKD_NO_PEEPHOLE
+	#define CACHE_PEEPHOLE_OPTION " no_peephole"
+#else
+	#define CACHE_PEEPHOLE_OPTION ""
+#endif
+
+#ifdef BKD_DUMP_ASM
+	#define CACHE_DUMP_OPTION " dump_asm"
+#else
+	#define CACHE_DUMP_OPTION ""
+#endif
+
+#ifdef MID_MEMOIZE
+	#define CACHE_MEMO_OPTION " memoize"
+#else
+	#define CACHE_MEMO_OPTION ""
+#endif
+
+#ifdef ASM_LEGACY_BYTE_CODE
+	#define CACHE_BYTE_CODE_OPTION " legacy_byte_code"
+#else
+	#define CACHE_BYTE_CODE_OPTION ""
+#endif
+
+#ifdef SPU_REGS_AMOUNT
+	#define CACHE_REGS_OPTION " regs=" OPTION_VALUE(SPU_REGS_AMOUNT)
+#else
+	#define CACHE_REGS_OPTION ""
+#endif
+
+/**
+ * @def CACHE_BUILD_OPTIONS
+ * @brief Build flags that change the compilation results, as seen by the driver.
+ */
+#define CACHE_BUILD_OPTIONS\
+	"options:" CACHE_PEEPHOLE_OPTION CACHE_DUMP_OPTION CACHE_MEMO_OPTION CACHE_BYTE_CODE_OPTION CACHE_REGS_OPTION
+
+const char   COMPILER_VERSION[]     = "tatlang 13"; /**< Bump it whenever the compilation results change. */
+const char   STD_CACHE_DIR[]        = "tat_cache"; /**< Cache directory if the config has no cache_dir. */
+const size_t STD_CACHE_SIZE         = 64 * 1024 * 1024; /**< Size limit in bytes if the config has no cache_size. */
+const size_t CACHE_DIR_SIZE         = 256; /**< Buffer size of the cache directory name. */
+const size_t CACHE_KEY_SIZE         = 17; /**< Hex digits of the key and the terminating zero. */
+const size_t CACHE_OPTIONS_SIZE     = 512; /**< Buffer size of the compiler description. */
+
+typedef enum
+{
+	CCH_ALL_GOOD            = 0, /**< No errors occurred. */
+	CCH_UNABLE_TO_OPEN_FILE = 1 << 0, /**< Unable to open file error. */
+	CCH_UNABLE_TO_ALLOCATE  = 1 << 1, /**< Memory allocation error. */
+	CCH_INVALID_FWRITE      = 1 << 2, /**< The amount of written elements is unexpected. */
+	CCH_UNAVAILABLE         = 1 << 3, /**< The cache is disabled or the platform has no directories. */
+} cch_err_t;
+
+/**
+ * @struct Compile_cache
+ * @brief Structure representing the settings of the cache.
+ */
+struct Compile_cache
+{
+	char   dir[CACHE_DIR_SIZE]; /**< Cache directory. */
+	size_t size_limit; /**< Size limit of the directory in bytes, 0 disables the cache. */
+};
+
+/**
+ * @struct Cache_key
+ * @brief Structure representing the key of a cache entry.
+ */
+struct Cache_key
+{
+	char     name[CACHE_KEY_SIZE]; /**< Hash in hex, which names the entry files. */
+	char     compiler[CACHE_OPTIONS_SIZE]; /**< Compiler version, executable hash and options. */
+	char    *source; /**< Contents of the source file. */
+	size_t   source_size; /**< Size of the source file in bytes. */
+};
+
+/**
+ * @brief Reads the cache settings and creates the cache directory.
+ *
+ * The config has the "key: value" lines cache_dir and cache_size, the missing ones get
+ * STD_CACHE_DIR and STD_CACHE_SIZE. A missing config file gives the defaults as well.
+ *
+ * @param cache Pointer to the cache to fill.
+ * @param config_file Path to the config file.
+ * @return cch_err_t Returns CCH_UNAVAILABLE if the cache is disabled or can't be created.
+ */
+cch_err_t cache_ctor(Compile_cache *cache, const char *config_file);
+
+/**
+ * @brief Computes the key of the source file.
+ *
+ * @param key Pointer to the key to fill, freed by cache_key_dtor().
+ * @param source_file Path to the source file.
+ * @param compiler_file Path to the compiler executable, usually argv[0]. Its contents are hashed,
+ * so rebuilding the compiler invalidates the cache. May be NULL.
+ * @param options Build and run options that change the compilation results.
+ * @return cch_err_t Returns an error code indicating the status of the hashing.
+ */
+cch_err_t cache_key(Cache_key *key, const char *source_file, const char *compiler_file,
+					const char *options);
+
+/**
+ * @brief Frees the key.
+ *
+ * @param key Pointer to the key.
+ */
+void      cache_key_dtor(Cache_key *key);
+
+/**
+ * @brief Looks the entry up and on a hit copies its byte code, label map and assembly code out.
+ *
+ * A hit marks the entry as the most recently used one.
+ *
+ * @param cache Pointer to the cache.
+ * @param key Pointer to the key.
+ * @param name Name the files are copied to: name.bin, name.labels and name if the entry has the assembly code.
+ * @return bool Returns true on a hit.
+ */
+bool      cache_lookup(Compile_cache *cache, const Cache_key *key, const char *name);
+
+/**
+ * @brief Stores the compilation results and evicts the least recently used entries over the size limit.
+ *
+ * @param cache Pointer to the cache.
+ * @param key Pointer to the key.
+ * @param root Optimized AST.
+ * @param name Name of the byte code name.bin and the label map name.labels, and of the assembly code if it is dumped.
+ * @return cch_err_t Returns an error code indicating the status of the storing.
+ */
+cch_err_t cache_store(Compile_cache *cache, const Cache_key *key, B_tree_node *root, const char *name);
+
+/**
+ * @brief Removes the least recently used entries until the cache fits its size limit.
+ *
+ * @param cache Pointer to the cache.
+ * @param keep Name of the entry which is never removed, may be NULL.
+ * @return size_t Returns the amount of removed entries.
+ */
+size_t    cache_evict(Compile_cache *cache, const char *keep);
+
+#endif
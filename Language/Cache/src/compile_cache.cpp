@@ -0,0 +1,517 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "compile_cache.h"
+#include "utils.h"
+
+/**
+ * @def CACHE_AVAILABLE
+ * @brief Enables the cache, which needs POSIX directories and timestamps.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+	#define CACHE_AVAILABLE
+
+	#include <dirent.h>
+	#include <sys/stat.h>
+	#include <sys/time.h>
+	#include <unistd.h>
+
+	#ifdef __APPLE__
+		#define MTIME_NS(stat) ((uint64_t)(stat).st_mtimespec.tv_sec * 1000000000 + (uint64_t)(stat).st_mtimespec.tv_nsec)
+	#else
+		#define MTIME_NS(stat) ((uint64_t)(stat).st_mtim.tv_sec * 1000000000 + (uint64_t)(stat).st_mtim.tv_nsec)
+	#endif
+#endif
+
+#define LOG(...)\
+	LOG_AT(LOG_LEVEL_INFO, LOG_SINK_CACHE, __VA_ARGS__);
+
+const size_t   CACHE_PATH_SIZE  = CACHE_DIR_SIZE + CACHE_KEY_SIZE + 16;
+
+/**
+ * @brief Extensions of the entry files, the meta file goes last so it marks a complete entry.
+ */
+static const char *ENTRY_FILES[] = {".src", ".ast", ".asm", ".bin", ".labels", ".meta"};
+
+const size_t ENTRY_FILES_AMOUNT = sizeof(ENTRY_FILES) / sizeof(ENTRY_FILES[0]);
+
+/**
+ * @struct Output_file
+ * @brief Structure representing a compilation result, which is copied into and out of an entry.
+ */
+struct Output_file
+{
+	const char *extension; /**< Extension the compiler writes the file with. */
+	const char *entry_extension; /**< Extension of the entry file. */
+	bool        optional; /**< The compiler writes the file only in some builds. */
+};
+
+static const Output_file OUTPUT_FILES[] =
+{
+	{"",        ".asm",    true }, // the backend writes the assembly code only if it's built with BKD_DUMP_ASM
+	{".bin",    ".bin",    false},
+	{".labels", ".labels", false},
+};
+
+const size_t OUTPUT_FILES_AMOUNT = sizeof(OUTPUT_FILES) / sizeof(OUTPUT_FILES[0]);
+
+/**
+ * @struct Cache_entry
+ * @brief Structure representing an entry found by the eviction scan.
+ */
+struct Cache_entry
+{
+	char     name[CACHE_KEY_SIZE]; /**< Key of the entry. */
+	uint64_t used_ns; /**< Time of the last store or hit. */
+	size_t   size; /**< Size of all the entry files. */
+};
+
+static char *read_file(const char *file_name, size_t *size)
+{
+	FILE *file = fopen(file_name, "rb");
+	if(file == NULL)
+	{
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if(length < 0)
+	{
+		fclose(file);
+
+		return NULL;
+	}
+
+	char *buf = (char *)calloc((size_t)length + 1, sizeof(char));
+	if(buf == NULL)
+	{
+		fclose(file);
+
+		return NULL;
+	}
+
+	*size = fread(buf, sizeof(char), (size_t)length, file);
+	fclose(file);
+
+	if(*size != (size_t)length)
+	{
+		free(buf);
+
+		return NULL;
+	}
+
+	return buf;
+}
+
+static bool write_file(const char *file_name, const char *buf, size_t size)
+{
+	FILE *file = fopen(file_name, "wb");
+	if(file == NULL)
+	{
+		return false;
+	}
+
+	size_t written_elems = fwrite(buf, sizeof(char), size, file);
+
+	return (fclose(file) == 0) && written_elems == size;
+}
+
+static bool copy_file(const char *src_name, const char *dst_name)
+{
+	size_t size = 0;
+	char  *buf  = read_file(src_name, &size);
+	if(buf == NULL)
+	{
+		return false;
+	}
+
+	bool copied = write_file(dst_name, buf, size);
+	free(buf);
+
+	return copied;
+}
+
+static void entry_path(char *path, const Compile_cache *cache, const char *name, const char *extension)
+{
+	snprintf(path, CACHE_PATH_SIZE, "%s/%s%s", cache->dir, name, extension);
+}
+
+cch_err_t cache_ctor(Compile_cache *cache, const char *config_file)
+{
+	snprintf(cache->dir, CACHE_DIR_SIZE, "%s", STD_CACHE_DIR);
+	cache->size_limit = STD_CACHE_SIZE;
+
+	FILE *config = fopen(config_file, "r");
+	if(config != NULL)
+	{
+		char line[CACHE_DIR_SIZE + 32] = {};
+
+		while(fgets(line, sizeof(line), config) != NULL)
+		{
+			char   dir[CACHE_DIR_SIZE] = {};
+			size_t size_limit          = 0;
+
+			if(sscanf(line, "cache_dir: %255s", dir) == 1)
+			{
+				snprintf(cache->dir, CACHE_DIR_SIZE, "%s", dir);
+			}
+			else if(sscanf(line, "cache_size: %lu", &size_limit) == 1)
+			{
+				cache->size_limit = size_limit;
+			}
+		}
+
+		fclose(config);
+	}
+
+	if(cache->size_limit == 0)
+	{
+		return CCH_UNAVAILABLE;
+	}
+
+#ifdef CACHE_AVAILABLE
+	struct stat dir_stat = {};
+
+	if(stat(cache->dir, &dir_stat) != 0 && mkdir(cache->dir, 0755) != 0)
+	{
+		LOG("ERROR: Unable to create the cache directory %s.\n", cache->dir);
+
+		return CCH_UNAVAILABLE;
+	}
+
+	return CCH_ALL_GOOD;
+#else
+	return CCH_UNAVAILABLE;
+#endif
+}
+
+cch_err_t cache_key(Cache_key *key, const char *source_file, const char *compiler_file,
+					const char *options)
+{
+	key->source = read_file(source_file, &key->source_size);
+	if(key->source == NULL)
+	{
+		LOG("ERROR: Unable to read the source %s.\n", source_file);
+
+		return CCH_UNABLE_TO_OPEN_FILE;
+	}
+
+	uint64_t compiler_hash = 0;
+	size_t   compiler_size = 0;
+	char    *compiler      = (compiler_file == NULL) ? NULL : read_file(compiler_file, &compiler_size);
+
+	if(compiler != NULL)
+	{
+		compiler_hash = hash_bytes(HASH_OFFSET_BASIS, compiler, compiler_size);
+		free(compiler);
+	}
+
+	snprintf(key->compiler, CACHE_OPTIONS_SIZE, "%s exe=%016lx %s",
+			 COMPILER_VERSION, (unsigned long)compiler_hash, options);
+
+	uint64_t hash = hash_bytes(HASH_OFFSET_BASIS, key->source, key->source_size);
+	hash = hash_bytes(hash, key->compiler, strlen(key->compiler));
+
+	snprintf(key->name, CACHE_KEY_SIZE, "%016lx", (unsigned long)hash);
+
+	return CCH_ALL_GOOD;
+}
+
+void cache_key_dtor(Cache_key *key)
+{
+	free(key->source);
+
+	*key = {};
+}
+
+static bool entry_matches(Compile_cache *cache, const Cache_key *key)
+{
+	char path[CACHE_PATH_SIZE] = {};
+
+	entry_path(path, cache, key->name, ".meta");
+
+	size_t meta_size = 0;
+	char  *meta      = read_file(path, &meta_size);
+	if(meta == NULL)
+	{
+		return false;
+	}
+
+	char expected[CACHE_OPTIONS_SIZE + 32] = {};
+	snprintf(expected, sizeof(expected), "%s\n%lu\n", key->compiler, key->source_size);
+
+	bool matches = !strcmp(meta, expected);
+	free(meta);
+
+	if(!matches)
+	{
+		return false;
+	}
+
+	entry_path(path, cache, key->name, ".src");
+
+	size_t source_size = 0;
+	char  *source      = read_file(path, &source_size);
+	if(source == NULL)
+	{
+		return false;
+	}
+
+	matches = source_size == key->source_size && !memcmp(source, key->source, source_size);
+	free(source);
+
+	return matches;
+}
+
+bool cache_lookup(Compile_cache *cache, const Cache_key *key, const char *name)
+{
+#ifdef CACHE_AVAILABLE
+	if(cache->size_limit == 0 || key->source == NULL || !entry_matches(cache, key))
+	{
+		LOG("Miss %s.\n", key->name);
+
+		return false;
+	}
+
+	char   path[CACHE_PATH_SIZE]     = {};
+	char   out_path[CACHE_PATH_SIZE] = {};
+
+	for(size_t file_ID = 0; file_ID < OUTPUT_FILES_AMOUNT; file_ID++)
+	{
+		entry_path(path, cache, key->name, OUTPUT_FILES[file_ID].entry_extension);
+		snprintf(out_path, CACHE_PATH_SIZE, "%s%s", name, OUTPUT_FILES[file_ID].extension);
+
+		if(OUTPUT_FILES[file_ID].optional && access(path, F_OK) != 0)
+		{
+			continue;
+		}
+
+		if(!copy_file(path, out_path))
+		{
+			LOG("ERROR: Unable to copy %s out of the cache.\n", path);
+
+			return false;
+		}
+	}
+
+	entry_path(path, cache, key->name, ".meta");
+	utimes(path, NULL);
+
+	LOG("Hit %s.\n", key->name);
+
+	return true;
+#else
+	(void)cache;
+	(void)key;
+	(void)name;
+
+	return false;
+#endif
+}
+
+cch_err_t cache_store(Compile_cache *cache, const Cache_key *key, B_tree_node *root, const char *name)
+{
+#ifdef CACHE_AVAILABLE
+	if(cache->size_limit == 0 || key->source == NULL)
+	{
+		return CCH_UNAVAILABLE;
+	}
+
+	char path[CACHE_PATH_SIZE]    = {};
+	char in_path[CACHE_PATH_SIZE] = {};
+
+	// a stale meta file would mark the half written entry as complete
+	entry_path(path, cache, key->name, ".meta");
+	remove(path);
+
+	entry_path(path, cache, key->name, ".src");
+	if(!write_file(path, key->source, key->source_size))
+	{
+		LOG("ERROR: Unable to write %s.\n", path);
+
+		return CCH_INVALID_FWRITE;
+	}
+
+	entry_path(path, cache, key->name, ".ast");
+
+	Compact_tree ast = {};
+	if(compact_tree_ctor(&ast, 0) != B_TREE_ALL_GOOD || pack_tree(&ast, root) != B_TREE_ALL_GOOD ||
+	   save_compact_tree(&ast, path) != B_TREE_ALL_GOOD)
+	{
+		LOG("ERROR: Unable to write %s.\n", path);
+		compact_tree_dtor(&ast);
+
+		return CCH_INVALID_FWRITE;
+	}
+
+	compact_tree_dtor(&ast);
+
+	for(size_t file_ID = 0; file_ID < OUTPUT_FILES_AMOUNT; file_ID++)
+	{
+		snprintf(in_path, CACHE_PATH_SIZE, "%s%s", name, OUTPUT_FILES[file_ID].extension);
+		entry_path(path, cache, key->name, OUTPUT_FILES[file_ID].entry_extension);
+
+		if(OUTPUT_FILES[file_ID].optional && access(in_path, F_OK) != 0)
+		{
+			remove(path);
+
+			continue;
+		}
+
+		if(!copy_file(in_path, path))
+		{
+			LOG("ERROR: Unable to copy %s into the cache.\n", in_path);
+
+			return CCH_INVALID_FWRITE;
+		}
+	}
+
+	char meta[CACHE_OPTIONS_SIZE + 32] = {};
+	int  meta_size = snprintf(meta, sizeof(meta), "%s\n%lu\n", key->compiler, key->source_size);
+
+	entry_path(path, cache, key->name, ".meta");
+	if(!write_file(path, meta, (size_t)meta_size))
+	{
+		LOG("ERROR: Unable to write %s.\n", path);
+
+		return CCH_INVALID_FWRITE;
+	}
+
+	LOG("Stored %s.\n", key->name);
+
+	cache_evict(cache, key->name);
+
+	return CCH_ALL_GOOD;
+#else
+	(void)cache;
+	(void)key;
+	(void)root;
+	(void)name;
+
+	return CCH_UNAVAILABLE;
+#endif
+}
+
+#ifdef CACHE_AVAILABLE
+static int cmp_entries(const void *first, const void *second)
+{
+	uint64_t first_ns  = ((const Cache_entry *)first)->used_ns;
+	uint64_t second_ns = ((const Cache_entry *)second)->used_ns;
+
+	return (first_ns > second_ns) - (first_ns < second_ns);
+}
+
+static void remove_entry(Compile_cache *cache, const char *name)
+{
+	char path[CACHE_PATH_SIZE] = {};
+
+	// the meta file goes first, so a half removed entry is never hit
+	for(size_t file_ID = ENTRY_FILES_AMOUNT; file_ID > 0; file_ID--)
+	{
+		entry_path(path, cache, name, ENTRY_FILES[file_ID - 1]);
+		remove(path);
+	}
+}
+#endif
+
+size_t cache_evict(Compile_cache *cache, const char *keep)
+{
+#ifdef CACHE_AVAILABLE
+	DIR *dir = opendir(cache->dir);
+	if(dir == NULL)
+	{
+		return 0;
+	}
+
+	size_t       capacity = 16;
+	size_t       amount   = 0;
+	size_t       total    = 0;
+	Cache_entry *entries  = (Cache_entry *)calloc(capacity, sizeof(Cache_entry));
+
+	const size_t meta_len = strlen(".meta");
+
+	for(struct dirent *file = readdir(dir); file != NULL && entries != NULL; file = readdir(dir))
+	{
+		size_t name_len = strlen(file->d_name);
+
+		if(name_len != CACHE_KEY_SIZE - 1 + meta_len ||
+		   strcmp(file->d_name + CACHE_KEY_SIZE - 1, ".meta"))
+		{
+			continue;
+		}
+
+		if(amount == capacity)
+		{
+			capacity *= 2;
+
+			Cache_entry *grown = (Cache_entry *)realloc(entries, capacity * sizeof(Cache_entry));
+			if(grown == NULL)
+			{
+				break;
+			}
+
+			entries = grown;
+		}
+
+		Cache_entry *entry = &entries[amount];
+		*entry = {};
+		memcpy(entry->name, file->d_name, CACHE_KEY_SIZE - 1);
+
+		char        path[CACHE_PATH_SIZE] = {};
+		struct stat file_stat             = {};
+
+		for(size_t file_ID = 0; file_ID < ENTRY_FILES_AMOUNT; file_ID++)
+		{
+			entry_path(path, cache, entry->name, ENTRY_FILES[file_ID]);
+
+			if(stat(path, &file_stat) == 0)
+			{
+				entry->size += (size_t)file_stat.st_size;
+				entry->used_ns = MTIME_NS(file_stat);
+			}
+		}
+
+		total += entry->size;
+		amount++;
+	}
+
+	closedir(dir);
+
+	size_t removed = 0;
+
+	if(entries != NULL && total > cache->size_limit)
+	{
+		qsort(entries, amount, sizeof(Cache_entry), cmp_entries);
+
+		for(size_t entry_ID = 0; entry_ID < amount && total > cache->size_limit; entry_ID++)
+		{
+			if(keep != NULL && !strcmp(entries[entry_ID].name, keep))
+			{
+				continue;
+			}
+
+			LOG("Evicted %s, %lu bytes.\n", entries[entry_ID].name, entries[entry_ID].size);
+
+			remove_entry(cache, entries[entry_ID].name);
+			total -= entries[entry_ID].size;
+			removed++;
+		}
+	}
+
+	free(entries);
+
+	return removed;
+#else
+	(void)cache;
+	(void)keep;
+
+	return 0;
+#endif
+}
+
+#undef LOG
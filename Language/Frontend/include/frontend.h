@@ -14,8 +14,31 @@ typedef enum
 	FRD_INVALID_FREAD       = 1 << 3, /**< The amount of read elements is unexpexted. */
 	FRD_UKNOWN_OP           = 1 << 4,
 	FRD_INVALID_VAR_SYMBOL  = 1 << 5,
+	FRD_TOO_LONG_TOKEN      = 1 << 6, /**< A name or a number is longer than MAX_TOKEN_SIZE - 1 symbols. */
 } frd_err_t;
 
+/**
+ * @brief Tokenizes the whole source file.
+ */
 Tokens *tokenize(const char *file, frd_err_t *error_code);
 
+/**
+ * @brief Opens the source file for tokens lexed as the parser asks for them.
+ *
+ * The file is mapped and decoded from UTF-8 on the fly. A lexing error goes to error_code,
+ * which has to outlive the parsing, and ends the tokens. Every call has its own names and symbol IDs
+ * and no shared state, so several sources may be tokenized and parsed at once on different threads.
+ */
+Tokens *stream_tokens(const char *file, frd_err_t *error_code);
+
+/**
+ * @brief Frees the tokens and closes their source, the names stay for the tree.
+ */
+void    close_tokens(Tokens *tokens);
+
+/**
+ * @brief Finds the line and the column, both from 1, of a token offset in the source file.
+ */
+frd_err_t source_position(const char *file, size_t offset, size_t *line, size_t *column);
+
 #endif
@@ -8,9 +8,6 @@
 	if(*error_code != FRD_ALL_GOOD)									\
 		return NULL;
 
-#define LEFT_AMOUNT													\
-	(file_len - (size_t)(symbs - symbs_start))
-
 //was: LOG(L"ERROR:\n\tUnable to allocate "#ptr".\n");
 
 #define ALLOCATION_CHECK(ptr)										\
@@ -27,9 +27,6 @@
 	if(error_code != FRD_ALL_GOOD)									\
 		return error_code;
 
-#define LEFT_AMOUNT													\
-	(file_len - (size_t)(*symbs_ptr - symbs_start))
-
 #define CASE(sym, type)										\
 	case sym:												\
 	{														\
@@ -37,7 +34,7 @@
 															\
 		CALL(add_token(tokens, type, {.num_value = 0}));	\
 															\
-		(*symbs_ptr)++;										\
+		src_next(src); 										\
 															\
 		break;												\
 	}
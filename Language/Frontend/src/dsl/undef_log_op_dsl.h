@@ -7,7 +7,7 @@
 																\
 		CALL(add_token(tokens, type, {.num_value = 0}));		\
 																\
-		(*symbs_ptr)++;											\
+		src_next(src); 											\
 																\
 		return error_code;										\
 	}
@@ -1,6 +1,5 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <clocale>
 
 #include "frontend.h"
 #include "frontend_secondary.h"
@@ -8,63 +7,121 @@
 
 #include "def_frd_dsl.h"
 
-Tokens *tokenize(const char *file, frd_err_t *error_code)
+static void lexer_dtor(Lexer *lexer)
 {
-	setlocale(LC_ALL, "");
+	src_close(&lexer->src);
+	symbols_dtor(&lexer->symbols);
+
+	free(lexer);
+}
+
+static bool lex_more(Tokens *tokens)
+{
+	Lexer *lexer = (Lexer *)tokens->source;
+	if(lexer == NULL || lexer->done)
+	{
+		return false;
+	}
+
+	frd_err_t error_code = lex_token(lexer, tokens);
+	if(error_code != FRD_ALL_GOOD)
+	{
+		*lexer->error_code = error_code;
+		lexer->done = true;
+	}
+
+	if(lexer->done)
+	{
+		src_close(&lexer->src);
+		dump_tokens(tokens);
+	}
 
+	return error_code == FRD_ALL_GOOD;
+}
+
+Tokens *stream_tokens(const char *file, frd_err_t *error_code)
+{
 	Tokens *tokens = NULL;
 	CALLOC(tokens, 1, Tokens);
-	CALL(init_tokens(tokens));
 
-	size_t file_len = 0;
+	Lexer *lexer = NULL;
+	CALLOC(lexer, 1, Lexer);
 
-	wchar_t *symbs = get_symbs(file, error_code, &file_len);
-	CHECK_ERROR(error_code);
+	lexer->error_code = error_code;
+	CALL(src_open(&lexer->src, file));
 
-	wchar_t *symbs_start = symbs;
+	CALL(init_tokens(tokens, lexer->src.size));
+
+	tokens->more   = &lex_more;
+	tokens->source = lexer;
+
+	return tokens;
+}
 
+Tokens *tokenize(const char *file, frd_err_t *error_code)
+{
+	Tokens *tokens = stream_tokens(file, error_code);
+	CHECK_ERROR;
 
-	while((size_t)(symbs - symbs_start) < file_len)
+	while(lex_more(tokens))
 	{
-		wchar_t cur_symb = *symbs;
-		LOG(L"\nCurrent symbol: %lc\n", cur_symb);
+		;
+	}
 
-		if(is_blank(cur_symb))
-		{
-			LOG(L"It's blank.\n");
+	CHECK_ERROR;
 
-			symbs++;
-		}
-		else if(is_number(cur_symb))
+	lexer_dtor((Lexer *)tokens->source);
+
+	tokens->more   = NULL;
+	tokens->source = NULL;
+
+	return tokens;
+}
+
+void close_tokens(Tokens *tokens)
+{
+	if(tokens == NULL)
+	{
+		return;
+	}
+
+	Lexer *lexer = (Lexer *)tokens->source;
+	if(lexer != NULL)
+	{
+		lexer_dtor(lexer);
+	}
+
+	tokens_dtor(tokens);
+	free(tokens);
+}
+
+frd_err_t source_position(const char *file, size_t offset, size_t *line, size_t *column)
+{
+	size_t size = 0;
+	char *data = map_file(file, &size);
+	if(data == NULL)
+	{
+		return FRD_UNABLE_TO_OPEN_FILE;
+	}
+
+	*line   = 1;
+	*column = 1;
+
+	for(size_t byte_ID = 0; byte_ID < offset && byte_ID < size; byte_ID++)
+	{
+		if(data[byte_ID] == '\n')
 		{
-			CALL(add_num(tokens, &symbs));
+			(*line)++;
+			*column = 1;
 		}
-		//else if(process_sym(&symbs, tokens, LEFT_AMOUNT, &processed));) //returns bool
-		else
+		// the continuation bytes of UTF-8 are a part of the same character
+		else if(((unsigned char)data[byte_ID] & 0xC0) != 0x80)
 		{
-			bool processed = false;
-
-			CALL(process_sym(&symbs, tokens, LEFT_AMOUNT, &processed));
-
-			if(!processed)
-			{
-				if(is_op(cur_symb))
-				{
-					CALL(process_op(&symbs, tokens));
-				}
-				else
-				{
-					CALL(process_id(&symbs, tokens));
-				}
-			}
+			(*column)++;
 		}
-
-
 	}
 
+	unmap_file(data, size);
 
-	CALL(add_token(tokens, END, {.num_value = 0}));
-	dump_tokens(tokens);
-
-	return tokens;
+	return FRD_ALL_GOOD;
 }
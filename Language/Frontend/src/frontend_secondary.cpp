@@ -6,41 +6,10 @@
 
 #include "frontend_secondary.h"
 #include "utils.h"
-#include "file_parser.h"
 
 #include "def_scnd_dsl.h"
 
 
-void frd_write_log(const char *file_name, const wchar_t *fmt, ...)
-{
-    static FILE *log_file = fopen(file_name, "w");
-
-    if(log_file == NULL)
-	{
-        perror("Error opening log_file");
-        return;
-    }
-
-    va_list args = NULL;
-
-    va_start(args, fmt);
-
-    vfwprintf(log_file, fmt, args);
-
-    va_end(args);
-}
-
-wchar_t *skip_nums(wchar_t *symbs)
-{
-	while(	(*(symbs) >= L'0' && *(symbs) <= L'9') ||
-			 *(symbs) == L'.')
-	{
-		symbs++;
-	}
-
-	return symbs;
-}
-
 bool is_number(wchar_t sym)
 {
 	if(sym >= L'0' && sym <= L'9')
@@ -85,26 +54,23 @@ bool is_blank(wchar_t sym)
 	}
 }
 
-wchar_t *skip_comment(wchar_t *symbs, size_t left_amount)
+void skip_comment(Src_stream *src)
 {
-	size_t skip_ct = 0;
-
-	while(*symbs != L'\n' && skip_ct < left_amount)
+	while(src->pos < src->size && src->cur != L'\n')
 	{
-		symbs++;
-		skip_ct++;
+		src_next(src);
 	}
 
-	symbs++;
-
-	return symbs;
+	src_next(src);
 }
 
-frd_err_t init_tokens(Tokens *tokens)
+frd_err_t init_tokens(Tokens *tokens, size_t src_size)
 {
-	CALLOC(tokens->data, STARTER_TOKENS_AMOUNT, B_tree_node);
+	size_t capacity = src_size / SRC_BYTES_PER_TOKEN + STARTER_TOKENS_AMOUNT;
+
+	CALLOC(tokens->data, capacity, Token);
 	tokens->size = 0;
-	tokens->capacity = STARTER_TOKENS_AMOUNT;
+	tokens->capacity = capacity;
 
 	LOG(L"Tokens itited.\n");
 
@@ -128,7 +94,7 @@ frd_err_t add_token(Tokens *tokens, Node_type type, Node_value value)
 
 		tokens->capacity *= 2;
 
-		REALLOC(tokens->data, tokens->capacity, B_tree_node);
+		REALLOC(tokens->data, tokens->capacity, Token);
 
 		// if(tokens->capacity > 10000)
 		// {
@@ -139,12 +105,31 @@ frd_err_t add_token(Tokens *tokens, Node_type type, Node_value value)
 		LOG(L"tokens->data reallocated successfuly.");
 	}
 
-	tokens->data[tokens->size].type  = type;
-	tokens->data[tokens->size].value = value;
+	Token *token = &tokens->data[tokens->size];
+
+	*token = {.value = {.num_value = 0}, .sym_ID = 0, .offset = 0, .type = type};
+
+	if(type == NUM)
+	{
+		token->value.num_value = value.num_value;
+	}
+	else if(type == OP || type == UNR_OP)
+	{
+		token->value.op_value = value.op_value;
+	}
+	else if(type == STD_FUNC)
+	{
+		token->value.func = value.func;
+	}
+	else if(type == VAR || type == FUNC)
+	{
+		token->value.var_value = value.var_value;
+		token->sym_ID          = (uint32_t)value.sym_ID;
+	}
 
 	LOG(L"New token\n");
-	LOG(L"\taddress: %p\n", tokens->data[tokens->size]);
-	LOG(L"\ttype: %d\n", tokens->data[tokens->size].type);
+	LOG(L"\taddress: %p\n", token);
+	LOG(L"\ttype: %d\n", token->type);
 
 	tokens->size++;
 
@@ -187,7 +172,86 @@ Ops get_op(wchar_t sym, frd_err_t *error_code)
 	}
 }
 
-frd_err_t add_id(Tokens *tokens, wchar_t *token, bool is_func)
+static size_t *find_bucket(Symbol_table *symbols, const wchar_t *name)
+{
+	size_t mask = symbols->capacity * 2 - 1;
+	size_t hash = hash_bytes(HASH_OFFSET_BASIS, name, wcslen(name) * sizeof(wchar_t));
+
+	for(size_t bucket_ID = hash & mask;; bucket_ID = (bucket_ID + 1) & mask)
+	{
+		size_t *bucket = &symbols->buckets[bucket_ID];
+
+		if(*bucket == NO_BUCKET || !wcsncmp(symbols->names[*bucket - 1], name, MAX_TOKEN_SIZE))
+		{
+			return bucket;
+		}
+	}
+}
+
+static frd_err_t grow_symbols(Symbol_table *symbols)
+{
+	size_t new_capacity = symbols->capacity == 0 ? SYMBOLS_START_CAPACITY : symbols->capacity * 2;
+
+	REALLOC(symbols->names, new_capacity, wchar_t *);
+
+	free(symbols->buckets);
+	symbols->capacity = new_capacity;
+
+	// the buckets are twice as many as the names, so the probes stay short
+	CALLOC(symbols->buckets, new_capacity * 2, size_t);
+
+	for(size_t sym_ID = 0; sym_ID < symbols->size; sym_ID++)
+	{
+		*find_bucket(symbols, symbols->names[sym_ID]) = sym_ID + 1;
+	}
+
+	return FRD_ALL_GOOD;
+}
+
+frd_err_t intern_symbol(Symbol_table *symbols, const wchar_t *token, wchar_t * *name, size_t *sym_ID)
+{
+	frd_err_t error_code = FRD_ALL_GOOD;
+
+	if(symbols->size >= symbols->capacity)
+	{
+		CALL(grow_symbols(symbols));
+	}
+
+	size_t *bucket = find_bucket(symbols, token);
+
+	if(*bucket != NO_BUCKET)
+	{
+		*sym_ID = *bucket - 1;
+		*name   = symbols->names[*sym_ID];
+
+		return error_code;
+	}
+
+	size_t length = wcslen(token);
+
+	wchar_t *copy = NULL;
+	CALLOC(copy, length + 1, wchar_t);
+	wmemcpy(copy, token, length + 1);
+
+	*sym_ID = symbols->size++;
+	*bucket = *sym_ID + 1;
+	*name   = copy;
+
+	symbols->names[*sym_ID] = copy;
+
+	return error_code;
+}
+
+void symbols_dtor(Symbol_table *symbols)
+{
+	free(symbols->names);
+	free(symbols->buckets);
+
+	*symbols = {};
+}
+
+// each identifier is kept once, the tree compares the IDs instead of the names
+frd_err_t add_id(Tokens *tokens, Symbol_table *symbols, const wchar_t *token, bool is_func)
 {
 	frd_err_t error_code = FRD_ALL_GOOD;
 	Node_type type = VAR;
@@ -196,37 +260,99 @@ frd_err_t add_id(Tokens *tokens, wchar_t *token, bool is_func)
 	if(is_kwd(token, &type, &val))
 	{
 		CALL(add_token(tokens, type, val));
+
+		return error_code;
 	}
-	else if(is_func)
+
+	wchar_t *name   = NULL;
+	size_t   sym_ID = 0;
+	CALL(intern_symbol(symbols, token, &name, &sym_ID));
+
+	if(is_func)
 	{
 		LOG(L"It's func.\n");
-		CALL(add_token(tokens, FUNC, {.var_value = token}));
+		CALL(add_token(tokens, FUNC, {.var_value = name, .sym_ID = sym_ID}));
 	}
 	else
 	{
-		LOG(L"It's VAR: %ls\n", token);
-		CALL(add_token(tokens, VAR, {.var_value = token}));
+		LOG(L"It's VAR: %ls\n", name);
+		CALL(add_token(tokens, VAR, {.var_value = name, .sym_ID = sym_ID}));
 	}
 
 	return error_code;
 }
 
-bool is_kwd(wchar_t *token, Node_type *type, Node_value *value)
+constexpr size_t kwd_length(const wchar_t *name)
 {
-	for(size_t kwd_id = 0; kwd_id < kwds_amount; kwd_id++)
+	size_t length = 0;
+
+	while(name[length] != L'\0')
 	{
-		if(!wcsncmp(token, kwds[kwd_id], MAX_TOKEN_SIZE))
-		{
-			LOG(L"It's KEYWORD: %ls\n", token);
+		length++;
+	}
+
+	return length;
+}
+
+constexpr size_t kwd_hash(const wchar_t *name, size_t length)
+{
+	return ((size_t)name[0] * KWD_HASH_FIRST + (size_t)name[length - 1] * KWD_HASH_LAST + length) % KWD_SLOTS;
+}
 
-			*type = get_type(token, value);
+struct Kwd_slots
+{
+	unsigned char kwd_IDs[KWD_SLOTS];
+	bool          is_perfect;
+};
 
-			return true;
+constexpr Kwd_slots fill_kwd_slots()
+{
+	Kwd_slots slots = {};
+	slots.is_perfect = true;
+
+	for(size_t kwd_id = 0; kwd_id < KWDS_AMOUNT; kwd_id++)
+	{
+		size_t slot = kwd_hash(KWDS[kwd_id].name, kwd_length(KWDS[kwd_id].name));
+
+		if(slots.kwd_IDs[slot] != 0)
+		{
+			slots.is_perfect = false;
 		}
 
+		// 0 marks an empty slot
+		slots.kwd_IDs[slot] = (unsigned char)(kwd_id + 1);
+	}
+
+	return slots;
+}
+
+static constexpr Kwd_slots KWD_TABLE = fill_kwd_slots();
+
+static_assert(KWD_TABLE.is_perfect, "two keywords share a slot, change KWD_HASH_FIRST or KWD_HASH_LAST");
+static_assert(KWDS_AMOUNT < 256, "keyword IDs must fit a byte");
+
+bool is_kwd(const wchar_t *token, Node_type *type, Node_value *value)
+{
+	size_t length = wcslen(token);
+
+	if(length == 0)
+	{
+		return false;
+	}
+
+	size_t kwd_id = KWD_TABLE.kwd_IDs[kwd_hash(token, length)];
+
+	if(kwd_id == 0 || wcscmp(token, KWDS[kwd_id - 1].name) != 0)
+	{
+		return false;
 	}
 
-	return false;
+	LOG(L"It's KEYWORD: %ls\n", token);
+
+	*type  = KWDS[kwd_id - 1].type;
+	*value = KWDS[kwd_id - 1].value;
+
+	return true;
 }
 
 void dump_tokens(Tokens *tokens)
@@ -234,7 +360,7 @@ void dump_tokens(Tokens *tokens)
 	LOG(L"\nTokens:\n");
 	FOR(size_t token_id = 0; token_id < tokens->size; token_id++)
 	{
-		LOG(L"%p\n", tokens->data[token_id]);
+		LOG(L"%p\n", &tokens->data[token_id]);
 		switch(tokens->data[token_id].type)
 		{
 			case NUM:
@@ -430,6 +556,10 @@ void log_std_func(Std_func func_type)
 	{
 		CASE(GETVAR)
 		CASE(PUTEXPR)
+		CASE(FILLRAM)
+		CASE(COPYRAM)
+		CASE(CMPRAM)
+		CASE(READRAM)
 		default:
 		{
 			LOG(L"UKNOWN STD_FUNC\n")
@@ -439,154 +569,196 @@ void log_std_func(Std_func func_type)
 
 #include "undef_log_op_dsl.h"
 
-#define IS_KWD(check_kwd)\
-	!wcsncmp(token, check_kwd, MAX_TOKEN_SIZE)
+static void decode_cur(Src_stream *src)
+{
+	if(src->pos >= src->size)
+	{
+		src->cur     = L'\0';
+		src->cur_len = 0;
 
-#define IF_UNR_OP(name, type)						\
-	else if(IS_KWD(name))							\
-	{												\
-		LOG(L"It's unary operation: %ls.\n", name);	\
-		*value = {.op_value = type};				\
-													\
-		return UNR_OP;								\
+		return;
 	}
 
-Node_type get_type(wchar_t *token, Node_value *value)
-{
+	const unsigned char *bytes = src->data + src->pos;
+	size_t               left  = src->size - src->pos;
 
-	if(IS_KWD(L"рәис"))
-	{
-		LOG(L"It's main.\n");
-		*value = {.num_value = 0};
+	unsigned char lead = bytes[0];
+	size_t length = (lead < 0x80)        ? 1 :
+					((lead >> 5) == 0x6)  ? 2 :
+					((lead >> 4) == 0xE)  ? 3 :
+					((lead >> 3) == 0x1E) ? 4 : 0;
 
-		return MAIN;
-	}
-	else if(IS_KWD(L"мисалныяз"))
-	{
-		LOG(L"It's standart func: putexpr.\n");
-		*value = {.func =  PUTEXPR};
+	// a broken sequence is one invalid character, the next byte starts over
+	src->cur     = UTF8_INVALID;
+	src->cur_len = 1;
 
-		return STD_FUNC;
-	}
-	else if(IS_KWD(L"алалмаш"))
+	if(length == 0 || length > left)
 	{
-		LOG(L"It's standart func: getvar.\n");
-		*value = {.func =  GETVAR};
-
-		return STD_FUNC;
+		return;
 	}
-	else if(IS_KWD(L"булганда"))
-	{
-		LOG(L"It's while.\n");
-		*value = {.num_value = 0};
 
-		return WHILE;
-	}
-	else if(IS_KWD(L"әгәр"))
-	{
-		LOG(L"It's if.\n");
-		*value = {.num_value = 0};
+	wchar_t code = (length == 1) ? (wchar_t)lead : (wchar_t)(lead & (0x7F >> length));
 
-		return IF;
-	}
-	else if(IS_KWD(L"белдерү"))
+	for(size_t byte_ID = 1; byte_ID < length; byte_ID++)
 	{
-		LOG(L"It's declare.\n");
-		*value = {.num_value = 0};
+		if((bytes[byte_ID] & 0xC0) != 0x80)
+		{
+			return;
+		}
 
-		return DECLARE;
+		code = (wchar_t)((code << 6) | (bytes[byte_ID] & 0x3F));
 	}
-	else if(IS_KWD(L"киребир"))
-	{
-		LOG(L"It's return.\n");
-		*value = {.num_value = 0};
 
-		return RETURN;
-	}
-	IF_UNR_OP(L"син",  SIN)
-	IF_UNR_OP(L"кос",  COS)
-	IF_UNR_OP(L"лн",   LN)
-	IF_UNR_OP(L"тамырасты", SQRT)
-	else
+	src->cur     = code;
+	src->cur_len = length;
+}
+
+frd_err_t src_open(Src_stream *src, const char *file_name)
+{
+	*src = {};
+
+	src->mapping = map_file(file_name, &src->size);
+	if(src->mapping == NULL)
 	{
-		LOG(L"%s: ERROR:\n\tKeyword could not be handled: %ls.\n", __func__, token);
+		// an empty file has nothing to map, but it is still a source
+		FILE *code = fopen(file_name, "r");
+		if(code == NULL)
+		{
+			fprintf(stderr, "Unable to open %s\n", file_name);
 
-		return NUM;
+			return FRD_UNABLE_TO_OPEN_FILE;
+		}
+
+		fclose(code);
+		src->size = 0;
 	}
-}
 
-#undef IF_UNR_OP
+	LOG(L"%s is mapped, %lu bytes.\n", file_name, src->size);
+
+	src->data = (const unsigned char *)src->mapping;
+	decode_cur(src);
 
-#include "def_get_sym_dsl.h"
+	return FRD_ALL_GOOD;
+}
 
-wchar_t *get_symbs(const char *file_name, frd_err_t *error_code, size_t *file_len)
+void src_close(Src_stream *src)
 {
-	WITH_OPEN
-	(
+	if(src->mapping != NULL)
+	{
+		unmap_file(src->mapping, src->size);
+	}
 
-		file_name, "r", code,
+	*src = {};
+}
 
-		LOG(L"%s is opened.\n", file_name);
+void src_next(Src_stream *src)
+{
+	src->pos += src->cur_len;
 
-		size_t length = get_file_length(code);
-		*file_len = length;
+	decode_cur(src);
+}
 
-		LOG(L"File length: %lu\n", length);
+frd_err_t lex_token(Lexer *lexer, Tokens *tokens)
+{
+	frd_err_t error_code = FRD_ALL_GOOD;
 
-		wchar_t *symbs = NULL;
-		CALLOC(symbs, length + 1, wchar_t);
-		LOG(L"symbs is allocated.\n");
+	Src_stream *src   = &lexer->src;
+	size_t      size  = tokens->size;
+	size_t      start = src->pos;
 
+	while(tokens->size == size)
+	{
+		start = src->pos;
 
+		if(src->pos >= src->size)
+		{
+			CALL(add_token(tokens, END, {.num_value = 0}));
+			lexer->done = true;
 
+			break;
+		}
 
-		size_t id = 0;
-		wint_t ch;
+		wchar_t cur_symb = src->cur;
+		LOG(L"\nCurrent symbol: %lc\n", cur_symb);
 
-		while ((ch = fgetwc(code)) != WEOF && id < length)
+		if(is_blank(cur_symb))
 		{
-			symbs[id++] = (wchar_t) ch;
-		}
-		symbs[id] = L'\0';
+			LOG(L"It's blank.\n");
 
-		LOG(L"Successful fread code -> symbs.\n");
+			src_next(src);
+		}
+		else if(is_number(cur_symb))
+		{
+			CALL(add_num(tokens, src));
+		}
+		else
+		{
+			bool processed = false;
 
-		LOG(L"read code:\n");
+			CALL(process_sym(src, tokens, &processed));
 
-		LOG(L"%ls\n", symbs);
+			if(!processed)
+			{
+				if(is_op(cur_symb))
+				{
+					CALL(process_op(src, tokens));
+				}
+				else
+				{
+					CALL(process_id(src, &lexer->symbols, tokens));
+				}
+			}
+		}
+	}
 
+	for(size_t token_id = size; token_id < tokens->size; token_id++)
+	{
+		tokens->data[token_id].offset = (uint32_t)start;
+	}
 
-		return symbs;
-	)
+	return error_code;
 }
 
-#include "undef_get_sym_dsl.h"
-
-frd_err_t add_num(Tokens *tokens, wchar_t * *symbs_ptr)
+frd_err_t add_num(Tokens *tokens, Src_stream *src)
 {
 	frd_err_t error_code = FRD_ALL_GOOD;
 
 	LOG(L"It's a number.\n");
 
-	double num = 0;
+	char   digits[MAX_TOKEN_SIZE] = {};
+	size_t length                 = 0;
+	size_t start                  = src->pos;
+
+	while((is_number(src->cur) || src->cur == L'.') && src->pos < src->size)
+	{
+		if(length == MAX_TOKEN_SIZE - 1)
+		{
+			LOG(L"The number is longer than %lu symbols.\n", MAX_TOKEN_SIZE - 1);
+
+			tokens->error_offset = start;
+			return FRD_TOO_LONG_TOKEN;
+		}
 
-	swscanf(*symbs_ptr, L"%lf", &num);
+		digits[length++] = (char)src->cur;
+
+		src_next(src);
+	}
+
+	double num = strtod(digits, NULL);
 
 	LOG(L"\tnum: %lf\n", num);
 
 	CALL(add_token(tokens, NUM, {.num_value = num}));
 
-	*symbs_ptr = skip_nums(*symbs_ptr);
-
 	return error_code;
 }
 
-frd_err_t process_sym(wchar_t * *symbs_ptr, Tokens *tokens, size_t left_amount, bool *processed)
+frd_err_t process_sym(Src_stream *src, Tokens *tokens, bool *processed)
 {
 	frd_err_t error_code = FRD_ALL_GOOD;
 	*processed = true;
 
-	wchar_t cur_symb = *(*symbs_ptr);
+	wchar_t cur_symb = src->cur;
 
 	switch(cur_symb)
 	{
@@ -605,7 +777,7 @@ frd_err_t process_sym(wchar_t * *symbs_ptr, Tokens *tokens, size_t left_amount,
 		case L'#':
 		{
 			LOG(L"Skipping comment.\n");
-			(*symbs_ptr) = skip_comment((*symbs_ptr), left_amount);
+			skip_comment(src);
 
 			return error_code;
 		}
@@ -615,89 +787,94 @@ frd_err_t process_sym(wchar_t * *symbs_ptr, Tokens *tokens, size_t left_amount,
 	return error_code;
 }
 
-frd_err_t process_op(wchar_t * *symbs_ptr, Tokens *tokens)
+frd_err_t process_op(Src_stream *src, Tokens *tokens)
 {
 	frd_err_t error_code = FRD_ALL_GOOD;
 
 	LOG(L"It's OP.\n");
 
-	Ops op = get_op(*(*symbs_ptr), &error_code);
+	Ops op = get_op(src->cur, &error_code);
 	CHECK_ERROR;
 
 	CALL(add_token(tokens, OP, {.op_value = op}));
 
-	(*symbs_ptr)++;
+	src_next(src);
 
 	return error_code;
 }
 
-frd_err_t process_id(wchar_t * *symbs_ptr, Tokens *tokens)
+frd_err_t process_id(Src_stream *src, Symbol_table *symbols, Tokens *tokens)
 {
 	frd_err_t error_code = FRD_ALL_GOOD;
 
-	wchar_t *token = NULL;
-	CALLOC(token, MAX_TOKEN_SIZE, wchar_t);
-
+	// only a new name is copied out of this buffer
+	wchar_t token[MAX_TOKEN_SIZE] = {};
+	size_t  start                 = src->pos;
 
-	token = get_token(token, symbs_ptr);
-	if(token == NULL)
+	error_code = get_token(token, src);
+	if(error_code == FRD_TOO_LONG_TOKEN)
 	{
-		return FRD_INVALID_VAR_SYMBOL;
+		tokens->error_offset = start;
 	}
+	CHECK_ERROR;
 
 
 	bool is_func = false;
 
-	if(*(*symbs_ptr) == L'(')
+	if(src->cur == L'(')
 	{
 		LOG(L"Next one after %ls is %lc so it's function type token\n",
-			 token, *(*symbs_ptr));
+			 token, src->cur);
 
 		is_func = true;
 	}
 
 	LOG(L"\ttoken: %ls\n", token);
 
-	CALL(add_id(tokens, token, is_func));
+	CALL(add_id(tokens, symbols, token, is_func));
 
 
 	return error_code;
 }
 
-wchar_t *get_token(wchar_t *token, wchar_t * *symbs_ptr)
+frd_err_t get_token(wchar_t *token, Src_stream *src)
 {
-	wchar_t *token_start = token;
+	wchar_t *token_end = token + MAX_TOKEN_SIZE - 1;
 
-	wchar_t cur_sym = *(*symbs_ptr);
+	wchar_t cur_sym = src->cur;
 
 	if(!is_reserved(cur_sym) && !is_number(cur_sym))
 	{
 		*token = cur_sym;
 
 		token++;
-		(*symbs_ptr)++;
-		cur_sym = *(*symbs_ptr);
+		src_next(src);
+		cur_sym = src->cur;
 	}
 	else
 	{
 		LOG(L"Invalid first  symbol for variable: %lc\n", cur_sym);
-		return NULL;
+		return FRD_INVALID_VAR_SYMBOL;
 	}
 
-	while(!is_reserved(cur_sym))
+	while(!is_reserved(cur_sym) && src->pos < src->size)
 	{
-		*token = cur_sym;
+		if(token == token_end)
+		{
+			LOG(L"The name is longer than %lu symbols.\n", MAX_TOKEN_SIZE - 1);
+			return FRD_TOO_LONG_TOKEN;
+		}
 
+		*token = cur_sym;
 		token++;
-		(*symbs_ptr)++;
-		cur_sym = *(*symbs_ptr);
-	}
-
 
+		src_next(src);
+		cur_sym = src->cur;
+	}
 
 	*token = L'\0';
 
-	return token_start;
+	return FRD_ALL_GOOD;
 }
 
 bool is_reserved(wchar_t symb)
@@ -3,32 +3,85 @@
 
 #include "frontend.h"
 
-const size_t kwds_amount = 11;
+struct Keyword
+{
+	const wchar_t *name;
+	Node_type      type;
+	Node_value     value;
+};
 
-const wchar_t * const kwds[] =
+constexpr Keyword KWDS[] =
 {
-	L"булганда",
-	L"әгәр",
-	L"син",
-	L"кос",
-	L"лн",
-	L"тамырасты",
-	L"алалмаш",
-	L"мисалныяз",
-	L"белдерү",
-	L"киребир",
-	L"рәис",
+	{L"булганда",  WHILE,    {.num_value = 0}},
+	{L"әгәр",      IF,       {.num_value = 0}},
+	{L"син",       UNR_OP,   {.op_value  = SIN}},
+	{L"кос",       UNR_OP,   {.op_value  = COS}},
+	{L"лн",        UNR_OP,   {.op_value  = LN}},
+	{L"тамырасты", UNR_OP,   {.op_value  = SQRT}},
+	{L"алалмаш",   STD_FUNC, {.func      = GETVAR}},
+	{L"мисалныяз", STD_FUNC, {.func      = PUTEXPR}},
+	{L"тутыр",     STD_FUNC, {.func      = FILLRAM}},
+	{L"күчер",     STD_FUNC, {.func      = COPYRAM}},
+	{L"чагыштыр",  STD_FUNC, {.func      = CMPRAM}},
+	{L"белдерү",   DECLARE,  {.num_value = 0}},
+	{L"киребир",   RETURN,   {.num_value = 0}},
+	{L"рәис",      MAIN,     {.num_value = 0}},
 };
 
-const size_t STARTER_TOKENS_AMOUNT = 5;
-const int    POISON_OP             = -666;
+const size_t KWDS_AMOUNT    = sizeof(KWDS) / sizeof(Keyword);
+
+/**
+ * @brief The keywords are found by a perfect hash of their first and last letters and their length.
+ *
+ * The slots are filled at compile time, and the build fails if two keywords share a slot,
+ * so a new keyword may need other multipliers.
+ */
+const size_t KWD_SLOTS      = 32;
+const size_t KWD_HASH_FIRST = 3;
+const size_t KWD_HASH_LAST  = 16;
+
+const size_t STARTER_TOKENS_AMOUNT  = 5;
+const size_t SRC_BYTES_PER_TOKEN    = 4; // the bench programs take 3 to 5.5 bytes of source per token
+const int    POISON_OP              = -666;
+const size_t SYMBOLS_START_CAPACITY = 64;
+const size_t NO_BUCKET              = 0;
+
+const wchar_t UTF8_INVALID           = 0xFFFD;
+
+/**
+ * @brief UTF-8 source decoded one character at a time, cur is the character at pos.
+ */
+struct Src_stream
+{
+	const unsigned char *data;
+	size_t               size;
+	size_t               pos;
+	size_t               cur_len;
+	wchar_t              cur;
+	char                *mapping;
+};
 
-#define LOG(...)\
-	frd_write_log("frontend_log", __VA_ARGS__);
+struct Symbol_table
+{
+	wchar_t **names;
+	size_t    size;
+	size_t    capacity;
+	size_t   *buckets;
+};
 
-void      frd_write_log(const char *file_name, const wchar_t *fmt, ...);
+/**
+ * @brief The state of one tokenized source, the names are interned per source.
+ */
+struct Lexer
+{
+	Src_stream    src;
+	Symbol_table  symbols;
+	frd_err_t    *error_code;
+	bool          done;
+};
 
-wchar_t  *skip_nums(wchar_t *symbs);
+#define LOG(...)\
+	WLOG_AT(LOG_LEVEL_DEBUG, LOG_SINK_FRONTEND, __VA_ARGS__);
 
 bool      is_number(wchar_t sym);
 
@@ -36,9 +89,12 @@ bool      is_op(wchar_t sym);
 
 bool      is_blank(wchar_t sym);
 
-wchar_t  *skip_comment(wchar_t *symbs, size_t left_amount);
+void      skip_comment(Src_stream *src);
 
-frd_err_t init_tokens(Tokens *tokens);
+/**
+ * @brief Sizes the tokens for a source of src_size bytes, so they are rarely reallocated.
+ */
+frd_err_t init_tokens(Tokens *tokens, size_t src_size);
 
 void      tokens_dtor(Tokens *tokens);
 
@@ -46,9 +102,19 @@ frd_err_t add_token(Tokens *tokens, Node_type type, Node_value value);
 
 Ops       get_op(wchar_t sym, frd_err_t *error_code);
 
-frd_err_t add_id(Tokens *tokens, wchar_t *token, bool is_func);
+frd_err_t add_id(Tokens *tokens, Symbol_table *symbols, const wchar_t *token, bool is_func);
+
+/**
+ * @brief Finds the ID of the name, the name is copied only when it is met for the first time.
+ */
+frd_err_t intern_symbol(Symbol_table *symbols, const wchar_t *token, wchar_t * *name, size_t *sym_ID);
 
-bool      is_kwd(wchar_t *token, Node_type *type, Node_value *value);
+/**
+ * @brief Frees the table, but not the names, which the tree keeps.
+ */
+void      symbols_dtor(Symbol_table *symbols);
+
+bool      is_kwd(const wchar_t *token, Node_type *type, Node_value *value);
 
 void      dump_tokens(Tokens *tokens);
 
@@ -56,19 +122,35 @@ void      log_std_func(Std_func func_type);
 
 void      log_op(Ops op);
 
-Node_type get_type(wchar_t *token, Node_value *value);
+/**
+ * @brief Maps the source, nothing is decoded ahead of the lexer.
+ */
+frd_err_t src_open(Src_stream *src, const char *file_name);
+
+void      src_close(Src_stream *src);
+
+void      src_next(Src_stream *src);
 
-wchar_t  *get_symbs(const char *file_name, frd_err_t *error_code, size_t *file_len);
+/**
+ * @brief Lexes the source up to the next token, the END one at its end.
+ */
+frd_err_t lex_token(Lexer *lexer, Tokens *tokens);
 
-frd_err_t add_num(Tokens *tokens, wchar_t * *symbs_ptr);
+/**
+ * @brief Adds the number token, a number longer than MAX_TOKEN_SIZE - 1 symbols is an error at its offset.
+ */
+frd_err_t add_num(Tokens *tokens, Src_stream *src);
 
-frd_err_t process_sym(wchar_t * *symbs_ptr, Tokens *tokens, size_t left_amount, bool *processed);
+frd_err_t process_sym(Src_stream *src, Tokens *tokens, bool *processed);
 
-frd_err_t process_op(wchar_t * *symbs_ptr, Tokens *tokens);
+frd_err_t process_op(Src_stream *src, Tokens *tokens);
 
-frd_err_t process_id(wchar_t * *symbs_ptr, Tokens *tokens);
+frd_err_t process_id(Src_stream *src, Symbol_table *symbols, Tokens *tokens);
 
-wchar_t  *get_token (wchar_t *token, wchar_t * *symbs_ptr);
+/**
+ * @brief Reads a name into the token buffer, a name longer than MAX_TOKEN_SIZE - 1 symbols is an error.
+ */
+frd_err_t get_token (wchar_t *token, Src_stream *src);
 
 bool     is_reserved(wchar_t symb);
 
@@ -0,0 +1,74 @@
+#ifndef DEF_STRENGTH_DSL_H
+#define DEF_STRENGTH_DSL_H
+
+#define IS_OP_NODE(checked_node, op)									\
+	((checked_node)->type == OP && (checked_node)->value.op_value == (op))
+
+#define IS_CONST(checked_node)											\
+	((checked_node)->type == NUM)
+
+#define RIGHT_CONST														\
+	node->right->value.num_value
+
+#define CONST__ADD_MUL__ANY												\
+	(IS_OP_NODE(node, ADD) || IS_OP_NODE(node, MUL)) &&					\
+	IS_CONST(node->left) && !IS_CONST(node->right)
+
+#define ANY__SUB__CONST													\
+	IS_OP_NODE(node, SUB) && IS_CONST(node->right)
+
+#define ANY__DIV__EXACT_CONST											\
+	IS_OP_NODE(node, DIV) && IS_CONST(node->right) &&					\
+	has_exact_reciprocal(RIGHT_CONST)
+
+#define ANY_OP_CONST__OP__CONST											\
+	(IS_OP_NODE(node, ADD) || IS_OP_NODE(node, MUL)) &&					\
+	IS_OP_NODE(node->left, node->value.op_value) &&						\
+	IS_CONST(node->left->right) && IS_CONST(node->right)
+
+#define ANY_OP_CONST__OP__ANY											\
+	carries_const(node, node->left) && !IS_CONST(node->right)
+
+#define ANY__OP__ANY_OP_CONST											\
+	carries_const(node, node->right)
+
+#define ANY__POW__HALF													\
+	IS_OP_NODE(node, POW) && IS_CONST(node->right) &&					\
+	!islessgreater(RIGHT_CONST, 0.5)
+
+#define PURE__POW__SMALL_INT											\
+	IS_OP_NODE(node, POW) && IS_CONST(node->right) &&					\
+	is_small_power(RIGHT_CONST) && is_pure_expr(node->left)
+
+#define VAR__MUL__TWO													\
+	IS_OP_NODE(node, MUL) && node->left->type == VAR &&					\
+	IS_CONST(node->right) && !islessgreater(RIGHT_CONST, 2)
+
+#define SWAP_CHILDREN													\
+	swap_children(node)
+
+#define ADD_NEGATED														\
+	negate_right(node)
+
+#define MUL_RECIPROCAL													\
+	invert_right(node)
+
+#define GATHER_INTO_RIGHT												\
+	gather_consts(node)
+
+#define LIFT_LEFT														\
+	lift_left_const(node, fired, error_code)
+
+#define LIFT_RIGHT														\
+	lift_right_const(node, fired, error_code)
+
+#define SQRT_OF_LEFT													\
+	pow_to_sqrt(node)
+
+#define EXPAND_POW														\
+	expand_pow(node, error_code)
+
+#define ADD_TO_ITSELF													\
+	mul_to_add(node, error_code)
+
+#endif
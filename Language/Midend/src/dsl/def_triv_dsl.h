@@ -2,10 +2,10 @@
 #define DEF_TRIV_DSL_H
 
 #define LEFT_VAR												\
-	node->left->value.var_value
+	node->left->value.sym_ID
 
 #define RIGHT_VAR												\
-	node->right->value.var_value
+	node->right->value.sym_ID
 
 #define LEFT_IS_ZERO\
 	node->left->type == NUM && cmp_double(node->left->value.num_value, 0) == 0
@@ -58,7 +58,7 @@
 	(node->left->type == VAR) &&									\
 			(node->right->type == VAR) &&							\
 			(node->type == OP && node->value.op_value == SUB) &&	\
-			(!wcsncmp(LEFT_VAR, RIGHT_VAR, MAX_VAR_SIZE))
+			(LEFT_VAR == RIGHT_VAR)
 
 // #define SAME_OP_W_CONSTS	\
 // left or right is const
@@ -67,10 +67,16 @@
 // 			and left or right child of the ops op is const
 
 #define ZERO													\
-	create_node(NUM, {.num_value = 0}, NULL, NULL).arg.node
+	make_num(node, 0)
 
 #define ONE														\
-	create_node(NUM, {.num_value = 1}, NULL, NULL).arg.node
+	make_num(node, 1)
+
+#define KEEP_LEFT												\
+	keep_child(node, LEFT_CHILD)
+
+#define KEEP_RIGHT												\
+	keep_child(node, RIGHT_CHILD)
 
 
 #endif
@@ -0,0 +1,16 @@
+// DEF_RULE(name, pattern, rewrite)
+//
+// The rules are tried in this order on every operation whose children are simplified already,
+// once its constants are folded and its trivial expressions are solved. A rewritten node is
+// folded, solved and matched again, so every rule makes only one step towards the canonical form:
+// the constants go to the right of the operation and up the chains of additions and multiplications.
+
+DEF_RULE(CONST_TO_RIGHT,   CONST__ADD_MUL__ANY,      SWAP_CHILDREN)
+DEF_RULE(SUB_TO_ADD,       ANY__SUB__CONST,          ADD_NEGATED)
+DEF_RULE(DIV_TO_MUL,       ANY__DIV__EXACT_CONST,    MUL_RECIPROCAL)
+DEF_RULE(GATHER_CONSTS,    ANY_OP_CONST__OP__CONST,  GATHER_INTO_RIGHT)
+DEF_RULE(LIFT_LEFT_CONST,  ANY_OP_CONST__OP__ANY,    LIFT_LEFT)
+DEF_RULE(LIFT_RIGHT_CONST, ANY__OP__ANY_OP_CONST,    LIFT_RIGHT)
+DEF_RULE(POW_TO_SQRT,      ANY__POW__HALF,           SQRT_OF_LEFT)
+DEF_RULE(POW_TO_MUL,       PURE__POW__SMALL_INT,     EXPAND_POW)
+DEF_RULE(MUL_TO_ADD,       VAR__MUL__TWO,            ADD_TO_ITSELF)
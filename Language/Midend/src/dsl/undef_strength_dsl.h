@@ -0,0 +1,26 @@
+#ifndef UNDEF_STRENGTH_DSL_H
+#define UNDEF_STRENGTH_DSL_H
+
+#undef IS_OP_NODE
+#undef IS_CONST
+#undef RIGHT_CONST
+#undef CONST__ADD_MUL__ANY
+#undef ANY__SUB__CONST
+#undef ANY__DIV__EXACT_CONST
+#undef ANY_OP_CONST__OP__CONST
+#undef ANY_OP_CONST__OP__ANY
+#undef ANY__OP__ANY_OP_CONST
+#undef ANY__POW__HALF
+#undef PURE__POW__SMALL_INT
+#undef VAR__MUL__TWO
+#undef SWAP_CHILDREN
+#undef ADD_NEGATED
+#undef MUL_RECIPROCAL
+#undef GATHER_INTO_RIGHT
+#undef LIFT_LEFT
+#undef LIFT_RIGHT
+#undef SQRT_OF_LEFT
+#undef EXPAND_POW
+#undef ADD_TO_ITSELF
+
+#endif
@@ -20,5 +20,7 @@
 #undef VAR__SUB__VAR
 #undef ZERO
 #undef ONE
+#undef KEEP_LEFT
+#undef KEEP_RIGHT
 
 #endif
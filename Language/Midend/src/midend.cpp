@@ -1,18 +1,48 @@
 #include "midend_secondary.h"
 
-bool change_flag = false;
-
 B_tree_node *optimize(B_tree_node *root, mid_err_t *error_code)
 {
 	*error_code = MID_ALL_GOOD;
 
-	do
+	root = inline_funcs(root, error_code);
+	if(*error_code != MID_ALL_GOOD)
+	{
+		return root;
+	}
+
+	root = simplify(root, error_code);
+	if(*error_code != MID_ALL_GOOD)
+	{
+		return root;
+	}
+
+	root = propagate_consts(root, error_code);
+	if(*error_code != MID_ALL_GOOD)
 	{
-		change_flag = false;
+		return root;
+	}
 
-		root = simplify(root, error_code);
+	root = eval_pure_calls(root, error_code);
+	if(*error_code != MID_ALL_GOOD)
+	{
+		return root;
+	}
+
+	root = hoist_invariants(root, error_code);
+	if(*error_code != MID_ALL_GOOD)
+	{
+		return root;
+	}
 
-	} while(change_flag == true);
+	root = share_common_exprs(root, error_code);
+
+#ifdef MID_MEMOIZE
+	// the tables read and fill the RAM, so the functions are no more pure for the passes above
+	if(*error_code == MID_ALL_GOOD)
+	{
+		root = memoize_funcs(root, error_code);
+	}
+#endif
 
 	return root;
 }
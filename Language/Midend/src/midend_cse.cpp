@@ -0,0 +1,590 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "midend_secondary.h"
+
+static wchar_t TEMP_NAME[] = L"_common";
+
+static uint64_t hash_node(const B_tree_node *node, uint64_t left_hash, uint64_t right_hash)
+{
+	uint64_t value = 0;
+
+	switch(node->type)
+	{
+		case NUM:
+		{
+			memcpy(&value, &node->value.num_value, sizeof(value));
+
+			break;
+		}
+		case OP:
+		case UNR_OP:
+		{
+			value = (uint64_t)node->value.op_value;
+
+			break;
+		}
+		case VAR:
+		case FUNC:
+		{
+			value = node->value.sym_ID;
+
+			break;
+		}
+		case COMMA:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case DECLARE:
+		case RETURN:
+		case FUNC_DECL:
+		case MAIN:
+		case CMD_FUNC:
+		default:
+		{
+			break;
+		}
+	}
+
+	const uint64_t words[] = {(uint64_t)node->type, value, left_hash, right_hash};
+
+	return hash_bytes(HASH_OFFSET_BASIS, words, sizeof(words));
+}
+
+static bool is_value(const Cse *cse, const B_tree_node *node)
+{
+	switch(node->type)
+	{
+		case OP:
+		{
+			return node->value.op_value != ASS;
+		}
+		case FUNC:
+		{
+			return cse->pure_funcs[node->value.sym_ID];
+		}
+		case NUM:
+		case VAR:
+		case UNR_OP:
+		case COMMA:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		{
+			return true;
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case DECLARE:
+		case RETURN:
+		case FUNC_DECL:
+		case MAIN:
+		case CMD_FUNC:
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+static bool add_expr(Cse *cse, B_tree_node **slot, uint64_t hash, size_t size, size_t stmt_ID)
+{
+	if(cse->exprs_amount >= cse->exprs_capacity)
+	{
+		cse->exprs_capacity = (cse->exprs_amount + 1) * 2;
+
+		Cse_expr *exprs = (Cse_expr *)realloc(cse->exprs, cse->exprs_capacity * sizeof(Cse_expr));
+		if(exprs == NULL)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the expressions.\n", __func__);
+			*cse->error_code = MID_UNABLE_TO_ALLOCATE;
+
+			return false;
+		}
+
+		cse->exprs = exprs;
+	}
+
+	cse->exprs[cse->exprs_amount] = {.slot    = slot,    .hash  = hash, .size = size,
+									 .stmt_ID = stmt_ID, .order = cse->exprs_amount};
+	cse->exprs_amount++;
+
+	return true;
+}
+
+static bool collect_exprs(Cse *cse, B_tree_node **slot, size_t stmt_ID, uint64_t *hash, size_t *size)
+{
+	B_tree_node *node = *slot;
+
+	*hash = 0;
+	*size = 0;
+
+	if(node == NULL)
+	{
+		return true;
+	}
+
+	uint64_t left_hash  = 0;
+	uint64_t right_hash = 0;
+	size_t   left_size  = 0;
+	size_t   right_size = 0;
+
+	bool left  = collect_exprs(cse, &node->left,  stmt_ID, &left_hash,  &left_size);
+	bool right = collect_exprs(cse, &node->right, stmt_ID, &right_hash, &right_size);
+
+	if(!left || !right || !is_value(cse, node))
+	{
+		return false;
+	}
+
+	*hash = hash_node(node, left_hash, right_hash);
+	*size = 1 + left_size + right_size;
+
+	// the leaves are as cheap as the temporary, and a list of arguments is not a value
+	if(node->type != NUM && node->type != VAR && node->type != COMMA)
+	{
+		add_expr(cse, slot, *hash, *size, stmt_ID);
+	}
+
+	return true;
+}
+
+static void collect_stmt(Cse *cse, B_tree_node *stmt, size_t stmt_ID)
+{
+	uint64_t hash = 0;
+	size_t   size = 0;
+
+	// only the condition of an if is computed in the block
+	if(stmt->type == IF)
+	{
+		collect_exprs(cse, &stmt->left, stmt_ID, &hash, &size);
+	}
+	else
+	{
+		collect_exprs(cse, &stmt->left,  stmt_ID, &hash, &size);
+		collect_exprs(cse, &stmt->right, stmt_ID, &hash, &size);
+	}
+}
+
+static int cmp_exprs(const void *first, const void *second)
+{
+	const Cse_expr *expr_1 = (const Cse_expr *)first;
+	const Cse_expr *expr_2 = (const Cse_expr *)second;
+
+	// the largest expressions go first, the equal ones in the order they are computed
+	if(expr_1->size != expr_2->size)
+	{
+		return expr_1->size > expr_2->size ? -1 : 1;
+	}
+
+	if(expr_1->hash != expr_2->hash)
+	{
+		return expr_1->hash < expr_2->hash ? -1 : 1;
+	}
+
+	if(expr_1->order != expr_2->order)
+	{
+		return expr_1->order < expr_2->order ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static bool reads_var(const B_tree_node *expr, size_t sym_ID)
+{
+	if(expr == NULL)
+	{
+		return false;
+	}
+
+	if(expr->type == VAR)
+	{
+		return expr->value.sym_ID == sym_ID;
+	}
+
+	return reads_var(expr->left, sym_ID) || reads_var(expr->right, sym_ID);
+}
+
+static bool writes_operand(const B_tree_node *stmt, const B_tree_node *expr)
+{
+	if(stmt->type == OP && stmt->value.op_value == ASS && stmt->left != NULL && stmt->left->type == VAR)
+	{
+		return reads_var(expr, stmt->left->value.sym_ID);
+	}
+
+	if(stmt->type == STD_FUNC && stmt->value.func == GETVAR && stmt->right != NULL)
+	{
+		return reads_var(expr, stmt->right->value.sym_ID);
+	}
+
+	return false;
+}
+
+static size_t find_kill(const Cse *cse, const Cse_expr *expr)
+{
+	// the statement assigning an operand still reads the old value, the ones after it don't
+	for(size_t stmt_ID = expr->stmt_ID; stmt_ID < cse->stmts_amount; stmt_ID++)
+	{
+		if(writes_operand(cse->stmts[stmt_ID]->left, *expr->slot))
+		{
+			return stmt_ID;
+		}
+	}
+
+	return cse->stmts_amount;
+}
+
+static bool insert_stmt(Cse *cse, size_t stmt_ID, B_tree_node *cmd)
+{
+	B_tree_node *holder = cse->stmts[stmt_ID];
+
+	Uni_ret moved = create_node(SEMICOLON, {}, holder->left, holder->right);
+	if(moved.error_code != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the statement.\n", __func__);
+		*cse->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return false;
+	}
+
+	if(cse->stmts_amount >= cse->stmts_capacity)
+	{
+		cse->stmts_capacity = (cse->stmts_amount + 1) * 2;
+
+		B_tree_node **stmts = (B_tree_node **)realloc(cse->stmts, cse->stmts_capacity * sizeof(B_tree_node *));
+		if(stmts == NULL)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the statements.\n", __func__);
+			*cse->error_code = MID_UNABLE_TO_ALLOCATE;
+
+			release_node(moved.arg.node);
+
+			return false;
+		}
+
+		cse->stmts = stmts;
+	}
+
+	// the holder keeps its scope and takes the new statement, the old one moves after it
+	holder->left  = cmd;
+	holder->right = moved.arg.node;
+
+	memmove(&cse->stmts[stmt_ID + 2], &cse->stmts[stmt_ID + 1],
+			(cse->stmts_amount - stmt_ID - 1) * sizeof(B_tree_node *));
+
+	cse->stmts[stmt_ID + 1] = moved.arg.node;
+	cse->stmts_amount++;
+
+	return true;
+}
+
+static B_tree_node *create_temp(size_t sym_ID, mid_err_t *error_code)
+{
+	Uni_ret temp = create_node(VAR, {.var_value = TEMP_NAME, .sym_ID = sym_ID}, NULL, NULL);
+	if(temp.error_code != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the temporary.\n", __func__);
+		*error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return NULL;
+	}
+
+	return temp.arg.node;
+}
+
+static void share_expr(Cse *cse, const Cse_expr *first, const Cse_expr *end, size_t kill)
+{
+	size_t       sym_ID = cse->next_sym++;
+	B_tree_node *expr   = *first->slot;
+	B_tree_node *target = create_temp(sym_ID, cse->error_code);
+	B_tree_node *use    = create_temp(sym_ID, cse->error_code);
+
+	Uni_ret ass = create_node(OP, {.op_value = ASS}, target, expr);
+	if(target == NULL || use == NULL || ass.error_code != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the assignment.\n", __func__);
+		*cse->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		release_node(target);
+		release_node(use);
+
+		return;
+	}
+
+	*first->slot = use;
+
+	// the copies are replaced before the statements move, so their slots stay right
+	for(const Cse_expr *copy = first + 1; copy < end && copy->stmt_ID <= kill && *cse->error_code == MID_ALL_GOOD;
+		copy++)
+	{
+		if(!cmp_nodes(expr, *copy->slot))
+		{
+			continue;
+		}
+
+		cse->removed_nodes += copy->size;
+
+		free_tree(*copy->slot);
+		*copy->slot = create_temp(sym_ID, cse->error_code);
+	}
+
+	cse->shared++;
+
+	if(!insert_stmt(cse, first->stmt_ID, ass.arg.node))
+	{
+		free_tree(ass.arg.node);
+	}
+}
+
+static bool share_repeated(Cse *cse)
+{
+	cse->exprs_amount = 0;
+
+	for(size_t stmt_ID = 0; stmt_ID < cse->stmts_amount; stmt_ID++)
+	{
+		collect_stmt(cse, cse->stmts[stmt_ID]->left, stmt_ID);
+	}
+
+	if(*cse->error_code != MID_ALL_GOOD)
+	{
+		return false;
+	}
+
+	// a block of no expressions may have no buffer yet, and it has nothing to share
+	if(cse->exprs_amount == 0)
+	{
+		return false;
+	}
+
+	qsort(cse->exprs, cse->exprs_amount, sizeof(Cse_expr), cmp_exprs);
+
+	const Cse_expr *end = cse->exprs;
+
+	for(size_t expr_ID = 0; expr_ID < cse->exprs_amount; expr_ID++)
+	{
+		const Cse_expr *first = &cse->exprs[expr_ID];
+
+		// the expressions of a hash share the end, so it is found once for all of them
+		if(end <= first)
+		{
+			end = first + 1;
+
+			while(end < cse->exprs + cse->exprs_amount && end->size == first->size && end->hash == first->hash)
+			{
+				end++;
+			}
+		}
+
+		size_t kill = find_kill(cse, first);
+
+		// the copies of a hash come in the order of their statements, so the ones past the kill are all dead
+		for(const Cse_expr *copy = first + 1; copy < end && copy->stmt_ID <= kill; copy++)
+		{
+			if(cmp_nodes(*first->slot, *copy->slot))
+			{
+				share_expr(cse, first, end, kill);
+
+				// the tree has changed, so the expressions are collected again
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static void share_block(Cse *cse)
+{
+	while(cse->stmts_amount > 1 && *cse->error_code == MID_ALL_GOOD && share_repeated(cse))
+	{
+		;
+	}
+
+	cse->stmts_amount = 0;
+}
+
+static bool add_stmt(Cse *cse, B_tree_node *holder)
+{
+	if(cse->stmts_amount >= cse->stmts_capacity)
+	{
+		cse->stmts_capacity = (cse->stmts_amount + 1) * 2;
+
+		B_tree_node **stmts = (B_tree_node **)realloc(cse->stmts, cse->stmts_capacity * sizeof(B_tree_node *));
+		if(stmts == NULL)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the statements.\n", __func__);
+			*cse->error_code = MID_UNABLE_TO_ALLOCATE;
+
+			return false;
+		}
+
+		cse->stmts = stmts;
+	}
+
+	cse->stmts[cse->stmts_amount++] = holder;
+
+	return true;
+}
+
+static void share_chain(Cse *cse, B_tree_node *node);
+
+static void share_nested(Cse *cse, B_tree_node *cmd)
+{
+	if(cmd == NULL)
+	{
+		return;
+	}
+
+	switch(cmd->type)
+	{
+		case IF:
+		case WHILE:
+		case FUNC_DECL:
+		case MAIN:
+		{
+			share_chain(cse, cmd->right);
+
+			break;
+		}
+		case SEMICOLON:
+		case SCOPE_START:
+		case SCOPE_END:
+		{
+			share_chain(cse, cmd);
+
+			break;
+		}
+		case NUM:
+		case OP:
+		case VAR:
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case KEYWORD:
+		case END:
+		case STD_FUNC:
+		case UNR_OP:
+		case FUNC:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case CMD_FUNC:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		default:
+		{
+			break;
+		}
+	}
+}
+
+static void share_chain(Cse *cse, B_tree_node *node)
+{
+	for(; is_chain(node) && *cse->error_code == MID_ALL_GOOD; node = node->right)
+	{
+		B_tree_node *cmd = node->left;
+
+		// a temporary must not outlive the scope it is assigned in
+		if(node->type != SEMICOLON)
+		{
+			share_block(cse);
+		}
+
+		if(cmd == NULL)
+		{
+			continue;
+		}
+
+		bool ends_block = cmd->type == WHILE || cmd->type == FUNC_DECL || cmd->type == MAIN || is_chain(cmd);
+
+		if(!ends_block)
+		{
+			add_stmt(cse, node);
+		}
+
+		if(ends_block || cmd->type == IF)
+		{
+			share_block(cse);
+
+			// the temporaries of the condition are put before the if
+			while(node->left != cmd)
+			{
+				node = node->right;
+			}
+
+			share_nested(cse, cmd);
+		}
+	}
+
+	share_block(cse);
+
+	if(node != NULL)
+	{
+		share_nested(cse, node);
+	}
+}
+
+B_tree_node *share_common_exprs(B_tree_node *root, mid_err_t *error_code)
+{
+	Cse cse = {};
+
+	cse.error_code = error_code;
+	cse.next_sym   = count_syms(root);
+	cse.pure_funcs = find_pure_funcs(root, cse.next_sym + 1, error_code);
+
+	if(cse.pure_funcs == NULL)
+	{
+		return root;
+	}
+
+	if(is_chain(root))
+	{
+		share_chain(&cse, root);
+	}
+	else
+	{
+		share_nested(&cse, root);
+	}
+
+	LOG("%s: %lu expressions shared, %lu nodes removed.\n", __func__, cse.shared, cse.removed_nodes);
+
+	free(cse.pure_funcs);
+	free(cse.stmts);
+	free(cse.exprs);
+
+	return root;
+}
@@ -0,0 +1,481 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "midend_secondary.h"
+
+static bool is_assignment(const B_tree_node *node)
+{
+	return node != NULL && node->type == OP && node->value.op_value == ASS &&
+		   node->left != NULL && node->left->type == VAR;
+}
+
+static bool is_getvar(const B_tree_node *node)
+{
+	return node != NULL && node->type == STD_FUNC && node->value.func == GETVAR &&
+		   node->right != NULL && node->right->type == VAR;
+}
+
+static size_t max_sym(const B_tree_node *node)
+{
+	size_t amount = 0;
+
+	// the walkers of whole programs take the right children in the loop, so a long chain needs no stack
+	for(; node != NULL; node = node->right)
+	{
+		size_t own  = node->type == VAR ? node->value.sym_ID + 1 : 0;
+		size_t left = max_sym(node->left);
+
+		amount = own  > amount ? own  : amount;
+		amount = left > amount ? left : amount;
+	}
+
+	return amount;
+}
+
+static Var_fact *copy_facts(Dataflow *flow, const Var_fact *facts)
+{
+	Var_fact *copy = (Var_fact *)calloc(flow->syms_amount, sizeof(Var_fact));
+	if(copy == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the facts.\n", __func__);
+		*flow->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return NULL;
+	}
+
+	memcpy(copy, facts, flow->syms_amount * sizeof(Var_fact));
+
+	return copy;
+}
+
+static void kill_var(Dataflow *flow, Var_fact *facts, size_t sym_ID)
+{
+	facts[sym_ID].type = FACT_UNKNOWN;
+
+	// the copies of the variable hold its old value
+	for(size_t var_ID = 0; var_ID < flow->syms_amount; var_ID++)
+	{
+		if(facts[var_ID].type == FACT_COPY && facts[var_ID].copy_ID == sym_ID)
+		{
+			facts[var_ID].type = FACT_UNKNOWN;
+		}
+	}
+}
+
+static void kill_copies(Dataflow *flow, Var_fact *facts)
+{
+	// the variable a copy names may be gone with its scope
+	for(size_t var_ID = 0; var_ID < flow->syms_amount; var_ID++)
+	{
+		if(facts[var_ID].type == FACT_COPY)
+		{
+			facts[var_ID].type = FACT_UNKNOWN;
+		}
+	}
+}
+
+static void meet_facts(Dataflow *flow, Var_fact *facts, const Var_fact *other)
+{
+	for(size_t var_ID = 0; var_ID < flow->syms_amount; var_ID++)
+	{
+		const Var_fact *fact  = &facts[var_ID];
+		const Var_fact *match = &other[var_ID];
+
+		bool same = fact->type == match->type &&
+					(fact->type != FACT_CONST || cmp_double(fact->num_value, match->num_value) == 0) &&
+					(fact->type != FACT_COPY  || fact->copy_ID == match->copy_ID);
+
+		if(!same)
+		{
+			facts[var_ID].type = FACT_UNKNOWN;
+		}
+	}
+}
+
+static void kill_assigned(Dataflow *flow, Var_fact *facts, const B_tree_node *node)
+{
+	for(; node != NULL; node = node->right)
+	{
+		if(is_assignment(node))
+		{
+			kill_var(flow, facts, node->left->value.sym_ID);
+		}
+		else if(is_getvar(node))
+		{
+			kill_var(flow, facts, node->right->value.sym_ID);
+		}
+
+		kill_assigned(flow, facts, node->left);
+	}
+}
+
+static void substitute_vars(Dataflow *flow, const Var_fact *facts, B_tree_node *node)
+{
+	if(node == NULL)
+	{
+		return;
+	}
+
+	if(node->type == VAR)
+	{
+		const Var_fact *fact = &facts[node->value.sym_ID];
+
+		if(fact->type == FACT_CONST)
+		{
+			node->type  = NUM;
+			node->value = {.num_value = fact->num_value};
+			flow->propagated++;
+		}
+		else if(fact->type == FACT_COPY)
+		{
+			node->value.sym_ID    = fact->copy_ID;
+			node->value.var_value = fact->copy_name;
+			flow->propagated++;
+		}
+
+		return;
+	}
+
+	substitute_vars(flow, facts, node->left);
+	substitute_vars(flow, facts, node->right);
+}
+
+static B_tree_node *propagate_expr(Dataflow *flow, const Var_fact *facts, B_tree_node *expr)
+{
+	substitute_vars(flow, facts, expr);
+
+	return simplify(expr, flow->error_code);
+}
+
+static long scope_balance(const B_tree_node *node)
+{
+	long balance = 0;
+
+	for(; node != NULL; node = node->right)
+	{
+		balance += (node->type == SCOPE_START) - (node->type == SCOPE_END) + scope_balance(node->left);
+	}
+
+	return balance;
+}
+
+static B_tree_node *drop_block(Dataflow *flow, B_tree_node *node)
+{
+	long balance = scope_balance(node->right);
+
+	free_tree(node);
+	flow->removed_branches++;
+
+	// the ends of the scopes the block opens are paid by the statements after it,
+	// so the scopes stay and the name tables see the same levels
+	B_tree_node *stub = NULL;
+
+	for(long scope_ID = 0; scope_ID < balance; scope_ID++)
+	{
+		Uni_ret scope = create_node(SCOPE_START, {}, NULL, stub);
+		if(scope.error_code != B_TREE_ALL_GOOD)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the scope.\n", __func__);
+			*flow->error_code = MID_UNABLE_TO_ALLOCATE;
+
+			return stub;
+		}
+
+		stub = scope.arg.node;
+	}
+
+	return stub;
+}
+
+static B_tree_node *keep_block(Dataflow *flow, B_tree_node *node)
+{
+	B_tree_node *body = node->right;
+
+	node->right = NULL;
+	free_tree(node);
+	flow->removed_branches++;
+
+	return body;
+}
+
+static void propagate_block(Dataflow *flow, Var_fact *facts, B_tree_node *node);
+
+static B_tree_node *propagate_cmd(Dataflow *flow, Var_fact *facts, B_tree_node *node)
+{
+	if(node == NULL || *flow->error_code != MID_ALL_GOOD)
+	{
+		return node;
+	}
+
+	if(is_chain(node))
+	{
+		propagate_block(flow, facts, node);
+
+		return node;
+	}
+
+	if(is_assignment(node))
+	{
+		size_t sym_ID = node->left->value.sym_ID;
+
+		node->right = propagate_expr(flow, facts, node->right);
+
+		kill_var(flow, facts, sym_ID);
+
+		if(node->right != NULL && node->right->type == NUM)
+		{
+			facts[sym_ID].type      = FACT_CONST;
+			facts[sym_ID].num_value = node->right->value.num_value;
+		}
+		else if(node->right != NULL && node->right->type == VAR && node->right->value.sym_ID != sym_ID)
+		{
+			facts[sym_ID].type      = FACT_COPY;
+			facts[sym_ID].copy_ID   = node->right->value.sym_ID;
+			facts[sym_ID].copy_name = node->right->value.var_value;
+		}
+
+		return node;
+	}
+
+	switch(node->type)
+	{
+		case IF:
+		{
+			node->left = propagate_expr(flow, facts, node->left);
+
+			if(node->left != NULL && node->left->type == NUM)
+			{
+				if(cmp_double(node->left->value.num_value, 0) == 0)
+				{
+					return drop_block(flow, node);
+				}
+
+				B_tree_node *body = keep_block(flow, node);
+
+				propagate_block(flow, facts, body);
+
+				return body;
+			}
+
+			// the block may be skipped, so only the facts both ways agree on are left
+			Var_fact *body_facts = copy_facts(flow, facts);
+			if(body_facts == NULL)
+			{
+				return node;
+			}
+
+			propagate_block(flow, body_facts, node->right);
+			meet_facts(flow, facts, body_facts);
+
+			free(body_facts);
+
+			return node;
+		}
+		case WHILE:
+		{
+			Var_fact *entry_facts = copy_facts(flow, facts);
+			if(entry_facts == NULL)
+			{
+				return node;
+			}
+
+			// every iteration starts with what the loop leaves of the facts
+			kill_assigned(flow, facts, node->right);
+
+			node->left = propagate_expr(flow, facts, node->left);
+
+			if(node->left != NULL && node->left->type == NUM && cmp_double(node->left->value.num_value, 0) == 0)
+			{
+				memcpy(facts, entry_facts, flow->syms_amount * sizeof(Var_fact));
+				free(entry_facts);
+
+				return drop_block(flow, node);
+			}
+
+			memcpy(entry_facts, facts, flow->syms_amount * sizeof(Var_fact));
+
+			propagate_block(flow, entry_facts, node->right);
+
+			free(entry_facts);
+
+			return node;
+		}
+		case STD_FUNC:
+		{
+			if(is_getvar(node))
+			{
+				kill_var(flow, facts, node->right->value.sym_ID);
+
+				return node;
+			}
+
+			node->left  = propagate_expr(flow, facts, node->left);
+			node->right = propagate_expr(flow, facts, node->right);
+
+			return node;
+		}
+		case FUNC:
+		case CMD_FUNC:
+		case RETURN:
+		{
+			// the callee never touches the variables of the caller
+			node->left  = propagate_expr(flow, facts, node->left);
+			node->right = propagate_expr(flow, facts, node->right);
+
+			return node;
+		}
+		case FUNC_DECL:
+		case MAIN:
+		{
+			Var_fact *func_facts = (Var_fact *)calloc(flow->syms_amount, sizeof(Var_fact));
+			if(func_facts == NULL)
+			{
+				LOG("%s: ERROR:\n\tUnable to allocate the facts.\n", __func__);
+				*flow->error_code = MID_UNABLE_TO_ALLOCATE;
+
+				return node;
+			}
+
+			propagate_block(flow, func_facts, node->right);
+
+			free(func_facts);
+
+			return node;
+		}
+		case NUM:
+		case OP:
+		case VAR:
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case UNR_OP:
+		case DECLARE:
+		case COMMA:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		default:
+		{
+			return node;
+		}
+	}
+}
+
+static void propagate_block(Dataflow *flow, Var_fact *facts, B_tree_node *node)
+{
+	B_tree_node *cur_node = node;
+
+	for(; is_chain(cur_node); cur_node = cur_node->right)
+	{
+		if(cur_node->type == SCOPE_END)
+		{
+			kill_copies(flow, facts);
+		}
+
+		cur_node->left = propagate_cmd(flow, facts, cur_node->left);
+	}
+
+	if(cur_node != NULL)
+	{
+		propagate_cmd(flow, facts, cur_node);
+	}
+}
+
+static void count_reads(Dataflow *flow, const B_tree_node *node, bool is_target)
+{
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == VAR)
+		{
+			if(!is_target)
+			{
+				flow->reads[node->value.sym_ID]++;
+			}
+
+			return;
+		}
+
+		count_reads(flow, node->left, is_assignment(node));
+
+		is_target = is_getvar(node);
+	}
+}
+
+static void remove_dead_stores(Dataflow *flow, B_tree_node *node)
+{
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == FUNC_DECL || node->type == MAIN)
+		{
+			// every function has its own variables
+			memset(flow->reads, 0, flow->syms_amount * sizeof(size_t));
+			count_reads(flow, node->right, false);
+		}
+
+		B_tree_node *cmd = node->left;
+
+		if(is_chain(node) && is_assignment(cmd) &&
+		   flow->reads[cmd->left->value.sym_ID] == 0 && is_pure_expr(cmd->right))
+		{
+			free_tree(cmd);
+			node->left = NULL;
+			flow->removed_stores++;
+		}
+		else
+		{
+			remove_dead_stores(flow, cmd);
+		}
+	}
+}
+
+B_tree_node *propagate_consts(B_tree_node *root, mid_err_t *error_code)
+{
+	Dataflow flow = {};
+
+	flow.error_code  = error_code;
+	flow.syms_amount = max_sym(root);
+
+	if(flow.syms_amount == 0)
+	{
+		return root;
+	}
+
+	Var_fact *facts = (Var_fact *)calloc(flow.syms_amount, sizeof(Var_fact));
+	flow.reads      = (size_t   *)calloc(flow.syms_amount, sizeof(size_t));
+
+	if(facts == NULL || flow.reads == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the facts.\n", __func__);
+		*error_code = MID_UNABLE_TO_ALLOCATE;
+
+		free(facts);
+		free(flow.reads);
+
+		return root;
+	}
+
+	root = propagate_cmd(&flow, facts, root);
+
+	if(*error_code == MID_ALL_GOOD)
+	{
+		count_reads(&flow, root, false);
+		remove_dead_stores(&flow, root);
+	}
+
+	LOG("%s: %lu variables propagated, %lu dead stores and %lu blocks removed.\n", __func__,
+		flow.propagated, flow.removed_stores, flow.removed_branches);
+
+	free(facts);
+	free(flow.reads);
+
+	return root;
+}
@@ -0,0 +1,410 @@
+#include <stdlib.h>
+
+#include "midend_secondary.h"
+
+bool is_pure_expr(const B_tree_node *node)
+{
+	if(node == NULL)
+	{
+		return true;
+	}
+
+	switch(node->type)
+	{
+		case OP:
+		{
+			return node->value.op_value != ASS && is_pure_expr(node->left) && is_pure_expr(node->right);
+		}
+		case NUM:
+		case VAR:
+		case UNR_OP:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		{
+			return is_pure_expr(node->left) && is_pure_expr(node->right);
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case FUNC:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case FUNC_DECL:
+		case MAIN:
+		case CMD_FUNC:
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+static size_t count_nodes(const B_tree_node *node)
+{
+	size_t amount = 0;
+
+	for(; node != NULL; node = node->right)
+	{
+		amount += 1 + count_nodes(node->left);
+	}
+
+	return amount;
+}
+
+static size_t count_uses(const B_tree_node *node, size_t sym_ID)
+{
+	size_t uses = 0;
+
+	for(; node != NULL; node = node->right)
+	{
+		uses += (node->type == VAR && node->value.sym_ID == sym_ID ? 1 : 0) + count_uses(node->left, sym_ID);
+	}
+
+	return uses;
+}
+
+// it walks the whole program, so the right children are taken in the loop and a long chain needs no stack
+static size_t count_calls(const B_tree_node *node, size_t sym_ID)
+{
+	size_t calls = 0;
+
+	for(; node != NULL; node = node->right)
+	{
+		calls += ((node->type == FUNC || node->type == CMD_FUNC) && node->value.sym_ID == sym_ID ? 1 : 0) +
+				 count_calls(node->left, sym_ID);
+	}
+
+	return calls;
+}
+
+static size_t count_list(const B_tree_node *list)
+{
+	size_t amount = 0;
+
+	for(; list != NULL; list = list->right)
+	{
+		amount++;
+	}
+
+	return amount;
+}
+
+static const B_tree_node *find_param(const B_tree_node *params, const B_tree_node *args, size_t sym_ID)
+{
+	for(; params != NULL && args != NULL; params = params->right, args = args->right)
+	{
+		if(params->left->value.sym_ID == sym_ID)
+		{
+			return args->left;
+		}
+	}
+
+	return NULL;
+}
+
+static bool is_param(const B_tree_node *params, size_t sym_ID)
+{
+	for(; params != NULL; params = params->right)
+	{
+		if(params->left->value.sym_ID == sym_ID)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool uses_only_params(const B_tree_node *node, const B_tree_node *params)
+{
+	for(; node != NULL; node = node->right)
+	{
+		// any other name would be looked up in the scope of the call and capture its variable
+		if(node->type == VAR)
+		{
+			return is_param(params, node->value.sym_ID);
+		}
+
+		if(!uses_only_params(node->left, params))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+B_tree_node *copy_tree(const B_tree_node *node, mid_err_t *error_code)
+{
+	B_tree_node  *copy = NULL;
+	B_tree_node **slot = &copy;
+
+	// the right children are copied in the loop, so a statement chain of any length needs no stack
+	for(; node != NULL; node = node->right)
+	{
+		B_tree_node *left = copy_tree(node->left, error_code);
+
+		Uni_ret node_copy = create_node(node->type, node->value, left, NULL);
+		if(node_copy.error_code != B_TREE_ALL_GOOD)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the copy.\n", __func__);
+			*error_code = MID_UNABLE_TO_ALLOCATE;
+
+			free_tree(left);
+			free_tree(copy);
+
+			return NULL;
+		}
+
+		*slot = node_copy.arg.node;
+		slot  = &node_copy.arg.node->right;
+	}
+
+	return copy;
+}
+
+static B_tree_node *substitute(const B_tree_node *node, const B_tree_node *params,
+							   const B_tree_node *args, mid_err_t *error_code)
+{
+	B_tree_node  *copy = NULL;
+	B_tree_node **slot = &copy;
+
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == VAR)
+		{
+			*slot = copy_tree(find_param(params, args, node->value.sym_ID), error_code);
+
+			break;
+		}
+
+		B_tree_node *left = substitute(node->left, params, args, error_code);
+
+		Uni_ret node_copy = create_node(node->type, node->value, left, NULL);
+		if(node_copy.error_code != B_TREE_ALL_GOOD)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the inlined node.\n", __func__);
+			*error_code = MID_UNABLE_TO_ALLOCATE;
+
+			free_tree(left);
+			free_tree(copy);
+
+			return NULL;
+		}
+
+		*slot = node_copy.arg.node;
+		slot  = &node_copy.arg.node->right;
+	}
+
+	return copy;
+}
+
+static Inline_func *find_func(Inline_table *table, size_t sym_ID)
+{
+	for(size_t func_ID = 0; func_ID < table->size; func_ID++)
+	{
+		if(table->funcs[func_ID].sym_ID == sym_ID)
+		{
+			return &table->funcs[func_ID];
+		}
+	}
+
+	return NULL;
+}
+
+static bool can_inline(const Inline_func *func, const B_tree_node *call)
+{
+	if(func == NULL || !func->inlinable || count_list(call->left) != func->params_amount)
+	{
+		return false;
+	}
+
+	// the arguments are evaluated as many times as their parameters are used
+	const B_tree_node *params = func->decl->left;
+
+	for(const B_tree_node *args = call->left; args != NULL; args = args->right, params = params->right)
+	{
+		if(!is_pure_expr(args->left))
+		{
+			return false;
+		}
+
+		if(args->left->type != NUM && args->left->type != VAR &&
+		   count_uses(func->ret->right, params->left->value.sym_ID) > 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static B_tree_node *inline_call(B_tree_node *node, Inline_table *table, mid_err_t *error_code)
+{
+	Inline_func *func = find_func(table, node->value.sym_ID);
+	if(!can_inline(func, node))
+	{
+		return node;
+	}
+
+	table->inlined++;
+
+	// the value of an inlined statement call is dropped, and so is the whole call
+	B_tree_node *body = node->type == FUNC ?
+						substitute(func->ret->right, func->decl->left, node->left, error_code) : NULL;
+
+	free_tree(node);
+
+	return body;
+}
+
+B_tree_node *inline_calls(B_tree_node *node, Inline_table *table, mid_err_t *error_code)
+{
+	if(node == NULL)
+	{
+		return NULL;
+	}
+
+	if(node->type == FUNC || node->type == CMD_FUNC)
+	{
+		node->left  = inline_calls(node->left,  table, error_code);
+		node->right = inline_calls(node->right, table, error_code);
+
+		return inline_call(node, table, error_code);
+	}
+
+	// every other node is kept, so its right children are taken in the loop and need no stack
+	for(B_tree_node *cur_node = node; cur_node != NULL; cur_node = cur_node->right)
+	{
+		cur_node->left = inline_calls(cur_node->left, table, error_code);
+
+		if(cur_node->right != NULL && (cur_node->right->type == FUNC || cur_node->right->type == CMD_FUNC))
+		{
+			cur_node->right = inline_calls(cur_node->right, table, error_code);
+
+			break;
+		}
+	}
+
+	return node;
+}
+
+static void collect_funcs(B_tree_node *node, Inline_table *table, mid_err_t *error_code)
+{
+	for(; node != NULL && *error_code == MID_ALL_GOOD; node = node->right)
+	{
+		B_tree_node *decl = node->left;
+
+		if(decl != NULL && decl->type == FUNC_DECL)
+		{
+			if(table->size >= table->capacity)
+			{
+				table->capacity = (table->size + 1) * 2;
+				table->funcs    = (Inline_func *)realloc(table->funcs, table->capacity * sizeof(Inline_func));
+				if(table->funcs == NULL)
+				{
+					LOG("%s: ERROR:\n\tUnable to allocate the functions.\n", __func__);
+					*error_code = MID_UNABLE_TO_ALLOCATE;
+
+					return;
+				}
+			}
+
+			Inline_func *func = &table->funcs[table->size++];
+			B_tree_node *body = decl->right;
+
+			*func = {};
+			func->sym_ID        = decl->value.sym_ID;
+			func->decl          = decl;
+			func->slot          = &node->left;
+			func->params_amount = count_list(decl->left);
+
+			// only a body of a single return is an expression to put in place of the call
+			if(body != NULL && body->right == NULL && body->left != NULL && body->left->type == RETURN)
+			{
+				func->ret = body->left;
+			}
+		}
+
+		collect_funcs(node->left, table, error_code);
+	}
+}
+
+static bool mark_inlinable(Inline_table *table, mid_err_t *error_code)
+{
+	bool changed = false;
+
+	for(size_t func_ID = 0; func_ID < table->size; func_ID++)
+	{
+		Inline_func *func = &table->funcs[func_ID];
+		if(func->inlinable || func->ret == NULL)
+		{
+			continue;
+		}
+
+		func->ret->right = inline_calls(func->ret->right, table, error_code);
+
+		// a recursive function keeps its call and never becomes pure
+		if(is_pure_expr(func->ret->right)                         &&
+		   uses_only_params(func->ret->right, func->decl->left) &&
+		   count_nodes(func->ret->right) <= INLINE_BUDGET)
+		{
+			func->inlinable = true;
+			changed         = true;
+		}
+	}
+
+	return changed;
+}
+
+B_tree_node *inline_funcs(B_tree_node *root, mid_err_t *error_code)
+{
+	Inline_table table = {};
+
+	collect_funcs(root, &table, error_code);
+
+	// the callees are found before their callers, so the small helpers inline into each other
+	while(*error_code == MID_ALL_GOOD && mark_inlinable(&table, error_code))
+	{
+		;
+	}
+
+	if(*error_code == MID_ALL_GOOD)
+	{
+		root = inline_calls(root, &table, error_code);
+	}
+
+	size_t removed = 0;
+
+	for(size_t func_ID = 0; func_ID < table.size && *error_code == MID_ALL_GOOD; func_ID++)
+	{
+		Inline_func *func = &table.funcs[func_ID];
+
+		if(func->inlinable && count_calls(root, func->sym_ID) == 0)
+		{
+			free_tree(func->decl);
+			*func->slot = NULL;
+			removed++;
+		}
+	}
+
+	LOG("%s: %lu calls inlined, %lu functions removed.\n", __func__, table.inlined, removed);
+
+	free(table.funcs);
+
+	return root;
+}
@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "midend_secondary.h"
+
+static wchar_t TEMP_NAME[] = L"_invariant";
+
+static void mark_assigned(Licm *licm, const B_tree_node *node)
+{
+	// the statements of the body follow in the loop, so a long body needs no stack
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == OP && node->value.op_value == ASS && node->left != NULL && node->left->type == VAR)
+		{
+			licm->assigned[node->left->value.sym_ID] = true;
+		}
+		else if(node->type == STD_FUNC && node->value.func == GETVAR && node->right != NULL)
+		{
+			licm->assigned[node->right->value.sym_ID] = true;
+		}
+
+		mark_assigned(licm, node->left);
+	}
+}
+
+static bool is_invariant(const Licm *licm, const B_tree_node *node)
+{
+	if(node == NULL)
+	{
+		return true;
+	}
+
+	switch(node->type)
+	{
+		case NUM:
+		{
+			return true;
+		}
+		case VAR:
+		{
+			return node->value.sym_ID < licm->syms_amount && !licm->assigned[node->value.sym_ID];
+		}
+		case OP:
+		{
+			return node->value.op_value != ASS &&
+				   is_invariant(licm, node->left) && is_invariant(licm, node->right);
+		}
+		case FUNC:
+		{
+			if(!licm->pure_funcs[node->value.sym_ID])
+			{
+				return false;
+			}
+
+			for(const B_tree_node *arg = node->left; arg != NULL; arg = arg->right)
+			{
+				if(!is_invariant(licm, arg->left))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+		case UNR_OP:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		{
+			return is_invariant(licm, node->left) && is_invariant(licm, node->right);
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case FUNC_DECL:
+		case MAIN:
+		case CMD_FUNC:
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+static bool is_worth_hoisting(const B_tree_node *node)
+{
+	return node->type != NUM && node->type != VAR;
+}
+
+static bool has_call(const B_tree_node *node)
+{
+	if(node == NULL)
+	{
+		return false;
+	}
+
+	return node->type == FUNC || has_call(node->left) || has_call(node->right);
+}
+
+static B_tree_node *hoist(Licm *licm, B_tree_node *expr)
+{
+	size_t sym_ID = licm->next_sym++;
+
+	Uni_ret target = create_node(VAR, {.var_value = TEMP_NAME, .sym_ID = sym_ID}, NULL, NULL);
+	Uni_ret use    = create_node(VAR, {.var_value = TEMP_NAME, .sym_ID = sym_ID}, NULL, NULL);
+	Uni_ret ass    = create_node(OP,  {.op_value  = ASS}, target.arg.node, expr);
+	Uni_ret loop   = create_node(SEMICOLON, {}, licm->holder->left, licm->holder->right);
+
+	if(target.error_code != B_TREE_ALL_GOOD || use.error_code  != B_TREE_ALL_GOOD ||
+	   ass.error_code    != B_TREE_ALL_GOOD || loop.error_code != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the temporary.\n", __func__);
+		*licm->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		release_node(target.arg.node);
+		release_node(use.arg.node);
+		release_node(ass.arg.node);
+		release_node(loop.arg.node);
+
+		return expr;
+	}
+
+	// the value is computed into the temporary right before the loop
+	licm->holder->left  = ass.arg.node;
+	licm->holder->right = loop.arg.node;
+	licm->holder        = loop.arg.node;
+	licm->hoisted++;
+
+	return use.arg.node;
+}
+
+// the body may run zero times, so a call hoisted from it could fail where the loop never would
+static bool can_hoist(const Licm *licm, const B_tree_node *node, bool from_body)
+{
+	return is_invariant(licm, node) && !(from_body && has_call(node));
+}
+
+static B_tree_node *hoist_exprs(Licm *licm, B_tree_node *node, bool from_body)
+{
+	if(node == NULL || *licm->error_code != MID_ALL_GOOD)
+	{
+		return node;
+	}
+
+	if(can_hoist(licm, node, from_body))
+	{
+		return is_worth_hoisting(node) ? hoist(licm, node) : node;
+	}
+
+	for(B_tree_node *cur_node = node; cur_node != NULL && *licm->error_code == MID_ALL_GOOD;
+		cur_node = cur_node->right)
+	{
+		cur_node->left = hoist_exprs(licm, cur_node->left, from_body);
+
+		B_tree_node *right = cur_node->right;
+
+		if(right != NULL && can_hoist(licm, right, from_body))
+		{
+			cur_node->right = is_worth_hoisting(right) ? hoist(licm, right) : right;
+
+			break;
+		}
+	}
+
+	return node;
+}
+
+static B_tree_node *hoist_loop(Licm *licm, B_tree_node *holder)
+{
+	B_tree_node *loop = holder->left;
+
+	licm->syms_amount = licm->next_sym;
+
+	bool *assigned = (bool *)realloc(licm->assigned, licm->syms_amount * sizeof(bool));
+	if(assigned == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the assigned variables.\n", __func__);
+		*licm->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return holder;
+	}
+
+	licm->assigned = assigned;
+	memset(licm->assigned, 0, licm->syms_amount * sizeof(bool));
+
+	mark_assigned(licm, loop->right);
+
+	licm->holder = holder;
+
+	loop->left  = hoist_exprs(licm, loop->left,  false);
+	loop->right = hoist_exprs(licm, loop->right, true);
+
+	return licm->holder;
+}
+
+static void hoist_loops(Licm *licm, B_tree_node *node)
+{
+	while(node != NULL && *licm->error_code == MID_ALL_GOOD)
+	{
+		if(!is_chain(node) || node->left == NULL || node->left->type != WHILE)
+		{
+			hoist_loops(licm, node->left);
+
+			node = node->right;
+
+			continue;
+		}
+
+		// the inner loops go first, so what they hoist may leave the outer loop too
+		hoist_loops(licm, node->left->right);
+
+		node = hoist_loop(licm, node)->right;
+	}
+}
+
+B_tree_node *hoist_invariants(B_tree_node *root, mid_err_t *error_code)
+{
+	Licm licm = {};
+
+	licm.error_code  = error_code;
+	licm.next_sym    = count_syms(root);
+	licm.pure_funcs  = find_pure_funcs(root, licm.next_sym + 1, error_code);
+
+	if(licm.pure_funcs == NULL)
+	{
+		return root;
+	}
+
+	hoist_loops(&licm, root);
+
+	LOG("%s: %lu invariant expressions hoisted.\n", __func__, licm.hoisted);
+
+	free(licm.pure_funcs);
+	free(licm.assigned);
+
+	return root;
+}
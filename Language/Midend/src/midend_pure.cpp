@@ -0,0 +1,667 @@
+#include <stdlib.h>
+#include <wchar.h>
+
+#include "midend_secondary.h"
+
+static wchar_t MEMO_NAME[]   = L"_memo";
+static wchar_t BODY_SUFFIX[] = L"#body"; // '#' starts a comment in Tatlang, so no user name ends so
+
+static void collect_decls(Pure_eval *pure, B_tree_node *node)
+{
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == FUNC_DECL)
+		{
+			pure->decls[node->value.sym_ID] = node;
+		}
+
+		collect_decls(pure, node->left);
+	}
+}
+
+static bool take_step(Pure_eval *pure)
+{
+	return ++pure->steps <= EVAL_BUDGET;
+}
+
+static Exec_result call_func(Pure_eval *pure, Eval_frame *caller, const B_tree_node *call, btr_elem_t *value);
+
+static Exec_result eval_expr(Pure_eval *pure, Eval_frame *frame, const B_tree_node *node, btr_elem_t *value)
+{
+	if(node == NULL || !take_step(pure))
+	{
+		return EXEC_FAILED;
+	}
+
+	btr_elem_t left  = 0;
+	btr_elem_t right = 0;
+	mid_err_t  error = MID_ALL_GOOD;
+
+	switch(node->type)
+	{
+		case NUM:
+		{
+			*value = node->value.num_value;
+
+			return EXEC_NEXT;
+		}
+		case VAR:
+		{
+			if(!frame->known[node->value.sym_ID])
+			{
+				return EXEC_FAILED;
+			}
+
+			*value = frame->values[node->value.sym_ID];
+
+			return EXEC_NEXT;
+		}
+		case OP:
+		{
+			if(node->value.op_value == ASS ||
+			   eval_expr(pure, frame, node->left,  &left)  != EXEC_NEXT ||
+			   eval_expr(pure, frame, node->right, &right) != EXEC_NEXT)
+			{
+				return EXEC_FAILED;
+			}
+
+			*value = eval_op(node->value.op_value, left, right, &error);
+
+			return error == MID_ALL_GOOD ? EXEC_NEXT : EXEC_FAILED;
+		}
+		case UNR_OP:
+		{
+			if(eval_expr(pure, frame, node->right, &right) != EXEC_NEXT)
+			{
+				return EXEC_FAILED;
+			}
+
+			*value = eval_op(node->value.op_value, 0, right, &error);
+
+			return error == MID_ALL_GOOD ? EXEC_NEXT : EXEC_FAILED;
+		}
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		{
+			if(eval_expr(pure, frame, node->left,  &left)  != EXEC_NEXT ||
+			   eval_expr(pure, frame, node->right, &right) != EXEC_NEXT)
+			{
+				return EXEC_FAILED;
+			}
+
+			*value = eval_relation(node->type, left, right);
+
+			return EXEC_NEXT;
+		}
+		case FUNC:
+		{
+			return call_func(pure, frame, node, value);
+		}
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case FUNC_DECL:
+		case MAIN:
+		case CMD_FUNC:
+		default:
+		{
+			return EXEC_FAILED;
+		}
+	}
+}
+
+static bool is_true(btr_elem_t value)
+{
+	// the VM jumps over a block if its condition equals 0
+	return cmp_double(value, 0) != 0;
+}
+
+static Exec_result exec_block(Pure_eval *pure, Eval_frame *frame, const B_tree_node *node);
+
+static Exec_result exec_cmd(Pure_eval *pure, Eval_frame *frame, const B_tree_node *node)
+{
+	if(node == NULL)
+	{
+		return EXEC_NEXT;
+	}
+
+	if(is_chain(node))
+	{
+		return exec_block(pure, frame, node);
+	}
+
+	if(!take_step(pure))
+	{
+		return EXEC_FAILED;
+	}
+
+	btr_elem_t value = 0;
+
+	switch(node->type)
+	{
+		case OP:
+		{
+			if(node->value.op_value != ASS || node->left == NULL || node->left->type != VAR ||
+			   eval_expr(pure, frame, node->right, &value) != EXEC_NEXT)
+			{
+				return EXEC_FAILED;
+			}
+
+			frame->values[node->left->value.sym_ID] = value;
+			frame->known [node->left->value.sym_ID] = true;
+
+			return EXEC_NEXT;
+		}
+		case IF:
+		{
+			if(eval_expr(pure, frame, node->left, &value) != EXEC_NEXT)
+			{
+				return EXEC_FAILED;
+			}
+
+			return is_true(value) ? exec_block(pure, frame, node->right) : EXEC_NEXT;
+		}
+		case WHILE:
+		{
+			// the budget stops the loops which never end
+			while(true)
+			{
+				if(eval_expr(pure, frame, node->left, &value) != EXEC_NEXT)
+				{
+					return EXEC_FAILED;
+				}
+
+				if(!is_true(value))
+				{
+					return EXEC_NEXT;
+				}
+
+				Exec_result result = exec_block(pure, frame, node->right);
+				if(result != EXEC_NEXT)
+				{
+					return result;
+				}
+			}
+		}
+		case RETURN:
+		{
+			if(eval_expr(pure, frame, node->right, &frame->ret) != EXEC_NEXT)
+			{
+				return EXEC_FAILED;
+			}
+
+			return EXEC_RETURN;
+		}
+		case CMD_FUNC:
+		{
+			return call_func(pure, frame, node, &value);
+		}
+		case NUM:
+		case VAR:
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case STD_FUNC:
+		case UNR_OP:
+		case FUNC:
+		case DECLARE:
+		case COMMA:
+		case FUNC_DECL:
+		case MAIN:
+		case ABOVE:
+		case BELOW:
+		case ABOVE_EQUAL:
+		case BELOW_EQUAL:
+		case EQUAL:
+		case NOT_EQUAL:
+		default:
+		{
+			return EXEC_FAILED;
+		}
+	}
+}
+
+static Exec_result exec_block(Pure_eval *pure, Eval_frame *frame, const B_tree_node *node)
+{
+	const B_tree_node *cur_node = node;
+
+	for(; is_chain(cur_node); cur_node = cur_node->right)
+	{
+		Exec_result result = exec_cmd(pure, frame, cur_node->left);
+		if(result != EXEC_NEXT)
+		{
+			return result;
+		}
+	}
+
+	return exec_cmd(pure, frame, cur_node);
+}
+
+static bool frame_ctor(Pure_eval *pure, Eval_frame *frame)
+{
+	*frame = {};
+
+	frame->values = (btr_elem_t *)calloc(pure->syms_amount, sizeof(btr_elem_t));
+	frame->known  = (bool       *)calloc(pure->syms_amount, sizeof(bool));
+
+	if(frame->values == NULL || frame->known == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the frame.\n", __func__);
+		*pure->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return false;
+	}
+
+	return true;
+}
+
+static void frame_dtor(Eval_frame *frame)
+{
+	free(frame->values);
+	free(frame->known);
+
+	*frame = {};
+}
+
+static Exec_result call_func(Pure_eval *pure, Eval_frame *caller, const B_tree_node *call, btr_elem_t *value)
+{
+	size_t             sym_ID = call->value.sym_ID;
+	const B_tree_node *decl   = pure->decls[sym_ID];
+
+	if(decl == NULL || !pure->pure_funcs[sym_ID] || pure->depth >= EVAL_DEPTH)
+	{
+		return EXEC_FAILED;
+	}
+
+	Eval_frame frame = {};
+	if(!frame_ctor(pure, &frame))
+	{
+		frame_dtor(&frame);
+
+		return EXEC_FAILED;
+	}
+
+	// the arguments are computed in the frame of the caller, the parameters live in the frame of the callee
+	const B_tree_node *params = decl->left;
+	const B_tree_node *args   = call->left;
+
+	Exec_result result = EXEC_NEXT;
+
+	for(; params != NULL && args != NULL && result == EXEC_NEXT; params = params->right, args = args->right)
+	{
+		size_t param_ID = params->left->value.sym_ID;
+
+		result = eval_expr(pure, caller, args->left, &frame.values[param_ID]);
+		frame.known[param_ID] = true;
+	}
+
+	if(result == EXEC_NEXT && params == NULL && args == NULL)
+	{
+		pure->depth++;
+		result = exec_block(pure, &frame, decl->right);
+		pure->depth--;
+	}
+	else
+	{
+		result = EXEC_FAILED;
+	}
+
+	*value = frame.ret;
+
+	frame_dtor(&frame);
+
+	// a function which ends without a return leaves no value
+	return result == EXEC_RETURN ? EXEC_NEXT : EXEC_FAILED;
+}
+
+static bool has_const_args(const B_tree_node *call)
+{
+	for(const B_tree_node *arg = call->left; arg != NULL; arg = arg->right)
+	{
+		if(arg->left == NULL || arg->left->type != NUM)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void fold_call(Pure_eval *pure, B_tree_node *node)
+{
+	Eval_frame caller = {};
+	btr_elem_t value  = 0;
+
+	pure->steps = 0;
+	pure->depth = 0;
+
+	if(frame_ctor(pure, &caller) && call_func(pure, &caller, node, &value) == EXEC_NEXT)
+	{
+		make_num(node, value);
+		pure->folded++;
+	}
+
+	frame_dtor(&caller);
+}
+
+static void fold_calls(Pure_eval *pure, B_tree_node *node)
+{
+	// a call is folded after its arguments, which are its left child, and the statements follow in the loop
+	for(; node != NULL && *pure->error_code == MID_ALL_GOOD; node = node->right)
+	{
+		fold_calls(pure, node->left);
+
+		if(node->type == FUNC && pure->pure_funcs[node->value.sym_ID] && has_const_args(node))
+		{
+			fold_call(pure, node);
+		}
+	}
+}
+
+static bool pure_eval_ctor(Pure_eval *pure, B_tree_node *root, mid_err_t *error_code)
+{
+	*pure = {};
+
+	pure->error_code  = error_code;
+	pure->syms_amount = count_syms(root);
+	pure->pure_funcs  = find_pure_funcs(root, pure->syms_amount + 1, error_code);
+	pure->decls       = (B_tree_node **)calloc(pure->syms_amount + 1, sizeof(B_tree_node *));
+
+	if(pure->pure_funcs == NULL || pure->decls == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the functions.\n", __func__);
+		*error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return false;
+	}
+
+	collect_decls(pure, root);
+
+	return true;
+}
+
+static void pure_eval_dtor(Pure_eval *pure)
+{
+	free(pure->pure_funcs);
+	free(pure->decls);
+
+	*pure = {};
+}
+
+B_tree_node *eval_pure_calls(B_tree_node *root, mid_err_t *error_code)
+{
+	Pure_eval pure = {};
+
+	if(!pure_eval_ctor(&pure, root, error_code))
+	{
+		pure_eval_dtor(&pure);
+
+		return root;
+	}
+
+	fold_calls(&pure, root);
+
+	size_t folded = pure.folded;
+
+	LOG("%s: %lu calls evaluated.\n", __func__, folded);
+
+	pure_eval_dtor(&pure);
+
+	// the folded numbers may fold their expressions and turn the variables they are assigned to into constants
+	if(folded != 0 && *error_code == MID_ALL_GOOD)
+	{
+		root = simplify(root, error_code);
+	}
+
+	if(folded != 0 && *error_code == MID_ALL_GOOD)
+	{
+		root = propagate_consts(root, error_code);
+	}
+
+	return root;
+}
+
+static B_tree_node *new_node(Pure_eval *pure, Node_type type, Node_value value,
+							 B_tree_node *left, B_tree_node *right)
+{
+	Uni_ret node = create_node(type, value, left, right);
+	if(node.error_code != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the memo node.\n", __func__);
+		*pure->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		free_tree(left);
+		free_tree(right);
+
+		return NULL;
+	}
+
+	return node.arg.node;
+}
+
+static B_tree_node *new_num(Pure_eval *pure, btr_elem_t value)
+{
+	return new_node(pure, NUM, {.num_value = value}, NULL, NULL);
+}
+
+static B_tree_node *new_add(Pure_eval *pure, const B_tree_node *param, size_t addend)
+{
+	return new_node(pure, OP, {.op_value = ADD}, new_node(pure, VAR, param->value, NULL, NULL),
+					new_num(pure, (btr_elem_t)addend));
+}
+
+static B_tree_node *new_chain(Pure_eval *pure, B_tree_node *cmd, B_tree_node *next)
+{
+	return new_node(pure, SEMICOLON, {.num_value = 0}, cmd, next);
+}
+
+static B_tree_node *new_fill(Pure_eval *pure, B_tree_node *address, B_tree_node *value)
+{
+	B_tree_node *args = new_node(pure, COMMA, {.num_value = 0}, value, NULL);
+	args = new_node(pure, COMMA, {.num_value = 0}, new_num(pure, 1), args);
+	args = new_node(pure, COMMA, {.num_value = 0}, address, args);
+
+	return new_node(pure, STD_FUNC, {.func = FILLRAM}, NULL, args);
+}
+
+static B_tree_node *new_read(Pure_eval *pure, B_tree_node *address)
+{
+	return new_node(pure, STD_FUNC, {.func = READRAM}, NULL, address);
+}
+
+static B_tree_node *new_body_call(Pure_eval *pure, Node_value body, const B_tree_node *param)
+{
+	B_tree_node *args = new_node(pure, COMMA, {.num_value = 0},
+								 new_node(pure, VAR, param->value, NULL, NULL), NULL);
+
+	return new_node(pure, FUNC, body, args, NULL);
+}
+
+static B_tree_node *new_lookup(Pure_eval *pure, Node_value body, const B_tree_node *param,
+							   Node_value memo, size_t keys_cell)
+{
+	size_t values_cell = keys_cell + MEMO_KEYS;
+
+	// a cell keeps the key it was filled for plus one, so the empty cells match no key
+	B_tree_node *hit = new_node(pure, IF, {.num_value = 0},
+								new_node(pure, EQUAL, {.num_value = 0},
+										 new_read(pure, new_add(pure, param, keys_cell)),
+										 new_add(pure, param, 1)),
+								new_node(pure, RETURN, {.num_value = 0}, NULL,
+										 new_read(pure, new_add(pure, param, values_cell))));
+
+	B_tree_node *miss = new_node(pure, OP, {.op_value = ASS},
+								 new_node(pure, VAR, memo, NULL, NULL), new_body_call(pure, body, param));
+
+	B_tree_node *keep_key   = new_fill(pure, new_add(pure, param, keys_cell), new_add(pure, param, 1));
+	B_tree_node *keep_value = new_fill(pure, new_add(pure, param, values_cell),
+									   new_node(pure, VAR, memo, NULL, NULL));
+	B_tree_node *ret        = new_node(pure, RETURN, {.num_value = 0}, NULL,
+									   new_node(pure, VAR, memo, NULL, NULL));
+
+	B_tree_node *lookup = new_chain(pure, ret, NULL);
+	lookup = new_chain(pure, keep_value, lookup);
+	lookup = new_chain(pure, keep_key,   lookup);
+	lookup = new_chain(pure, miss,       lookup);
+	lookup = new_chain(pure, hit,        lookup);
+
+	// the keys out of the table are computed without it
+	B_tree_node *in_table = new_node(pure, IF, {.num_value = 0},
+									 new_node(pure, BELOW, {.num_value = 0},
+											  new_node(pure, VAR, param->value, NULL, NULL),
+											  new_num(pure, (btr_elem_t)MEMO_KEYS)),
+									 lookup);
+
+	B_tree_node *above_zero = new_node(pure, IF, {.num_value = 0},
+									   new_node(pure, ABOVE_EQUAL, {.num_value = 0},
+												new_node(pure, VAR, param->value, NULL, NULL),
+												new_num(pure, 0)),
+									   in_table);
+
+	B_tree_node *computed = new_node(pure, RETURN, {.num_value = 0}, NULL, new_body_call(pure, body, param));
+
+	return new_chain(pure, above_zero, new_chain(pure, computed, NULL));
+}
+
+static bool calls_itself(const B_tree_node *node, size_t sym_ID)
+{
+	for(; node != NULL; node = node->right)
+	{
+		if(((node->type == FUNC || node->type == CMD_FUNC) && node->value.sym_ID == sym_ID) ||
+		   calls_itself(node->left, sym_ID))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool is_memoizable(const Pure_eval *pure, const B_tree_node *decl)
+{
+	size_t sym_ID = decl->value.sym_ID;
+
+	return pure->pure_funcs[sym_ID] && decl->left != NULL && decl->left->right == NULL &&
+		   calls_itself(decl->right, sym_ID);
+}
+
+static wchar_t *body_name(Pure_eval *pure, const wchar_t *name)
+{
+	size_t   size = wcslen(name) + wcslen(BODY_SUFFIX) + 1;
+	wchar_t *body = (wchar_t *)calloc(size, sizeof(wchar_t));
+	if(body == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the name.\n", __func__);
+		*pure->error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return NULL;
+	}
+
+	swprintf(body, size, L"%ls%ls", name, BODY_SUFFIX);
+
+	return body;
+}
+
+static void memoize_func(Pure_eval *pure, B_tree_node *holder, size_t *next_sym)
+{
+	B_tree_node *decl      = holder->left;
+	size_t       keys_cell = MEMO_START + pure->memoized * 2 * MEMO_KEYS;
+
+	wchar_t *name = body_name(pure, decl->value.var_value);
+	if(name == NULL)
+	{
+		return;
+	}
+
+	// the tables are shared by all the frames of the function, the names table of its own keeps the temporary
+	Node_value body = {.var_value = name,      .sym_ID = (*next_sym)++};
+	Node_value memo = {.var_value = MEMO_NAME, .sym_ID = (*next_sym)++};
+
+	B_tree_node *param   = decl->left->left;
+	B_tree_node *lookup  = new_lookup(pure, body, param, memo, keys_cell);
+	B_tree_node *params  = new_node(pure, COMMA, {.num_value = 0},
+									new_node(pure, VAR, param->value, NULL, NULL), NULL);
+	B_tree_node *wrapper = new_node(pure, FUNC_DECL, decl->value, params, lookup);
+	B_tree_node *next    = new_chain(pure, NULL, holder->right);
+
+	if(*pure->error_code != MID_ALL_GOOD)
+	{
+		free_tree(wrapper);
+		release_node(next);
+		free(name);
+
+		return;
+	}
+
+	// the old body keeps calling the function by its name, so its recursion goes through the table too
+	decl->value = body;
+
+	next->left    = decl;
+	holder->left  = wrapper;
+	holder->right = next;
+
+	pure->memoized++;
+}
+
+static void memoize_chain(Pure_eval *pure, B_tree_node *node, size_t *next_sym)
+{
+	for(; node != NULL && *pure->error_code == MID_ALL_GOOD; node = node->right)
+	{
+		if(node->left == NULL || node->left->type != FUNC_DECL)
+		{
+			continue;
+		}
+
+		if(is_memoizable(pure, node->left))
+		{
+			memoize_func(pure, node, next_sym);
+
+			// the old body is the next statement now
+			node = node->right;
+		}
+	}
+}
+
+B_tree_node *memoize_funcs(B_tree_node *root, mid_err_t *error_code)
+{
+	Pure_eval pure = {};
+
+	if(!pure_eval_ctor(&pure, root, error_code))
+	{
+		pure_eval_dtor(&pure);
+
+		return root;
+	}
+
+	size_t next_sym = pure.syms_amount;
+
+	memoize_chain(&pure, root, &next_sym);
+
+	LOG("%s: %lu functions memoized.\n", __func__, pure.memoized);
+
+	pure_eval_dtor(&pure);
+
+	return root;
+}
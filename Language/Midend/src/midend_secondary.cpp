@@ -3,24 +3,201 @@
 
 #include "midend_secondary.h"
 
-extern bool change_flag;
+static const char *RULE_NAMES[] =
+{
+	#define DEF_RULE(name, ...) #name,
+
+	#include "strength_rules.h"
+
+	#undef DEF_RULE
+};
+
+static bool push_item(Worklist *worklist, B_tree_node **slot, mid_err_t *error_code)
+{
+	if(worklist->size >= worklist->capacity)
+	{
+		worklist->capacity = (worklist->size + 1) * 2;
+
+		Simplify_item *items = (Simplify_item *)realloc(worklist->items,
+														worklist->capacity * sizeof(Simplify_item));
+		if(items == NULL)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the worklist.\n", __func__);
+			*error_code = MID_UNABLE_TO_ALLOCATE;
+
+			return false;
+		}
+
+		worklist->items = items;
+	}
+
+	worklist->items[worklist->size++] = {.slot = slot, .children_done = false};
+
+	return true;
+}
 
 B_tree_node *simplify(B_tree_node *root, mid_err_t *error_code)
 {
-	if(root == NULL)
+	Worklist worklist            = {};
+	size_t   fired[RULES_AMOUNT] = {};
+
+	// the children are simplified before their parent, so every node is visited once
+	if(!push_item(&worklist, &root, error_code))
 	{
 		return root;
 	}
 
-	root->left  = simplify(root->left,  error_code);
-	root->right = simplify(root->right, error_code);
+	while(worklist.size != 0 && *error_code == MID_ALL_GOOD)
+	{
+		Simplify_item *item = &worklist.items[worklist.size - 1];
+		B_tree_node   *node = *item->slot;
+
+		if(node == NULL)
+		{
+			worklist.size--;
+
+			continue;
+		}
+
+		if(item->children_done)
+		{
+			worklist.size--;
 
-	root = fold_consts(root, error_code);
-	root = solve_trivial_expr(root);
+			*item->slot = apply_rules(node, fired, error_code);
+
+			continue;
+		}
+
+		item->children_done = true;
+
+		if(!push_item(&worklist, &node->right, error_code) ||
+		   !push_item(&worklist, &node->left,  error_code))
+		{
+			break;
+		}
+	}
+
+	free(worklist.items);
+
+	for(size_t rule_ID = 0; rule_ID < RULES_AMOUNT; rule_ID++)
+	{
+		if(fired[rule_ID] != 0)
+		{
+			LOG("%s: %s rule applied %lu times.\n", __func__, RULE_NAMES[rule_ID], fired[rule_ID]);
+		}
+	}
 
 	return root;
 }
 
+B_tree_node *make_num(B_tree_node *node, btr_elem_t value)
+{
+	free_tree(node->left);
+	free_tree(node->right);
+
+	node->type  = NUM;
+	node->value = {.num_value = value};
+	node->left  = NULL;
+	node->right = NULL;
+
+	return node;
+}
+
+B_tree_node *keep_child(B_tree_node *node, bool is_right_child)
+{
+	B_tree_node *child = is_right_child ? node->right : node->left;
+
+	if(is_right_child)
+	{
+		node->right = NULL;
+	}
+	else
+	{
+		node->left = NULL;
+	}
+
+	free_tree(node);
+
+	return child;
+}
+
+void free_tree(B_tree_node *node)
+{
+	release_tree(node);
+}
+
+bool is_chain(const B_tree_node *node)
+{
+	return node != NULL && (node->type == SEMICOLON || node->type == SCOPE_START || node->type == SCOPE_END);
+}
+
+bool is_relation(Node_type type)
+{
+	return type == ABOVE       || type == BELOW       ||
+		   type == ABOVE_EQUAL || type == BELOW_EQUAL ||
+		   type == EQUAL       || type == NOT_EQUAL;
+}
+
+btr_elem_t eval_relation(Node_type type, btr_elem_t left, btr_elem_t right)
+{
+	int cmp_result = cmp_double(left, right);
+
+	switch(type)
+	{
+		case ABOVE:
+		{
+			return cmp_result > 0;
+		}
+		case BELOW:
+		{
+			return cmp_result < 0;
+		}
+		case ABOVE_EQUAL:
+		{
+			return cmp_result >= 0;
+		}
+		case BELOW_EQUAL:
+		{
+			return cmp_result <= 0;
+		}
+		case EQUAL:
+		{
+			return cmp_result == 0;
+		}
+		case NOT_EQUAL:
+		{
+			return cmp_result != 0;
+		}
+		case NUM:
+		case OP:
+		case VAR:
+		case OPEN_BR:
+		case CLOSE_BR:
+		case OPEN_CBR:
+		case CLOSE_CBR:
+		case SEMICOLON:
+		case KEYWORD:
+		case END:
+		case SCOPE_START:
+		case SCOPE_END:
+		case IF:
+		case WHILE:
+		case STD_FUNC:
+		case UNR_OP:
+		case FUNC:
+		case DECLARE:
+		case RETURN:
+		case COMMA:
+		case FUNC_DECL:
+		case MAIN:
+		case CMD_FUNC:
+		default:
+		{
+			return NAN;
+		}
+	}
+}
+
 B_tree_node *fold_consts(B_tree_node *node, mid_err_t *error_code)
 {
 	if(node == NULL)
@@ -28,23 +205,60 @@ B_tree_node *fold_consts(B_tree_node *node, mid_err_t *error_code)
 		return NULL;
 	}
 
-	if(node->left == NULL || node->right == NULL)
+	// only the arithmetic and the comparisons are folded, the statements are left as they are
+	if((node->type != OP && !is_relation(node->type)) || node->left == NULL || node->right == NULL)
+	{
+		return node;
+	}
+
+	if(node->left->type != NUM || node->right->type != NUM)
 	{
 		return node;
 	}
 
-	if(node->left->type == NUM && node->right->type == NUM)
+	if(is_relation(node->type))
 	{
-		btr_elem_t result = eval(node, error_code);
+		return make_num(node, eval_relation(node->type, node->left->value.num_value,
+													  node->right->value.num_value));
+	}
+
+	btr_elem_t result = eval(node, error_code);
+
+	return make_num(node, result);
+}
+
+static Visit_action eval_visit(B_tree_node *node, void *context)
+{
+	Eval_stack *stack = (Eval_stack *)context;
 
-		change_flag = true;
+	if(node->type == NUM)
+	{
+		stack->values[stack->size++] = node->value.num_value;
 
-		return create_node(NUM, {.num_value = result}, NULL, NULL).arg.node;
+		return VISIT_CONTINUE;
 	}
-	else
+
+	if(node->left == NULL || node->right == NULL)
 	{
-		return node;
+		LOG("%s: ERROR:\n\tNULL node.\n", __func__);
+		*stack->error_code = MID_NULL_NODE;
 	}
+
+	// the operands were pushed by the children, the left one first
+	btr_elem_t right_node_value = node->right == NULL ? NAN : stack->values[--stack->size];
+	btr_elem_t left_node_value  = node->left  == NULL ? NAN : stack->values[--stack->size];
+
+	stack->values[stack->size++] = eval_op(node->value.op_value, left_node_value,
+										   right_node_value, stack->error_code);
+
+	return VISIT_CONTINUE;
+}
+
+static Visit_action eval_count(B_tree_node *, void *context)
+{
+	(*(size_t *)context)++;
+
+	return VISIT_CONTINUE;
 }
 
 btr_elem_t eval(B_tree_node *node, mid_err_t *error_code)
@@ -62,10 +276,45 @@ btr_elem_t eval(B_tree_node *node, mid_err_t *error_code)
 		return node->value.num_value;
 	}
 
-	btr_elem_t left_node_value  = eval(node->left,  error_code);
-	btr_elem_t right_node_value = eval(node->right, error_code);
+	// fold_consts only gets here with two numbers
+	if(node->left  != NULL && node->left->type  == NUM &&
+	   node->right != NULL && node->right->type == NUM)
+	{
+		return eval_op(node->value.op_value, node->left->value.num_value,
+					   node->right->value.num_value, error_code);
+	}
 
-	switch(node->value.op_value)
+	size_t nodes_amount = 0;
+	Eval_stack stack = {.values = NULL, .size = 0, .error_code = error_code};
+
+	if(visit_tree(node, &eval_count, NULL, &nodes_amount) != B_TREE_ALL_GOOD ||
+	   (stack.values = (btr_elem_t *)calloc(nodes_amount, sizeof(btr_elem_t))) == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the values.\n", __func__);
+		*error_code = MID_UNABLE_TO_ALLOCATE;
+
+		return NAN;
+	}
+
+	btr_elem_t result = NAN;
+
+	if(visit_tree(node, NULL, &eval_visit, &stack) != B_TREE_ALL_GOOD)
+	{
+		*error_code = MID_UNABLE_TO_ALLOCATE;
+	}
+	else
+	{
+		result = stack.values[0];
+	}
+
+	free(stack.values);
+
+	return result;
+}
+
+btr_elem_t eval_op(Ops op, btr_elem_t left_node_value, btr_elem_t right_node_value, mid_err_t *error_code)
+{
+	switch(op)
 	{
 		case ADD:
 		{
@@ -156,52 +405,45 @@ B_tree_node *solve_trivial_expr(B_tree_node *node)
 		return node;
 	}
 
+	// the kept child is simplified already, so nothing is left to redo
 	if(LEFT_IS_ZERO)
 	{
 		if(ZERO__MUL_DIV_POW__ANY)
 		{
-			change_flag = true;
 			return ZERO;
 		}
 		else if(ZERO__ADD__ANY)
 		{
-			change_flag      = true;
-			return node->right; // might be simplified further
+			return KEEP_RIGHT;
 		}
 	}
 	else if(RIGHT_IS_ZERO)
 	{
 		if(ANY__MUL__ZERO)
 		{
-			change_flag = true;
 			return ZERO;
 		}
 		else if(ANY__POW__ZERO)
 		{
-			change_flag = true;
 			return ONE;
 		}
 		else if	(ANY__DIV__ZERO)
 		{
-			change_flag = true;
-			return create_node(NUM, {.num_value = NAN}, NULL, NULL).arg.node;
+			return make_num(node, NAN);
 		}
 		else if(ANY__ADD_SUB__ZERO)
 		{
-			change_flag      = true;
-			return node->left; // might be simplified further
+			return KEEP_LEFT;
 		}
 	}
 	else if(LEFT_IS_ONE)
 	{
 		if(ONE__MUL__ANY)
 		{
-			change_flag      = true;
-			return node->right;	// might be simplified further
+			return KEEP_RIGHT;
 		}
 		else if(ONE__POW__ANY)
 		{
-			change_flag = true;
 			return ONE;
 		}
 	}
@@ -209,38 +451,116 @@ B_tree_node *solve_trivial_expr(B_tree_node *node)
 	{
 		if(ANY__MUL_POW_DIV__ONE)
 		{
-			change_flag      = true;
-			return node->left;	// might be simplified further
+			return KEEP_LEFT;
 		}
 	}
 	else if(VAR__SUB__VAR)
 	{
-		change_flag = true;
 		return ZERO;
 	}
 
-
-
 	return node;
 }
 
 #include "undef_triv_dsl.h"
 
-void mid_write_log(const char *file_name, const char *fmt, ...)
+static bool has_sym(const B_tree_node *node)
+{
+	return node->type == VAR || node->type == FUNC || node->type == CMD_FUNC || node->type == FUNC_DECL;
+}
+
+size_t count_syms(const B_tree_node *node)
 {
-    static FILE *log_file = fopen(file_name, "w");
+	size_t amount = 0;
 
-    if (log_file == NULL)
+	// the right children are taken in the loop, so a statement chain of any length needs no stack
+	for(; node != NULL; node = node->right)
 	{
-        perror("Error opening log_file");
-        return;
-    }
+		size_t own  = has_sym(node) ? node->value.sym_ID + 1 : 0;
+		size_t left = count_syms(node->left);
 
-    va_list args = NULL;
+		amount = own  > amount ? own  : amount;
+		amount = left > amount ? left : amount;
+	}
+
+	return amount;
+}
+
+static void mark_funcs(bool *pure_funcs, const B_tree_node *node)
+{
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == FUNC_DECL)
+		{
+			pure_funcs[node->value.sym_ID] = true;
+		}
+
+		mark_funcs(pure_funcs, node->left);
+	}
+}
+
+static bool has_side_effects(const bool *pure_funcs, const B_tree_node *node)
+{
+	for(; node != NULL; node = node->right)
+	{
+		// the input, the output and the RAM are all the state a function can touch
+		if(node->type == STD_FUNC)
+		{
+			return true;
+		}
+
+		if((node->type == FUNC || node->type == CMD_FUNC) && !pure_funcs[node->value.sym_ID])
+		{
+			return true;
+		}
+
+		if(has_side_effects(pure_funcs, node->left))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool unmark_impure(bool *pure_funcs, const B_tree_node *node)
+{
+	bool changed = false;
+
+	for(; node != NULL; node = node->right)
+	{
+		if(node->type == FUNC_DECL && pure_funcs[node->value.sym_ID] &&
+		   has_side_effects(pure_funcs, node->right))
+		{
+			pure_funcs[node->value.sym_ID] = false;
+
+			return true;
+		}
+
+		changed = unmark_impure(pure_funcs, node->left) || changed;
+	}
+
+	return changed;
+}
 
-    va_start(args, fmt);
+bool *find_pure_funcs(const B_tree_node *root, size_t syms_amount, mid_err_t *error_code)
+{
+	bool *pure_funcs = (bool *)calloc(syms_amount, sizeof(bool));
+	if(pure_funcs == NULL)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the functions.\n", __func__);
+		*error_code = MID_UNABLE_TO_ALLOCATE;
 
-    vfprintf(log_file, fmt, args);
+		return NULL;
+	}
+
+	// a function is pure until it is found to call an impure one
+	mark_funcs(pure_funcs, root);
+
+	while(unmark_impure(pure_funcs, root))
+	{
+		;
+	}
 
-    va_end(args);
+	return pure_funcs;
 }
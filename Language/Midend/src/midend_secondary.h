@@ -4,19 +4,268 @@
 #include "midend.h"
 #include "utils.h"
 
+// the midend logs only the errors and a line per pass, so they are kept by default
 #define LOG(...)\
-	mid_write_log("midend_log", __VA_ARGS__);
+	LOG_AT(LOG_LEVEL_INFO, LOG_SINK_MIDEND, __VA_ARGS__);
 
-const size_t MAX_VAR_SIZE = 100;
+const size_t MAX_VAR_SIZE   = 100;
+const size_t INLINE_BUDGET  = 24;
+const size_t MAX_POW_EXPAND = 8;
+const size_t MAX_REWRITES   = 64;
+const size_t EVAL_BUDGET    = 1 << 20;
+const size_t EVAL_DEPTH     = 256;
+const size_t MEMO_KEYS      = 1024;
+const size_t MEMO_START     = 4096;
+
+/**
+ * @def MID_MEMOIZE
+ * @brief Define it to give the pure recursive functions of one parameter a memo table in the VM RAM.
+ *
+ * The tables take 2 * MEMO_KEYS cells each from MEMO_START on, so the program must not use them.
+ */
+
+enum Rule_ID
+{
+	#define DEF_RULE(name, ...) RULE_##name,
+
+	#include "strength_rules.h"
+
+	#undef DEF_RULE
+
+	RULES_AMOUNT,
+};
+
+struct Simplify_item
+{
+	B_tree_node **slot;
+	bool          children_done;
+};
+
+struct Worklist
+{
+	Simplify_item *items;
+	size_t         size;
+	size_t         capacity;
+};
+
+enum Fact_type
+{
+	FACT_UNKNOWN = 0,
+	FACT_CONST   = 1,
+	FACT_COPY    = 2,
+};
+
+struct Var_fact
+{
+	Fact_type   type;
+	btr_elem_t  num_value;
+	size_t      copy_ID;
+	wchar_t    *copy_name;
+};
+
+struct Dataflow
+{
+	mid_err_t *error_code;
+	size_t     syms_amount;
+	size_t    *reads;
+	size_t     propagated;
+	size_t     removed_stores;
+	size_t     removed_branches;
+};
+
+struct Licm
+{
+	mid_err_t   *error_code;
+	size_t       next_sym;
+	size_t       syms_amount;
+	bool        *pure_funcs;
+	bool        *assigned;
+	B_tree_node *holder;
+	size_t       hoisted;
+};
+
+struct Cse_expr
+{
+	B_tree_node **slot;
+	size_t        hash;
+	size_t        size;
+	size_t        stmt_ID;
+	size_t        order;
+};
+
+struct Cse
+{
+	mid_err_t     *error_code;
+	size_t         next_sym;
+	bool          *pure_funcs;
+	B_tree_node  **stmts;
+	size_t         stmts_amount;
+	size_t         stmts_capacity;
+	Cse_expr      *exprs;
+	size_t         exprs_amount;
+	size_t         exprs_capacity;
+	size_t         shared;
+	size_t         removed_nodes;
+};
+
+struct Eval_stack
+{
+	btr_elem_t *values;
+	size_t      size;
+	mid_err_t  *error_code;
+};
+
+enum Exec_result
+{
+	EXEC_NEXT   = 0,
+	EXEC_RETURN = 1,
+	EXEC_FAILED = 2,
+};
+
+struct Eval_frame
+{
+	btr_elem_t *values;
+	bool       *known;
+	btr_elem_t  ret;
+};
+
+struct Pure_eval
+{
+	mid_err_t    *error_code;
+	size_t        syms_amount;
+	bool         *pure_funcs;
+	B_tree_node **decls;
+	size_t        steps;
+	size_t        depth;
+	size_t        folded;
+	size_t        memoized;
+};
+
+struct Inline_func
+{
+	size_t        sym_ID;
+	B_tree_node  *decl;
+	B_tree_node **slot;
+	B_tree_node  *ret;
+	size_t        params_amount;
+	bool          inlinable;
+};
+
+struct Inline_table
+{
+	Inline_func *funcs;
+	size_t       size;
+	size_t       capacity;
+	size_t       inlined;
+};
 
 B_tree_node *simplify          (B_tree_node *root, mid_err_t *error_code);
 
 B_tree_node *fold_consts       (B_tree_node *node, mid_err_t *error_code);
 
+B_tree_node *make_num          (B_tree_node *node, btr_elem_t value);
+
+B_tree_node *keep_child        (B_tree_node *node, bool is_right_child);
+
 btr_elem_t   eval              (B_tree_node *node, mid_err_t *error_code);
 
+btr_elem_t   eval_op           (Ops op, btr_elem_t left, btr_elem_t right, mid_err_t *error_code);
+
+btr_elem_t   eval_relation     (Node_type type, btr_elem_t left, btr_elem_t right);
+
+bool         is_relation       (Node_type type);
+
+bool         is_chain          (const B_tree_node *node);
+
 B_tree_node *solve_trivial_expr(B_tree_node *node);
 
-void         mid_write_log     (const char *file_name, const char *fmt, ...);
+/**
+ * @brief Folds, solves and rewrites an operation by the strength rules until none matches.
+ *
+ * The rules of strength_rules.h move the constants to the right and gather them, so they fold,
+ * turn a division by a power of two into a multiplication, a power of a small integer into
+ * a chain of multiplications, a power of 0.5 into a square root and a doubled variable into
+ * an addition. The children of the node must be simplified already. The amount of the rewrites
+ * of every rule is added to fired.
+ */
+B_tree_node *apply_rules       (B_tree_node *node, size_t *fired, mid_err_t *error_code);
+
+/**
+ * @brief Puts the bodies of the small functions in place of their calls.
+ *
+ * A function is inlined if its body is a single return of an expression of at most
+ * INLINE_BUDGET nodes, which uses only its parameters and calls only inlined functions,
+ * so the recursive ones are never inlined. A call is replaced if its arguments have no
+ * side effects and every argument but a number or a variable is used at most once.
+ * The inlined functions which are called no more are removed.
+ */
+B_tree_node *inline_funcs      (B_tree_node *root, mid_err_t *error_code);
+
+/**
+ * @brief Propagates the constants and the copies of the variables over the statements.
+ *
+ * The facts of a function flow down its statements: an assignment of a number or of another
+ * variable is put in place of the reads, an input or another assignment forgets it. Both ways
+ * of an if keep only the facts they agree on, and a while forgets every variable it assigns
+ * before its condition, so the facts hold on every iteration. An if or a while whose condition
+ * folds into a number is replaced by its block or removed. Then the assignments of pure
+ * expressions to the variables the function never reads are removed.
+ */
+B_tree_node *propagate_consts  (B_tree_node *root, mid_err_t *error_code);
+
+/**
+ * @brief Hoists the loop-invariant expressions out of the while loops.
+ *
+ * An expression of a loop is invariant if it reads no variable the loop assigns or inputs
+ * and calls only pure functions, which have no input, output or RAM commands and call only
+ * pure functions. sin, cos, ln and sqrt are pure as well. Every largest invariant expression
+ * but a number or a variable is computed into a temporary right before the loop, the inner
+ * loops first, so their temporaries may leave the outer loops too.
+ */
+B_tree_node *hoist_invariants  (B_tree_node *root, mid_err_t *error_code);
+
+/**
+ * @brief Computes the expressions repeated within a basic block once into temporaries.
+ *
+ * A basic block is a run of statements of one scope up to an if, whose condition it takes,
+ * or a while. Every expression without side effects gets a structural hash, and cmp_nodes
+ * confirms the ones whose hashes match. The largest expression met again before any of its
+ * variables is assigned or input is computed into a temporary before the statement it first
+ * appears in, and all its copies read the temporary and are freed, until none is repeated.
+ */
+B_tree_node *share_common_exprs(B_tree_node *root, mid_err_t *error_code);
+
+/**
+ * @brief Evaluates the calls of the pure functions with constant arguments at compile time.
+ *
+ * The body of the function is interpreted over its own variables, as the VM would run it,
+ * and the call is replaced with the number it returns. A call which divides by zero, reads
+ * an unknown variable, ends without a return, runs over EVAL_BUDGET steps or nests deeper
+ * than EVAL_DEPTH calls is left as it is. The tree is simplified and propagated again
+ * if anything is folded.
+ */
+B_tree_node *eval_pure_calls   (B_tree_node *root, mid_err_t *error_code);
+
+/**
+ * @brief Caches the results of the pure recursive functions of one parameter in the VM RAM.
+ *
+ * The body of such a function moves to a new function, and the function itself looks its
+ * argument up in a table of MEMO_KEYS keys and values first. An argument out of the table
+ * or one which only shares the cell of another key is computed as before. The recursive calls
+ * of the body go through the table as well, so every value is computed once.
+ */
+B_tree_node *memoize_funcs     (B_tree_node *root, mid_err_t *error_code);
+
+B_tree_node *inline_calls      (B_tree_node *node, Inline_table *table, mid_err_t *error_code);
+
+bool         is_pure_expr      (const B_tree_node *node);
+
+B_tree_node *copy_tree         (const B_tree_node *node, mid_err_t *error_code);
+
+void         free_tree         (B_tree_node *node);
+
+size_t       count_syms        (const B_tree_node *node);
+
+bool        *find_pure_funcs   (const B_tree_node *root, size_t syms_amount, mid_err_t *error_code);
 
 #endif
@@ -0,0 +1,236 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "midend_secondary.h"
+
+static bool has_exact_reciprocal(btr_elem_t value)
+{
+	int exponent = 0;
+
+	// only a power of two has a reciprocal, which the multiplication gives without a rounding
+	btr_elem_t mantissa   = frexp(value, &exponent);
+	btr_elem_t reciprocal = 1 / value;
+
+	return !islessgreater(fabs(mantissa), 0.5) && isnormal(reciprocal);
+}
+
+static bool is_small_power(btr_elem_t value)
+{
+	return !islessgreater(value, round(value)) && fabs(value) <= (btr_elem_t)MAX_POW_EXPAND;
+}
+
+static bool carries_const(const B_tree_node *node, const B_tree_node *child)
+{
+	if(node->type != OP || child->type != OP || child->right == NULL || child->right->type != NUM)
+	{
+		return false;
+	}
+
+	// a constant may leave an addition for an addition or a subtraction,
+	// and a multiplication for a multiplication or a division
+	switch(node->value.op_value)
+	{
+		case ADD:
+		case SUB:
+		{
+			return child->value.op_value == ADD;
+		}
+		case MUL:
+		case DIV:
+		{
+			return child->value.op_value == MUL;
+		}
+		case DO_NOTHING:
+		case POW:
+		case LN:
+		case SIN:
+		case COS:
+		case SQRT:
+		case ASS:
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+static B_tree_node *create_op(Ops op, B_tree_node *left, B_tree_node *right, mid_err_t *error_code)
+{
+	Uni_ret new_op = create_node(OP, {.op_value = op}, left, right);
+	if(new_op.error_code != B_TREE_ALL_GOOD)
+	{
+		LOG("%s: ERROR:\n\tUnable to allocate the operation.\n", __func__);
+		*error_code = MID_UNABLE_TO_ALLOCATE;
+
+		free_tree(left);
+		free_tree(right);
+
+		return NULL;
+	}
+
+	return new_op.arg.node;
+}
+
+static B_tree_node *swap_children(B_tree_node *node)
+{
+	B_tree_node *left = node->left;
+
+	node->left  = node->right;
+	node->right = left;
+
+	return node;
+}
+
+static B_tree_node *negate_right(B_tree_node *node)
+{
+	node->value.op_value         = ADD;
+	node->right->value.num_value = -node->right->value.num_value;
+
+	return node;
+}
+
+static B_tree_node *invert_right(B_tree_node *node)
+{
+	node->value.op_value         = MUL;
+	node->right->value.num_value = 1 / node->right->value.num_value;
+
+	return node;
+}
+
+static B_tree_node *gather_consts(B_tree_node *node)
+{
+	btr_elem_t inner_const = node->left->right->value.num_value;
+
+	if(node->value.op_value == ADD)
+	{
+		node->right->value.num_value += inner_const;
+	}
+	else
+	{
+		node->right->value.num_value *= inner_const;
+	}
+
+	node->left = keep_child(node->left, LEFT_CHILD);
+
+	return node;
+}
+
+static B_tree_node *lift_left_const(B_tree_node *node, size_t *fired, mid_err_t *error_code)
+{
+	// (x + c) - y turns into (x - y) + c, and (x * c) / y into (x / y) * c
+	B_tree_node *inner       = node->left;
+	B_tree_node *inner_const = inner->right;
+	Ops          outer_op    = node->value.op_value;
+
+	inner->right = node->right;
+	node->right  = inner_const;
+
+	node->value.op_value  = inner->value.op_value;
+	inner->value.op_value = outer_op;
+
+	node->left = apply_rules(inner, fired, error_code);
+
+	return node;
+}
+
+static B_tree_node *lift_right_const(B_tree_node *node, size_t *fired, mid_err_t *error_code)
+{
+	// x - (y + c) turns into (x - y) - c, and x / (y * c) into (x / y) / c
+	B_tree_node *inner = node->right;
+
+	node->right           = inner->right;
+	inner->right          = inner->left;
+	inner->left           = node->left;
+	inner->value.op_value = node->value.op_value;
+
+	node->left = apply_rules(inner, fired, error_code);
+
+	return node;
+}
+
+static B_tree_node *pow_to_sqrt(B_tree_node *node)
+{
+	free_tree(node->right);
+
+	node->type           = UNR_OP;
+	node->value.op_value = SQRT;
+	node->right          = node->left;
+	node->left           = NULL;
+
+	return node;
+}
+
+static B_tree_node *expand_pow(B_tree_node *node, mid_err_t *error_code)
+{
+	btr_elem_t   exponent = node->right->value.num_value;
+	size_t       factors  = (size_t)fabs(exponent);
+	B_tree_node *base     = keep_child(node, LEFT_CHILD);
+	B_tree_node *chain    = base;
+
+	// the base is pure, so every factor may compute it again
+	for(size_t factor_ID = 1; factor_ID < factors && chain != NULL; factor_ID++)
+	{
+		chain = create_op(MUL, chain, copy_tree(base, error_code), error_code);
+	}
+
+	if(exponent < 0 && chain != NULL)
+	{
+		Uni_ret one = create_node(NUM, {.num_value = 1}, NULL, NULL);
+		if(one.error_code != B_TREE_ALL_GOOD)
+		{
+			LOG("%s: ERROR:\n\tUnable to allocate the numerator.\n", __func__);
+			*error_code = MID_UNABLE_TO_ALLOCATE;
+
+			return chain;
+		}
+
+		chain = create_op(DIV, one.arg.node, chain, error_code);
+	}
+
+	return chain;
+}
+
+static B_tree_node *mul_to_add(B_tree_node *node, mid_err_t *error_code)
+{
+	free_tree(node->right);
+
+	node->value.op_value = ADD;
+	node->right          = copy_tree(node->left, error_code);
+
+	return node;
+}
+
+#include "def_strength_dsl.h"
+
+B_tree_node *apply_rules(B_tree_node *node, size_t *fired, mid_err_t *error_code)
+{
+	for(size_t rewrite_ID = 0; rewrite_ID < MAX_REWRITES && *error_code == MID_ALL_GOOD; rewrite_ID++)
+	{
+		node = fold_consts(node, error_code);
+		node = solve_trivial_expr(node);
+
+		if(node == NULL || node->type != OP || node->left == NULL || node->right == NULL)
+		{
+			return node;
+		}
+
+		#define DEF_RULE(name, pattern, rewrite)	\
+			if(pattern)								\
+			{										\
+				fired[RULE_##name]++;				\
+				node = rewrite;						\
+													\
+				continue;							\
+			}
+
+		#include "strength_rules.h"
+
+		#undef DEF_RULE
+
+		return node;
+	}
+
+	return node;
+}
+
+#include "undef_strength_dsl.h"
@@ -0,0 +1,577 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pipeline.h"
+#include "backend.h"
+#include "SPU.h"
+#include "SPU_input.h"
+
+/**
+ * @file language_bench.cpp
+ * @brief Benchmarks of the whole Tatlang pipeline on the programs of build/bench.
+ *
+ * Every program is compiled and run in memory like --time-passes does, several times, and the
+ * fastest time of every pass counts. The SPU is built with SPU_COUNT_CMDS, so the amount of the
+ * instructions every run dispatched is known exactly, and the integer commands the backend emitted
+ * are counted. The printed results are checked, and the times, the instructions and the integer
+ * commands are compared with the baseline file. One more program is generated
+ * with a function per line of its main to load the compiler rather than the processor, and one
+ * with a main of BENCH_LONG_STMTS statements, which a pass recursing down the statements can't take.
+ */
+
+const size_t      BENCH_REPEATS       = 5; /**< Runs of every benchmark if the command line has none. */
+const double      BENCH_TOLERANCE     = 0.25; /**< Slowdown against the baseline reported as a regression. */
+const double      BENCH_NOISE_MS      = 0.25; /**< Smaller slowdowns are timer noise rather than regressions. */
+const double      BENCH_RESULT_GAP    = 1e-3; /**< Allowed difference of a printed result. */
+const size_t      BENCH_MAX_BASELINES = 128; /**< Capacity of the baseline table. */
+const size_t      BENCH_MAX_VALUES    = 4; /**< Capacity of the inputs and the results of a benchmark. */
+const size_t      BENCH_NAME_SIZE     = 64; /**< Size of the names of the baseline file. */
+const size_t      BENCH_LINE_SIZE     = 256; /**< Size of a line of the baseline and the result files. */
+const size_t      BENCH_BIG_FUNCS     = 1000; /**< Functions of the generated program. */
+const size_t      BENCH_LONG_STMTS    = 50000; /**< Statements of the main of the long generated program. */
+const char *const BENCH_CONFIG_FILE   = "language_bench_config";
+const char *const BENCH_BIG_SOURCE    = "language_bench_big.tat";
+const char *const BENCH_LONG_SOURCE   = "language_bench_long.tat";
+const char *const BENCH_RESULT_FILE   = "execution_result.txt";
+
+/**
+ * @brief The measured values: the time of every pass of Pass_ID, the instructions executed and the
+ * integer commands emitted.
+ */
+const size_t METRIC_INSTRUCTIONS = PASSES_AMOUNT;
+const size_t METRIC_INT_CMDS     = PASSES_AMOUNT + 1;
+const size_t METRICS_AMOUNT      = PASSES_AMOUNT + 2;
+
+static const char * const METRIC_NAMES[METRICS_AMOUNT] =
+{
+	"frontend",
+	"midend",
+	"codegen",
+	"assemble",
+	"execute",
+	"instructions",
+	"int_cmds",
+};
+
+/**
+ * @struct Lang_bench
+ * @brief Structure representing a benchmark program.
+ */
+struct Lang_bench
+{
+	const char *name; /**< Name, which the baseline is keyed by. */
+	const char *source_file; /**< Tatlang source, relative to the build folder. */
+	size_t      inputs_amount; /**< Amount of the values алалмаш reads. */
+	elem_t      inputs[BENCH_MAX_VALUES]; /**< Values алалмаш reads. */
+	size_t      results_amount; /**< Amount of the values мисалныяз prints. */
+	double      results[BENCH_MAX_VALUES]; /**< Expected printed values. */
+};
+
+/**
+ * @struct Lang_baseline
+ * @brief Structure representing a stored measurement.
+ */
+struct Lang_baseline
+{
+	char   name[BENCH_NAME_SIZE]; /**< Name of the benchmark. */
+	char   metric[BENCH_NAME_SIZE]; /**< Name of the metric. */
+	double value; /**< Milliseconds of a pass or the amount of the instructions. */
+};
+
+static const Lang_bench BENCHES[] =
+{
+	{"recursion", "bench/recursion.tat", 2, {5000, 26}, 2, {12502500, 121393}},
+	{"loops",     "bench/loops.tat",     1, {120},      1, {6014736000}},
+	{"math",      "bench/math.tat",      1, {200000},   2, {1000000, 892.968}},
+	{"ram",       "bench/ram.tat",       1, {2000},     1, {2000}},
+	{"licm_guard", "bench/licm_guard.tat", 2, {0, -1},  1, {0}},
+	// 1000 * (499500 * x - 499500 / 2)
+	{"counters",  "bench/counters.tat",  1, {1.5},      1, {499500000}},
+	// f_k(1) is 1 + k, so the sum is the amount of the functions and the sum of 1..amount
+	{"big_source", BENCH_BIG_SOURCE,     1, {1},        1,
+	 {(double)BENCH_BIG_FUNCS + (double)(BENCH_BIG_FUNCS * (BENCH_BIG_FUNCS + 1) / 2)}},
+	{"long_main",  BENCH_LONG_SOURCE,    1, {1},        1, {(double)BENCH_LONG_STMTS}},
+};
+
+/**
+ * @brief Driver of the draw command, which the Tatlang programs never emit.
+ */
+static void bench_draw(VM *, char *, FILE *)
+{
+}
+
+static bool write_config(void)
+{
+	FILE *config = fopen(BENCH_CONFIG_FILE, "w");
+	if(config == NULL)
+	{
+		return false;
+	}
+
+	// the deep recursion needs the stacks much bigger than the ones of build/config
+	fprintf(config, "RAM_size: 10201\n"
+					"user_stack_size: 65536\n"
+					"ret_stack_size: 65536\n"
+					"jit: 0\n"
+					"output_buffer_size: 4096\n"
+					"binary_output: 0\n");
+	fclose(config);
+
+	return true;
+}
+
+/**
+ * @brief Writes a program with BENCH_BIG_FUNCS functions and a call of each of them in main.
+ *
+ * The functions have a branch each, so the midend inlines none of them.
+ */
+static bool write_big_source(void)
+{
+	FILE *source = fopen(BENCH_BIG_SOURCE, "w");
+	if(source == NULL)
+	{
+		return false;
+	}
+
+	for(size_t func_ID = 1; func_ID <= BENCH_BIG_FUNCS; func_ID++)
+	{
+		fprintf(source, "белдерү f_%lu(x)\n"
+						"{\n"
+						"\ts = x;\n"
+						"\tәгәр(s > %lu)\n"
+						"\t{\n"
+						"\t\ts = s - %lu;\n"
+						"\t}\n"
+						"\tкиребир s + %lu;\n"
+						"}\n\n", func_ID, func_ID, func_ID, func_ID);
+	}
+
+	fprintf(source, "рәис\n{\n\tалалмаш(x);\n\ttotal = 0;\n");
+
+	for(size_t func_ID = 1; func_ID <= BENCH_BIG_FUNCS; func_ID++)
+	{
+		fprintf(source, "\ttotal = total + f_%lu(x);\n", func_ID);
+	}
+
+	fprintf(source, "\tмисалныяз(total);\n}\n");
+	fclose(source);
+
+	return true;
+}
+
+/**
+ * @brief Writes a program whose main adds the input BENCH_LONG_STMTS times.
+ *
+ * The input keeps the midend from folding the sum, so every statement reaches the backend.
+ */
+static bool write_long_source(void)
+{
+	FILE *source = fopen(BENCH_LONG_SOURCE, "w");
+	if(source == NULL)
+	{
+		return false;
+	}
+
+	fprintf(source, "рәис\n{\n\tалалмаш(x);\n\ttotal = 0;\n");
+
+	for(size_t stmt_ID = 0; stmt_ID < BENCH_LONG_STMTS; stmt_ID++)
+	{
+		fprintf(source, "\ttotal = total + x;\n");
+	}
+
+	fprintf(source, "\tмисалныяз(total);\n}\n");
+	fclose(source);
+
+	return true;
+}
+
+static bool is_int_cmd(Ir_op op)
+{
+	return op == IR_IADD || op == IR_ISUB || op == IR_IMUL || op == IR_IJA || op == IR_IJB ||
+		   op == IR_IJAE || op == IR_IJBE || op == IR_IJE || op == IR_IJNE;
+}
+
+/**
+ * @brief Compiles the source in memory, timing the passes into the pipeline.
+ *
+ * @param source_file Name of the source file.
+ * @param pipeline Pointer to the pipeline.
+ * @param byte_code Pointer to the byte code, freed by the caller.
+ * @param byte_code_length Pointer to the length of the byte code.
+ * @param int_cmds Pointer to the amount of the integer commands of the program.
+ */
+static bool compile_bench(const char *source_file, Pipeline *pipeline, char **byte_code, size_t *byte_code_length,
+						  size_t *int_cmds)
+{
+	Node_arena arena = {};
+	arena_ctor(&arena, NODE_ARENA_CHUNK);
+	use_arena(&arena);
+	pipeline->arena = &arena;
+
+	bool compiled = false;
+
+	B_tree_node *root = build_tree(source_file, false, pipeline);
+	if(root != NULL)
+	{
+		Ir_program ir = {};
+
+		pass_start(pipeline, PASS_CODEGEN);
+
+		bkd_err_t bkd_error_code = ir_ctor(&ir) == ASM_ALL_GOOD ? generate_program(root, &ir, "root") :
+																  BKD_UNABLE_TO_ALLOCATE;
+
+		pass_end(pipeline, PASS_CODEGEN, ir.size);
+
+		if(bkd_error_code != BKD_ALL_GOOD)
+		{
+			fprintf(stderr, "ERROR: %s: assembly error %d\n", source_file, bkd_error_code);
+		}
+		else
+		{
+			*int_cmds = 0;
+
+			for(size_t cmd_ID = 0; cmd_ID < ir.size; cmd_ID++)
+			{
+				*int_cmds += is_int_cmd(ir.cmds[cmd_ID].op);
+			}
+
+			pass_start(pipeline, PASS_ASSEMBLE);
+
+			asm_err_t asm_error_code = ir_assemble(&ir, byte_code, byte_code_length);
+
+			pass_end(pipeline, PASS_ASSEMBLE, *byte_code_length);
+
+			compiled = asm_error_code == ASM_ALL_GOOD;
+			if(!compiled)
+			{
+				fprintf(stderr, "ERROR: %s: ir_assemble error %d\n", source_file, asm_error_code);
+			}
+		}
+
+		ir_dtor(&ir);
+	}
+
+	use_arena(NULL);
+	arena_dtor(&arena);
+	pipeline->arena = NULL;
+
+	return compiled;
+}
+
+static bool check_results(const Lang_bench *bench)
+{
+	FILE *output = fopen(BENCH_RESULT_FILE, "r");
+	if(output == NULL)
+	{
+		return false;
+	}
+
+	size_t results_amount = 0;
+	bool   correct        = true;
+	double result         = 0;
+
+	while(fscanf(output, " RESULT: %lf", &result) == 1)
+	{
+		if(results_amount >= bench->results_amount ||
+		   fabs(result - bench->results[results_amount]) >= BENCH_RESULT_GAP)
+		{
+			fprintf(stderr, "ERROR: %s printed %.3lf as its result %lu\n", bench->name, result, results_amount + 1);
+
+			correct = false;
+		}
+
+		results_amount++;
+	}
+
+	fclose(output);
+
+	return correct && results_amount == bench->results_amount;
+}
+
+/**
+ * @brief Compiles and runs the benchmark several times.
+ *
+ * @param bench Pointer to the benchmark.
+ * @param repeats Amount of the runs.
+ * @param metrics Array of METRICS_AMOUNT values: the fastest time of every pass, the instructions and
+ * the integer commands.
+ */
+static bool run_bench(const Lang_bench *bench, size_t repeats, double *metrics)
+{
+	for(size_t metric_ID = 0; metric_ID < METRICS_AMOUNT; metric_ID++)
+	{
+		metrics[metric_ID] = INFINITY;
+	}
+
+	for(size_t repeat = 0; repeat < repeats; repeat++)
+	{
+		Pipeline pipeline         = {};
+		char    *byte_code        = NULL;
+		size_t   byte_code_length = 0;
+		size_t   int_cmds         = 0;
+
+		if(!compile_bench(bench->source_file, &pipeline, &byte_code, &byte_code_length, &int_cmds))
+		{
+			free(byte_code);
+
+			return false;
+		}
+
+		Input_source input = {};
+		input_from_values(&input, bench->inputs, bench->inputs_amount);
+
+		pass_start(&pipeline, PASS_EXECUTE);
+
+		spu_err_t spu_error = execute_byte_code(byte_code, byte_code_length, BENCH_CONFIG_FILE, &bench_draw, &input);
+
+		pass_end(&pipeline, PASS_EXECUTE, 0);
+
+		input_dtor(&input);
+		free(byte_code);
+
+		if(spu_error != SPU_ALL_GOOD)
+		{
+			fprintf(stderr, "ERROR: %s failed with %d\n", bench->name, spu_error);
+
+			return false;
+		}
+
+		for(size_t pass_ID = 0; pass_ID < PASSES_AMOUNT; pass_ID++)
+		{
+			metrics[pass_ID] = fmin(metrics[pass_ID], pipeline.passes[pass_ID].wall_ms);
+		}
+
+		metrics[METRIC_INSTRUCTIONS] = (double)spu_cmds_executed();
+		metrics[METRIC_INT_CMDS]     = (double)int_cmds;
+	}
+
+	return check_results(bench);
+}
+
+static size_t load_baselines(const char *baseline_file, Lang_baseline *baselines)
+{
+	FILE *file = fopen(baseline_file, "r");
+	if(file == NULL)
+	{
+		return 0;
+	}
+
+	char   line[BENCH_LINE_SIZE] = {};
+	size_t amount                = 0;
+
+	while(amount < BENCH_MAX_BASELINES && fgets(line, BENCH_LINE_SIZE, file) != NULL)
+	{
+		Lang_baseline *baseline = &baselines[amount];
+
+		if(line[0] != '#' &&
+		   sscanf(line, "%63s %63s %lf", baseline->name, baseline->metric, &baseline->value) == 3)
+		{
+			amount++;
+		}
+	}
+
+	fclose(file);
+
+	return amount;
+}
+
+static bool save_baselines(const char *baseline_file, const Lang_baseline *baselines, size_t amount)
+{
+	FILE *file = fopen(baseline_file, "w");
+	if(file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "# Tatlang benchmark baseline, rewritten by language_bench --update.\n"
+				  "# benchmark metric value, the passes in ms\n");
+
+	for(size_t baseline_ID = 0; baseline_ID < amount; baseline_ID++)
+	{
+		fprintf(file, "%-12s %-12s %.3lf\n", baselines[baseline_ID].name,
+				baselines[baseline_ID].metric, baselines[baseline_ID].value);
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+static Lang_baseline *find_baseline(Lang_baseline *baselines, size_t *amount,
+									const char *name, const char *metric, bool add)
+{
+	for(size_t baseline_ID = 0; baseline_ID < *amount; baseline_ID++)
+	{
+		if(!strcmp(baselines[baseline_ID].name, name) && !strcmp(baselines[baseline_ID].metric, metric))
+		{
+			return &baselines[baseline_ID];
+		}
+	}
+
+	if(!add || *amount == BENCH_MAX_BASELINES)
+	{
+		return NULL;
+	}
+
+	Lang_baseline *baseline = &baselines[(*amount)++];
+
+	snprintf(baseline->name,   BENCH_NAME_SIZE, "%s", name);
+	snprintf(baseline->metric, BENCH_NAME_SIZE, "%s", metric);
+
+	return baseline;
+}
+
+/**
+ * @brief Compares the metric with the baseline and reports a regression.
+ *
+ * The amount of the instructions is exact, so any growth of it is a regression, and so is any drop
+ * of the integer commands, which means the backend lost an integer variable.
+ *
+ * @return true if the metric regressed.
+ */
+static bool compare_metric(const Lang_bench *bench, size_t metric_ID, double value, const Lang_baseline *baseline)
+{
+	if(baseline == NULL)
+	{
+		return false;
+	}
+
+	bool regressed = false;
+
+	if(metric_ID == METRIC_INSTRUCTIONS)
+	{
+		regressed = value > baseline->value;
+	}
+	else if(metric_ID == METRIC_INT_CMDS)
+	{
+		regressed = value < baseline->value;
+	}
+	else
+	{
+		regressed = value > baseline->value * (1 + BENCH_TOLERANCE) && value - baseline->value > BENCH_NOISE_MS;
+	}
+
+	if(regressed)
+	{
+		printf("%s %s: %.3lf against %.3lf of the baseline, %+.0lf%%\n", bench->name, METRIC_NAMES[metric_ID],
+			   value, baseline->value, (value / baseline->value - 1) * 100);
+	}
+
+	return regressed;
+}
+
+int main(int argc, const char *argv[])
+{
+	if(argc < 2 || argc > 4)
+	{
+		fprintf(stderr, "usage: %s <baseline file> [--update] [repeats, %lu by default]\n",
+				argv[0], BENCH_REPEATS);
+
+		return EXIT_FAILURE;
+	}
+
+	const char *baseline_file = argv[1];
+	bool        update        = false;
+	size_t      repeats       = BENCH_REPEATS;
+
+	for(int arg_ID = 2; arg_ID < argc; arg_ID++)
+	{
+		if(!strcmp(argv[arg_ID], "--update"))
+		{
+			update = true;
+		}
+		else if(sscanf(argv[arg_ID], "%lu", &repeats) != 1 || repeats == 0)
+		{
+			fprintf(stderr, "ERROR: bad repeats amount %s\n", argv[arg_ID]);
+
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!write_config() || !write_big_source() || !write_long_source())
+	{
+		fprintf(stderr, "ERROR: unable to write the bench config, %s or %s\n", BENCH_BIG_SOURCE, BENCH_LONG_SOURCE);
+
+		return EXIT_FAILURE;
+	}
+
+	Lang_baseline baselines[BENCH_MAX_BASELINES] = {};
+	size_t        baselines_amount               = load_baselines(baseline_file, baselines);
+	size_t        failed                         = 0;
+	size_t        slower                         = 0;
+	size_t        grown                          = 0;
+	size_t        lost                           = 0;
+
+	printf("%-12s", "benchmark");
+	for(size_t pass_ID = 0; pass_ID < PASSES_AMOUNT; pass_ID++)
+	{
+		printf(" %9s", METRIC_NAMES[pass_ID]);
+	}
+	printf(" %14s %8s  %s\n", METRIC_NAMES[METRIC_INSTRUCTIONS], METRIC_NAMES[METRIC_INT_CMDS], "result");
+
+	for(size_t bench_ID = 0; bench_ID < sizeof(BENCHES) / sizeof(Lang_bench); bench_ID++)
+	{
+		const Lang_bench *bench                   = &BENCHES[bench_ID];
+		double            metrics[METRICS_AMOUNT] = {};
+
+		bool correct = run_bench(bench, repeats, metrics);
+
+		printf("%-12s", bench->name);
+		for(size_t pass_ID = 0; pass_ID < PASSES_AMOUNT; pass_ID++)
+		{
+			printf(" %9.3lf", correct ? metrics[pass_ID] : NAN);
+		}
+		printf(" %14.0lf %8.0lf  %s\n", correct ? metrics[METRIC_INSTRUCTIONS] : NAN,
+			   correct ? metrics[METRIC_INT_CMDS] : NAN, correct ? "ok" : "WRONG");
+
+		if(!correct)
+		{
+			failed++;
+
+			continue;
+		}
+
+		for(size_t metric_ID = 0; metric_ID < METRICS_AMOUNT; metric_ID++)
+		{
+			Lang_baseline *baseline = find_baseline(baselines, &baselines_amount, bench->name,
+													METRIC_NAMES[metric_ID], update);
+			if(update)
+			{
+				if(baseline != NULL)
+				{
+					baseline->value = metrics[metric_ID];
+				}
+			}
+			else if(compare_metric(bench, metric_ID, metrics[metric_ID], baseline))
+			{
+				(metric_ID == METRIC_INSTRUCTIONS ? grown : metric_ID == METRIC_INT_CMDS ? lost : slower)++;
+			}
+		}
+	}
+
+	if(update && !save_baselines(baseline_file, baselines, baselines_amount))
+	{
+		fprintf(stderr, "ERROR: unable to write %s\n", baseline_file);
+
+		return EXIT_FAILURE;
+	}
+
+	if(slower != 0)
+	{
+		printf("%lu passes are more than %.0lf%% slower than the baseline\n", slower, BENCH_TOLERANCE * 100);
+	}
+
+	if(grown != 0)
+	{
+		printf("%lu programs execute more instructions than the baseline\n", grown);
+	}
+
+	if(lost != 0)
+	{
+		printf("%lu programs emit fewer integer commands than the baseline\n", lost);
+	}
+
+	return failed == 0 && grown == 0 && lost == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
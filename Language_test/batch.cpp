@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "batch.h"
+#include "pipeline.h"
+#include "backend.h"
+#include "SPU_input.h"
+
+const size_t MAX_BATCH_THREADS = 256;
+
+const double MS_PER_S  = 1e3;
+const double MS_PER_NS = 1e-6;
+
+struct Batch
+{
+	FILE                *list;
+	pthread_mutex_t      list_mutex;
+	bool                 execute;
+	std::atomic<size_t>  jobs_amount;
+	std::atomic<size_t>  failed_amount;
+};
+
+struct Batch_job
+{
+	char  line[BATCH_LINE_SIZE];
+	char  name[BATCH_LINE_SIZE];
+	char *source;
+	char *input;
+};
+
+static double now_ms(void)
+{
+	timespec now = {};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec * MS_PER_S + (double)now.tv_nsec * MS_PER_NS;
+}
+
+static char *skip_spaces(char *str)
+{
+	while(isspace((unsigned char)*str))
+	{
+		str++;
+	}
+
+	return str;
+}
+
+static char *cut_word(char *str)
+{
+	while(*str != '\0' && !isspace((unsigned char)*str))
+	{
+		str++;
+	}
+
+	if(*str != '\0')
+	{
+		*str = '\0';
+		str++;
+	}
+
+	return str;
+}
+
+// splits the line into the source and the input, the name is the source without its extension
+static bool parse_job(Batch_job *job)
+{
+	job->source = skip_spaces(job->line);
+
+	if(*job->source == '\0' || *job->source == '#')
+	{
+		return false;
+	}
+
+	job->input = skip_spaces(cut_word(job->source));
+	cut_word(job->input);
+
+	if(*job->input == '\0')
+	{
+		job->input = NULL;
+	}
+
+	strncpy(job->name, job->source, BATCH_LINE_SIZE - 1);
+
+	char *extension = strrchr(job->name, '.');
+	if(extension != NULL && strchr(extension, '/') == NULL && extension != job->name)
+	{
+		*extension = '\0';
+	}
+
+	return true;
+}
+
+static bool take_job(Batch *batch, Batch_job *job)
+{
+	bool taken = false;
+
+	pthread_mutex_lock(&(batch->list_mutex));
+
+	while(!taken && fgets(job->line, BATCH_LINE_SIZE, batch->list) != NULL)
+	{
+		taken = parse_job(job);
+	}
+
+	pthread_mutex_unlock(&(batch->list_mutex));
+
+	return taken;
+}
+
+static bool build_job(const Batch_job *job, Node_arena *arena)
+{
+	arena_reset(arena);
+	use_arena(arena);
+
+	B_tree_node *root = build_tree(job->source, false, NULL);
+
+	bkd_err_t bkd_error_code = root == NULL ? BKD_INVALID_NODE : assembly(root, job->name);
+	if(root != NULL && bkd_error_code != BKD_ALL_GOOD)
+	{
+		fprintf(stderr, "%s: assembly error: %d.\n", job->source, bkd_error_code);
+	}
+
+	use_arena(NULL);
+
+	return bkd_error_code == BKD_ALL_GOOD;
+}
+
+static spu_err_t run_job(const Batch_job *job, char *result_file)
+{
+	Input_source input = {};
+
+	if(job->input == NULL)
+	{
+		input_from_values(&input, NULL, 0);
+	}
+	else
+	{
+		spu_err_t input_error = input_from_file(&input, job->input);
+		if(input_error != SPU_ALL_GOOD)
+		{
+			return input_error;
+		}
+	}
+
+	char bin_file[BATCH_LINE_SIZE + sizeof(".bin")] = {};
+	snprintf(bin_file, sizeof(bin_file), "%s.bin", job->name);
+
+	Spu_job spu_job =
+	{
+		.input        = &input,
+		.output_file  = result_file,
+		.restore_file = NULL,
+		.error_code   = SPU_ALL_GOOD,
+	};
+
+	spu_err_t spu_error = execute_parallel(bin_file, "config", &file_draw, &spu_job, 1, 1);
+
+	input_dtor(&input);
+
+	return spu_error != SPU_ALL_GOOD ? spu_error : spu_job.error_code;
+}
+
+static void *batch_worker(void *batch_ptr)
+{
+	Batch *batch = (Batch *)batch_ptr;
+
+	// one arena for all the jobs of the thread, reset between them
+	Node_arena arena = {};
+	arena_ctor(&arena, NODE_ARENA_CHUNK);
+
+	Batch_job job = {};
+
+	while(take_job(batch, &job))
+	{
+		batch->jobs_amount++;
+
+		double build_start = now_ms();
+		bool   built       = build_job(&job, &arena);
+		double build_ms    = now_ms() - build_start;
+
+		if(!built)
+		{
+			batch->failed_amount++;
+			printf("%s: build failed after %.3lf ms\n", job.source, build_ms);
+		}
+		else if(!batch->execute)
+		{
+			printf("%s: built %s.bin in %.3lf ms\n", job.source, job.name, build_ms);
+		}
+		else
+		{
+			char result_file[BATCH_LINE_SIZE + sizeof("_result.txt")] = {};
+			snprintf(result_file, sizeof(result_file), "%s_result.txt", job.name);
+
+			double    run_start = now_ms();
+			spu_err_t spu_error = run_job(&job, result_file);
+			double    run_ms    = now_ms() - run_start;
+
+			if(spu_error != SPU_ALL_GOOD)
+			{
+				batch->failed_amount++;
+				printf("%s: built in %.3lf ms, run failed with %d after %.3lf ms\n",
+					   job.source, build_ms, spu_error, run_ms);
+			}
+			else
+			{
+				printf("%s: built in %.3lf ms, ran in %.3lf ms into %s\n",
+					   job.source, build_ms, run_ms, result_file);
+			}
+		}
+
+		// the client of a pipe waits for its answer
+		fflush(stdout);
+	}
+
+	arena_dtor(&arena);
+
+	return NULL;
+}
+
+int run_batch(const char *list_file, bool execute, size_t threads_amount)
+{
+	FILE *list = strcmp(list_file, "-") == 0 ? stdin : fopen(list_file, "r");
+	if(list == NULL)
+	{
+		fprintf(stderr, "ERROR: Unable to open %s.\n", list_file);
+
+		return EXIT_FAILURE;
+	}
+
+	if(threads_amount == 0)
+	{
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads_amount = online > 0 ? (size_t)online : 1;
+	}
+	if(threads_amount > MAX_BATCH_THREADS)
+	{
+		threads_amount = MAX_BATCH_THREADS;
+	}
+
+	Batch batch = {};
+	batch.list    = list;
+	batch.execute = execute;
+	pthread_mutex_init(&(batch.list_mutex), NULL);
+
+	pthread_t threads[MAX_BATCH_THREADS] = {};
+	size_t    started = 0;
+
+	for(; started < threads_amount; started++)
+	{
+		if(pthread_create(&threads[started], NULL, batch_worker, &batch) != 0)
+		{
+			break;
+		}
+	}
+
+	// the batch goes on in this thread if no thread could be started
+	if(started == 0)
+	{
+		batch_worker(&batch);
+	}
+
+	for(size_t thread_ID = 0; thread_ID < started; thread_ID++)
+	{
+		pthread_join(threads[thread_ID], NULL);
+	}
+
+	pthread_mutex_destroy(&(batch.list_mutex));
+
+	if(list != stdin)
+	{
+		fclose(list);
+	}
+
+	size_t failed_amount = batch.failed_amount;
+
+	printf("%lu jobs, %lu failed\n", (size_t)batch.jobs_amount, failed_amount);
+
+	return failed_amount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
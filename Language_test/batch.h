@@ -0,0 +1,26 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+const size_t BATCH_LINE_SIZE = 1024;
+
+/**
+ * @brief Compiles the sources of a list on a pool of threads, and runs them if execute is set.
+ *
+ * Every line of the list is a source file, optionally followed by a file of the input values
+ * of its run; the empty lines and the ones starting with '#' are skipped. The threads take
+ * the lines one by one as they get free, so with "-" the driver serves the requests another
+ * process writes into its stdin for as long as the pipe stays open. code.tat is built into
+ * code.bin and code.labels, and its run writes code_result.txt. Every thread keeps one node
+ * arena for all its jobs, and the VM config is parsed once. Every job prints a line with its
+ * result to stdout as soon as it is done.
+ *
+ * @param list_file Name of the list, "-" for stdin.
+ * @param execute Run every program which is built.
+ * @param threads_amount Amount of threads, 0 for the amount of the online processors.
+ * @return EXIT_SUCCESS if every job succeeded, EXIT_FAILURE otherwise.
+ */
+int run_batch(const char *list_file, bool execute, size_t threads_amount);
+
+#endif
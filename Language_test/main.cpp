@@ -1,80 +1,291 @@
 #include <stdio.h>
+#include <clocale>
 
 #include "frontend.h"
 #include "midend.h"
 #include "backend.h"
+#include "compile_cache.h"
+#include "pipeline.h"
+#include "batch.h"
+#include "SPU_input.h"
 
-int main(int argc, const char *argv[])
+static int back(B_tree_node *root, Compile_cache *cache, Cache_key *key)
 {
-	if(argc != 2)
+//Backend
+	bkd_err_t bkd_error_code = ASSEMBLY(root);
+	if(bkd_error_code != BKD_ALL_GOOD)
 	{
-		fprintf(stderr, "ERROR: invalid amount of main function arguments(argc = %d)\n", argc);
+		fprintf(stderr, "assembly error: %d.\n", bkd_error_code);
 
 		return EXIT_FAILURE;
 	}
 
-	frd_err_t frd_error_code = FRD_ALL_GOOD;
-
-// Frontend
-	Tokens *tokens = tokenize(argv[1], &frd_error_code);
-	if(frd_error_code != FRD_ALL_GOOD)
+	if(cache != NULL)
 	{
-		fprintf(stderr, "tokenize error: %d.\n", frd_error_code);
-
-		return EXIT_FAILURE;
+		cache_store(cache, key, root, "root");
 	}
 
-	B_tree_node *root = parse_tokens(tokens);
+	return 0;
+}
+
+static int build(const char *source_file, bool graph, Compile_cache *cache, Cache_key *key)
+{
+	Node_arena arena = {};
+	arena_ctor(&arena, NODE_ARENA_CHUNK);
+	use_arena(&arena);
+
+	B_tree_node *root = build_tree(source_file, graph, NULL);
+
+	int build_result = (root == NULL) ? EXIT_FAILURE : back(root, cache, key);
+
+	use_arena(NULL);
+	arena_dtor(&arena);
+
+	return build_result;
+}
+
+// the frontend and the midend only, the tree goes to ast_file for a later --from-ast run
+static int emit_ast(const char *source_file, const char *ast_file, bool graph)
+{
+	Node_arena arena = {};
+	arena_ctor(&arena, NODE_ARENA_CHUNK);
+	use_arena(&arena);
+
+	B_tree_node *root = build_tree(source_file, graph, NULL);
+
+	Compact_tree ast = {};
+	error_t error_code = B_TREE_ALL_GOOD;
+
 	if(root == NULL)
 	{
-		fprintf(stderr, "parse_tokens error: %d.\n", frd_error_code);
-
-		return EXIT_FAILURE;
+		error_code = B_TREE_NULL_PTR;
+	}
+	else if((error_code = compact_tree_ctor(&ast, 0))         != B_TREE_ALL_GOOD ||
+			(error_code = pack_tree(&ast, root))              != B_TREE_ALL_GOOD ||
+			(error_code = save_compact_tree(&ast, ast_file))  != B_TREE_ALL_GOOD)
+	{
+		fprintf(stderr, "save_compact_tree error: %d.\n", error_code);
 	}
 
+	compact_tree_dtor(&ast);
 
-// Midend
-	mid_err_t mid_error_code = MID_ALL_GOOD;
+	use_arena(NULL);
+	arena_dtor(&arena);
 
-	root = optimize(root, &mid_error_code);
+	return error_code == B_TREE_ALL_GOOD ? 0 : EXIT_FAILURE;
+}
+
+// the backend only, on a tree saved by --emit-ast
+static int build_from_ast(const char *ast_file)
+{
+	Compact_tree ast = {};
 
-	if(mid_error_code != MID_ALL_GOOD)
+	error_t error_code = map_compact_tree(&ast, ast_file);
+	if(error_code != B_TREE_ALL_GOOD)
 	{
-		fprintf(stderr, "optimize error: %d.\n", mid_error_code);
+		fprintf(stderr, "map_compact_tree error: %d.\n", error_code);
 
 		return EXIT_FAILURE;
 	}
 
-	GR_DUMP_CODE_GEN(root);
+	Node_arena arena = {};
+	arena_ctor(&arena, NODE_ARENA_CHUNK);
+	use_arena(&arena);
 
+	// the names of the tree stay in the mapping until the backend is done
+	B_tree_node *root = unpack_tree(&ast, &error_code);
 
-//Backend
-	bkd_err_t bkd_error_code = ASSEMBLY(root);
-	if(bkd_error_code != BKD_ALL_GOOD)
+	int build_result = EXIT_FAILURE;
+	if(error_code != B_TREE_ALL_GOOD)
+	{
+		fprintf(stderr, "unpack_tree error: %d.\n", error_code);
+	}
+	else
 	{
-		fprintf(stderr, "assembly error: %d.\n", mid_error_code);
+		build_result = back(root, NULL, NULL);
+	}
+
+	use_arena(NULL);
+	arena_dtor(&arena);
+
+	compact_tree_dtor(&ast);
+
+	return build_result;
+}
+
+static int run_in_memory(char *byte_code, size_t byte_code_length, Pipeline *pipeline)
+{
+	Input_source input = {};
+	input_interactive(&input);
+
+	pass_start(pipeline, PASS_EXECUTE);
+
+	spu_err_t spu_error = execute_byte_code(byte_code, byte_code_length, "config", &window_draw, &input);
+	window_draw_finish();
+
+	pass_end(pipeline, PASS_EXECUTE, 0);
+
+	if(spu_error != SPU_ALL_GOOD)
+	{
+		fprintf(stderr, "execute error: %d.\n", spu_error);
 
 		return EXIT_FAILURE;
 	}
 
+	return 0;
+}
+
+// every stage hands its result to the next one in memory, no file is written between them
+static int time_passes(const char *source_file, bool graph)
+{
+	Pipeline pipeline = {};
+
+	Node_arena arena = {};
+	arena_ctor(&arena, NODE_ARENA_CHUNK);
+	use_arena(&arena);
+	pipeline.arena = &arena;
 
+	char  *byte_code        = NULL;
+	size_t byte_code_length = 0;
 
+	B_tree_node *root = build_tree(source_file, graph, &pipeline);
 
-	asm_err_t asm_error = compile("root");
-	if(asm_error != ASM_ALL_GOOD)
+	int build_result = EXIT_FAILURE;
+	if(root != NULL)
 	{
-		fprintf(stderr, "compile error: %d.\n", mid_error_code);
+		Ir_program ir = {};
 
-		return EXIT_FAILURE;
+		pass_start(&pipeline, PASS_CODEGEN);
+
+		bkd_err_t bkd_error_code = ir_ctor(&ir) == ASM_ALL_GOOD ? generate_program(root, &ir, "root") :
+																  BKD_UNABLE_TO_ALLOCATE;
+
+		pass_end(&pipeline, PASS_CODEGEN, ir.size);
+
+		if(bkd_error_code != BKD_ALL_GOOD)
+		{
+			fprintf(stderr, "assembly error: %d.\n", bkd_error_code);
+		}
+		else
+		{
+			pass_start(&pipeline, PASS_ASSEMBLE);
+
+			asm_err_t asm_error_code = ir_assemble(&ir, &byte_code, &byte_code_length);
+
+			pass_end(&pipeline, PASS_ASSEMBLE, byte_code_length);
+
+			if(asm_error_code != ASM_ALL_GOOD)
+			{
+				fprintf(stderr, "ir_assemble error: %d.\n", asm_error_code);
+			}
+			else
+			{
+				build_result = 0;
+			}
+		}
+
+		ir_dtor(&ir);
 	}
 
+	use_arena(NULL);
+	arena_dtor(&arena);
+	pipeline.arena = NULL;
+
+	if(build_result == 0)
+	{
+		build_result = run_in_memory(byte_code, byte_code_length, &pipeline);
+	}
+
+	free(byte_code);
+
+	print_pipeline(&pipeline, stderr);
+
+	return build_result;
+}
+
+static int run(void)
+{
 	spu_err_t spu_error = execute("root.bin", "config", &window_draw);
+	window_draw_finish();
+
 	if(spu_error != SPU_ALL_GOOD)
 	{
-		fprintf(stderr, "execute error: %d.\n", mid_error_code);
+		fprintf(stderr, "execute error: %d.\n", spu_error);
 
 		return EXIT_FAILURE;
 	}
 
 	return 0;
 }
+
+int main(int argc, const char *argv[])
+{
+	// once for the whole process, the compilation itself never changes the locale
+	setlocale(LC_ALL, "");
+
+	const char *compiler_file = argv[0];
+
+	// --graph dumps the optimized tree into root.dot and root.png
+	bool graph = argc > 1 && !strcmp(argv[1], "--graph");
+	if(graph)
+	{
+		argc--;
+		argv++;
+	}
+
+	// --batch builds the sources of a list in parallel, --batch-run runs them as well
+	if((argc == 3 || argc == 4) && (!strcmp(argv[1], "--batch") || !strcmp(argv[1], "--batch-run")))
+	{
+		size_t threads_amount = argc == 4 ? strtoul(argv[3], NULL, 10) : 0;
+
+		return run_batch(argv[2], !strcmp(argv[1], "--batch-run"), threads_amount);
+	}
+
+	// --time-passes builds without the cache and reports the cost of every pass
+	if(argc == 3 && !strcmp(argv[1], "--time-passes"))
+	{
+		return time_passes(argv[2], graph);
+	}
+
+	if(argc == 4 && !strcmp(argv[1], "--emit-ast"))
+	{
+		return emit_ast(argv[2], argv[3], graph);
+	}
+
+	if(argc == 3 && !strcmp(argv[1], "--from-ast"))
+	{
+		int build_result = build_from_ast(argv[2]);
+
+		return build_result != 0 ? build_result : run();
+	}
+
+	if(argc != 2)
+	{
+		fprintf(stderr, "ERROR: invalid amount of main function arguments(argc = %d)\n", argc);
+
+		return EXIT_FAILURE;
+	}
+
+// Cache
+	Compile_cache cache = {};
+	Cache_key     key   = {};
+
+	bool cached = cache_ctor(&cache, "cache_config") == CCH_ALL_GOOD &&
+				  cache_key(&key, argv[1], compiler_file, CACHE_BUILD_OPTIONS) == CCH_ALL_GOOD;
+
+	// the tree of a cached build is never made, so a graph needs a build
+	if(graph || !cached || !cache_lookup(&cache, &key, "root"))
+	{
+		int build_result = build(argv[1], graph, cached ? &cache : NULL, &key);
+		if(build_result != 0)
+		{
+			cache_key_dtor(&key);
+
+			return build_result;
+		}
+	}
+
+	cache_key_dtor(&key);
+
+	return run();
+}
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "pipeline.h"
+#include "frontend.h"
+#include "midend.h"
+
+static const char * const PASS_NAMES[PASSES_AMOUNT] =
+{
+	"frontend",
+	"midend",
+	"codegen",
+	"assemble",
+	"execute",
+};
+
+// the midend outputs the tree, which the tree nodes count
+static const char * const PASS_UNITS[PASSES_AMOUNT] =
+{
+	"tokens",
+	"",
+	"commands",
+	"bytes",
+	"",
+};
+
+const double MS_PER_S  = 1e3;
+const double MS_PER_NS = 1e-6;
+
+static long peak_rss_kb(void)
+{
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+
+#ifdef __APPLE__
+	// macOS counts it in bytes
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+void pass_start(Pipeline *pipeline, Pass_ID pass)
+{
+	if(pipeline == NULL)
+	{
+		return;
+	}
+
+	pipeline->start_rss_kb = peak_rss_kb();
+
+	clock_gettime(CLOCK_MONOTONIC, &(pipeline->passes[pass].start));
+}
+
+void pass_end(Pipeline *pipeline, Pass_ID pass, size_t output_size)
+{
+	if(pipeline == NULL)
+	{
+		return;
+	}
+
+	Pass_stats *stats = &(pipeline->passes[pass]);
+
+	timespec end = {};
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	stats->done        = true;
+	stats->wall_ms     = (double)(end.tv_sec - stats->start.tv_sec) * MS_PER_S +
+						 (double)(end.tv_nsec - stats->start.tv_nsec) * MS_PER_NS;
+	stats->peak_rss_kb = peak_rss_kb() - pipeline->start_rss_kb;
+	stats->tree_nodes  = pipeline->arena != NULL ? pipeline->arena->nodes_amount : 0;
+	stats->output_size = output_size;
+}
+
+void print_pipeline(const Pipeline *pipeline, FILE *stream)
+{
+	double total_ms = 0;
+
+	fprintf(stream, "%-10s %12s %14s %12s   %s\n", "pass", "wall, ms", "peak RSS, +KB", "tree nodes", "output");
+
+	for(size_t pass_ID = 0; pass_ID < PASSES_AMOUNT; pass_ID++)
+	{
+		const Pass_stats *stats = &(pipeline->passes[pass_ID]);
+
+		if(!stats->done)
+		{
+			continue;
+		}
+
+		fprintf(stream, "%-10s %12.3lf %14ld %12lu   ", PASS_NAMES[pass_ID], stats->wall_ms,
+				stats->peak_rss_kb, stats->tree_nodes);
+
+		if(PASS_UNITS[pass_ID][0] == '\0')
+		{
+			fprintf(stream, "-\n");
+		}
+		else
+		{
+			fprintf(stream, "%lu %s\n", stats->output_size, PASS_UNITS[pass_ID]);
+		}
+
+		total_ms += stats->wall_ms;
+	}
+
+	fprintf(stream, "%-10s %12.3lf\n", "total", total_ms);
+}
+
+B_tree_node *build_tree(const char *source_file, bool graph, Pipeline *pipeline)
+{
+	frd_err_t frd_error_code = FRD_ALL_GOOD;
+
+// Frontend
+	pass_start(pipeline, PASS_FRONTEND);
+
+	Tokens *tokens = stream_tokens(source_file, &frd_error_code);
+	if(frd_error_code != FRD_ALL_GOOD)
+	{
+		fprintf(stderr, "tokenize error: %d.\n", frd_error_code);
+
+		return NULL;
+	}
+
+	// the parser pulls the tokens as it goes, so a lexing error shows up only here
+	B_tree_node *root = parse_tokens(tokens);
+	size_t error_offset = tokens->error_offset;
+	size_t tokens_amount = tokens->size;
+	close_tokens(tokens);
+
+	pass_end(pipeline, PASS_FRONTEND, tokens_amount);
+
+	// a too long name or number is a syntax error at its offset, the other lexing errors have none
+	if(frd_error_code != FRD_ALL_GOOD && frd_error_code != FRD_TOO_LONG_TOKEN)
+	{
+		fprintf(stderr, "tokenize error: %d.\n", frd_error_code);
+
+		return NULL;
+	}
+
+	if(root == NULL || frd_error_code != FRD_ALL_GOOD)
+	{
+		size_t line   = 0;
+		size_t column = 0;
+
+		if(error_offset != NO_TOKEN_OFFSET &&
+		   source_position(source_file, error_offset, &line, &column) == FRD_ALL_GOOD)
+		{
+			fprintf(stderr, "%s:%lu:%lu: syntax error.\n", source_file, line, column);
+		}
+		else
+		{
+			fprintf(stderr, "parse_tokens error: %d.\n", frd_error_code);
+		}
+
+		return NULL;
+	}
+
+
+// Midend
+	mid_err_t mid_error_code = MID_ALL_GOOD;
+
+	pass_start(pipeline, PASS_MIDEND);
+
+	root = optimize(root, &mid_error_code);
+
+	// the tree is the output, counted by its nodes
+	pass_end(pipeline, PASS_MIDEND, 0);
+
+	if(mid_error_code != MID_ALL_GOOD)
+	{
+		fprintf(stderr, "optimize error: %d.\n", mid_error_code);
+
+		return NULL;
+	}
+
+	if(graph)
+	{
+		GR_DUMP_CODE_GEN(root);
+	}
+
+	return root;
+}
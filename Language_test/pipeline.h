@@ -0,0 +1,74 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "b_tree.h"
+
+/**
+ * @brief The passes --time-passes reports, in the order they run.
+ *
+ * The tokens are lexed as the parser pulls them, so the frontend pass is the both of them.
+ */
+enum Pass_ID
+{
+	PASS_FRONTEND = 0,
+	PASS_MIDEND   = 1,
+	PASS_CODEGEN  = 2,
+	PASS_ASSEMBLE = 3,
+	PASS_EXECUTE  = 4,
+	PASSES_AMOUNT = 5,
+};
+
+/**
+ * @brief What one pass cost and made.
+ */
+struct Pass_stats
+{
+	bool     done; /**< The pass has run. */
+	timespec start; /**< Wall clock at the start of the pass. */
+	double   wall_ms; /**< Wall time of the pass. */
+	long     peak_rss_kb; /**< Growth of the peak resident memory of the process over the pass. */
+	size_t   tree_nodes; /**< Nodes alive in the arena after the pass. */
+	size_t   output_size; /**< Size of what the pass made, in the units of the pass. */
+};
+
+/**
+ * @brief The statistics of one compilation, passed to the stages which are timed.
+ */
+struct Pipeline
+{
+	Pass_stats  passes[PASSES_AMOUNT]; /**< Statistics of every pass. */
+	Node_arena *arena; /**< Arena of the tree, whose nodes are counted, or NULL. */
+	long        start_rss_kb; /**< Peak resident memory when the pass started. */
+};
+
+/**
+ * @brief Starts timing a pass, does nothing if pipeline is NULL.
+ */
+void pass_start     (Pipeline *pipeline, Pass_ID pass);
+
+/**
+ * @brief Ends timing a pass and keeps the size of what it made, does nothing if pipeline is NULL.
+ */
+void pass_end       (Pipeline *pipeline, Pass_ID pass, size_t output_size);
+
+/**
+ * @brief Tokenizes, parses and optimizes the source into a tree of the arena in use.
+ *
+ * The errors are printed to stderr, a syntax error as file:line:column.
+ *
+ * @param source_file Name of the source file.
+ * @param graph Dump the optimized tree into root.dot and root.png.
+ * @param pipeline Times the frontend and the midend passes if it is not NULL.
+ * @return The optimized tree, NULL on an error.
+ */
+B_tree_node *build_tree(const char *source_file, bool graph, Pipeline *pipeline);
+
+/**
+ * @brief Prints the time, the memory and the sizes of the passes which have run, and their total.
+ */
+void print_pipeline (const Pipeline *pipeline, FILE *stream);
+
+#endif
@@ -1,16 +1,62 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stdint.h>
+
 #include "b_tree.h"
 #include "utils.h"
 
+const size_t NO_TOKEN_OFFSET = (size_t)-1;
+
+/**
+ * @brief The value of a token, which one is read is told by its type.
+ */
+union Token_value
+{
+	double    num_value;
+	Ops       op_value;
+	Std_func  func;
+	wchar_t  *var_value;
+};
+
+/**
+ * @brief A 24-byte token: its value, the interned ID of a VAR or a FUNC
+ * and the byte of the source it starts at.
+ */
+struct Token
+{
+	Token_value value;
+	uint32_t    sym_ID;
+	uint32_t    offset;
+	Node_type   type;
+};
+
+struct Tokens;
+
+/**
+ * @brief Appends at least one token to the tokens, returns false if none can be made.
+ */
+typedef bool (*Token_source)(Tokens *tokens);
+
+/**
+ * @brief Token array, more is called whenever the parser needs a token past its end.
+ *
+ * A fully tokenized source has no more, and source is the state of the one that has.
+ * A failed parse leaves the offset of the token it stopped on in error_offset.
+ */
 struct Tokens
 {
-	B_tree_node *data;
+	Token *data;
 	size_t size;
 	size_t capacity;
+	Token_source more;
+	void *source;
+	size_t error_offset;
 };
 
+/**
+ * @brief Parses the tokens into a tree, NULL on a syntax error.
+ */
 B_tree_node *parse_tokens(Tokens *tokens);
 
 #endif
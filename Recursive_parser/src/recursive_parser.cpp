@@ -2,17 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <clocale>
 
 #include "recursive_parser.h"
 #include "recursive_parser_secondary.h"
 
-B_tree_node *parse_tokens(Tokens *passed_tokens)
+B_tree_node *parse_tokens(Tokens *tokens)
 {
-	setlocale(LC_ALL, "");
+	Parser parser = {.tokens = tokens, .id = 0, .sce_debt = 0};
 
-	B_tree_node *root = get_general(passed_tokens);
-	CHECK_RET(root);
-
-	return root;
+	return get_general(&parser);
 }
@@ -4,57 +4,120 @@
 
 #include "recursive_parser_secondary.h"
 
-static size_t  sce_debt = 0;
-static Tokens *tokens   = NULL;
-static size_t  id       = 0;
+// a source that fails reads as the end, its owner reports the error
+static const Token END_TOKEN = {.value = {.num_value = 0}, .sym_ID = 0, .offset = 0, .type = END};
 
+static const Token *cur_token(Parser *parser)
+{
+	while(parser->id >= parser->tokens->size)
+	{
+		if(parser->tokens->more == NULL || !parser->tokens->more(parser->tokens))
+		{
+			return &END_TOKEN;
+		}
+	}
+
+	return &parser->tokens->data[parser->id];
+}
 
-B_tree_node *get_general(Tokens *passed_tokens)
+// indexed by Ops, only the binary operations bind
+static const Precedence OP_PRECS[] =
+{
+	PREC_NONE,		// DO_NOTHING
+	PREC_ADD,		// ADD
+	PREC_ADD,		// SUB
+	PREC_MUL,		// MUL
+	PREC_MUL,		// DIV
+	PREC_POW,		// POW
+	PREC_NONE,		// LN
+	PREC_NONE,		// SIN
+	PREC_NONE,		// COS
+	PREC_NONE,		// SQRT
+	PREC_NONE,		// ASS
+};
+
+static_assert(sizeof(OP_PRECS) / sizeof(OP_PRECS[0]) == ASS + 1, "every operation needs a precedence");
+
+// indexed by Node_type, the operations look their own precedence up in OP_PRECS
+static const Precedence TYPE_PRECS[] =
+{
+	PREC_NONE,		// NUM
+	PREC_NONE,		// OP
+	PREC_NONE,		// VAR
+	PREC_NONE,		// OPEN_BR
+	PREC_NONE,		// CLOSE_BR
+	PREC_NONE,		// OPEN_CBR
+	PREC_NONE,		// CLOSE_CBR
+	PREC_NONE,		// SEMICOLON
+	PREC_NONE,		// KEYWORD
+	PREC_NONE,		// END
+	PREC_NONE,		// SCOPE_START
+	PREC_NONE,		// SCOPE_END
+	PREC_NONE,		// IF
+	PREC_NONE,		// WHILE
+	PREC_NONE,		// STD_FUNC
+	PREC_NONE,		// UNR_OP
+	PREC_NONE,		// FUNC
+	PREC_NONE,		// DECLARE
+	PREC_NONE,		// RETURN
+	PREC_NONE,		// COMMA
+	PREC_NONE,		// FUNC_DECL
+	PREC_NONE,		// MAIN
+	PREC_NONE,		// CMD_FUNC
+	PREC_RELATION,	// ABOVE
+	PREC_RELATION,	// BELOW
+	PREC_RELATION,	// ABOVE_EQUAL
+	PREC_RELATION,	// BELOW_EQUAL
+	PREC_RELATION,	// EQUAL
+	PREC_RELATION,	// NOT_EQUAL
+};
+
+static_assert(sizeof(TYPE_PRECS) / sizeof(TYPE_PRECS[0]) == NOT_EQUAL + 1, "every token type needs a precedence");
+
+static Precedence infix_prec(const Token *token)
 {
-	id     = 0;
-	tokens = passed_tokens;
+	return token->type == OP ? OP_PRECS[token->value.op_value] : TYPE_PRECS[token->type];
+}
 
-	if(CUR_TYPE == END)
+void note_error(Parser *parser)
+{
+	if(parser->tokens->error_offset != NO_TOKEN_OFFSET || parser->tokens->size == 0)
 	{
-		return CR_SEMICOLON(NULL, NULL);
+		return;
 	}
 
-	B_tree_node *root = get_all_scopes(false, END);
-	CHECK_RET(root);
+	// the end has no token of its own, the last one stands for it
+	size_t token_id = parser->id < parser->tokens->size ? parser->id : parser->tokens->size - 1;
 
-	return root;
+	parser->tokens->error_offset = parser->tokens->data[token_id].offset;
 }
 
-void rec_write_log(const char *file_name, const char *fmt, ...)
+B_tree_node *get_general(Parser *parser)
 {
-    static FILE *log_file = fopen(file_name, "w");
+	parser->tokens->error_offset = NO_TOKEN_OFFSET;
 
-    if (log_file == NULL)
+	if(CUR_TYPE == END)
 	{
-        perror("Error opening log_file");
-        return;
-    }
-
-    va_list args = NULL;
-
-    va_start(args, fmt);
+		return CR_SEMICOLON(NULL, NULL);
+	}
 
-    vfprintf(log_file, fmt, args);
+	B_tree_node *root = get_all_scopes(parser, false, END);
+	CHECK_RET(root);
 
-    va_end(args);
+	return root;
 }
 
-B_tree_node *get_scope()
+B_tree_node *get_scope(Parser *parser)
 {
 	if(CUR_TYPE == OPEN_CBR)
 	{
-		id++;
+		parser->id++;
 
-		size_t scopes_sce_debt = take_debt();
+		size_t scopes_sce_debt = take_debt(parser);
 
 		PARSE_LOG("There is scope.\n");
 
-		B_tree_node *root = get_all_scopes(true, CLOSE_CBR);
+		B_tree_node *root = get_all_scopes(parser, true, CLOSE_CBR);
 		CHECK_RET(root);
 
 		root = manage_scopes(root);
@@ -70,26 +133,26 @@ B_tree_node *get_scope()
 	{
 		PARSE_LOG("Getting command.\n");
 
-		B_tree_node *root = get_cmd();
+		B_tree_node *root = get_cmd(parser);
 		CHECK_RET(root);
 
 		return root;
 	}
 }
 
-B_tree_node *get_cmd()
+B_tree_node *get_cmd(Parser *parser)
 {
 	B_tree_node *cmd = NULL;
 
-	size_t cmds_sce_debt = take_debt();
+	size_t cmds_sce_debt = take_debt(parser);
 
 	if(CUR_TYPE == IF || CUR_TYPE == WHILE)
 	{
 		Node_type cond_type = CUR_TYPE;
 		PARSE_LOG("It's 'if' or 'while'.\n");
-		id++;
+		parser->id++;
 
-		cmd = get_cond(cond_type);
+		cmd = get_cond(parser, cond_type);
 		CHECK_RET(cmd);
 
 		PAY_CMD_DEBT;;
@@ -98,7 +161,13 @@ B_tree_node *get_cmd()
 	{
 		PARSE_LOG("It's standart function.\n");
 
-		cmd = get_std_func();
+		// cmpram leaves its result on the stack, so it is only an expression
+		if(CUR_STD_FUNC == CMPRAM)
+		{
+			SYNTAX_ERROR;
+		}
+
+		cmd = get_std_func(parser);
 		CHECK_RET(cmd);
 
 		SYNTAX_CHECK(CUR_TYPE == SEMICOLON);
@@ -109,7 +178,7 @@ B_tree_node *get_cmd()
 	{
 		PARSE_LOG("It's function.\n");
 
-		cmd = get_func(true);
+		cmd = get_func(parser, true);
 		CHECK_RET(cmd);
 
 		SYNTAX_CHECK(CUR_TYPE == SEMICOLON);
@@ -120,7 +189,7 @@ B_tree_node *get_cmd()
 	{
 		PARSE_LOG("It's function declaration.\n");
 
-		cmd = get_func_decl();
+		cmd = get_func_decl(parser);
 		CHECK_RET(cmd);
 
 		PAY_CMD_DEBT;;
@@ -129,7 +198,7 @@ B_tree_node *get_cmd()
 	{
 		PARSE_LOG("It's return.\n");
 
-		cmd = get_return();
+		cmd = get_return(parser);
 		CHECK_RET(cmd);
 
 		SYNTAX_CHECK(CUR_TYPE == SEMICOLON);
@@ -140,7 +209,7 @@ B_tree_node *get_cmd()
 	{
 		PARSE_LOG("It's main.\n");
 
-		cmd = get_main();
+		cmd = get_main(parser);
 		CHECK_RET(cmd);
 
 		PAY_CMD_DEBT;;
@@ -149,7 +218,7 @@ B_tree_node *get_cmd()
 	{
 		PARSE_LOG("Getting assignment.\n");
 
-		cmd = get_ass();
+		cmd = get_ass(parser);
 		CHECK_RET(cmd);
 
 		SYNTAX_CHECK(CUR_TYPE == SEMICOLON);
@@ -158,34 +227,34 @@ B_tree_node *get_cmd()
 	}
 }
 
-B_tree_node *get_main()
+B_tree_node *get_main(Parser *parser)
 {
 	SYNTAX_CHECK(CUR_TYPE == MAIN);
 
-	B_tree_node *body = get_scope();
+	B_tree_node *body = get_scope(parser);
 
 	return CR_MAIN(NULL, body);
 }
 
-B_tree_node *get_return()
+B_tree_node *get_return(Parser *parser)
 {
 	SYNTAX_CHECK(CUR_TYPE == RETURN);
 
-	B_tree_node *expr = get_expr();
+	B_tree_node *expr = get_expr(parser);
 
 	return CR_RETURN(NULL, expr);
 }
 
-B_tree_node *get_func_decl()
+B_tree_node *get_func_decl(Parser *parser)
 {
 	SYNTAX_CHECK(CUR_TYPE == DECLARE);
 
-	B_tree_node *func_name = get_id();
+	B_tree_node *func_name = get_id(parser);
 	CHECK_RET(func_name);
 
 	SYNTAX_CHECK(CUR_TYPE == OPEN_BR);
 
-	B_tree_node *arg = get_id();
+	B_tree_node *arg = get_id(parser);
 	CHECK_RET(arg);
 
 	B_tree_node *args = CR_COMMA(arg, NULL);
@@ -196,26 +265,26 @@ B_tree_node *get_func_decl()
 	{
 		SYNTAX_CHECK(CUR_TYPE == COMMA);
 
-		arg = get_id();
+		arg = get_id(parser);
 		cur_node->right = CR_COMMA(arg, NULL);
 
 		cur_node = cur_node->right;
 	}
-	id++;
+	parser->id++;
 
-	B_tree_node *body = get_scope();
+	B_tree_node *body = get_scope(parser);
 
 	return CR_FUNC_DECL(func_name->value, args, body);
 }
 
-B_tree_node *get_func(bool cmd_func = false)
+B_tree_node *get_func(Parser *parser, bool cmd_func = false)
 {
-	B_tree_node *func_name = get_id();
+	B_tree_node *func_name = get_id(parser);
 	CHECK_RET(func_name);
 
 	SYNTAX_CHECK(CUR_TYPE == OPEN_BR);
 
-	B_tree_node *expr = get_expr();
+	B_tree_node *expr = get_expr(parser);
 	CHECK_RET(expr);
 
 	B_tree_node *args = CR_COMMA(expr, NULL);
@@ -226,12 +295,12 @@ B_tree_node *get_func(bool cmd_func = false)
 	{
 		SYNTAX_CHECK(CUR_TYPE == COMMA);
 
-		expr = get_expr();
+		expr = get_expr(parser);
 		cur_node->right = CR_COMMA(expr, NULL);
 
 		cur_node = cur_node->right;
 	}
-	id++;
+	parser->id++;
 
 	if(cmd_func)
 	{
@@ -243,10 +312,10 @@ B_tree_node *get_func(bool cmd_func = false)
 	}
 }
 
-B_tree_node *get_std_func()
+B_tree_node *get_std_func(Parser *parser)
 {
 	Std_func func_type = CUR_STD_FUNC;
-	id++;
+	parser->id++;
 
 	SYNTAX_CHECK(CUR_TYPE == OPEN_BR);
 
@@ -258,7 +327,7 @@ B_tree_node *get_std_func()
 		{
 			PARSE_LOG("Getting brace var.\n");
 
-			child = get_id();
+			child = get_id(parser);
 			CHECK_RET(child);
 
 			break;
@@ -267,11 +336,23 @@ B_tree_node *get_std_func()
 		{
 			PARSE_LOG("Getting brace expression.\n");
 
-			child = get_expr();
+			child = get_expr(parser);
+			CHECK_RET(child);
+
+			break;
+		}
+		case FILLRAM:
+		case COPYRAM:
+		case CMPRAM:
+		{
+			PARSE_LOG("Getting three brace expressions.\n");
+
+			child = get_std_func_args(parser, STD_FUNC_RAM_ARGS_AMOUNT);
 			CHECK_RET(child);
 
 			break;
 		}
+		case READRAM:
 		default:
 		{
 			SYNTAX_ERROR;
@@ -286,118 +367,119 @@ B_tree_node *get_std_func()
 	return CR_STD_FUNC(func_type, NULL, child);
 }
 
-B_tree_node *get_cond(Node_type type)
+B_tree_node *get_std_func_args(Parser *parser, size_t args_amount)
+{
+	B_tree_node *expr = get_expr(parser);
+	CHECK_RET(expr);
+
+	B_tree_node *args = CR_COMMA(expr, NULL);
+
+	B_tree_node *cur_node = args;
+
+	for(size_t arg_id = 1; arg_id < args_amount; arg_id++)
+	{
+		SYNTAX_CHECK(CUR_TYPE == COMMA);
+
+		expr = get_expr(parser);
+		CHECK_RET(expr);
+
+		cur_node->right = CR_COMMA(expr, NULL);
+
+		cur_node = cur_node->right;
+	}
+
+	return args;
+}
+
+B_tree_node *get_cond(Parser *parser, Node_type type)
 {
 
 	SYNTAX_CHECK(CUR_TYPE == OPEN_BR);
 
 	PARSE_LOG("Getting brace expression.\n");
-	B_tree_node *br_expr = get_expr();
+	B_tree_node *br_expr = get_expr(parser);
 	CHECK_RET(br_expr);
 
 	SYNTAX_CHECK(CUR_TYPE == CLOSE_BR);
 
-	B_tree_node *scope = get_scope();
+	B_tree_node *scope = get_scope(parser);
 	CHECK_RET(scope);
 
 	return CR_COND(type, br_expr, scope);
 }
 
-B_tree_node *get_ass()
+B_tree_node *get_ass(Parser *parser)
 {
-	B_tree_node *var = get_id();
+	B_tree_node *var = get_id(parser);
 	CHECK_RET(var);
 
 	SYNTAX_CHECK(CUR_TYPE == OP && CUR_OP == ASS);
 
-	B_tree_node *expr = get_expr();
+	B_tree_node *expr = get_expr(parser);
 	CHECK_RET(expr);
 
 	return CR_ASS(var, expr);
 }
 
-B_tree_node *get_num()
+B_tree_node *get_num(Parser *parser)
 {
 	btr_elem_t val = CUR_NUM;
 
 	PARSE_LOG("It's num: %lf\n", val);
 
-	id++;
+	parser->id++;
 
 	return CR_NUM(val, NULL, NULL);
 }
 
-B_tree_node *get_expr()
+B_tree_node *get_expr(Parser *parser)
 {
 	PARSE_LOG("%s log:\n", __func__);
-	B_tree_node *val = get_mul();
-	CHECK_RET(val);
-
-	if(CUR_TYPE == OP)
-	{
-		while(	CUR_TYPE == OP &&
-				(	CUR_OP == ADD ||
-					CUR_OP == SUB	)	)
-		{
-			PARSE_LOG("It's ADD or SUB.\n");
-			Ops op = CUR_OP;
-
-			id++;
 
-			B_tree_node *val_2 = get_mul();
-			CHECK_RET(val_2);
-
-			val = CR_OP(op, val, val_2);
-		}
-	}
-	else if(	CUR_TYPE == ABOVE ||
-				CUR_TYPE == BELOW ||
-				CUR_TYPE == ABOVE_EQUAL ||
-				CUR_TYPE == BELOW_EQUAL ||
-				CUR_TYPE == EQUAL ||
-				CUR_TYPE == NOT_EQUAL	)
-	{
-		Node_type cond_type = CUR_TYPE;
-		id++;
-
-		B_tree_node *val_2 = get_mul();
-		CHECK_RET(val_2);
-
-		val = create_node(cond_type, {.num_value = 0}, val, val_2).arg.node;
-	}
-
-	return val;
+	return get_infix(parser, PREC_RELATION);
 }
 
-B_tree_node *get_mul()
+B_tree_node *get_infix(Parser *parser, Precedence min_prec)
 {
-	B_tree_node *val = get_pow();
+	B_tree_node *val = get_par(parser);
 	CHECK_RET(val);
 
-	while(	CUR_TYPE == OP &&
-			(	CUR_OP == MUL ||
-				CUR_OP == DIV	)	)
+	Precedence prec = PREC_NONE;
+
+	while((prec = infix_prec(cur_token(parser))) >= min_prec)
 	{
-		PARSE_LOG("It's MUL or DIV.\n");
-		Ops op = CUR_OP;
+		Node_type type = CUR_TYPE;
+		Ops       op   = CUR_OP;
+
+		PARSE_LOG("Infix operator of precedence %d.\n", prec);
 
-		id++;
+		parser->id++;
 
-		B_tree_node *val_2 = get_pow();
+		B_tree_node *val_2 = get_infix(parser, (Precedence)(prec + 1));
 		CHECK_RET(val_2);
 
-		val = CR_OP(op, val, val_2);
+		if(type == OP)
+		{
+			val = CR_OP(op, val, val_2);
+		}
+		else
+		{
+			val = create_node(type, {.num_value = 0}, val, val_2).arg.node;
+
+			// a relation is not chained, the next one is left to the caller
+			min_prec = PREC_ADD;
+		}
 	}
 
 	return val;
 }
 
-B_tree_node *get_par()
+B_tree_node *get_par(Parser *parser)
 {
 	if(CUR_TYPE == OPEN_BR)
 	{
-		id++;
-		B_tree_node *val = get_expr();
+		parser->id++;
+		B_tree_node *val = get_expr(parser);
 		CHECK_RET(val);
 
 		SYNTAX_CHECK(CUR_TYPE == CLOSE_BR);
@@ -406,35 +488,42 @@ B_tree_node *get_par()
 	}
 	else if(CUR_TYPE == NUM)
 	{
-		B_tree_node *val = get_num();
+		B_tree_node *val = get_num(parser);
 		CHECK_RET(val);
 
 		return val;
 	}
 	else if(CUR_TYPE == UNR_OP)
 	{
-		B_tree_node *val = get_unary();
+		B_tree_node *val = get_unary(parser);
 		CHECK_RET(val);
 
 		return val;
 	}
 	else if(CUR_TYPE == FUNC)
 	{
-		B_tree_node *val = get_func();
+		B_tree_node *val = get_func(parser);
+		CHECK_RET(val);
+
+		return val;
+	}
+	else if(CUR_TYPE == STD_FUNC && CUR_STD_FUNC == CMPRAM)
+	{
+		B_tree_node *val = get_std_func(parser);
 		CHECK_RET(val);
 
 		return val;
 	}
 	else
 	{
-		B_tree_node *val = get_id();
+		B_tree_node *val = get_id(parser);
 		CHECK_RET(val);
 
 		return val;
 	}
 }
 
-B_tree_node *get_unary()
+B_tree_node *get_unary(Parser *parser)
 {
 	PARSE_LOG("%s log:\n", __func__);
 
@@ -442,11 +531,11 @@ B_tree_node *get_unary()
 
 	PARSE_LOG("Unary opertaion: %d.\n", operation);
 
-	id++;
+	parser->id++;
 
 	SYNTAX_CHECK(CUR_TYPE == OPEN_BR);
 
-	B_tree_node *child = get_expr();
+	B_tree_node *child = get_expr(parser);
 	CHECK_RET(child);
 
 	SYNTAX_CHECK(CUR_TYPE == CLOSE_BR);
@@ -454,34 +543,16 @@ B_tree_node *get_unary()
 	return CR_UNR_OP(operation, NULL, child);
 }
 
-B_tree_node *get_id()
+B_tree_node *get_id(Parser *parser)
 {
 	PARSE_LOG("%s log:\n", __func__);
 
-	wchar_t *var_name = CUR_VAR;
+	Node_value var = {.var_value = CUR_VAR, .sym_ID = CUR_SYM_ID};
 
-	PARSE_LOG("Variable name: %ls.\n", var_name);
+	PARSE_LOG("Variable name: %ls.\n", var.var_value);
 
-	id++;
-	return CR_VAR(var_name, NULL, NULL);
-}
-
-B_tree_node *get_pow()
-{
-	B_tree_node *val = get_par();
-	CHECK_RET(val);
-
-	while(	(CUR_TYPE == OP) && (CUR_OP == POW)	)
-	{
-		id++;
-
-		B_tree_node *val_2 = get_par();
-		CHECK_RET(val_2);
-
-		val = CR_OP(POW, val, val_2);
-	}
-
-	return val;
+	parser->id++;
+	return CR_VAR(var, NULL, NULL);
 }
 
 B_tree_node *move_scope_end(B_tree_node *root)
@@ -498,19 +569,19 @@ B_tree_node *move_scope_end(B_tree_node *root)
 	return root;
 }
 
-size_t take_debt()
+size_t take_debt(Parser *parser)
 {
-	size_t scopes_sce_debt = sce_debt;
-	sce_debt = 0;
+	size_t scopes_sce_debt = parser->sce_debt;
+	parser->sce_debt = 0;
 
 	return scopes_sce_debt;
 }
 
-B_tree_node *get_all_scopes(bool manage_ccbrs, Node_type end_type)
+B_tree_node *get_all_scopes(Parser *parser, bool manage_ccbrs, Node_type end_type)
 {
 	PARSE_LOG("Getting scopes.\n");
 
-	B_tree_node *root = get_scope();
+	B_tree_node *root = get_scope(parser);
 	CHECK_RET(root);
 
 	B_tree_node *cur_node = root;
@@ -519,7 +590,7 @@ B_tree_node *get_all_scopes(bool manage_ccbrs, Node_type end_type)
 	{
 		B_tree_node *scope_end = move_scope_end(cur_node);
 
-		scope_end->right = get_scope();
+		scope_end->right = get_scope(parser);
 		CHECK_RET(scope_end->right);
 
 		cur_node = scope_end->right;
@@ -527,9 +598,9 @@ B_tree_node *get_all_scopes(bool manage_ccbrs, Node_type end_type)
 
 	if(manage_ccbrs)
 	{
-		sce_debt++;
+		parser->sce_debt++;
 		PARSE_LOG("CLOSE_CBR for scope ok.\n");
-		id++;
+		parser->id++;
 	}
 
 	return root;
@@ -3,20 +3,51 @@
 
 #include "recursive_parser.h"
 
+const size_t STD_FUNC_RAM_ARGS_AMOUNT = 3;
+
+/**
+ * @brief The binding power of the infix operators, the tighter the higher.
+ *
+ * The operators of one level are left-associative, the relations take one operand on each side.
+ */
+enum Precedence
+{
+	PREC_NONE     = 0,
+	PREC_RELATION = 1,
+	PREC_ADD      = 2,
+	PREC_MUL      = 3,
+	PREC_POW      = 4,
+};
+
+/**
+ * @brief The state of one parse, so several token arrays may be parsed at once.
+ *
+ * id is the current token, sce_debt the amount of the scope ends the next command has to close.
+ */
+struct Parser
+{
+	Tokens *tokens;
+	size_t  id;
+	size_t  sce_debt;
+};
+
 #define CUR_TYPE\
-	tokens->data[id].type
+	cur_token(parser)->type
 
 #define CUR_OP\
-	tokens->data[id].value.op_value
+	cur_token(parser)->value.op_value
 
 #define CUR_NUM\
-	tokens->data[id].value.num_value
+	cur_token(parser)->value.num_value
 
 #define CUR_VAR\
-	tokens->data[id].value.var_value
+	cur_token(parser)->value.var_value
+
+#define CUR_SYM_ID\
+	cur_token(parser)->sym_ID
 
 #define CUR_STD_FUNC\
-	tokens->data[id].value.func
+	cur_token(parser)->value.func
 
 #define CR_SEMICOLON(left_child, right_child)\
 	create_node(SEMICOLON, {.num_value = 0}, left_child, right_child).arg.node;
@@ -64,7 +95,7 @@
 	create_node(FUNC, val, left_child, right_child).arg.node;
 
 #define CR_VAR(val, left_child, right_child)\
-	create_node(VAR, {.var_value = val}, left_child, right_child).arg.node;
+	create_node(VAR, val, left_child, right_child).arg.node;
 
 #define CR_SCOPE_START(left_child, right_child)\
 	create_node(SCOPE_START, {.num_value = 0}, left_child, right_child).arg.node;
@@ -77,10 +108,11 @@
 	else																	\
 	{																		\
 		PARSE_LOG(#cond" - OK.\n");											\
-		id++;																\
+		parser->id++;														\
 	}
 
 #define REPORT_ERROR(...)							\
+	note_error(parser);								\
 	PARSE_LOG(__VA_ARGS__);							\
 	PARSE_LOG("%s returning NULL\n", __func__);		\
 	return NULL;
@@ -95,7 +127,7 @@
 	}												\
 
 #define PARSE_LOG(...)\
-	rec_write_log("parse_log.txt", __VA_ARGS__);
+	LOG_AT(LOG_LEVEL_DEBUG, LOG_SINK_PARSER, __VA_ARGS__);
 
 #define PAY_CMD_DEBT;												\
 	if(cmds_sce_debt)												\
@@ -109,47 +141,56 @@
 		return CR_SEMICOLON(cmd, NULL);								\
 	}
 
-void         rec_write_log  (const char *file_name, const char *fmt, ...);
+B_tree_node *get_general    (Parser *parser);
 
-B_tree_node *get_general    (Tokens *passed_tokens);
+/**
+ * @brief Keeps the offset of the current token as the place of the error, unless one is kept already.
+ */
+void         note_error     (Parser *parser);
 
-B_tree_node *get_cmd        ();
+B_tree_node *get_cmd        (Parser *parser);
 
-B_tree_node *get_std_func   ();
+B_tree_node *get_std_func   (Parser *parser);
 
-B_tree_node *get_cond       (Node_type type);
+B_tree_node *get_std_func_args(Parser *parser, size_t args_amount);
 
-B_tree_node *get_ass        ();
+B_tree_node *get_cond       (Parser *parser, Node_type type);
 
-B_tree_node *get_num        ();
+B_tree_node *get_ass        (Parser *parser);
 
-B_tree_node *get_expr        ();
+B_tree_node *get_num        (Parser *parser);
 
-B_tree_node *get_mul        ();
+B_tree_node *get_expr       (Parser *parser);
 
-B_tree_node *get_par        ();
+/**
+ * @brief Parses the operands joined by the infix operators of at least min_prec by precedence climbing.
+ *
+ * One loop takes the operators of every level, and an operand recurses only into the tighter
+ * levels, so an expression costs a call per operand instead of a call per level.
+ */
+B_tree_node *get_infix      (Parser *parser, Precedence min_prec);
 
-B_tree_node *get_id         ();
+B_tree_node *get_par        (Parser *parser);
 
-B_tree_node *get_pow        ();
+B_tree_node *get_id         (Parser *parser);
 
-B_tree_node *get_scope      ();
+B_tree_node *get_scope      (Parser *parser);
 
-B_tree_node *get_unary      ();
+B_tree_node *get_unary      (Parser *parser);
 
-B_tree_node *get_func       (bool cmd_func);
+B_tree_node *get_func       (Parser *parser, bool cmd_func);
 
-B_tree_node *get_func_decl  ();
+B_tree_node *get_func_decl  (Parser *parser);
 
-B_tree_node *get_return     ();
+B_tree_node *get_return     (Parser *parser);
 
-B_tree_node *get_main       ();
+B_tree_node *get_main       (Parser *parser);
 
 B_tree_node *move_scope_end (B_tree_node *root);
 
-size_t       take_debt      ();
+size_t       take_debt      (Parser *parser);
 
-B_tree_node *get_all_scopes (bool manage_ccbrs, Node_type end_type);
+B_tree_node *get_all_scopes (Parser *parser, bool manage_ccbrs, Node_type end_type);
 
 B_tree_node *manage_scopes  (B_tree_node *root);
 
@@ -1,6 +1,11 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
 #define LEN(str)\
 	sizeof(str) / sizeof(char) - 1
 
@@ -58,17 +63,110 @@
 													\
 	fclose(file_ptr);
 
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+/**
+ * @def LOG_MIN_LEVEL
+ * @brief The lowest level which is logged, -D LOG_MIN_LEVEL=LOG_LEVEL_DEBUG brings every trace back.
+ *
+ * A call below it is a constant false condition, so its arguments are never evaluated
+ * and the compiler drops it.
+ */
+#ifndef LOG_MIN_LEVEL
+	#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+/**
+ * @brief Writes into the sink if the level is not below LOG_MIN_LEVEL.
+ */
+#define LOG_AT(level, sink, ...)				\
+	do											\
+	{											\
+		if((level) >= LOG_MIN_LEVEL)			\
+		{										\
+			log_write(sink, __VA_ARGS__);		\
+		}										\
+	} while(0)
+
+/**
+ * @brief LOG_AT() of a wide format string.
+ */
+#define WLOG_AT(level, sink, ...)				\
+	do											\
+	{											\
+		if((level) >= LOG_MIN_LEVEL)			\
+		{										\
+			log_wwrite(sink, __VA_ARGS__);		\
+		}										\
+	} while(0)
+
 const size_t MAX_TOKEN_SIZE              = 256;
-static size_t  GLOBAL_CYCLE_COUNTER      = 0; /**< Global counter for loop iterations. */
+static thread_local size_t GLOBAL_CYCLE_COUNTER = 0; /**< Loop iterations of the thread. */
 const  size_t  CYCLE_LIMIT               = 10000; /**< Limit for loop iterations. */
 
 
 const unsigned char ADDITIONAL_CONCATENATION_SPACE = 2;
 
+/**
+ * @brief The log files, every thread writes its own copy of each through a buffer.
+ *
+ * The first thread to log writes into the file of the sink, the next ones add their number to its name.
+ */
+enum Log_sink
+{
+	LOG_SINK_FRONTEND = 0,
+	LOG_SINK_PARSER   = 1,
+	LOG_SINK_MIDEND   = 2,
+	LOG_SINK_BACKEND  = 3,
+	LOG_SINK_CACHE    = 4,
+	LOG_SINK_ASM      = 5,
+	LOG_SINK_SPU      = 6,
+
+	LOG_SINKS_AMOUNT,
+};
+
+const size_t LOG_BUF_SIZE = 1 << 16;
+
+const uint64_t HASH_OFFSET_BASIS = 14695981039346656037ULL; /**< FNV-1a hash of no bytes. */
+const uint64_t HASH_PRIME        = 1099511628211ULL;
+
+void   log_write       (Log_sink sink, const char *fmt, ...);
+
+void   log_vwrite      (Log_sink sink, const char *fmt, va_list args);
+
+/**
+ * @brief log_write() of a wide format string, a sink must get only the narrow or only the wide ones.
+ */
+void   log_wwrite      (Log_sink sink, const wchar_t *fmt, ...);
+
 char * create_file_name(const char *name, const char *postfix);
 
 int    cmp_double      (double first_double, double second_double);
 
 size_t max_len         (size_t len_1, size_t len_2);
 
+/**
+ * @brief Adds size bytes to an FNV-1a hash, which starts from HASH_OFFSET_BASIS.
+ *
+ * Pieces added one by one hash as the bytes added at once.
+ */
+uint64_t hash_bytes    (uint64_t hash, const void *buf, size_t size);
+
+/**
+ * @brief Maps the file read-only, or reads it into memory where there is no mmap.
+ *
+ * @param size Gets the size of the file.
+ * @return char* The contents, NULL if the file is empty or can't be opened.
+ */
+char  *map_file        (const char *file_name, size_t *size);
+
+/**
+ * @brief Releases the contents given by map_file().
+ */
+void   unmap_file      (void *mapping, size_t size);
+
 #endif
@@ -5,6 +5,19 @@
 
 #include "utils.h"
 
+/**
+ * @def UTILS_MMAP
+ * @brief Maps the files with POSIX mmap; otherwise they are read.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+	#define UTILS_MMAP
+
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 char *create_file_name(const char *name, const char *postfix)
 {
 	size_t byte_code_file_name_size =
@@ -55,3 +68,82 @@ size_t max_len(size_t len_1, size_t len_2)
 		return len_2;
 	}
 }
+
+uint64_t hash_bytes(uint64_t hash, const void *buf, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)buf;
+
+	for(size_t byte_ID = 0; byte_ID < size; byte_ID++)
+	{
+		hash ^= bytes[byte_ID];
+		hash *= HASH_PRIME;
+	}
+
+	return hash;
+}
+
+char *map_file(const char *file_name, size_t *size)
+{
+#ifdef UTILS_MMAP
+	int file = open(file_name, O_RDONLY);
+	if(file < 0)
+	{
+		return NULL;
+	}
+
+	struct stat file_stat = {};
+	if(fstat(file, &file_stat) != 0 || file_stat.st_size <= 0)
+	{
+		close(file);
+
+		return NULL;
+	}
+
+	*size = (size_t)file_stat.st_size;
+
+	void *mapping = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	return mapping == MAP_FAILED ? NULL : (char *)mapping;
+#else
+	FILE *file = fopen(file_name, "rb");
+	if(file == NULL)
+	{
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if(length <= 0)
+	{
+		fclose(file);
+
+		return NULL;
+	}
+
+	*size = (size_t)length;
+
+	char *buf = (char *)calloc(*size + 1, sizeof(char));
+	if(buf != NULL && fread(buf, sizeof(char), *size, file) != *size)
+	{
+		free(buf);
+		buf = NULL;
+	}
+
+	fclose(file);
+
+	return buf;
+#endif
+}
+
+void unmap_file(void *mapping, size_t size)
+{
+#ifdef UTILS_MMAP
+	munmap(mapping, size);
+#else
+	(void)size;
+	free(mapping);
+#endif
+}
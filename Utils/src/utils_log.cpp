@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <wchar.h>
+#include <atomic>
+
+#include "utils.h"
+
+static const char * const LOG_FILE_NAMES[LOG_SINKS_AMOUNT] =
+{
+	"frontend_log",
+	"parse_log.txt",
+	"midend_log",
+	"backend_log",
+	"cache_log.txt",
+	"asm_log.txt",
+	"SPU_log.txt",
+};
+
+const size_t LOG_FILE_NAME_SIZE = 128;
+
+static std::atomic<size_t> LOG_THREADS(0);
+
+/**
+ * @brief The log files of one thread, closed with their buffers flushed when it ends.
+ */
+struct Log_files
+{
+	FILE   *files[LOG_SINKS_AMOUNT];
+	bool    failed[LOG_SINKS_AMOUNT];
+	size_t  thread_ID;
+	bool    has_ID;
+
+	~Log_files()
+	{
+		for(size_t sink_ID = 0; sink_ID < LOG_SINKS_AMOUNT; sink_ID++)
+		{
+			if(files[sink_ID] != NULL)
+			{
+				fclose(files[sink_ID]);
+			}
+		}
+	}
+};
+
+static thread_local Log_files THREAD_LOGS = {};
+
+static FILE *get_log_file(Log_sink sink)
+{
+	Log_files *logs = &THREAD_LOGS;
+
+	if(logs->files[sink] != NULL || logs->failed[sink])
+	{
+		return logs->files[sink];
+	}
+
+	if(!logs->has_ID)
+	{
+		logs->thread_ID = LOG_THREADS++;
+		logs->has_ID    = true;
+	}
+
+	char file_name[LOG_FILE_NAME_SIZE] = {};
+
+	if(logs->thread_ID == 0)
+	{
+		snprintf(file_name, LOG_FILE_NAME_SIZE, "%s", LOG_FILE_NAMES[sink]);
+	}
+	else
+	{
+		snprintf(file_name, LOG_FILE_NAME_SIZE, "%s.%lu", LOG_FILE_NAMES[sink], logs->thread_ID);
+	}
+
+	FILE *log_file = fopen(file_name, "w");
+
+	if(log_file == NULL)
+	{
+		perror("Error opening log_file");
+		logs->failed[sink] = true;
+
+		return NULL;
+	}
+
+	setvbuf(log_file, NULL, _IOFBF, LOG_BUF_SIZE);
+
+	logs->files[sink] = log_file;
+
+	return log_file;
+}
+
+void log_vwrite(Log_sink sink, const char *fmt, va_list args)
+{
+	FILE *log_file = get_log_file(sink);
+
+	if(log_file == NULL)
+	{
+		return;
+	}
+
+	vfprintf(log_file, fmt, args);
+}
+
+void log_write(Log_sink sink, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+
+	log_vwrite(sink, fmt, args);
+
+	va_end(args);
+}
+
+void log_wwrite(Log_sink sink, const wchar_t *fmt, ...)
+{
+	FILE *log_file = get_log_file(sink);
+
+	if(log_file == NULL)
+	{
+		return;
+	}
+
+	va_list args;
+
+	va_start(args, fmt);
+
+	vfwprintf(log_file, fmt, args);
+
+	va_end(args);
+}